@@ -0,0 +1,110 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "os/mynewt.h"
+#include "console/console.h"
+#include "osbench.h"
+
+/*
+ * Runs a set of kernel micro-benchmarks and prints the results to the
+ * console.  Timing is done with os_cputime, so results on the native BSP are
+ * only meaningful relative to each other (e.g. with and without a syscfg
+ * setting enabled).
+ */
+
+static struct os_task osbench_task;
+OS_TASK_STACK_DEFINE(osbench_stack, OSBENCH_STACK_SIZE);
+
+void
+osbench_result_init(struct osbench_result *res, const char *name)
+{
+    memset(res, 0, sizeof *res);
+    res->name = name;
+    res->min = UINT32_MAX;
+}
+
+void
+osbench_result_add(struct osbench_result *res, uint32_t ticks)
+{
+    if (ticks < res->min) {
+        res->min = ticks;
+    }
+    if (ticks > res->max) {
+        res->max = ticks;
+    }
+    res->total += ticks;
+    res->cnt++;
+}
+
+void
+osbench_result_print(const struct osbench_result *res)
+{
+    uint32_t avg;
+
+    if (res->cnt == 0) {
+        console_printf("%-32s: no samples\n", res->name);
+        return;
+    }
+
+    avg = res->total / res->cnt;
+    console_printf("%-32s: n=%lu min=%luns avg=%luns max=%luns\n",
+                   res->name, (unsigned long)res->cnt,
+                   (unsigned long)os_cputime_ticks_to_nsecs(res->min),
+                   (unsigned long)os_cputime_ticks_to_nsecs(avg),
+                   (unsigned long)os_cputime_ticks_to_nsecs(res->max));
+}
+
+static void
+osbench_task_handler(void *arg)
+{
+    console_printf("osbench: %d iterations\n", OSBENCH_ITERATIONS);
+
+    osbench_sched();
+    osbench_callout();
+    osbench_mempool();
+    osbench_eventq();
+    osbench_heap();
+    osbench_dev();
+
+    console_printf("osbench: done\n");
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    int rc;
+
+    sysinit();
+
+    rc = os_task_init(&osbench_task, "osbench", osbench_task_handler, NULL,
+                      OSBENCH_TASK_PRIO, OS_WAIT_FOREVER, osbench_stack,
+                      OSBENCH_STACK_SIZE);
+    assert(rc == 0);
+
+    while (1) {
+        os_eventq_run(os_eventq_dflt_get());
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef H_OSBENCH_
+#define H_OSBENCH_
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OSBENCH_ITERATIONS      MYNEWT_VAL(OSBENCH_ITERATIONS)
+
+#define OSBENCH_STACK_SIZE      OS_STACK_ALIGN(256)
+
+/** Priority of the task which runs the benchmarks. */
+#define OSBENCH_TASK_PRIO       (MYNEWT_VAL(OS_MAIN_TASK_PRIO) + 1)
+
+/**
+ * Accumulated timing of one measured operation, in os_cputime ticks.
+ */
+struct osbench_result {
+    const char *name;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t cnt;
+};
+
+void osbench_result_init(struct osbench_result *res, const char *name);
+void osbench_result_add(struct osbench_result *res, uint32_t ticks);
+void osbench_result_print(const struct osbench_result *res);
+
+void osbench_sched(void);
+void osbench_callout(void);
+void osbench_mempool(void);
+void osbench_eventq(void);
+void osbench_heap(void);
+void osbench_dev(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <assert.h>
+#include "os/mynewt.h"
+#include "console/console.h"
+#include "osbench.h"
+
+/*
+ * Callout benchmarks.
+ *
+ * OSBENCH_CALLOUTS callouts are armed with timeouts spread over a few seconds,
+ * then the cost of resetting one more callout to a short and to a long
+ * timeout, and of stopping it, is measured.  With the sorted callout list a
+ * long timeout has to be inserted behind every other pending callout.
+ *
+ * The wakeup benchmark measures os_callout_wakeup_ticks(), which the idle
+ * task calls with interrupts disabled, right after the earliest pending
+ * callout has been removed, i.e. the path taken after every callout fires.
+ */
+
+#define OSBENCH_CALLOUTS        MYNEWT_VAL(OSBENCH_CALLOUTS)
+
+static struct os_callout osbench_callouts[OSBENCH_CALLOUTS];
+static struct os_callout osbench_timed_callout;
+
+static void
+osbench_callout_cb(struct os_event *ev)
+{
+}
+
+static void
+osbench_callout_reset(os_time_t ticks, const char *name)
+{
+    struct osbench_result res;
+    uint32_t start;
+    os_sr_t sr;
+    int i;
+
+    osbench_result_init(&res, name);
+
+    for (i = 0; i < OSBENCH_ITERATIONS; i++) {
+        OS_ENTER_CRITICAL(sr);
+        start = os_cputime_get32();
+        os_callout_reset(&osbench_timed_callout, ticks);
+        osbench_result_add(&res, os_cputime_get32() - start);
+        os_callout_stop(&osbench_timed_callout);
+        OS_EXIT_CRITICAL(sr);
+    }
+
+    osbench_result_print(&res);
+}
+
+static void
+osbench_callout_stop(void)
+{
+    struct osbench_result res;
+    uint32_t start;
+    os_sr_t sr;
+    int i;
+
+    osbench_result_init(&res, "callout stop");
+
+    for (i = 0; i < OSBENCH_ITERATIONS; i++) {
+        OS_ENTER_CRITICAL(sr);
+        os_callout_reset(&osbench_timed_callout, 5 * OS_TICKS_PER_SEC);
+        start = os_cputime_get32();
+        os_callout_stop(&osbench_timed_callout);
+        osbench_result_add(&res, os_cputime_get32() - start);
+        OS_EXIT_CRITICAL(sr);
+    }
+
+    osbench_result_print(&res);
+}
+
+static void
+osbench_callout_wakeup(void)
+{
+    struct osbench_result res;
+    uint32_t start;
+    os_sr_t sr;
+    int i;
+
+    osbench_result_init(&res, "callout wakeup ticks");
+
+    for (i = 0; i < OSBENCH_ITERATIONS; i++) {
+        OS_ENTER_CRITICAL(sr);
+        os_callout_reset(&osbench_timed_callout, 1);
+        os_callout_wakeup_ticks(os_time_get());
+        os_callout_stop(&osbench_timed_callout);
+        start = os_cputime_get32();
+        os_callout_wakeup_ticks(os_time_get());
+        osbench_result_add(&res, os_cputime_get32() - start);
+        OS_EXIT_CRITICAL(sr);
+    }
+
+    osbench_result_print(&res);
+}
+
+void
+osbench_callout(void)
+{
+    uint32_t seed;
+    int rc;
+    int i;
+
+    console_printf("callout: %s, %d pending callouts\n",
+                   MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS) ? "timing wheel" :
+                                                        "sorted list",
+                   OSBENCH_CALLOUTS);
+
+    /* Spread the pending callouts over 1 to 3 seconds. */
+    seed = 1;
+    for (i = 0; i < OSBENCH_CALLOUTS; i++) {
+        seed = seed * 1103515245 + 12345;
+        os_callout_init(&osbench_callouts[i], os_eventq_dflt_get(),
+                        osbench_callout_cb, NULL);
+        rc = os_callout_reset(&osbench_callouts[i],
+                              OS_TICKS_PER_SEC +
+                              (seed >> 16) % (2 * OS_TICKS_PER_SEC));
+        assert(rc == 0);
+    }
+
+    os_callout_init(&osbench_timed_callout, os_eventq_dflt_get(),
+                    osbench_callout_cb, NULL);
+
+    osbench_callout_reset(1, "callout reset (1 tick)");
+    osbench_callout_reset(5 * OS_TICKS_PER_SEC, "callout reset (5 s)");
+    osbench_callout_stop();
+    osbench_callout_wakeup();
+
+    for (i = 0; i < OSBENCH_CALLOUTS; i++) {
+        os_callout_stop(&osbench_callouts[i]);
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <assert.h>
+#include <stdio.h>
+#include "os/mynewt.h"
+#include "console/console.h"
+#include "osbench.h"
+
+/*
+ * Device registry benchmark.
+ *
+ * Registers up to OSBENCH_DEV_COUNT dummy devices, doubling the count from 8,
+ * and at each step times os_dev_open() by name and os_dev_open_handle() over
+ * every registered device.  Compare runs with OS_DEV_HASH_BUCKETS set to 0
+ * and to a non-zero value to see the cost of the linear name search.
+ */
+
+#define OSBENCH_DEV_COUNT       MYNEWT_VAL(OSBENCH_DEV_COUNT)
+
+static struct os_dev osbench_devs[OSBENCH_DEV_COUNT];
+static char osbench_dev_names[OSBENCH_DEV_COUNT][12];
+
+static int
+osbench_dev_init(struct os_dev *dev, void *arg)
+{
+    return 0;
+}
+
+static void
+osbench_dev_measure(int num_devs)
+{
+    struct osbench_result name_res;
+    struct osbench_result handle_res;
+    struct os_dev *dev;
+    char name_title[32];
+    char handle_title[32];
+    uint32_t start;
+    uint32_t ticks;
+    int iters;
+    int i;
+
+    snprintf(name_title, sizeof name_title, "os_dev_open (%d devs)", num_devs);
+    snprintf(handle_title, sizeof handle_title, "os_dev_open_handle (%d devs)",
+             num_devs);
+    osbench_result_init(&name_res, name_title);
+    osbench_result_init(&handle_res, handle_title);
+
+    for (iters = 0; iters < OSBENCH_ITERATIONS / num_devs; iters++) {
+        for (i = 0; i < num_devs; i++) {
+            start = os_cputime_get32();
+            dev = os_dev_open(osbench_dev_names[i], 0, NULL);
+            ticks = os_cputime_get32() - start;
+            assert(dev == &osbench_devs[i]);
+            osbench_result_add(&name_res, ticks);
+            os_dev_close(dev);
+
+            start = os_cputime_get32();
+            dev = os_dev_open_handle(&osbench_devs[i], 0, NULL);
+            ticks = os_cputime_get32() - start;
+            assert(dev == &osbench_devs[i]);
+            osbench_result_add(&handle_res, ticks);
+            os_dev_close(dev);
+        }
+    }
+
+    osbench_result_print(&name_res);
+    osbench_result_print(&handle_res);
+}
+
+void
+osbench_dev(void)
+{
+    int num_devs;
+    int rc;
+    int i;
+
+    num_devs = 0;
+    for (i = 8; ; i *= 2) {
+        if (i > OSBENCH_DEV_COUNT) {
+            i = OSBENCH_DEV_COUNT;
+        }
+
+        for (; num_devs < i; num_devs++) {
+            snprintf(osbench_dev_names[num_devs],
+                     sizeof osbench_dev_names[num_devs], "osbench%d",
+                     num_devs);
+            rc = os_dev_create(&osbench_devs[num_devs],
+                               osbench_dev_names[num_devs],
+                               OS_DEV_INIT_KERNEL, OS_DEV_INIT_PRIO_DEFAULT,
+                               osbench_dev_init, NULL);
+            assert(rc == 0);
+        }
+
+        osbench_dev_measure(num_devs);
+
+        if (num_devs == OSBENCH_DEV_COUNT) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <assert.h>
+#include "os/mynewt.h"
+#include "console/console.h"
+#include "osbench.h"
+
+/*
+ * Event queue benchmarks.
+ *
+ * OSBENCH_EVENTQ_EVENTS events are queued on a private event queue and then
+ * drained, once with os_eventq_run() and once with os_eventq_run_batch(); the
+ * reported time is per dispatched event.  The head-of-line test queues the
+ * same number of bulk events (each doing OSBENCH_EVENTQ_WORK_USECS of work)
+ * followed by one urgent event and measures how long the urgent event waits.
+ * With OS_EVENTQ_PRIOS > 1 the urgent event overtakes the bulk ones.
+ */
+
+#define OSBENCH_EVENTQ_EVENTS       MYNEWT_VAL(OSBENCH_EVENTQ_EVENTS)
+#define OSBENCH_EVENTQ_WORK_USECS   MYNEWT_VAL(OSBENCH_EVENTQ_WORK_USECS)
+
+static struct os_eventq osbench_evq;
+static struct os_event osbench_events[OSBENCH_EVENTQ_EVENTS];
+static struct os_event osbench_urgent_ev;
+static uint32_t osbench_urgent_start;
+static struct osbench_result osbench_hol_res;
+
+static void
+osbench_eventq_nop_cb(struct os_event *ev)
+{
+}
+
+static void
+osbench_eventq_bulk_cb(struct os_event *ev)
+{
+    os_cputime_delay_usecs(OSBENCH_EVENTQ_WORK_USECS);
+}
+
+static void
+osbench_eventq_urgent_cb(struct os_event *ev)
+{
+    osbench_result_add(&osbench_hol_res,
+                       os_cputime_get32() - osbench_urgent_start);
+}
+
+static void
+osbench_eventq_fill(os_event_fn *cb, uint8_t prio)
+{
+    int i;
+
+    for (i = 0; i < OSBENCH_EVENTQ_EVENTS; i++) {
+        osbench_events[i].ev_cb = cb;
+        osbench_events[i].ev_prio = prio;
+        os_eventq_put(&osbench_evq, &osbench_events[i]);
+    }
+}
+
+static void
+osbench_eventq_drain(int batch, const char *name)
+{
+    struct osbench_result res;
+    uint32_t start;
+    int rounds;
+    int cnt;
+    int i;
+
+    osbench_result_init(&res, name);
+
+    rounds = OSBENCH_ITERATIONS / OSBENCH_EVENTQ_EVENTS;
+    for (i = 0; i < rounds; i++) {
+        osbench_eventq_fill(osbench_eventq_nop_cb, 0);
+
+        start = os_cputime_get32();
+        if (batch) {
+            cnt = os_eventq_run_batch(&osbench_evq, OSBENCH_EVENTQ_EVENTS);
+            assert(cnt == OSBENCH_EVENTQ_EVENTS);
+        } else {
+            for (cnt = 0; cnt < OSBENCH_EVENTQ_EVENTS; cnt++) {
+                os_eventq_run(&osbench_evq);
+            }
+        }
+        osbench_result_add(&res, (os_cputime_get32() - start) /
+                                 OSBENCH_EVENTQ_EVENTS);
+    }
+
+    osbench_result_print(&res);
+}
+
+static void
+osbench_eventq_hol(void)
+{
+    int rounds;
+    int cnt;
+    int i;
+
+    osbench_result_init(&osbench_hol_res, "eventq urgent behind bulk");
+    osbench_urgent_ev.ev_cb = osbench_eventq_urgent_cb;
+    osbench_urgent_ev.ev_prio = 0;
+
+    rounds = OSBENCH_ITERATIONS / OSBENCH_EVENTQ_EVENTS;
+    for (i = 0; i < rounds; i++) {
+        osbench_eventq_fill(osbench_eventq_bulk_cb, UINT8_MAX);
+
+        osbench_urgent_start = os_cputime_get32();
+        os_eventq_put(&osbench_evq, &osbench_urgent_ev);
+
+        cnt = 0;
+        while (cnt < OSBENCH_EVENTQ_EVENTS + 1) {
+            cnt += os_eventq_run_batch(&osbench_evq,
+                                       OSBENCH_EVENTQ_EVENTS + 1 - cnt);
+        }
+    }
+
+    osbench_result_print(&osbench_hol_res);
+}
+
+void
+osbench_eventq(void)
+{
+    os_eventq_init(&osbench_evq);
+
+    osbench_eventq_drain(0, "eventq run (per event)");
+    osbench_eventq_drain(1, "eventq run_batch (per event)");
+    osbench_eventq_hol();
+}
@@ -0,0 +1,135 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <assert.h>
+#include <string.h>
+#include "os/mynewt.h"
+#include "console/console.h"
+#include "osbench.h"
+
+/*
+ * Heap benchmark.
+ *
+ * Runs OSBENCH_HEAP_ITERATIONS random operations over OSBENCH_HEAP_SLOTS
+ * allocation slots: an empty slot gets a block of random size (mostly small,
+ * occasionally up to OSBENCH_HEAP_MAX_SIZE), a full slot is freed.  The
+ * latency of os_malloc() and os_free() is reported, plus the peak footprint
+ * and final fragmentation when the heap backend keeps statistics (TLSF).
+ */
+
+#define OSBENCH_HEAP_ITERATIONS     MYNEWT_VAL(OSBENCH_HEAP_ITERATIONS)
+#define OSBENCH_HEAP_SLOTS          MYNEWT_VAL(OSBENCH_HEAP_SLOTS)
+#define OSBENCH_HEAP_MAX_SIZE       MYNEWT_VAL(OSBENCH_HEAP_MAX_SIZE)
+
+static void *osbench_heap_slots[OSBENCH_HEAP_SLOTS];
+static uint32_t osbench_heap_seed = 1;
+
+static uint32_t
+osbench_heap_rand(void)
+{
+    /* xorshift32; deterministic so runs are comparable. */
+    osbench_heap_seed ^= osbench_heap_seed << 13;
+    osbench_heap_seed ^= osbench_heap_seed >> 17;
+    osbench_heap_seed ^= osbench_heap_seed << 5;
+
+    return osbench_heap_seed;
+}
+
+static size_t
+osbench_heap_size(void)
+{
+    uint32_t r;
+
+    r = osbench_heap_rand();
+    if ((r & 0xf) == 0) {
+        return 1 + (r >> 4) % OSBENCH_HEAP_MAX_SIZE;
+    } else {
+        return 1 + (r >> 4) % 64;
+    }
+}
+
+static void
+osbench_heap_info_print(void)
+{
+    struct os_heap_info info;
+    int rc;
+
+    rc = os_heap_info_get(&info);
+    if (rc != 0) {
+        console_printf("%-32s: no heap statistics\n", "heap footprint");
+        return;
+    }
+
+    console_printf("%-32s: total=%lu max_used=%lu free=%lu largest=%lu "
+                   "fails=%lu\n", "heap footprint",
+                   (unsigned long)info.ohi_total,
+                   (unsigned long)info.ohi_max_used,
+                   (unsigned long)info.ohi_free,
+                   (unsigned long)info.ohi_largest_free,
+                   (unsigned long)info.ohi_fail_cnt);
+}
+
+void
+osbench_heap(void)
+{
+    struct osbench_result malloc_res;
+    struct osbench_result free_res;
+    uint32_t start;
+    uint32_t ticks;
+    size_t size;
+    void *ptr;
+    int slot;
+    int i;
+
+    osbench_result_init(&malloc_res, "os_malloc");
+    osbench_result_init(&free_res, "os_free");
+
+    for (i = 0; i < OSBENCH_HEAP_ITERATIONS; i++) {
+        slot = osbench_heap_rand() % OSBENCH_HEAP_SLOTS;
+        if (osbench_heap_slots[slot] == NULL) {
+            size = osbench_heap_size();
+
+            start = os_cputime_get32();
+            ptr = os_malloc(size);
+            ticks = os_cputime_get32() - start;
+
+            if (ptr != NULL) {
+                memset(ptr, 0xa5, size);
+                osbench_result_add(&malloc_res, ticks);
+            }
+            osbench_heap_slots[slot] = ptr;
+        } else {
+            start = os_cputime_get32();
+            os_free(osbench_heap_slots[slot]);
+            osbench_result_add(&free_res, os_cputime_get32() - start);
+
+            osbench_heap_slots[slot] = NULL;
+        }
+    }
+
+    osbench_result_print(&malloc_res);
+    osbench_result_print(&free_res);
+    osbench_heap_info_print();
+
+    for (i = 0; i < OSBENCH_HEAP_SLOTS; i++) {
+        os_free(osbench_heap_slots[i]);
+        osbench_heap_slots[i] = NULL;
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <assert.h>
+#include "os/mynewt.h"
+#include "console/console.h"
+#include "osbench.h"
+
+/*
+ * Memory pool benchmarks.
+ *
+ * Measures the cost of an os_memblock_get()/os_memblock_put() pair, then runs
+ * the same pair in a tight loop while a cputime timer periodically fires and
+ * allocates from the same pool in interrupt context.  The delay between the
+ * programmed expiry and the timer callback running is reported as interrupt
+ * latency.  Without OS_MEMPOOL_LOCKFREE the loop masks interrupts for every
+ * get and put, which bounds the worst case; with it, nothing is masked, so
+ * build the app both ways to compare.
+ */
+
+#define OSBENCH_MEMPOOL_BLOCKS      (8)
+#define OSBENCH_MEMPOOL_BLOCK_SIZE  (32)
+#define OSBENCH_MEMPOOL_TIMER_USECS MYNEWT_VAL(OSBENCH_MEMPOOL_TIMER_USECS)
+
+#if MYNEWT_VAL(OS_MEMPOOL_LOCKFREE)
+#define OSBENCH_MEMPOOL_MODE        "lock-free"
+#else
+#define OSBENCH_MEMPOOL_MODE        "locked"
+#endif
+
+static struct os_mempool osbench_pool;
+static os_membuf_t osbench_pool_buf[
+    OS_MEMPOOL_SIZE(OSBENCH_MEMPOOL_BLOCKS, OSBENCH_MEMPOOL_BLOCK_SIZE)];
+
+static struct hal_timer osbench_mempool_timer;
+static struct osbench_result osbench_mempool_irq_res;
+static uint32_t osbench_mempool_irq_expiry;
+
+static void
+osbench_mempool_timer_cb(void *arg)
+{
+    void *block;
+
+    osbench_result_add(&osbench_mempool_irq_res,
+                       os_cputime_get32() - osbench_mempool_irq_expiry);
+
+    block = os_memblock_get(&osbench_pool);
+    if (block != NULL) {
+        os_memblock_put(&osbench_pool, block);
+    }
+
+    if (osbench_mempool_irq_res.cnt < OSBENCH_ITERATIONS) {
+        osbench_mempool_irq_expiry +=
+            os_cputime_usecs_to_ticks(OSBENCH_MEMPOOL_TIMER_USECS);
+        os_cputime_timer_start(&osbench_mempool_timer,
+                               osbench_mempool_irq_expiry);
+    }
+}
+
+static void
+osbench_mempool_get_put(void)
+{
+    struct osbench_result res;
+    uint32_t start;
+    void *block;
+    int i;
+
+    osbench_result_init(&res, "mempool get+put " OSBENCH_MEMPOOL_MODE);
+
+    for (i = 0; i < OSBENCH_ITERATIONS; i++) {
+        start = os_cputime_get32();
+        block = os_memblock_get(&osbench_pool);
+        os_memblock_put(&osbench_pool, block);
+        osbench_result_add(&res, os_cputime_get32() - start);
+    }
+
+    osbench_result_print(&res);
+}
+
+static void
+osbench_mempool_contended(void)
+{
+    void *block;
+
+    osbench_result_init(&osbench_mempool_irq_res,
+                        "mempool contended irq lat " OSBENCH_MEMPOOL_MODE);
+    os_cputime_timer_init(&osbench_mempool_timer, osbench_mempool_timer_cb,
+                          NULL);
+
+    osbench_mempool_irq_expiry = os_cputime_get32() +
+        os_cputime_usecs_to_ticks(OSBENCH_MEMPOOL_TIMER_USECS);
+    os_cputime_timer_start(&osbench_mempool_timer, osbench_mempool_irq_expiry);
+
+    while (osbench_mempool_irq_res.cnt < OSBENCH_ITERATIONS) {
+        block = os_memblock_get(&osbench_pool);
+        if (block != NULL) {
+            os_memblock_put(&osbench_pool, block);
+        }
+    }
+
+    os_cputime_timer_stop(&osbench_mempool_timer);
+    osbench_result_print(&osbench_mempool_irq_res);
+}
+
+void
+osbench_mempool(void)
+{
+    int rc;
+
+    rc = os_mempool_init(&osbench_pool, OSBENCH_MEMPOOL_BLOCKS,
+                         OSBENCH_MEMPOOL_BLOCK_SIZE, osbench_pool_buf,
+                         "osbench");
+    assert(rc == 0);
+
+    osbench_mempool_get_put();
+    osbench_mempool_contended();
+
+    assert(osbench_pool.mp_num_free == OSBENCH_MEMPOOL_BLOCKS);
+}
@@ -0,0 +1,145 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <assert.h>
+#include "os/mynewt.h"
+#include "console/console.h"
+#include "osbench.h"
+
+/*
+ * Scheduler benchmarks.
+ *
+ * The run list is populated with OSBENCH_SCHED_TASKS ready tasks which have a
+ * lower priority than the benchmark task, so they never get to run while
+ * measurements are taken.  Two things are measured:
+ *
+ * - The cost of putting a ready task to sleep and waking it up again, for the
+ *   highest and for the lowest priority task in the run list.  With the linear
+ *   run list the latter has to walk past every other ready task.
+ * - The cost of a context switch, as half of the round trip between the
+ *   benchmark task and a lower priority task signalling each other through a
+ *   pair of semaphores.
+ */
+
+#define OSBENCH_SCHED_TASKS     MYNEWT_VAL(OSBENCH_SCHED_TASKS)
+#define OSBENCH_PONG_PRIO       (OSBENCH_TASK_PRIO + 1)
+#define OSBENCH_FILL_PRIO       (OSBENCH_TASK_PRIO + 2)
+
+static struct os_task osbench_pong_task;
+OS_TASK_STACK_DEFINE(osbench_pong_stack, OSBENCH_STACK_SIZE);
+
+static struct os_task osbench_fill_tasks[OSBENCH_SCHED_TASKS];
+static os_stack_t osbench_fill_stacks[OSBENCH_SCHED_TASKS][OSBENCH_STACK_SIZE]
+    __attribute__((aligned(OS_STACK_ALIGNMENT)));
+
+static struct os_sem osbench_ping_sem;
+static struct os_sem osbench_pong_sem;
+static struct os_sem osbench_fill_sem;
+
+static void
+osbench_fill_handler(void *arg)
+{
+    /* Park forever once the benchmark task lets us run. */
+    while (1) {
+        os_sem_pend(&osbench_fill_sem, OS_TIMEOUT_NEVER);
+    }
+}
+
+static void
+osbench_pong_handler(void *arg)
+{
+    while (1) {
+        os_sem_pend(&osbench_pong_sem, OS_TIMEOUT_NEVER);
+        os_sem_release(&osbench_ping_sem);
+    }
+}
+
+static void
+osbench_sched_wakeup(struct os_task *t, const char *name)
+{
+    struct osbench_result res;
+    uint32_t start;
+    os_sr_t sr;
+    int i;
+
+    osbench_result_init(&res, name);
+
+    for (i = 0; i < OSBENCH_ITERATIONS; i++) {
+        OS_ENTER_CRITICAL(sr);
+        os_sched_sleep(t, OS_TIMEOUT_NEVER);
+        start = os_cputime_get32();
+        os_sched_wakeup(t);
+        osbench_result_add(&res, os_cputime_get32() - start);
+        OS_EXIT_CRITICAL(sr);
+    }
+
+    osbench_result_print(&res);
+}
+
+static void
+osbench_sched_ctx_sw(void)
+{
+    struct osbench_result res;
+    uint32_t start;
+    int rc;
+    int i;
+
+    osbench_result_init(&res, "context switch (round trip / 2)");
+
+    rc = os_task_init(&osbench_pong_task, "pong", osbench_pong_handler, NULL,
+                      OSBENCH_PONG_PRIO, OS_WAIT_FOREVER, osbench_pong_stack,
+                      OSBENCH_STACK_SIZE);
+    assert(rc == 0);
+
+    for (i = 0; i < OSBENCH_ITERATIONS; i++) {
+        start = os_cputime_get32();
+        os_sem_release(&osbench_pong_sem);
+        os_sem_pend(&osbench_ping_sem, OS_TIMEOUT_NEVER);
+        osbench_result_add(&res, (os_cputime_get32() - start) / 2);
+    }
+
+    osbench_result_print(&res);
+}
+
+void
+osbench_sched(void)
+{
+    int rc;
+    int i;
+
+    console_printf("scheduler: %s run list, %d extra ready tasks\n",
+                   MYNEWT_VAL(OS_SCHED_BITMAP) ? "bitmap" : "linear",
+                   OSBENCH_SCHED_TASKS);
+
+    os_sem_init(&osbench_ping_sem, 0);
+    os_sem_init(&osbench_pong_sem, 0);
+    os_sem_init(&osbench_fill_sem, 0);
+
+    for (i = 0; i < OSBENCH_SCHED_TASKS; i++) {
+        rc = os_task_init(&osbench_fill_tasks[i], "fill", osbench_fill_handler,
+                          NULL, OSBENCH_FILL_PRIO + i, OS_WAIT_FOREVER,
+                          osbench_fill_stacks[i], OSBENCH_STACK_SIZE);
+        assert(rc == 0);
+    }
+
+    osbench_sched_wakeup(&osbench_fill_tasks[0], "wakeup (highest prio ready)");
+    osbench_sched_wakeup(&osbench_fill_tasks[OSBENCH_SCHED_TASKS - 1],
+                         "wakeup (lowest prio ready)");
+    osbench_sched_ctx_sw();
+}
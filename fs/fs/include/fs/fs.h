@@ -41,6 +41,7 @@ int fs_write(struct fs_file *, const void *data, int len);
 int fs_seek(struct fs_file *, uint32_t offset);
 uint32_t fs_getpos(const struct fs_file *);
 int fs_filelen(const struct fs_file *, uint32_t *out_len);
+int fs_flush(struct fs_file *);
 
 int fs_unlink(const char *filename);
 int fs_rename(const char *from, const char *to);
@@ -40,6 +40,7 @@ struct fs_ops {
     int (*f_seek)(struct fs_file *file, uint32_t offset);
     uint32_t (*f_getpos)(const struct fs_file *file);
     int (*f_filelen)(const struct fs_file *file, uint32_t *out_len);
+    int (*f_flush)(struct fs_file *file);
 
     int (*f_unlink)(const char *filename);
     int (*f_rename)(const char *from, const char *to);
@@ -69,6 +69,12 @@ fake_filelen(const struct fs_file *file, uint32_t *out_len)
     return FS_EUNINIT;
 }
 
+static int
+fake_flush(struct fs_file *file)
+{
+    return FS_EUNINIT;
+}
+
 static int
 fake_unlink(const char *filename)
 {
@@ -125,6 +131,7 @@ struct fs_ops not_initialized_ops = {
     .f_seek          = &fake_seek,
     .f_getpos        = &fake_getpos,
     .f_filelen       = &fake_filelen,
+    .f_flush         = &fake_flush,
     .f_unlink        = &fake_unlink,
     .f_rename        = &fake_rename,
     .f_mkdir         = &fake_mkdir,
@@ -228,6 +235,18 @@ fs_filelen(const struct fs_file *file, uint32_t *out_len)
     return fops->f_filelen(file, out_len);
 }
 
+int
+fs_flush(struct fs_file *file)
+{
+    struct fs_ops *fops = fops_from_file(file);
+
+    /* File systems that do not buffer writes have nothing to flush. */
+    if (fops->f_flush == NULL) {
+        return 0;
+    }
+    return fops->f_flush(file);
+}
+
 int
 fs_unlink(const char *filename)
 {
@@ -22,6 +22,7 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+#include "syscfg/syscfg.h"
 #include "fs/fs.h"
 
 #ifdef __cplusplus
@@ -63,6 +64,16 @@ int nffs_init(void);
 int nffs_detect(const struct nffs_area_desc *area_descs);
 int nffs_format(const struct nffs_area_desc *area_descs);
 
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+int nffs_checkpoint_init(const struct nffs_area_desc *slot_descs);
+int nffs_checkpoint(void);
+#endif
+
+#if MYNEWT_VAL(NFFS_GC_BG)
+struct os_eventq;
+void nffs_gc_bg_evq_set(struct os_eventq *evq);
+#endif
+
 int nffs_misc_desc_from_flash_area(int idx, int *cnt, struct nffs_area_desc *nad);
 
 #ifdef __cplusplus
@@ -44,6 +44,9 @@ struct os_mempool nffs_inode_entry_pool;
 struct os_mempool nffs_block_entry_pool;
 struct os_mempool nffs_cache_inode_pool;
 struct os_mempool nffs_cache_block_pool;
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+struct os_mempool nffs_write_buf_pool;
+#endif
 
 void *nffs_file_mem;
 void *nffs_inode_mem;
@@ -51,12 +54,35 @@ void *nffs_block_entry_mem;
 void *nffs_cache_inode_mem;
 void *nffs_cache_block_mem;
 void *nffs_dir_mem;
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+void *nffs_write_buf_mem;
+#endif
 
 struct nffs_inode_entry *nffs_root_dir;
 struct nffs_inode_entry *nffs_lost_found_dir;
 
 static struct os_mutex nffs_mutex;
 
+#if MYNEWT_VAL(NFFS_GC_BG)
+static struct os_callout nffs_gc_bg_callout;
+
+/* Delay before the next background garbage collection cycle, in
+ * milliseconds.  It doubles each time a cycle finds free space short but
+ * nothing worth collecting, so that a disk full of live data is not rescanned
+ * after every write.
+ */
+static uint32_t nffs_gc_bg_delay_ms = MYNEWT_VAL(NFFS_GC_BG_INTERVAL_MS);
+#endif
+
+/* Whether buffered writes get flushed by a timer. */
+#define NFFS_WRITE_BUF_TIMER                    \
+    (MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0 &&     \
+     MYNEWT_VAL(NFFS_WRITE_BUF_FLUSH_MS) > 0)
+
+#if NFFS_WRITE_BUF_TIMER
+static struct os_callout nffs_write_buf_callout;
+#endif
+
 static int nffs_open(const char *path, uint8_t access_flags,
   struct fs_file **out_file);
 static int nffs_close(struct fs_file *fs_file);
@@ -66,6 +92,7 @@ static int nffs_write(struct fs_file *fs_file, const void *data, int len);
 static int nffs_seek(struct fs_file *fs_file, uint32_t offset);
 static uint32_t nffs_getpos(const struct fs_file *fs_file);
 static int nffs_file_len(const struct fs_file *fs_file, uint32_t *out_len);
+static int nffs_flush(struct fs_file *fs_file);
 static int nffs_unlink(const char *path);
 static int nffs_rename(const char *from, const char *to);
 static int nffs_mkdir(const char *path);
@@ -85,6 +112,7 @@ struct fs_ops nffs_ops = {
     .f_seek = nffs_seek,
     .f_getpos = nffs_getpos,
     .f_filelen = nffs_file_len,
+    .f_flush = nffs_flush,
 
     .f_unlink = nffs_unlink,
     .f_rename = nffs_rename,
@@ -104,10 +132,15 @@ STATS_SECT_DECL(nffs_stats) nffs_stats;
 STATS_NAME_START(nffs_stats)
     STATS_NAME(nffs_stats, nffs_hashcnt_ins)
     STATS_NAME(nffs_stats, nffs_hashcnt_rm)
+    STATS_NAME(nffs_stats, nffs_hashcnt_find)
+    STATS_NAME(nffs_stats, nffs_hashcnt_probe)
     STATS_NAME(nffs_stats, nffs_object_count)
     STATS_NAME(nffs_stats, nffs_iocnt_read)
     STATS_NAME(nffs_stats, nffs_iocnt_write)
     STATS_NAME(nffs_stats, nffs_gccnt)
+    STATS_NAME(nffs_stats, nffs_gccnt_bg)
+    STATS_NAME(nffs_stats, nffs_wrlat_max)
+    STATS_NAME(nffs_stats, nffs_wrlat_p99)
     STATS_NAME(nffs_stats, nffs_readcnt_data)
     STATS_NAME(nffs_stats, nffs_readcnt_block)
     STATS_NAME(nffs_stats, nffs_readcnt_crc)
@@ -141,6 +174,105 @@ nffs_unlock(void)
     assert(rc == 0 || rc == OS_NOT_STARTED);
 }
 
+#if MYNEWT_VAL(NFFS_GC_BG)
+/**
+ * Schedules a background garbage collection cycle, unless one is already
+ * pending.
+ */
+static void
+nffs_gc_bg_schedule(void)
+{
+    if (nffs_gc_bg_callout.c_evq != NULL &&
+        !os_callout_queued(&nffs_gc_bg_callout)) {
+
+        os_callout_reset(&nffs_gc_bg_callout,
+                         os_time_ms_to_ticks32(nffs_gc_bg_delay_ms));
+    }
+}
+
+static void
+nffs_gc_bg_event(struct os_event *ev)
+{
+    int rc;
+
+    /* Never make a file system operation wait; if nffs is busy, try again
+     * later.
+     */
+    rc = os_mutex_pend(&nffs_mutex, 0);
+    if (rc == OS_TIMEOUT) {
+        nffs_gc_bg_schedule();
+        return;
+    }
+    assert(rc == 0 || rc == OS_NOT_STARTED);
+
+    if (nffs_misc_ready()) {
+        rc = nffs_gc_bg_step();
+        if (rc == FS_ENOENT && nffs_gc_bg_needed()) {
+            /* The scan found nothing to reclaim; back off. */
+            nffs_gc_bg_delay_ms *= 2;
+            if (nffs_gc_bg_delay_ms > MYNEWT_VAL(NFFS_GC_BG_BACKOFF_MAX_MS)) {
+                nffs_gc_bg_delay_ms = MYNEWT_VAL(NFFS_GC_BG_BACKOFF_MAX_MS);
+            }
+        } else {
+            nffs_gc_bg_delay_ms = MYNEWT_VAL(NFFS_GC_BG_INTERVAL_MS);
+        }
+    } else {
+        rc = FS_EUNINIT;
+    }
+
+    nffs_unlock();
+
+    /* Keep tallying, then compacting one area per cycle, until there is
+     * enough free space or nothing is worth collecting.
+     */
+    if (rc == 0) {
+        nffs_gc_bg_schedule();
+    }
+}
+
+/**
+ * Specifies the event queue that runs background garbage collection.  By
+ * default this is the default event queue; pass the queue of a low-priority
+ * task to keep garbage collection from delaying other events.  NULL disables
+ * background garbage collection.
+ *
+ * @param evq               The event queue to use.
+ */
+void
+nffs_gc_bg_evq_set(struct os_eventq *evq)
+{
+    nffs_lock();
+
+    os_callout_stop(&nffs_gc_bg_callout);
+    os_callout_init(&nffs_gc_bg_callout, evq, nffs_gc_bg_event, NULL);
+
+    nffs_unlock();
+}
+#endif
+
+#if NFFS_WRITE_BUF_TIMER
+static void
+nffs_write_buf_event(struct os_event *ev)
+{
+    int rc;
+
+    nffs_lock();
+    if (nffs_misc_ready()) {
+        /* There is no caller to report a failure to; the data stays buffered
+         * and gets retried when the timer fires again, or on the next access
+         * to the file.
+         */
+        rc = nffs_write_buf_flush_all();
+        if (rc != 0) {
+            os_callout_reset(&nffs_write_buf_callout,
+                             os_time_ms_to_ticks32(
+                                 MYNEWT_VAL(NFFS_WRITE_BUF_FLUSH_MS)));
+        }
+    }
+    nffs_unlock();
+}
+#endif
+
 static int
 nffs_stats_init(void)
 {
@@ -300,7 +432,14 @@ nffs_file_len(const struct fs_file *fs_file, uint32_t *out_len)
     const struct nffs_file *file = (const struct nffs_file *)fs_file;
 
     nffs_lock();
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    rc = nffs_write_buf_flush_inode(file->nf_inode_entry, NULL);
+    if (rc == 0) {
+        rc = nffs_inode_data_len(file->nf_inode_entry, out_len);
+    }
+#else
     rc = nffs_inode_data_len(file->nf_inode_entry, out_len);
+#endif
     nffs_unlock();
 
     return rc;
@@ -344,9 +483,13 @@ nffs_read(struct fs_file *fs_file, uint32_t len, void *out_data,
 static int
 nffs_write(struct fs_file *fs_file, const void *data, int len)
 {
+    os_time_t start;
     int rc;
     struct nffs_file *file = (struct nffs_file *)fs_file;
 
+    /* The recorded latency includes time spent waiting for the lock. */
+    start = os_time_get();
+
     nffs_lock();
 
     if (!nffs_misc_ready()) {
@@ -359,13 +502,61 @@ nffs_write(struct fs_file *fs_file, const void *data, int len)
         goto done;
     }
 
+#if NFFS_WRITE_BUF_TIMER
+    /* Bound the time that newly buffered data stays in RAM. */
+    if (file->nf_write_buf != NULL &&
+        !os_callout_queued(&nffs_write_buf_callout)) {
+
+        os_callout_reset(&nffs_write_buf_callout,
+                         os_time_ms_to_ticks32(
+                             MYNEWT_VAL(NFFS_WRITE_BUF_FLUSH_MS)));
+    }
+#endif
+
+#if MYNEWT_VAL(NFFS_GC_BG)
+    if (nffs_gc_bg_needed()) {
+        nffs_gc_bg_schedule();
+    }
+#endif
+
     rc = 0;
 
 done:
+    nffs_write_lat_record(os_time_ticks_to_ms32(os_time_get() - start));
     nffs_unlock();
     return rc;
 }
 
+/**
+ * Writes any data buffered for the specified file handle to flash.
+ *
+ * @param file              The file handle to flush.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+static int
+nffs_flush(struct fs_file *fs_file)
+{
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    int rc;
+    struct nffs_file *file = (struct nffs_file *)fs_file;
+
+    nffs_lock();
+
+    if (!nffs_misc_ready()) {
+        rc = FS_EUNINIT;
+    } else {
+        rc = nffs_write_buf_flush(file);
+    }
+
+    nffs_unlock();
+    return rc;
+#else
+    /* Writes are not buffered; there is nothing to flush. */
+    return 0;
+#endif
+}
+
 /**
  * Unlinks the file or directory at the specified path.  If the path refers to
  * a directory, all the directory's descendants are recursively unlinked.  Any
@@ -668,6 +859,54 @@ nffs_detect(const struct nffs_area_desc *area_descs)
     return rc;
 }
 
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+/**
+ * Specifies the two flash regions that hold mount checkpoints.  Each region
+ * must consist of whole flash sectors.  This should be called before
+ * nffs_detect() so that detection can restore from a checkpoint.
+ *
+ * @param slot_descs        Array of two checkpoint slots; NULL disables
+ *                              checkpoints.
+ *
+ * @return                  0 on success;
+ *                          FS_EINVAL if a slot is too small.
+ */
+int
+nffs_checkpoint_init(const struct nffs_area_desc *slot_descs)
+{
+    int rc;
+
+    nffs_lock();
+    rc = nffs_checkpoint_set_slots(slot_descs);
+    nffs_unlock();
+
+    return rc;
+}
+
+/**
+ * Writes a checkpoint of the file system.  The next nffs_detect() only scans
+ * objects written after the most recent checkpoint; call this before a clean
+ * shutdown.  A checkpoint is also written after every
+ * NFFS_CHECKPOINT_GC_INTERVAL garbage collection cycles.
+ *
+ * @return                  0 on success;
+ *                          FS_EINVAL if no checkpoint slots are set;
+ *                          FS_EFULL if the checkpoint does not fit in a slot;
+ *                          other nonzero on error.
+ */
+int
+nffs_checkpoint(void)
+{
+    int rc;
+
+    nffs_lock();
+    rc = nffs_checkpoint_write();
+    nffs_unlock();
+
+    return rc;
+}
+#endif
+
 /**
  * Initializes internal nffs memory and data structures.  This must be called
  * before any nffs operations are attempted.
@@ -693,6 +932,16 @@ nffs_init(void)
         return FS_EOS;
     }
 
+#if MYNEWT_VAL(NFFS_GC_BG)
+    nffs_gc_bg_evq_set(os_eventq_dflt_get());
+#endif
+
+#if NFFS_WRITE_BUF_TIMER
+    os_callout_stop(&nffs_write_buf_callout);
+    os_callout_init(&nffs_write_buf_callout, os_eventq_dflt_get(),
+                    nffs_write_buf_event, NULL);
+#endif
+
     free(nffs_file_mem);
     nffs_file_mem = malloc(
         OS_MEMPOOL_BYTES(nffs_config.nc_num_files, sizeof (struct nffs_file)));
@@ -740,6 +989,16 @@ nffs_init(void)
         return FS_ENOMEM;
     }
 
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    free(nffs_write_buf_mem);
+    nffs_write_buf_mem = malloc(
+        OS_MEMPOOL_BYTES(MYNEWT_VAL(NFFS_WRITE_BUF_COUNT),
+                         sizeof (struct nffs_write_buf)));
+    if (nffs_write_buf_mem == NULL) {
+        return FS_ENOMEM;
+    }
+#endif
+
     rc = nffs_misc_reset();
     if (rc != 0) {
         return rc;
@@ -753,6 +1012,9 @@ void
 nffs_pkg_init(void)
 {
     struct nffs_area_desc descs[MYNEWT_VAL(NFFS_NUM_AREAS) + 1];
+#if MYNEWT_VAL(NFFS_CHECKPOINT) && MYNEWT_VAL(NFFS_CHECKPOINT_FLASH_AREA) >= 0
+    struct nffs_area_desc cp_descs[3];
+#endif
     int cnt;
     int rc;
 
@@ -771,6 +1033,17 @@ nffs_pkg_init(void)
         MYNEWT_VAL(NFFS_FLASH_AREA), &cnt, descs);
     SYSINIT_PANIC_ASSERT(rc == 0);
 
+#if MYNEWT_VAL(NFFS_CHECKPOINT) && MYNEWT_VAL(NFFS_CHECKPOINT_FLASH_AREA) >= 0
+    /* Split the checkpoint flash area into its two slots. */
+    cnt = 2;
+    rc = nffs_misc_desc_from_flash_area(
+        MYNEWT_VAL(NFFS_CHECKPOINT_FLASH_AREA), &cnt, cp_descs);
+    SYSINIT_PANIC_ASSERT(rc == 0 && cnt == 2);
+
+    rc = nffs_checkpoint_init(cp_descs);
+    SYSINIT_PANIC_ASSERT(rc == 0);
+#endif
+
     /* Attempt to restore an existing nffs file system from flash. */
     rc = nffs_detect(descs);
     switch (rc) {
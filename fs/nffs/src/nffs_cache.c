@@ -193,6 +193,162 @@ nffs_cache_inode_find(const struct nffs_inode_entry *inode_entry)
     return NULL;
 }
 
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+#define NFFS_CACHE_INDEX_SIZE   MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE)
+
+/**
+ * Doubles the stride of a cached inode's block index.  Each pair of slots is
+ * merged into one, keeping the block that ends further into the file.
+ */
+static void
+nffs_cache_index_widen(struct nffs_cache_inode *cache_inode)
+{
+    struct nffs_cache_index_entry *lo;
+    struct nffs_cache_index_entry *hi;
+    int i;
+
+    for (i = 0; i < NFFS_CACHE_INDEX_SIZE; i++) {
+        if (i < (NFFS_CACHE_INDEX_SIZE + 1) / 2) {
+            lo = cache_inode->nci_index + 2 * i;
+            if (2 * i + 1 < NFFS_CACHE_INDEX_SIZE) {
+                hi = lo + 1;
+            } else {
+                hi = NULL;
+            }
+
+            if (hi != NULL && hi->ncie_block_entry != NULL) {
+                cache_inode->nci_index[i] = *hi;
+            } else {
+                cache_inode->nci_index[i] = *lo;
+            }
+        } else {
+            memset(cache_inode->nci_index + i, 0,
+                   sizeof cache_inode->nci_index[i]);
+        }
+    }
+
+    cache_inode->nci_index_stride *= 2;
+}
+
+/**
+ * Records a data block in a cached inode's block index.  Blocks are recorded
+ * as seeks read them from flash, so the index fills in without extra reads.
+ *
+ * @param cache_inode           The cached inode that owns the block.
+ * @param block_entry           The hash entry of the block to record.
+ * @param block_end             The file offset of the end of the block.
+ */
+static void
+nffs_cache_index_add(struct nffs_cache_inode *cache_inode,
+                     struct nffs_hash_entry *block_entry, uint32_t block_end)
+{
+    struct nffs_cache_index_entry *index_entry;
+    uint32_t slot;
+
+    if (cache_inode->nci_index_stride == 0) {
+        /* Slots narrower than a block would mostly stay empty. */
+        cache_inode->nci_index_stride =
+            (cache_inode->nci_file_size + NFFS_CACHE_INDEX_SIZE - 1) /
+            NFFS_CACHE_INDEX_SIZE;
+        if (cache_inode->nci_index_stride < nffs_block_max_data_sz) {
+            cache_inode->nci_index_stride = nffs_block_max_data_sz;
+        }
+    }
+
+    /* The file may have grown since the stride was chosen. */
+    while ((block_end - 1) / cache_inode->nci_index_stride >=
+           NFFS_CACHE_INDEX_SIZE) {
+
+        nffs_cache_index_widen(cache_inode);
+    }
+
+    slot = (block_end - 1) / cache_inode->nci_index_stride;
+    index_entry = cache_inode->nci_index + slot;
+    if (index_entry->ncie_block_entry == NULL ||
+        index_entry->ncie_block_end < block_end) {
+
+        index_entry->ncie_block_entry = block_entry;
+        index_entry->ncie_block_end = block_end;
+    }
+}
+
+/**
+ * Finds the indexed block that ends closest after the specified file offset.
+ * A backwards walk from this block reaches the offset in at most one index
+ * stride.
+ *
+ * @return                      The index entry on success; null if no
+ *                                  indexed block ends after the offset.
+ */
+static const struct nffs_cache_index_entry *
+nffs_cache_index_find(const struct nffs_cache_inode *cache_inode,
+                      uint32_t seek_offset)
+{
+    const struct nffs_cache_index_entry *index_entry;
+    uint32_t slot;
+
+    if (cache_inode->nci_index_stride == 0) {
+        return NULL;
+    }
+
+    for (slot = seek_offset / cache_inode->nci_index_stride;
+         slot < NFFS_CACHE_INDEX_SIZE;
+         slot++) {
+
+        index_entry = cache_inode->nci_index + slot;
+        if (index_entry->ncie_block_entry != NULL &&
+            index_entry->ncie_block_end > seek_offset) {
+
+            return index_entry;
+        }
+    }
+
+    return NULL;
+}
+#endif
+
+/**
+ * Empties a cached inode's block index.  This must be called whenever the
+ * inode's block chain changes other than by an append.
+ */
+void
+nffs_cache_index_clear(struct nffs_cache_inode *cache_inode)
+{
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+    cache_inode->nci_index_stride = 0;
+    memset(cache_inode->nci_index, 0, sizeof cache_inode->nci_index);
+#endif
+}
+
+/**
+ * Drops the index entries of blocks that end at or after the specified file
+ * offset.  This must be called when the blocks ending there change length;
+ * entries for blocks ending earlier stay valid.
+ */
+void
+nffs_cache_index_trim(struct nffs_cache_inode *cache_inode, uint32_t offset)
+{
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+    struct nffs_cache_index_entry *index_entry;
+    uint32_t slot;
+
+    if (cache_inode->nci_index_stride == 0 || offset == 0) {
+        nffs_cache_index_clear(cache_inode);
+        return;
+    }
+
+    for (slot = (offset - 1) / cache_inode->nci_index_stride;
+         slot < NFFS_CACHE_INDEX_SIZE;
+         slot++) {
+
+        index_entry = cache_inode->nci_index + slot;
+        if (index_entry->ncie_block_end >= offset) {
+            memset(index_entry, 0, sizeof *index_entry);
+        }
+    }
+#endif
+}
+
 void
 nffs_cache_inode_range(const struct nffs_cache_inode *cache_inode,
                       uint32_t *out_start, uint32_t *out_end)
@@ -292,8 +448,11 @@ nffs_cache_inode_refresh(void)
     int rc;
 
     TAILQ_FOREACH(cache_inode, &nffs_cache_inode_list, nci_link) {
-        /* Clear entire block list. */
+        /* Clear entire block list.  Garbage collection may have merged
+         * blocks, so the block index is stale as well.
+         */
         nffs_cache_inode_free_blocks(cache_inode);
+        nffs_cache_index_clear(cache_inode);
 
         inode_entry = cache_inode->nci_inode.ni_inode_entry;
         rc = nffs_inode_from_entry(&cache_inode->nci_inode, inode_entry);
@@ -363,6 +522,11 @@ nffs_cache_insert_block(struct nffs_cache_inode *cache_inode,
  *      b. Else, clear the cache, and populate it with the single entry
  *         corresponding to the requested block.
  *
+ * If the inode's block index is enabled, the backwards scan in case 3 starts
+ * at the nearest indexed block rather than at the end of the file.  In case
+ * 2, a gap of more than one index stride is not bridged; the cache is cleared
+ * and the seek proceeds as in case 3.
+ *
  * @param cache_inode           The cached file inode to seek within.
  * @param seek_offset           The file offset to seek to.
  * @param out_cache_block       On success, the requested cached block gets
@@ -375,6 +539,9 @@ int
 nffs_cache_seek(struct nffs_cache_inode *cache_inode, uint32_t seek_offset,
                 struct nffs_cache_block **out_cache_block)
 {
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+    const struct nffs_cache_index_entry *index_entry;
+#endif
     struct nffs_cache_block *cache_block;
     struct nffs_hash_entry *last_cached_entry;
     struct nffs_hash_entry *block_entry;
@@ -392,6 +559,26 @@ nffs_cache_seek(struct nffs_cache_inode *cache_inode, uint32_t seek_offset,
     }
 
     nffs_cache_inode_range(cache_inode, &cache_start, &cache_end);
+
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+    if (cache_end != 0 && seek_offset < cache_start) {
+        /* Bridging the gap to the cache reads every block in it.  If an
+         * indexed block lies more than a stride before the cache, drop the
+         * cache and start from that block instead.
+         */
+        index_entry = nffs_cache_index_find(cache_inode, seek_offset);
+        if (index_entry != NULL &&
+            index_entry->ncie_block_end < cache_start &&
+            cache_start - index_entry->ncie_block_end >
+                cache_inode->nci_index_stride) {
+
+            nffs_cache_inode_free_blocks(cache_inode);
+            cache_start = 0;
+            cache_end = 0;
+        }
+    }
+#endif
+
     if (cache_end != 0 && seek_offset < cache_start) {
         /* Seeking prior to cache.  Iterate backwards from cache start. */
         cache_block = TAILQ_FIRST(&cache_inode->nci_block_list);
@@ -414,6 +601,15 @@ nffs_cache_seek(struct nffs_cache_inode *cache_inode, uint32_t seek_offset,
         block_entry =
             cache_inode->nci_inode.ni_inode_entry->nie_last_block_entry;
         block_end = cache_inode->nci_file_size;
+
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+        /* Start from the nearest indexed block instead, if there is one. */
+        index_entry = nffs_cache_index_find(cache_inode, seek_offset);
+        if (index_entry != NULL) {
+            block_entry = index_entry->ncie_block_entry;
+            block_end = index_entry->ncie_block_end;
+        }
+#endif
     }
 
     /* Scan backwards until we find the block containing the seek offest. */
@@ -431,6 +627,9 @@ nffs_cache_seek(struct nffs_cache_inode *cache_inode, uint32_t seek_offset,
             }
 
             nffs_cache_insert_block(cache_inode, cache_block, 0);
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+            nffs_cache_index_add(cache_inode, block_entry, block_end);
+#endif
         }
 
         /* Calculate the file offset of the start of this block.  This is used
@@ -451,6 +650,9 @@ nffs_cache_seek(struct nffs_cache_inode *cache_inode, uint32_t seek_offset,
 
             block_start = block_end - block.nb_data_len;
             pred_entry = block.nb_prev;
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+            nffs_cache_index_add(cache_inode, block_entry, block_end);
+#endif
         }
 
         if (block_start <= seek_offset) {
@@ -0,0 +1,566 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <string.h>
+#include "os/mynewt.h"
+
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+
+#include "hal/hal_flash.h"
+#include "nffs/nffs.h"
+#include "nffs_priv.h"
+
+#define NFFS_CHECKPOINT_NUM_SLOTS   2
+
+/** Number of object records buffered per flash write. */
+#define NFFS_CHECKPOINT_OBJ_BATCH   16
+
+/**
+ * The two flash regions that alternately hold the checkpoint.  A new
+ * checkpoint always overwrites the older slot, so the newer one survives an
+ * interrupted write.
+ */
+static struct nffs_area_desc nffs_checkpoint_slots[NFFS_CHECKPOINT_NUM_SLOTS];
+
+/**
+ * Generation of the checkpoint the file system was restored from; 0 if it
+ * was restored with a full scan.
+ */
+uint32_t nffs_checkpoint_restored_gen;
+
+static int
+nffs_checkpoint_slots_set(void)
+{
+    return nffs_checkpoint_slots[0].nad_length != 0;
+}
+
+static int
+nffs_checkpoint_flash_read(uint8_t slot, uint32_t offset, void *data,
+                           uint32_t len)
+{
+    const struct nffs_area_desc *desc;
+    int rc;
+
+    desc = nffs_checkpoint_slots + slot;
+    if (offset + len > desc->nad_length) {
+        return FS_EOFFSET;
+    }
+
+    STATS_INC(nffs_stats, nffs_iocnt_read);
+    rc = hal_flash_read(desc->nad_flash_id, desc->nad_offset + offset, data,
+                        len);
+    if (rc != 0) {
+        return FS_EHW;
+    }
+
+    return 0;
+}
+
+static int
+nffs_checkpoint_flash_write(uint8_t slot, uint32_t offset, const void *data,
+                            uint32_t len)
+{
+    const struct nffs_area_desc *desc;
+    int rc;
+
+    desc = nffs_checkpoint_slots + slot;
+    if (offset + len > desc->nad_length) {
+        return FS_EOFFSET;
+    }
+
+    STATS_INC(nffs_stats, nffs_iocnt_write);
+    rc = hal_flash_write(desc->nad_flash_id, desc->nad_offset + offset, data,
+                         len);
+    if (rc != 0) {
+        return FS_EHW;
+    }
+
+    return 0;
+}
+
+static int
+nffs_checkpoint_flash_erase(uint8_t slot)
+{
+    const struct nffs_area_desc *desc;
+    int rc;
+
+    desc = nffs_checkpoint_slots + slot;
+    rc = hal_flash_erase(desc->nad_flash_id, desc->nad_offset,
+                         desc->nad_length);
+    if (rc != 0) {
+        return FS_EHW;
+    }
+
+    return 0;
+}
+
+/**
+ * Reads a slot's checkpoint header and verifies the CRC of the entire
+ * checkpoint.
+ *
+ * @param slot                  The slot to read.
+ * @param out_cp                On success, the header gets written here.
+ *
+ * @return                      0 if the slot holds a complete checkpoint;
+ *                              FS_ECORRUPT if it does not;
+ *                              other nonzero on flash error.
+ */
+static int
+nffs_checkpoint_read_hdr(uint8_t slot, struct nffs_disk_checkpoint *out_cp)
+{
+    uint32_t chunk_len;
+    uint32_t offset;
+    uint32_t len;
+    uint16_t crc;
+    int rc;
+
+    rc = nffs_checkpoint_flash_read(slot, 0, out_cp, sizeof *out_cp);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (out_cp->ndc_magic != NFFS_CHECKPOINT_MAGIC) {
+        return FS_ECORRUPT;
+    }
+
+    /* Reject record counts that cannot fit in the slot before computing the
+     * checkpoint length; this keeps the length from overflowing.
+     */
+    len = nffs_checkpoint_slots[slot].nad_length - sizeof *out_cp;
+    if (out_cp->ndc_num_objects >
+        len / sizeof (struct nffs_disk_checkpoint_object)) {
+
+        return FS_ECORRUPT;
+    }
+    len = out_cp->ndc_num_areas * sizeof (struct nffs_disk_checkpoint_area) +
+          out_cp->ndc_num_objects *
+          sizeof (struct nffs_disk_checkpoint_object);
+    if (len > nffs_checkpoint_slots[slot].nad_length - sizeof *out_cp) {
+        return FS_ECORRUPT;
+    }
+
+    crc = crc16_ccitt(0, out_cp, NFFS_DISK_CHECKPOINT_OFFSET_CRC);
+
+    offset = sizeof *out_cp;
+    while (len > 0) {
+        if (len > sizeof nffs_flash_buf) {
+            chunk_len = sizeof nffs_flash_buf;
+        } else {
+            chunk_len = len;
+        }
+
+        rc = nffs_checkpoint_flash_read(slot, offset, nffs_flash_buf,
+                                        chunk_len);
+        if (rc != 0) {
+            return rc;
+        }
+
+        crc = crc16_ccitt(crc, nffs_flash_buf, chunk_len);
+
+        offset += chunk_len;
+        len -= chunk_len;
+    }
+
+    if (crc != out_cp->ndc_crc16) {
+        return FS_ECORRUPT;
+    }
+
+    return 0;
+}
+
+/**
+ * Selects the slot to write the next checkpoint to: the one holding the older
+ * generation, or one without a checkpoint.
+ */
+static int
+nffs_checkpoint_next_slot(uint8_t *out_slot, uint32_t *out_gen)
+{
+    struct nffs_disk_checkpoint cp;
+    uint32_t gens[NFFS_CHECKPOINT_NUM_SLOTS];
+    int rc;
+    int i;
+
+    for (i = 0; i < NFFS_CHECKPOINT_NUM_SLOTS; i++) {
+        rc = nffs_checkpoint_flash_read(i, 0, &cp, sizeof cp);
+        if (rc != 0) {
+            return rc;
+        }
+
+        if (cp.ndc_magic == NFFS_CHECKPOINT_MAGIC) {
+            gens[i] = cp.ndc_gen;
+        } else {
+            gens[i] = 0;
+        }
+    }
+
+    if (gens[0] <= gens[1]) {
+        *out_slot = 0;
+        *out_gen = gens[1] + 1;
+    } else {
+        *out_slot = 1;
+        *out_gen = gens[0] + 1;
+    }
+
+    return 0;
+}
+
+static int
+nffs_checkpoint_write_objects(uint8_t slot, uint32_t *offset, uint16_t *crc,
+                              const struct nffs_disk_checkpoint_object *objs,
+                              int num_objs)
+{
+    uint32_t len;
+    int rc;
+
+    len = num_objs * sizeof *objs;
+    rc = nffs_checkpoint_flash_write(slot, *offset, objs, len);
+    if (rc != 0) {
+        return rc;
+    }
+
+    *crc = crc16_ccitt(*crc, objs, len);
+    *offset += len;
+
+    return 0;
+}
+
+/**
+ * Specifies the flash regions that hold checkpoints.
+ *
+ * @param slot_descs            Array of two slot descriptors; NULL disables
+ *                                  checkpoints.
+ *
+ * @return                      0 on success;
+ *                              FS_EINVAL if a slot is too small to hold a
+ *                                  checkpoint header.
+ */
+int
+nffs_checkpoint_set_slots(const struct nffs_area_desc *slot_descs)
+{
+    int i;
+
+    if (slot_descs == NULL) {
+        memset(nffs_checkpoint_slots, 0, sizeof nffs_checkpoint_slots);
+        return 0;
+    }
+
+    for (i = 0; i < NFFS_CHECKPOINT_NUM_SLOTS; i++) {
+        if (slot_descs[i].nad_length < sizeof (struct nffs_disk_checkpoint)) {
+            return FS_EINVAL;
+        }
+    }
+
+    memcpy(nffs_checkpoint_slots, slot_descs, sizeof nffs_checkpoint_slots);
+
+    return 0;
+}
+
+/**
+ * Erases every slot holding a checkpoint.  This must be done whenever the
+ * areas change in a way that a stale checkpoint could not detect.
+ *
+ * @return                      0 on success; nonzero on flash error.
+ */
+int
+nffs_checkpoint_invalidate(void)
+{
+    struct nffs_disk_checkpoint cp;
+    int rc;
+    int i;
+
+    if (!nffs_checkpoint_slots_set()) {
+        return 0;
+    }
+
+    for (i = 0; i < NFFS_CHECKPOINT_NUM_SLOTS; i++) {
+        rc = nffs_checkpoint_flash_read(i, 0, &cp, sizeof cp);
+        if (rc != 0) {
+            return rc;
+        }
+
+        if (cp.ndc_magic != NFFS_CHECKPOINT_MAGIC) {
+            continue;
+        }
+
+        rc = nffs_checkpoint_flash_erase(i);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Writes a checkpoint of the hash table and the current write position of
+ * each area.  On failure, all checkpoints are invalidated so that the next
+ * restore does not use one older than the current area contents.
+ *
+ * @return                      0 on success;
+ *                              FS_EINVAL if no checkpoint slots are set;
+ *                              FS_EFULL if the checkpoint does not fit in a
+ *                                  slot;
+ *                              other nonzero on error.
+ */
+int
+nffs_checkpoint_write(void)
+{
+    struct nffs_disk_checkpoint_object objs[NFFS_CHECKPOINT_OBJ_BATCH];
+    struct nffs_disk_checkpoint_area disk_area;
+    struct nffs_disk_checkpoint cp;
+    struct nffs_hash_entry *entry;
+    struct nffs_hash_entry *next;
+    struct nffs_area *area;
+    uint32_t num_objects;
+    uint32_t offset;
+    uint32_t gen;
+    uint16_t crc;
+    uint8_t slot;
+    int num_batched;
+    int rc;
+    int i;
+
+    if (!nffs_checkpoint_slots_set()) {
+        return FS_EINVAL;
+    }
+
+    if (!nffs_misc_ready()) {
+        rc = FS_EUNINIT;
+        goto err;
+    }
+
+    rc = nffs_checkpoint_next_slot(&slot, &gen);
+    if (rc != 0) {
+        goto err;
+    }
+
+    num_objects = 0;
+    NFFS_HASH_FOREACH(entry, i, next) {
+        if (!nffs_hash_entry_is_dummy(entry)) {
+            num_objects++;
+        }
+    }
+
+    if (sizeof cp + nffs_num_areas * sizeof disk_area +
+        num_objects * sizeof objs[0] > nffs_checkpoint_slots[slot].nad_length) {
+
+        rc = FS_EFULL;
+        goto err;
+    }
+
+    memset(&cp, 0, sizeof cp);
+    cp.ndc_magic = NFFS_CHECKPOINT_MAGIC;
+    cp.ndc_gen = gen;
+    cp.ndc_num_objects = num_objects;
+    cp.ndc_next_file_id = nffs_hash_next_file_id;
+    cp.ndc_next_dir_id = nffs_hash_next_dir_id;
+    cp.ndc_next_block_id = nffs_hash_next_block_id;
+    cp.ndc_num_areas = nffs_num_areas;
+    cp.ndc_scratch_area_idx = nffs_scratch_area_idx;
+
+    rc = nffs_checkpoint_flash_erase(slot);
+    if (rc != 0) {
+        goto err;
+    }
+
+    crc = crc16_ccitt(0, &cp, NFFS_DISK_CHECKPOINT_OFFSET_CRC);
+    offset = sizeof cp;
+
+    for (i = 0; i < nffs_num_areas; i++) {
+        area = nffs_areas + i;
+
+        memset(&disk_area, 0, sizeof disk_area);
+        disk_area.ndca_offset = area->na_offset;
+        disk_area.ndca_length = area->na_length;
+        disk_area.ndca_cur = area->na_cur;
+        disk_area.ndca_flash_id = area->na_flash_id;
+        disk_area.ndca_id = area->na_id;
+        disk_area.ndca_gc_seq = area->na_gc_seq;
+
+        rc = nffs_checkpoint_flash_write(slot, offset, &disk_area,
+                                         sizeof disk_area);
+        if (rc != 0) {
+            goto err;
+        }
+
+        crc = crc16_ccitt(crc, &disk_area, sizeof disk_area);
+        offset += sizeof disk_area;
+    }
+
+    num_batched = 0;
+    NFFS_HASH_FOREACH(entry, i, next) {
+        if (nffs_hash_entry_is_dummy(entry)) {
+            continue;
+        }
+
+        objs[num_batched].ndco_id = entry->nhe_id;
+        objs[num_batched].ndco_flash_loc = entry->nhe_flash_loc;
+        num_batched++;
+
+        if (num_batched == NFFS_CHECKPOINT_OBJ_BATCH) {
+            rc = nffs_checkpoint_write_objects(slot, &offset, &crc, objs,
+                                               num_batched);
+            if (rc != 0) {
+                goto err;
+            }
+            num_batched = 0;
+        }
+    }
+
+    if (num_batched > 0) {
+        rc = nffs_checkpoint_write_objects(slot, &offset, &crc, objs,
+                                           num_batched);
+        if (rc != 0) {
+            goto err;
+        }
+    }
+
+    /* The header goes last; until it is written, the slot is not valid. */
+    cp.ndc_crc16 = crc;
+    rc = nffs_checkpoint_flash_write(slot, 0, &cp, sizeof cp);
+    if (rc != 0) {
+        goto err;
+    }
+
+    return 0;
+
+err:
+    nffs_checkpoint_invalidate();
+    return rc;
+}
+
+/**
+ * Finds the newest valid checkpoint and checks that it matches the areas
+ * detected on disk.  On success, each non-scratch area's write position is
+ * set to its position at checkpoint time; restore resumes scanning from
+ * there.
+ *
+ * @param out_cp                On success, the checkpoint header gets written
+ *                                  here.
+ * @param out_slot              On success, the slot holding the checkpoint
+ *                                  gets written here.
+ *
+ * @return                      0 on success;
+ *                              FS_ENOENT if there is no valid checkpoint;
+ *                              FS_ECORRUPT if the checkpoint is stale;
+ *                              other nonzero on flash error.
+ */
+int
+nffs_checkpoint_find(struct nffs_disk_checkpoint *out_cp, uint8_t *out_slot)
+{
+    struct nffs_disk_checkpoint_area disk_area;
+    struct nffs_disk_checkpoint cp;
+    struct nffs_area *area;
+    int found;
+    int rc;
+    int i;
+
+    if (!nffs_checkpoint_slots_set()) {
+        return FS_ENOENT;
+    }
+
+    found = 0;
+    for (i = 0; i < NFFS_CHECKPOINT_NUM_SLOTS; i++) {
+        rc = nffs_checkpoint_read_hdr(i, &cp);
+        if (rc == FS_ECORRUPT) {
+            continue;
+        }
+        if (rc != 0) {
+            return rc;
+        }
+
+        if (!found || cp.ndc_gen > out_cp->ndc_gen) {
+            *out_cp = cp;
+            *out_slot = i;
+            found = 1;
+        }
+    }
+
+    if (!found) {
+        return FS_ENOENT;
+    }
+
+    /* A garbage collection cycle changes the scratch area index and the ID or
+     * GC sequence number of the areas involved; any of these differing means
+     * the object locations in the checkpoint are no longer valid.
+     */
+    if (out_cp->ndc_num_areas != nffs_num_areas ||
+        out_cp->ndc_scratch_area_idx != nffs_scratch_area_idx) {
+
+        return FS_ECORRUPT;
+    }
+
+    for (i = 0; i < nffs_num_areas; i++) {
+        rc = nffs_checkpoint_flash_read(*out_slot,
+                                        sizeof cp + i * sizeof disk_area,
+                                        &disk_area, sizeof disk_area);
+        if (rc != 0) {
+            return rc;
+        }
+
+        area = nffs_areas + i;
+        if (disk_area.ndca_offset != area->na_offset ||
+            disk_area.ndca_length != area->na_length ||
+            disk_area.ndca_flash_id != area->na_flash_id ||
+            disk_area.ndca_id != area->na_id ||
+            disk_area.ndca_gc_seq != area->na_gc_seq) {
+
+            return FS_ECORRUPT;
+        }
+
+        if (i != nffs_scratch_area_idx) {
+            if (disk_area.ndca_cur < sizeof (struct nffs_disk_area) ||
+                disk_area.ndca_cur > area->na_length) {
+
+                return FS_ECORRUPT;
+            }
+            area->na_cur = disk_area.ndca_cur;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Reads a run of object records from a checkpoint located with
+ * nffs_checkpoint_find().
+ *
+ * @param slot                  The slot holding the checkpoint.
+ * @param first_idx             The index of the first record to read.
+ * @param objs                  On success, the records get written here.
+ * @param num_objs              The number of records to read.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+int
+nffs_checkpoint_read_objects(uint8_t slot, uint32_t first_idx,
+                             struct nffs_disk_checkpoint_object *objs,
+                             int num_objs)
+{
+    uint32_t offset;
+
+    offset = sizeof (struct nffs_disk_checkpoint) +
+             nffs_num_areas * sizeof (struct nffs_disk_checkpoint_area) +
+             first_idx * sizeof *objs;
+
+    return nffs_checkpoint_flash_read(slot, offset, objs,
+                                      num_objs * sizeof *objs);
+}
+
+#endif
@@ -272,6 +272,13 @@ nffs_file_seek(struct nffs_file *file, uint32_t offset)
     uint32_t len;
     int rc;
 
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    rc = nffs_write_buf_flush_inode(file->nf_inode_entry, NULL);
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
     rc = nffs_inode_data_len(file->nf_inode_entry, &len);
     if (rc != 0) {
         return rc;
@@ -313,6 +320,13 @@ nffs_file_read(struct nffs_file *file, uint32_t len, void *out_data,
         return FS_EACCESS;
     }
 
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    rc = nffs_write_buf_flush_inode(file->nf_inode_entry, NULL);
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
     rc = nffs_inode_read(file->nf_inode_entry, file->nf_offset, len, out_data,
                         &bytes_read);
     if (rc != 0) {
@@ -339,8 +353,19 @@ nffs_file_read(struct nffs_file *file, uint32_t len, void *out_data,
 int
 nffs_file_close(struct nffs_file *file)
 {
+    int flush_rc;
     int rc;
 
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    /* Buffered data that cannot be written is dropped with the handle; the
+     * error gets reported once the handle is closed.
+     */
+    flush_rc = nffs_write_buf_flush(file);
+    nffs_write_buf_free(file);
+#else
+    flush_rc = 0;
+#endif
+
     rc = nffs_inode_dec_refcnt(file->nf_inode_entry);
     if (rc != 0) {
         return rc;
@@ -351,5 +376,5 @@ nffs_file_close(struct nffs_file *file)
         return rc;
     }
 
-    return 0;
+    return flush_rc;
 }
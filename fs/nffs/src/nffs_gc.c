@@ -18,6 +18,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include "os/mynewt.h"
 #include "testutil/testutil.h"
@@ -31,6 +32,13 @@
  */
 unsigned int nffs_gc_count;
 
+#if MYNEWT_VAL(NFFS_CHECKPOINT) && MYNEWT_VAL(NFFS_CHECKPOINT_GC_INTERVAL) > 0
+/** Garbage collection cycles since a checkpoint was last written by one. */
+static unsigned int nffs_gc_checkpoint_cnt;
+#endif
+
+static int nffs_gc_area(uint8_t from_area_idx, uint8_t *out_area_idx);
+
 static int
 nffs_gc_copy_object(struct nffs_hash_entry *entry, uint16_t object_size,
                     uint8_t to_area_idx)
@@ -445,6 +453,23 @@ nffs_gc_inode_blocks(struct nffs_inode_entry *inode_entry,
  */
 int
 nffs_gc(uint8_t *out_area_idx)
+{
+    return nffs_gc_area(nffs_gc_select_area(), out_area_idx);
+}
+
+/**
+ * Performs a garbage collection cycle on the specified source area.  See
+ * nffs_gc() for details.
+ *
+ * @param from_area_idx     The index of the area to garbage collect.
+ * @param out_area_idx      On success, the ID of the cleaned up area gets
+ *                              written here.  Pass null if you do not need
+ *                              this information.
+ *
+ * @return                  0 on success; nonzero on error.
+ */
+static int
+nffs_gc_area(uint8_t from_area_idx, uint8_t *out_area_idx)
 {
     struct nffs_hash_entry *entry;
     struct nffs_hash_entry *next;
@@ -452,12 +477,10 @@ nffs_gc(uint8_t *out_area_idx)
     struct nffs_area *to_area;
     struct nffs_inode_entry *inode_entry;
     uint32_t area_offset;
-    uint8_t from_area_idx;
     uint8_t area_idx;
     int rc;
     int i;
 
-    from_area_idx = nffs_gc_select_area();
     from_area = nffs_areas + from_area_idx;
     to_area = nffs_areas + nffs_scratch_area_idx;
 
@@ -467,7 +490,7 @@ nffs_gc(uint8_t *out_area_idx)
         return rc;
     }
 
-    for (i = 0; i < NFFS_HASH_SIZE; i++) {
+    for (i = 0; i < nffs_hash_size; i++) {
         entry = SLIST_FIRST(nffs_hash + i);
         while (entry != NULL) {
             next = SLIST_NEXT(entry, nhe_next);
@@ -535,6 +558,16 @@ nffs_gc(uint8_t *out_area_idx)
     nffs_gc_count++;
     STATS_INC(nffs_stats, nffs_gccnt);
 
+#if MYNEWT_VAL(NFFS_CHECKPOINT) && MYNEWT_VAL(NFFS_CHECKPOINT_GC_INTERVAL) > 0
+    /* The previous checkpoint no longer matches the areas.  A failed write
+     * invalidates all checkpoints, so it does not fail the gc cycle.
+     */
+    if (++nffs_gc_checkpoint_cnt >= MYNEWT_VAL(NFFS_CHECKPOINT_GC_INTERVAL)) {
+        nffs_gc_checkpoint_cnt = 0;
+        nffs_checkpoint_write();
+    }
+#endif
+
     return 0;
 }
 
@@ -572,3 +605,212 @@ nffs_gc_until(uint32_t space, uint8_t *out_area_idx)
 
     return FS_EFULL;
 }
+
+#if MYNEWT_VAL(NFFS_GC_BG)
+/**
+ * Indicates whether background garbage collection should run; i.e., whether
+ * every area other than the scratch area has fewer than NFFS_GC_BG_LOW_WATER
+ * bytes free.
+ *
+ * @return                      1 if garbage collection is needed; 0 if not.
+ */
+int
+nffs_gc_bg_needed(void)
+{
+    int i;
+
+    for (i = 0; i < nffs_num_areas; i++) {
+        if (i != nffs_scratch_area_idx &&
+            nffs_area_free_space(nffs_areas + i) >=
+                MYNEWT_VAL(NFFS_GC_BG_LOW_WATER)) {
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Live byte tally used by background garbage collection.  It is spread over
+ * several cycles so that no cycle holds the nffs lock for a walk of the whole
+ * hash table.
+ */
+static uint32_t *nffs_gc_bg_live;
+/** Next hash bucket to tally; 0 if no tally is in progress. */
+static int nffs_gc_bg_bucket;
+/** nffs_gc_count when the tally started; a gc cycle moves live objects. */
+static unsigned int nffs_gc_bg_gc_count;
+
+/**
+ * Drops the background garbage collection state.  This is used when the
+ * areas get reinitialized.
+ */
+void
+nffs_gc_bg_reset(void)
+{
+    free(nffs_gc_bg_live);
+    nffs_gc_bg_live = NULL;
+    nffs_gc_bg_bucket = 0;
+}
+
+/**
+ * Continues tallying the number of bytes each area devotes to objects that
+ * are still present in the RAM representation; the rest of an area's written
+ * space is garbage.  Each call looks at whole hash buckets until it has read
+ * at least NFFS_GC_BG_SCAN_ENTRIES objects.  A garbage collection cycle in
+ * between restarts the tally.  Other writes can skew it, which only affects
+ * which area gets picked; compaction itself copies exactly the live objects.
+ *
+ * @param out_done              On success, set to 1 if nffs_gc_bg_live holds
+ *                                  the totals; 0 if more calls are needed.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+static int
+nffs_gc_bg_tally(int *out_done)
+{
+    struct nffs_disk_inode disk_inode;
+    struct nffs_disk_block disk_block;
+    struct nffs_hash_entry *entry;
+    uint32_t area_offset;
+    uint8_t area_idx;
+    int num_entries;
+    int rc;
+    int i;
+
+    if (nffs_gc_bg_gc_count != nffs_gc_count) {
+        nffs_gc_bg_bucket = 0;
+    }
+
+    if (nffs_gc_bg_bucket == 0) {
+        if (nffs_gc_bg_live == NULL) {
+            nffs_gc_bg_live = malloc(nffs_num_areas * sizeof *nffs_gc_bg_live);
+            if (nffs_gc_bg_live == NULL) {
+                return FS_ENOMEM;
+            }
+        }
+        memset(nffs_gc_bg_live, 0, nffs_num_areas * sizeof *nffs_gc_bg_live);
+        nffs_gc_bg_gc_count = nffs_gc_count;
+    }
+
+    num_entries = 0;
+    for (i = nffs_gc_bg_bucket;
+         i < nffs_hash_size &&
+         num_entries < MYNEWT_VAL(NFFS_GC_BG_SCAN_ENTRIES);
+         i++) {
+
+        SLIST_FOREACH(entry, nffs_hash + i, nhe_next) {
+            if (nffs_hash_entry_is_dummy(entry)) {
+                continue;
+            }
+            num_entries++;
+
+            nffs_flash_loc_expand(entry->nhe_flash_loc, &area_idx,
+                                  &area_offset);
+            if (nffs_hash_id_is_inode(entry->nhe_id)) {
+                rc = nffs_inode_read_disk(area_idx, area_offset, &disk_inode);
+                if (rc != 0) {
+                    nffs_gc_bg_bucket = 0;
+                    return rc;
+                }
+                nffs_gc_bg_live[area_idx] += sizeof disk_inode +
+                                             disk_inode.ndi_filename_len;
+            } else {
+                rc = nffs_block_read_disk(area_idx, area_offset, &disk_block);
+                if (rc != 0) {
+                    nffs_gc_bg_bucket = 0;
+                    return rc;
+                }
+                nffs_gc_bg_live[area_idx] += sizeof disk_block +
+                                             disk_block.ndb_data_len;
+            }
+        }
+    }
+
+    if (i < nffs_hash_size) {
+        nffs_gc_bg_bucket = i;
+        *out_done = 0;
+    } else {
+        nffs_gc_bg_bucket = 0;
+        *out_done = 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Performs a single background garbage collection cycle.  Unlike nffs_gc(),
+ * which rotates through the areas, this compacts the area holding the most
+ * garbage.  Areas with less than NFFS_GC_BG_MIN_GARBAGE percent garbage, and
+ * areas whose live objects would not fit in the scratch area, are left alone.
+ * Finding the garbage can take several cycles; see nffs_gc_bg_tally().
+ *
+ * @return                      0 if an area was compacted, or if the search
+ *                                  for garbage needs another cycle;
+ *                              FS_ENOENT if no area needed compacting;
+ *                              other nonzero on error.
+ */
+int
+nffs_gc_bg_step(void)
+{
+    const struct nffs_area *area;
+    uint32_t scratch_len;
+    uint32_t best_garbage;
+    uint32_t garbage;
+    uint32_t used;
+    int best_area_idx;
+    int done;
+    int rc;
+    int i;
+
+    if (!nffs_gc_bg_needed()) {
+        return FS_ENOENT;
+    }
+
+    rc = nffs_gc_bg_tally(&done);
+    if (rc != 0 || !done) {
+        return rc;
+    }
+
+    scratch_len = nffs_areas[nffs_scratch_area_idx].na_length;
+    best_area_idx = -1;
+    best_garbage = 0;
+    for (i = 0; i < nffs_num_areas; i++) {
+        if (i == nffs_scratch_area_idx) {
+            continue;
+        }
+
+        area = nffs_areas + i;
+        used = sizeof (struct nffs_disk_area) + nffs_gc_bg_live[i];
+        if (used > scratch_len || used > area->na_cur) {
+            continue;
+        }
+
+        garbage = area->na_cur - used;
+        if (garbage * 100 <
+            area->na_length * MYNEWT_VAL(NFFS_GC_BG_MIN_GARBAGE)) {
+
+            continue;
+        }
+
+        if (garbage > best_garbage) {
+            best_area_idx = i;
+            best_garbage = garbage;
+        }
+    }
+
+    if (best_area_idx == -1) {
+        return FS_ENOENT;
+    }
+
+    rc = nffs_gc_area(best_area_idx, NULL);
+    if (rc != 0) {
+        return rc;
+    }
+
+    STATS_INC(nffs_stats, nffs_gccnt_bg);
+
+    return 0;
+}
+#endif
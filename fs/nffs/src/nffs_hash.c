@@ -25,6 +25,12 @@
 
 struct nffs_hash_list *nffs_hash;
 
+/** Number of hash buckets; always a power of two. */
+int nffs_hash_size;
+
+/** 32 minus log2 of the number of hash buckets. */
+static uint8_t nffs_hash_shift;
+
 uint32_t nffs_hash_next_dir_id;
 uint32_t nffs_hash_next_file_id;
 uint32_t nffs_hash_next_block_id;
@@ -53,10 +59,17 @@ nffs_hash_id_is_block(uint32_t id)
     return id >= NFFS_ID_BLOCK_MIN && id < NFFS_ID_BLOCK_MAX;
 }
 
-static int
+/**
+ * Maps an object ID to a hash bucket.  The ID is multiplied by 2^32 divided by
+ * the golden ratio and the top bits of the product are kept.  This spreads
+ * consecutive IDs evenly across the buckets, and unlike a plain modulus it
+ * separates directories, files, and blocks, whose ID ranges differ only in
+ * their high bits.
+ */
+int
 nffs_hash_fn(uint32_t id)
 {
-    return id % NFFS_HASH_SIZE;
+    return (uint32_t)(id * 0x9e3779b1) >> nffs_hash_shift;
 }
 
 static struct nffs_hash_entry *
@@ -70,8 +83,11 @@ nffs_hash_find_reorder(uint32_t id)
     idx = nffs_hash_fn(id);
     list = nffs_hash + idx;
 
+    STATS_INC(nffs_stats, nffs_hashcnt_find);
+
     prev = NULL;
     SLIST_FOREACH(entry, list, nhe_next) {
+        STATS_INC(nffs_stats, nffs_hashcnt_probe);
         if (entry->nhe_id == id) {
             /* Put entry at the front of the list. */
             if (prev != NULL) {
@@ -97,7 +113,10 @@ nffs_hash_find(uint32_t id)
     idx = nffs_hash_fn(id);
     list = nffs_hash + idx;
 
+    STATS_INC(nffs_stats, nffs_hashcnt_find);
+
     SLIST_FOREACH(entry, list, nhe_next) {
+        STATS_INC(nffs_stats, nffs_hashcnt_probe);
         if (entry->nhe_id == id) {
             return entry;
         }
@@ -194,19 +213,77 @@ nffs_hash_remove(struct nffs_hash_entry *entry)
     assert(nffs_hash_find(entry->nhe_id) == NULL);
 }
 
+/**
+ * Reports how evenly the hash table's entries are spread across its buckets.
+ *
+ * @param out_info              On success, the occupancy gets written here.
+ */
+void
+nffs_hash_chain_info(struct nffs_hash_chain_info *out_info)
+{
+    struct nffs_hash_entry *entry;
+    uint32_t len;
+    int i;
+
+    memset(out_info, 0, sizeof *out_info);
+
+    for (i = 0; i < nffs_hash_size; i++) {
+        len = 0;
+        SLIST_FOREACH(entry, nffs_hash + i, nhe_next) {
+            len++;
+            out_info->nhci_probe_sum += len;
+        }
+
+        out_info->nhci_num_entries += len;
+        if (len > 0) {
+            out_info->nhci_num_used++;
+        }
+        if (len > out_info->nhci_max_len) {
+            out_info->nhci_max_len = len;
+        }
+    }
+}
+
+/**
+ * Allocates an empty hash table.  The number of buckets is NFFS_HASH_SIZE,
+ * or if that is 0, one bucket per NFFS_HASH_AUTO_LOAD inodes and blocks that
+ * the configuration allows.  The count is rounded up to a power of two of at
+ * least NFFS_HASH_SIZE_MIN.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
 int
 nffs_hash_init(void)
 {
+    uint32_t num_buckets;
     int i;
 
     free(nffs_hash);
 
-    nffs_hash = malloc(NFFS_HASH_SIZE * sizeof *nffs_hash);
+#if MYNEWT_VAL(NFFS_HASH_SIZE) == 0
+    num_buckets = (nffs_config.nc_num_inodes + nffs_config.nc_num_blocks) /
+                  NFFS_HASH_AUTO_LOAD;
+#else
+    num_buckets = MYNEWT_VAL(NFFS_HASH_SIZE);
+#endif
+
+    if (num_buckets < NFFS_HASH_SIZE_MIN) {
+        num_buckets = NFFS_HASH_SIZE_MIN;
+    }
+
+    nffs_hash_size = 1;
+    nffs_hash_shift = 32;
+    while (nffs_hash_size < num_buckets) {
+        nffs_hash_size *= 2;
+        nffs_hash_shift--;
+    }
+
+    nffs_hash = malloc(nffs_hash_size * sizeof *nffs_hash);
     if (nffs_hash == NULL) {
         return FS_ENOMEM;
     }
 
-    for (i = 0; i < NFFS_HASH_SIZE; i++) {
+    for (i = 0; i < nffs_hash_size; i++) {
         SLIST_INIT(nffs_hash + i);
     }
 
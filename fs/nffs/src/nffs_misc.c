@@ -410,6 +410,17 @@ nffs_misc_reset(void)
         return FS_EOS;
     }
 
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    rc = os_mempool_init(&nffs_write_buf_pool,
+                         MYNEWT_VAL(NFFS_WRITE_BUF_COUNT),
+                         sizeof (struct nffs_write_buf),
+                         nffs_write_buf_mem, "nffs_write_buf_pool");
+    if (rc != 0) {
+        return FS_EOS;
+    }
+    nffs_write_buf_reset();
+#endif
+
     rc = nffs_hash_init();
     if (rc != 0) {
         return rc;
@@ -418,6 +429,9 @@ nffs_misc_reset(void)
     free(nffs_areas);
     nffs_areas = NULL;
     nffs_num_areas = 0;
+#if MYNEWT_VAL(NFFS_GC_BG)
+    nffs_gc_bg_reset();
+#endif
 
     nffs_root_dir = NULL;
     nffs_lost_found_dir = NULL;
@@ -427,6 +441,8 @@ nffs_misc_reset(void)
     nffs_hash_next_dir_id = NFFS_ID_DIR_MIN;
     nffs_hash_next_block_id = NFFS_ID_BLOCK_MIN;
 
+    nffs_write_lat_reset();
+
     return 0;
 }
 
@@ -32,7 +32,8 @@
 extern "C" {
 #endif
 
-#define NFFS_HASH_SIZE               256
+#define NFFS_HASH_SIZE_MIN           16
+#define NFFS_HASH_AUTO_LOAD          4
 
 #define NFFS_ID_DIR_MIN              0
 #define NFFS_ID_DIR_MAX              0x10000000
@@ -51,6 +52,7 @@ extern "C" {
 #define NFFS_AREA_MAGIC3             0xb185fc8e
 #define NFFS_BLOCK_MAGIC             0x53ba23b9
 #define NFFS_INODE_MAGIC             0x925f8bc0
+#define NFFS_CHECKPOINT_MAGIC        0x3c8e9a57
 
 #define NFFS_AREA_ID_NONE            0xff
 #define NFFS_AREA_VER_0                 0
@@ -106,6 +108,43 @@ struct nffs_disk_block {
 
 #define NFFS_DISK_BLOCK_OFFSET_CRC  18
 
+/**
+ * On-disk representation of a checkpoint header.  The header is written after
+ * the rest of the checkpoint, so an interrupted write leaves no magic number.
+ */
+struct nffs_disk_checkpoint {
+    uint32_t ndc_magic;         /* NFFS_CHECKPOINT_MAGIC */
+    uint32_t ndc_gen;           /* Generation; greater supersedes lesser. */
+    uint32_t ndc_num_objects;   /* Number of object records. */
+    uint32_t ndc_next_file_id;
+    uint32_t ndc_next_dir_id;
+    uint32_t ndc_next_block_id;
+    uint8_t ndc_num_areas;      /* Number of area records. */
+    uint8_t ndc_scratch_area_idx;
+    uint16_t ndc_crc16;         /* Covers rest of header and all records. */
+    /* Followed by area records, then object records. */
+};
+
+#define NFFS_DISK_CHECKPOINT_OFFSET_CRC  26
+
+/** On-disk record of an area's state at checkpoint time. */
+struct nffs_disk_checkpoint_area {
+    uint32_t ndca_offset;       /* Flash offset of start of area. */
+    uint32_t ndca_length;       /* Total size of area, in bytes. */
+    uint32_t ndca_cur;          /* Objects at or past this offset are newer
+                                   than the checkpoint. */
+    uint8_t ndca_flash_id;
+    uint8_t ndca_id;
+    uint8_t ndca_gc_seq;
+    uint8_t reserved8;
+};
+
+/** On-disk record of one hash table entry at checkpoint time. */
+struct nffs_disk_checkpoint_object {
+    uint32_t ndco_id;
+    uint32_t ndco_flash_loc;
+};
+
 /**
  * What gets stored in the hash table.  Each entry represents a data block or
  * an inode.
@@ -116,6 +155,13 @@ struct nffs_hash_entry {
     uint32_t nhe_flash_loc; /* Upper-byte = area idx; rest = area offset. */
 };
 
+/** Hash table occupancy, as reported by nffs_hash_chain_info(). */
+struct nffs_hash_chain_info {
+    uint32_t nhci_num_entries;  /* Total number of entries. */
+    uint32_t nhci_num_used;     /* Number of non-empty buckets. */
+    uint32_t nhci_max_len;      /* Length of the longest chain. */
+    uint32_t nhci_probe_sum;    /* Entries visited to find each entry once. */
+};
 
 SLIST_HEAD(nffs_hash_list, nffs_hash_entry);
 SLIST_HEAD(nffs_inode_list, nffs_inode_entry);
@@ -173,8 +219,22 @@ struct nffs_file {
     struct nffs_inode_entry *nf_inode_entry;
     uint32_t nf_offset;
     uint8_t nf_access_flags;
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    struct nffs_write_buf *nf_write_buf;
+#endif
 };
 
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+/** Appended data that has not been written to flash yet. */
+struct nffs_write_buf {
+    SLIST_ENTRY(nffs_write_buf) nwb_next;
+    struct nffs_file *nwb_file;     /* File handle that owns the buffer. */
+    uint32_t nwb_offset;            /* File offset of the first byte. */
+    uint16_t nwb_len;               /* Number of buffered bytes. */
+    uint8_t nwb_data[MYNEWT_VAL(NFFS_WRITE_BUF_SIZE)];
+};
+#endif
+
 struct nffs_area {
     uint32_t na_offset;
     uint32_t na_length;
@@ -228,12 +288,27 @@ struct nffs_cache_block {
 
 TAILQ_HEAD(nffs_cache_block_list, nffs_cache_block);
 
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+/** A data block recorded in a cached inode's block index. */
+struct nffs_cache_index_entry {
+    struct nffs_hash_entry *ncie_block_entry;   /* Null if slot is unused. */
+    uint32_t ncie_block_end;                    /* File offset of block end. */
+};
+#endif
+
 /** Represents a single cached file inode. */
 struct nffs_cache_inode {
     TAILQ_ENTRY(nffs_cache_inode) nci_link;        /* Sorted; LRU at tail. */
     struct nffs_inode nci_inode;                   /* Full inode. */
     struct nffs_cache_block_list nci_block_list;   /* List of cached blocks. */
     uint32_t nci_file_size;                        /* Total file size. */
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+    /* Slot i holds the block ending furthest into file range
+     * (i * stride, (i + 1) * stride].  A stride of 0 means the index is empty.
+     */
+    uint32_t nci_index_stride;
+    struct nffs_cache_index_entry nci_index[MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE)];
+#endif
 };
 
 struct nffs_dirent {
@@ -250,10 +325,15 @@ struct nffs_dir {
 STATS_SECT_START(nffs_stats)
     STATS_SECT_ENTRY(nffs_hashcnt_ins)
     STATS_SECT_ENTRY(nffs_hashcnt_rm)
+    STATS_SECT_ENTRY(nffs_hashcnt_find)
+    STATS_SECT_ENTRY(nffs_hashcnt_probe)
     STATS_SECT_ENTRY(nffs_object_count)
     STATS_SECT_ENTRY(nffs_iocnt_read)
     STATS_SECT_ENTRY(nffs_iocnt_write)
     STATS_SECT_ENTRY(nffs_gccnt)
+    STATS_SECT_ENTRY(nffs_gccnt_bg)
+    STATS_SECT_ENTRY(nffs_wrlat_max)
+    STATS_SECT_ENTRY(nffs_wrlat_p99)
     STATS_SECT_ENTRY(nffs_readcnt_data)
     STATS_SECT_ENTRY(nffs_readcnt_block)
     STATS_SECT_ENTRY(nffs_readcnt_crc)
@@ -276,6 +356,10 @@ extern void *nffs_inode_mem;
 extern void *nffs_cache_inode_mem;
 extern void *nffs_cache_block_mem;
 extern void *nffs_dir_mem;
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+extern void *nffs_write_buf_mem;
+extern struct os_mempool nffs_write_buf_pool;
+#endif
 extern struct os_mempool nffs_file_pool;
 extern struct os_mempool nffs_dir_pool;
 extern struct os_mempool nffs_inode_entry_pool;
@@ -296,6 +380,7 @@ extern struct nffs_area_desc *nffs_current_area_descs;
 extern uint8_t nffs_flash_buf[NFFS_FLASH_BUF_SZ];
 
 extern struct nffs_hash_list *nffs_hash;
+extern int nffs_hash_size;
 extern struct nffs_inode_entry *nffs_root_dir;
 extern struct nffs_inode_entry *nffs_lost_found_dir;
 
@@ -344,6 +429,9 @@ void nffs_cache_inode_range(const struct nffs_cache_inode *cache_inode,
                             uint32_t *out_start, uint32_t *out_end);
 int nffs_cache_seek(struct nffs_cache_inode *cache_inode, uint32_t to,
                     struct nffs_cache_block **out_cache_block);
+void nffs_cache_index_clear(struct nffs_cache_inode *cache_inode);
+void nffs_cache_index_trim(struct nffs_cache_inode *cache_inode,
+                           uint32_t offset);
 void nffs_cache_clear(void);
 
 /* @crc */
@@ -359,6 +447,20 @@ int nffs_crc_disk_inode_validate(const struct nffs_disk_inode *disk_inode,
 void nffs_crc_disk_inode_fill(struct nffs_disk_inode *disk_inode,
                               const char *filename);
 
+/* @checkpoint */
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+extern uint32_t nffs_checkpoint_restored_gen;
+
+int nffs_checkpoint_set_slots(const struct nffs_area_desc *slot_descs);
+int nffs_checkpoint_write(void);
+int nffs_checkpoint_invalidate(void);
+int nffs_checkpoint_find(struct nffs_disk_checkpoint *out_cp,
+                         uint8_t *out_slot);
+int nffs_checkpoint_read_objects(uint8_t slot, uint32_t first_idx,
+                                 struct nffs_disk_checkpoint_object *objs,
+                                 int num_objs);
+#endif
+
 /* @config */
 void nffs_config_init(void);
 
@@ -386,6 +488,11 @@ int nffs_format_full(const struct nffs_area_desc *area_descs);
 /* @gc */
 int nffs_gc(uint8_t *out_area_idx);
 int nffs_gc_until(uint32_t space, uint8_t *out_area_idx);
+#if MYNEWT_VAL(NFFS_GC_BG)
+int nffs_gc_bg_needed(void);
+int nffs_gc_bg_step(void);
+void nffs_gc_bg_reset(void);
+#endif
 
 /* @flash */
 struct nffs_area *nffs_flash_find_area(uint16_t logical_id);
@@ -405,6 +512,7 @@ int nffs_hash_id_is_dir(uint32_t id);
 int nffs_hash_id_is_file(uint32_t id);
 int nffs_hash_id_is_inode(uint32_t id);
 int nffs_hash_id_is_block(uint32_t id);
+int nffs_hash_fn(uint32_t id);
 struct nffs_hash_entry *nffs_hash_find(uint32_t id);
 struct nffs_inode_entry *nffs_hash_find_inode(uint32_t id);
 struct nffs_hash_entry *nffs_hash_find_block(uint32_t id);
@@ -413,6 +521,7 @@ void nffs_hash_remove(struct nffs_hash_entry *entry);
 int nffs_hash_init(void);
 int nffs_hash_entry_is_dummy(struct nffs_hash_entry *he);
 int nffs_hash_id_is_dummy(uint32_t id);
+void nffs_hash_chain_info(struct nffs_hash_chain_info *out_info);
 
 /* @inode */
 struct nffs_inode_entry *nffs_inode_entry_alloc(void);
@@ -500,10 +609,21 @@ int nffs_restore_full(const struct nffs_area_desc *area_descs);
 
 /* @write */
 int nffs_write_to_file(struct nffs_file *file, const void *data, int len);
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+int nffs_write_buf_flush(struct nffs_file *file);
+int nffs_write_buf_flush_inode(struct nffs_inode_entry *inode_entry,
+                               const struct nffs_file *except);
+int nffs_write_buf_flush_all(void);
+void nffs_write_buf_free(struct nffs_file *file);
+void nffs_write_buf_reset(void);
+#endif
+void nffs_write_lat_record(uint32_t ms);
+uint32_t nffs_write_lat_p99(void);
+void nffs_write_lat_reset(void);
 
 
 #define NFFS_HASH_FOREACH(entry, i, next)                               \
-    for ((i) = 0; (i) < NFFS_HASH_SIZE; (i)++)                          \
+    for ((i) = 0; (i) < nffs_hash_size; (i)++)                          \
         for ((entry) = SLIST_FIRST(nffs_hash + (i));                    \
              (entry) && (((next)) = SLIST_NEXT((entry), nhe_next), 1);  \
              (entry) = ((next)))
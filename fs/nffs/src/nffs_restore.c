@@ -281,74 +281,83 @@ nffs_restore_sweep(void)
     struct nffs_inode inode;
     struct nffs_block block;
     int del = 0;
+    int pass;
     int rc;
     int i;
 
     /* Iterate through every object in the hash table, deleting all inodes that
-     * should be removed.
+     * should be removed.  Inodes are swept in a first pass and stray blocks in
+     * a second.  A file's last block may be a dummy; deleting it on its own
+     * would leave the file pointing at a freed entry, so the file must get
+     * the chance to delete it first.
      */
-    for (i = 0; i < NFFS_HASH_SIZE; i++) {
-        list = nffs_hash + i;
-
-        entry = SLIST_FIRST(list);
-        while (entry != NULL) {
-            next = SLIST_NEXT(entry, nhe_next);
-            if (nffs_hash_id_is_inode(entry->nhe_id)) {
-                inode_entry = (struct nffs_inode_entry *)entry;
-
-                /*
-                 * If this is a dummy inode directory, the file system
-                 * is corrupt.  Move the directory's children inodes to
-                 * the lost+found directory.
-                 */
-                rc = nffs_restore_migrate_orphan_children(inode_entry);
-                if (rc != 0) {
-                    return rc;
-                }
-
-                /* Determine if this inode needs to be deleted. */
-                rc = nffs_restore_should_sweep_inode_entry(inode_entry, &del);
-                if (rc != 0) {
-                    return rc;
-                }
-
-                rc = nffs_inode_from_entry(&inode, inode_entry);
-                if (rc != 0 && rc != FS_ENOENT) {
-                    return rc;
-                }
-
-                if (del) {
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < nffs_hash_size; i++) {
+            list = nffs_hash + i;
+
+            entry = SLIST_FIRST(list);
+            while (entry != NULL) {
+                next = SLIST_NEXT(entry, nhe_next);
+                if (pass == 0 && nffs_hash_id_is_inode(entry->nhe_id)) {
+                    inode_entry = (struct nffs_inode_entry *)entry;
 
-                    /* Remove the inode and all its children from RAM.  We
-                     * expect some file system corruption; the children are
-                     * subject to garbage collection and may not exist in the
-                     * hash.  Remove what is actually present and ignore
-                     * corruption errors.
+                    /*
+                     * If this is a dummy inode directory, the file system
+                     * is corrupt.  Move the directory's children inodes to
+                     * the lost+found directory.
                      */
-                    rc = nffs_inode_unlink_from_ram_corrupt_ok(&inode, &next);
+                    rc = nffs_restore_migrate_orphan_children(inode_entry);
                     if (rc != 0) {
                         return rc;
                     }
-                    next = SLIST_FIRST(list);
-                }
-            } else if (nffs_hash_id_is_block(entry->nhe_id)) {
-                if (nffs_hash_id_is_dummy(entry->nhe_id)) {
-                    del = 1;
-                    nffs_block_delete_from_ram(entry);
-                } else {
-                    rc = nffs_block_from_hash_entry(&block, entry);
+
+                    /* Determine if this inode needs to be deleted. */
+                    rc = nffs_restore_should_sweep_inode_entry(inode_entry,
+                                                               &del);
+                    if (rc != 0) {
+                        return rc;
+                    }
+
+                    rc = nffs_inode_from_entry(&inode, inode_entry);
                     if (rc != 0 && rc != FS_ENOENT) {
+                        return rc;
+                    }
+
+                    if (del) {
+
+                        /* Remove the inode and all its children from RAM.
+                         * We expect some file system corruption; the children
+                         * are subject to garbage collection and may not exist
+                         * in the hash.  Remove what is actually present and
+                         * ignore corruption errors.
+                         */
+                        rc = nffs_inode_unlink_from_ram_corrupt_ok(&inode,
+                                                                   &next);
+                        if (rc != 0) {
+                            return rc;
+                        }
+                        next = SLIST_FIRST(list);
+                    }
+                } else if (pass == 1 &&
+                           nffs_hash_id_is_block(entry->nhe_id)) {
+                    if (nffs_hash_id_is_dummy(entry->nhe_id)) {
                         del = 1;
                         nffs_block_delete_from_ram(entry);
+                    } else {
+                        rc = nffs_block_from_hash_entry(&block, entry);
+                        if (rc != 0 && rc != FS_ENOENT) {
+                            del = 1;
+                            nffs_block_delete_from_ram(entry);
+                        }
+                    }
+                    if (del) {
+                        del = 0;
+                        next = SLIST_FIRST(list);
                     }
                 }
-                if (del) {
-                    del = 0;
-                    next = SLIST_FIRST(list);
-                }
-            }
 
-            entry = next;
+                entry = next;
+            }
         }
     }
 
@@ -461,12 +470,14 @@ nffs_restore_inode_gets_replaced(struct nffs_inode_entry *old_inode_entry,
  * @param disk_inode            The inode just read from flash.
  * @param area_idx              The index of the area containing the inode.
  * @param area_offset           The offset within the area of the inode.
+ * @param check_crc             Whether to validate the inode's CRC; 0 if the
+ *                                  inode comes from a checkpoint.
  *
  * @return                      0 on success; nonzero on failure.
  */
 static int
 nffs_restore_inode(const struct nffs_disk_inode *disk_inode, uint8_t area_idx,
-                   uint32_t area_offset)
+                   uint32_t area_offset, int check_crc)
 {
     struct nffs_inode_entry *inode_entry;
     struct nffs_inode_entry *parent;
@@ -479,9 +490,11 @@ nffs_restore_inode(const struct nffs_disk_inode *disk_inode, uint8_t area_idx,
     new_inode = 0;
 
     /* Check the inode's CRC.  If the inode is corrupt, discard it. */
-    rc = nffs_crc_disk_inode_validate(disk_inode, area_idx, area_offset);
-    if (rc != 0) {
-        goto err;
+    if (check_crc) {
+        rc = nffs_crc_disk_inode_validate(disk_inode, area_idx, area_offset);
+        if (rc != 0) {
+            goto err;
+        }
     }
 
     inode_entry = nffs_hash_find_inode(disk_inode->ndi_id);
@@ -781,12 +794,14 @@ nffs_restore_block_gets_replaced(const struct nffs_block *old_block,
  * @param disk_block            The source disk block to insert.
  * @param area_idx              The ID of the area containing the block.
  * @param area_offset           The area_offset within the area of the block.
+ * @param check_crc             Whether to validate the block's CRC; 0 if the
+ *                                  block comes from a checkpoint.
  *
  * @return                      0 on success; nonzero on failure.
  */
 static int
 nffs_restore_block(const struct nffs_disk_block *disk_block, uint8_t area_idx,
-                   uint32_t area_offset)
+                   uint32_t area_offset, int check_crc)
 {
     struct nffs_inode_entry *inode_entry;
     struct nffs_hash_entry *entry;
@@ -800,9 +815,11 @@ nffs_restore_block(const struct nffs_disk_block *disk_block, uint8_t area_idx,
     /* Check the block's CRC.  If the block is corrupt, discard it.  If this
      * block would have superseded another, the old block becomes current.
      */
-    rc = nffs_crc_disk_block_validate(disk_block, area_idx, area_offset);
-    if (rc != 0) {
-        goto err;
+    if (check_crc) {
+        rc = nffs_crc_disk_block_validate(disk_block, area_idx, area_offset);
+        if (rc != 0) {
+            goto err;
+        }
     }
 
     entry = nffs_hash_find_block(disk_block->ndb_id);
@@ -931,11 +948,12 @@ err:
  * disk object.
  *
  * @param disk_object           The source disk object to convert.
+ * @param check_crc             Whether to validate the object's CRC.
  *
  * @return                      0 on success; nonzero on failure.
  */
 static int
-nffs_restore_object(const struct nffs_disk_object *disk_object)
+nffs_restore_object(const struct nffs_disk_object *disk_object, int check_crc)
 {
     int rc;
 
@@ -943,13 +961,13 @@ nffs_restore_object(const struct nffs_disk_object *disk_object)
     case NFFS_OBJECT_TYPE_INODE:
         rc = nffs_restore_inode(&disk_object->ndo_disk_inode,
                                 disk_object->ndo_area_idx,
-                                disk_object->ndo_offset);
+                                disk_object->ndo_offset, check_crc);
         break;
 
     case NFFS_OBJECT_TYPE_BLOCK:
         rc = nffs_restore_block(&disk_object->ndo_disk_block,
                                 disk_object->ndo_area_idx,
-                                disk_object->ndo_offset);
+                                disk_object->ndo_offset, check_crc);
         break;
 
     default:
@@ -1030,7 +1048,7 @@ nffs_restore_disk_object_size(const struct nffs_disk_object *disk_object)
 
 /**
  * Reads the specified area from disk and loads its contents into the RAM
- * representation.
+ * representation.  Reading starts at the area's current write position.
  *
  * @param area_idx              The index of the area to read.
  *
@@ -1045,14 +1063,13 @@ nffs_restore_area_contents(int area_idx)
 
     area = nffs_areas + area_idx;
 
-    area->na_cur = sizeof (struct nffs_disk_area);
     while (1) {
         rc = nffs_restore_disk_object(area_idx, area->na_cur,  &disk_object);
         switch (rc) {
         case 0:
 
             /* Valid object; restore it into the RAM representation. */
-            rc = nffs_restore_object(&disk_object);
+            rc = nffs_restore_object(&disk_object, 1);
 
             /*
              * If the restore fails the CRC check, the object length field
@@ -1087,6 +1104,106 @@ nffs_restore_area_contents(int area_idx)
     }
 }
 
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+/**
+ * Loads the objects recorded in the newest checkpoint into the RAM
+ * representation.  Checkpointed objects were already validated when they were
+ * written or first restored, so their CRCs are not checked again.  On
+ * success, each area's write position is set to its position at checkpoint
+ * time.
+ *
+ * @return                      0 on success;
+ *                              FS_ENOENT if there is no usable checkpoint;
+ *                              FS_ECORRUPT if the checkpoint does not match
+ *                                  the disk contents;
+ *                              other nonzero on error.
+ */
+static int
+nffs_restore_checkpoint(void)
+{
+    struct nffs_disk_checkpoint_object objs[16];
+    struct nffs_disk_checkpoint cp;
+    struct nffs_disk_object disk_object;
+    uint32_t area_offset;
+    uint32_t id;
+    uint32_t i;
+    uint8_t area_idx;
+    uint8_t slot;
+    int num_objs;
+    int rc;
+    int j;
+
+    rc = nffs_checkpoint_find(&cp, &slot);
+    if (rc != 0) {
+        return rc;
+    }
+
+    for (i = 0; i < cp.ndc_num_objects; i += num_objs) {
+        num_objs = cp.ndc_num_objects - i;
+        if (num_objs > sizeof objs / sizeof objs[0]) {
+            num_objs = sizeof objs / sizeof objs[0];
+        }
+
+        rc = nffs_checkpoint_read_objects(slot, i, objs, num_objs);
+        if (rc != 0) {
+            return rc;
+        }
+
+        for (j = 0; j < num_objs; j++) {
+            nffs_flash_loc_expand(objs[j].ndco_flash_loc,
+                                  &area_idx, &area_offset);
+            if (area_idx >= nffs_num_areas ||
+                area_idx == nffs_scratch_area_idx ||
+                area_offset >= nffs_areas[area_idx].na_cur) {
+
+                return FS_ECORRUPT;
+            }
+
+            rc = nffs_restore_disk_object(area_idx, area_offset,
+                                          &disk_object);
+            if (rc != 0) {
+                return FS_ECORRUPT;
+            }
+
+            if (disk_object.ndo_type == NFFS_OBJECT_TYPE_INODE) {
+                id = disk_object.ndo_disk_inode.ndi_id;
+            } else {
+                id = disk_object.ndo_disk_block.ndb_id;
+            }
+            if (id != objs[j].ndco_id) {
+                return FS_ECORRUPT;
+            }
+
+            /* As in nffs_restore_area_contents(), only corruption is fatal;
+             * other results just mean the object did not become current.
+             */
+            rc = nffs_restore_object(&disk_object, 0);
+            if (rc == FS_ECORRUPT) {
+                return rc;
+            }
+            STATS_INC(nffs_stats, nffs_object_count);
+        }
+    }
+
+    /* Objects deleted before the checkpoint are still on disk; never reuse
+     * their IDs.
+     */
+    if (cp.ndc_next_file_id > nffs_hash_next_file_id) {
+        nffs_hash_next_file_id = cp.ndc_next_file_id;
+    }
+    if (cp.ndc_next_dir_id > nffs_hash_next_dir_id) {
+        nffs_hash_next_dir_id = cp.ndc_next_dir_id;
+    }
+    if (cp.ndc_next_block_id > nffs_hash_next_block_id) {
+        nffs_hash_next_block_id = cp.ndc_next_block_id;
+    }
+
+    nffs_checkpoint_restored_gen = cp.ndc_gen;
+
+    return 0;
+}
+#endif
+
 /**
  * Reads and parses one area header.  This function does not read the area's
  * contents.
@@ -1159,7 +1276,7 @@ nffs_restore_corrupt_scratch(void)
     }
 
     /* Invalidate all objects resident in the bad area. */
-    for (i = 0; i < NFFS_HASH_SIZE; i++) {
+    for (i = 0; i < nffs_hash_size; i++) {
         entry = SLIST_FIRST(&nffs_hash[i]);
         while (entry != NULL) {
             next = SLIST_NEXT(entry, nhe_next);
@@ -1185,6 +1302,7 @@ nffs_restore_corrupt_scratch(void)
     /* Now that the objects in the scratch area have been invalidated, reload
      * everything from the good area.
      */
+    nffs_areas[good_idx].na_cur = sizeof (struct nffs_disk_area);
     rc = nffs_restore_area_contents(good_idx);
     if (rc != 0) {
         return rc;
@@ -1207,6 +1325,7 @@ nffs_log_contents(void)
     return;
 #endif
 
+    struct nffs_hash_chain_info chain_info;
     struct nffs_inode_entry *inode_entry;
     struct nffs_hash_entry *entry;
     struct nffs_hash_entry *next;
@@ -1215,6 +1334,12 @@ nffs_log_contents(void)
     int rc;
     int i;
 
+    nffs_hash_chain_info(&chain_info);
+    NFFS_LOG(DEBUG, "hash; buckets=%d entries=%u used=%u max_chain=%u\n",
+             nffs_hash_size, (unsigned int)chain_info.nhci_num_entries,
+             (unsigned int)chain_info.nhci_num_used,
+             (unsigned int)chain_info.nhci_max_len);
+
     NFFS_HASH_FOREACH(entry, i, next) {
         if (nffs_hash_id_is_block(entry->nhe_id)) {
             rc = nffs_block_from_hash_entry(&block, entry);
@@ -1274,20 +1399,17 @@ nffs_log_contents(void)
 }
 
 /**
- * Searches for a valid nffs file system among the specified areas.  This
- * function succeeds if a file system is detected among any subset of the
- * supplied areas.  If the area set does not contain a valid file system,
- * a new one can be created via a call to nffs_format().
+ * Restores the file system from the specified areas.
  *
- * @param area_descs        The area set to search.  This array must be
- *                              terminated with a 0-length area.
+ * @param area_descs        The area set to search.
+ * @param use_checkpoint    Whether to load objects from the newest
+ *                              checkpoint rather than scanning the areas from
+ *                              the start.
  *
- * @return                  0 on success;
- *                          FS_ECORRUPT if no valid file system was detected;
- *                          other nonzero on error.
+ * @return                  0 on success; nonzero on failure.
  */
-int
-nffs_restore_full(const struct nffs_area_desc *area_descs)
+static int
+nffs_restore_areas(const struct nffs_area_desc *area_descs, int use_checkpoint)
 {
     struct nffs_disk_area disk_area;
     int cur_area_idx;
@@ -1301,6 +1423,9 @@ nffs_restore_full(const struct nffs_area_desc *area_descs)
         return rc;
     }
     nffs_restore_largest_block_data_len = 0;
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+    nffs_checkpoint_restored_gen = 0;
+#endif
     nffs_current_area_descs = (struct nffs_area_desc*) area_descs;
 
     /* Read each area from flash. */
@@ -1357,11 +1482,29 @@ nffs_restore_full(const struct nffs_area_desc *area_descs)
             } else {
                 nffs_areas[cur_area_idx].na_cur =
                     sizeof (struct nffs_disk_area);
-                nffs_restore_area_contents(cur_area_idx);
             }
         }
     }
 
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+    if (use_checkpoint) {
+        /* Load the checkpointed objects; only objects written after the
+         * checkpoint remain to be scanned.
+         */
+        rc = nffs_restore_checkpoint();
+        if (rc != 0) {
+            goto err;
+        }
+    }
+#endif
+
+    /* Populate RAM with a representation of each area's contents. */
+    for (i = 0; i < nffs_num_areas; i++) {
+        if (i != nffs_scratch_area_idx) {
+            nffs_restore_area_contents(i);
+        }
+    }
+
     /* All areas have been restored from flash. */
 
     if (nffs_scratch_area_idx == NFFS_AREA_ID_NONE) {
@@ -1417,3 +1560,35 @@ err:
     nffs_misc_reset();
     return rc;
 }
+
+/**
+ * Searches for a valid nffs file system among the specified areas.  This
+ * function succeeds if a file system is detected among any subset of the
+ * supplied areas.  If the area set does not contain a valid file system,
+ * a new one can be created via a call to nffs_format().
+ *
+ * @param area_descs        The area set to search.  This array must be
+ *                              terminated with a 0-length area.
+ *
+ * @return                  0 on success;
+ *                          FS_ECORRUPT if no valid file system was detected;
+ *                          other nonzero on error.
+ */
+int
+nffs_restore_full(const struct nffs_area_desc *area_descs)
+{
+    int rc;
+
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+    /* Try the checkpoint first.  If there is none, or it does not match the
+     * disk contents, start over with a full scan.
+     */
+    rc = nffs_restore_areas(area_descs, 1);
+    if (rc == 0) {
+        return 0;
+    }
+#endif
+
+    rc = nffs_restore_areas(area_descs, 0);
+    return rc;
+}
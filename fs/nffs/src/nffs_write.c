@@ -23,6 +23,23 @@
 #include "nffs/nffs.h"
 #include "nffs_priv.h"
 
+#define NFFS_WRITE_LAT_BUCKETS  16
+
+/**
+ * Histogram of write latencies.  Bucket 0 counts writes that took under a
+ * millisecond; bucket n counts writes that took between 2^(n-1) and 2^n - 1
+ * milliseconds.  The last bucket also counts anything slower.
+ */
+static uint32_t nffs_write_lat_hist[NFFS_WRITE_LAT_BUCKETS];
+static uint32_t nffs_write_lat_count;
+static uint32_t nffs_write_lat_max;
+
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+/** Write-back buffers currently holding data. */
+static SLIST_HEAD(, nffs_write_buf) nffs_write_buf_list =
+    SLIST_HEAD_INITIALIZER(nffs_write_buf_list);
+#endif
+
 static int
 nffs_write_fill_crc16_overwrite(struct nffs_disk_block *disk_block,
                                 uint8_t src_area_idx, uint32_t src_area_offset,
@@ -369,10 +386,218 @@ nffs_write_chunk(struct nffs_inode_entry *inode_entry, uint32_t file_offset,
         }
     } while (data_offset > 0);
 
+    if (append_len > 0) {
+        /* The last block grew; its indexed end offset is stale. */
+        nffs_cache_index_trim(cache_inode, cache_inode->nci_file_size);
+    }
     cache_inode->nci_file_size += append_len;
     return 0;
 }
 
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+/**
+ * Writes a file handle's buffered data to flash as a single data block.  On
+ * success, the buffer is returned to the pool.  On failure, the data stays
+ * buffered.
+ *
+ * @param file                  The file handle to flush.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+int
+nffs_write_buf_flush(struct nffs_file *file)
+{
+    struct nffs_write_buf *buf;
+    int rc;
+
+    buf = file->nf_write_buf;
+    if (buf == NULL) {
+        return 0;
+    }
+
+    rc = nffs_write_chunk(file->nf_inode_entry, buf->nwb_offset,
+                          buf->nwb_data, buf->nwb_len);
+    if (rc != 0) {
+        return rc;
+    }
+
+    nffs_write_buf_free(file);
+
+    return 0;
+}
+
+/**
+ * Flushes every file handle that has buffered data for the specified file.
+ *
+ * @param inode_entry           The file whose buffered data gets flushed.
+ * @param except                A file handle to leave buffered; null to flush
+ *                                  all handles.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+int
+nffs_write_buf_flush_inode(struct nffs_inode_entry *inode_entry,
+                           const struct nffs_file *except)
+{
+    struct nffs_write_buf *buf;
+    struct nffs_write_buf *next;
+    int rc;
+
+    buf = SLIST_FIRST(&nffs_write_buf_list);
+    while (buf != NULL) {
+        next = SLIST_NEXT(buf, nwb_next);
+
+        if (buf->nwb_file != except &&
+            buf->nwb_file->nf_inode_entry == inode_entry) {
+
+            rc = nffs_write_buf_flush(buf->nwb_file);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+
+        buf = next;
+    }
+
+    return 0;
+}
+
+/**
+ * Flushes every file handle that has buffered data.  A handle that cannot be
+ * flushed keeps its data buffered and does not stop the others from being
+ * flushed.
+ *
+ * @return                      0 on success; the first error on failure.
+ */
+int
+nffs_write_buf_flush_all(void)
+{
+    struct nffs_write_buf *buf;
+    struct nffs_write_buf *next;
+    int first_rc;
+    int rc;
+
+    first_rc = 0;
+    buf = SLIST_FIRST(&nffs_write_buf_list);
+    while (buf != NULL) {
+        next = SLIST_NEXT(buf, nwb_next);
+
+        rc = nffs_write_buf_flush(buf->nwb_file);
+        if (rc != 0 && first_rc == 0) {
+            first_rc = rc;
+        }
+
+        buf = next;
+    }
+
+    return first_rc;
+}
+
+/**
+ * Discards a file handle's buffered data, if any, and returns its buffer to
+ * the pool.
+ *
+ * @param file                  The file handle whose buffer gets freed.
+ */
+void
+nffs_write_buf_free(struct nffs_file *file)
+{
+    struct nffs_write_buf *buf;
+
+    buf = file->nf_write_buf;
+    if (buf != NULL) {
+        SLIST_REMOVE(&nffs_write_buf_list, buf, nffs_write_buf, nwb_next);
+        os_memblock_put(&nffs_write_buf_pool, buf);
+        file->nf_write_buf = NULL;
+    }
+}
+
+/**
+ * Forgets all write-back buffers.  This is used when the buffer pool gets
+ * reinitialized.
+ */
+void
+nffs_write_buf_reset(void)
+{
+    SLIST_INIT(&nffs_write_buf_list);
+}
+
+/**
+ * Collects as much of an append as possible in the file handle's write-back
+ * buffer.  A full buffer is written to flash as a single data block.  Only
+ * handles opened with FS_ACCESS_APPEND are buffered; other handles keep
+ * writing straight to flash.  Writes of at least a buffer's size are not
+ * buffered, and neither is anything when all buffers are in use.
+ *
+ * @param file                  The file handle being written to.
+ * @param inout_data            On input, the data to write; on output, the
+ *                                  data that was not buffered.
+ * @param inout_len             On input, the length of the data to write; on
+ *                                  output, the length of the data that was
+ *                                  not buffered.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+static int
+nffs_write_buf_append(struct nffs_file *file, const uint8_t **inout_data,
+                      int *inout_len)
+{
+    struct nffs_write_buf *buf;
+    uint16_t buf_size;
+    uint16_t chunk_size;
+    int rc;
+
+    if (!(file->nf_access_flags & FS_ACCESS_APPEND)) {
+        return 0;
+    }
+
+    buf_size = MYNEWT_VAL(NFFS_WRITE_BUF_SIZE);
+    if (buf_size > nffs_block_max_data_sz) {
+        buf_size = nffs_block_max_data_sz;
+    }
+
+    while (*inout_len > 0) {
+        buf = file->nf_write_buf;
+        if (buf == NULL) {
+            if (*inout_len >= buf_size) {
+                return 0;
+            }
+
+            buf = os_memblock_get(&nffs_write_buf_pool);
+            if (buf == NULL) {
+                return 0;
+            }
+
+            buf->nwb_file = file;
+            buf->nwb_offset = file->nf_offset;
+            buf->nwb_len = 0;
+            SLIST_INSERT_HEAD(&nffs_write_buf_list, buf, nwb_next);
+            file->nf_write_buf = buf;
+        }
+
+        chunk_size = buf_size - buf->nwb_len;
+        if (chunk_size > *inout_len) {
+            chunk_size = *inout_len;
+        }
+
+        memcpy(buf->nwb_data + buf->nwb_len, *inout_data, chunk_size);
+        buf->nwb_len += chunk_size;
+        file->nf_offset += chunk_size;
+        *inout_data += chunk_size;
+        *inout_len -= chunk_size;
+
+        if (buf->nwb_len == buf_size) {
+            rc = nffs_write_buf_flush(file);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+    }
+
+    return 0;
+}
+#endif
+
 /**
  * Writes a chunk of contiguous data to a file.
  *
@@ -398,6 +623,14 @@ nffs_write_to_file(struct nffs_file *file, const void *data, int len)
         return 0;
     }
 
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    /* Data that other handles appended to this file goes first. */
+    rc = nffs_write_buf_flush_inode(file->nf_inode_entry, file);
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
     rc = nffs_cache_inode_ensure(&cache_inode, file->nf_inode_entry);
     if (rc != 0) {
         return rc;
@@ -408,10 +641,34 @@ nffs_write_to_file(struct nffs_file *file, const void *data, int len)
      */
     if (file->nf_access_flags & FS_ACCESS_APPEND) {
         file->nf_offset = cache_inode->nci_file_size;
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+        if (file->nf_write_buf != NULL) {
+            file->nf_offset += file->nf_write_buf->nwb_len;
+        }
+#endif
     }
 
-    /* Write data as a sequence of blocks. */
     data_ptr = data;
+
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    rc = nffs_write_buf_append(file, &data_ptr, &len);
+    if (rc != 0) {
+        return rc;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    /* The rest of the write bypasses the buffer; anything still buffered must
+     * reach flash before it.
+     */
+    rc = nffs_write_buf_flush(file);
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
+    /* Write data as a sequence of blocks. */
     while (len > 0) {
         if (len > nffs_block_max_data_sz) {
             chunk_size = nffs_block_max_data_sz;
@@ -432,3 +689,79 @@ nffs_write_to_file(struct nffs_file *file, const void *data, int len)
 
     return 0;
 }
+
+/**
+ * Records the latency of a single write and updates the write latency stats.
+ *
+ * @param ms                    The duration of the write, in milliseconds.
+ */
+void
+nffs_write_lat_record(uint32_t ms)
+{
+    int bucket;
+
+    bucket = 0;
+    while (bucket < NFFS_WRITE_LAT_BUCKETS - 1 && ms >= 1u << bucket) {
+        bucket++;
+    }
+
+    nffs_write_lat_hist[bucket]++;
+    nffs_write_lat_count++;
+
+    if (ms > nffs_write_lat_max) {
+        nffs_write_lat_max = ms;
+        STATS_CLEAR(nffs_stats, nffs_wrlat_max);
+        STATS_INCN(nffs_stats, nffs_wrlat_max, ms);
+    }
+
+    STATS_CLEAR(nffs_stats, nffs_wrlat_p99);
+    STATS_INCN(nffs_stats, nffs_wrlat_p99, nffs_write_lat_p99());
+}
+
+/**
+ * Estimates the 99th percentile write latency from the latency histogram.
+ * The estimate is the upper bound of the histogram bucket containing the
+ * percentile, capped at the slowest write recorded.
+ *
+ * @return                      The 99th percentile latency, in milliseconds.
+ */
+uint32_t
+nffs_write_lat_p99(void)
+{
+    uint32_t target;
+    uint32_t sum;
+    uint32_t ms;
+    int i;
+
+    /* Number of writes at or below the percentile, rounded up. */
+    target = nffs_write_lat_count - nffs_write_lat_count / 100;
+
+    sum = 0;
+    for (i = 0; i < NFFS_WRITE_LAT_BUCKETS - 1; i++) {
+        sum += nffs_write_lat_hist[i];
+        if (sum >= target) {
+            break;
+        }
+    }
+
+    ms = (1u << i) - 1;
+    if (ms > nffs_write_lat_max) {
+        ms = nffs_write_lat_max;
+    }
+
+    return ms;
+}
+
+/**
+ * Clears the write latency histogram and stats.
+ */
+void
+nffs_write_lat_reset(void)
+{
+    memset(nffs_write_lat_hist, 0, sizeof nffs_write_lat_hist);
+    nffs_write_lat_count = 0;
+    nffs_write_lat_max = 0;
+
+    STATS_CLEAR(nffs_stats, nffs_wrlat_max);
+    STATS_CLEAR(nffs_stats, nffs_wrlat_p99);
+}
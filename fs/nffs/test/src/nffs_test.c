@@ -108,6 +108,16 @@ TEST_CASE_DECL(nffs_test_lost_found)
 TEST_CASE_DECL(nffs_test_readdir)
 TEST_CASE_DECL(nffs_test_split_file)
 TEST_CASE_DECL(nffs_test_gc_on_oom)
+TEST_CASE_DECL(nffs_test_hash)
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+TEST_CASE_DECL(nffs_test_checkpoint)
+#endif
+#if MYNEWT_VAL(NFFS_GC_BG)
+TEST_CASE_DECL(nffs_test_gc_bg)
+#endif
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+TEST_CASE_DECL(nffs_test_write_buf)
+#endif
 
 void
 nffs_test_suite_gen_1_1_init(void)
@@ -174,9 +184,22 @@ TEST_SUITE(nffs_test_suite)
     nffs_test_readdir();
     nffs_test_split_file();
     nffs_test_gc_on_oom();
+    nffs_test_hash();
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+    nffs_test_checkpoint();
+#endif
+#if MYNEWT_VAL(NFFS_GC_BG)
+    nffs_test_gc_bg();
+#endif
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+    nffs_test_write_buf();
+#endif
 }
 
 TEST_CASE_DECL(nffs_test_cache_large_file)
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+TEST_CASE_DECL(nffs_test_cache_index)
+#endif
 
 TEST_SUITE(nffs_suite_cache)
 {
@@ -186,6 +209,9 @@ TEST_SUITE(nffs_suite_cache)
     TEST_ASSERT(rc == 0);
 
     nffs_test_cache_large_file();
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+    nffs_test_cache_index();
+#endif
 }
 
 void
@@ -200,28 +226,58 @@ nffs_test_suite_cache_init(void)
     return;
 }
 
-int
-main(void)
+/*
+ * The general suite runs once per cache configuration.  Each run sets its
+ * own init callback so that it can be started in a separate process.
+ */
+static void
+nffs_test_suite_gen_1_1(void)
 {
-    nffs_config.nc_num_inodes = 1024 * 8;
-    nffs_config.nc_num_blocks = 1024 * 20;
-    nffs_current_area_descs = nffs_selftest_area_descs;
-
-    sysinit();
-
     tu_suite_set_init_cb((void*)nffs_test_suite_gen_1_1_init, NULL);
     nffs_test_suite();
+}
 
+static void
+nffs_test_suite_gen_4_32(void)
+{
     tu_suite_set_init_cb((void*)nffs_test_suite_gen_4_32_init, NULL);
     nffs_test_suite();
+}
 
+static void
+nffs_test_suite_gen_32_1024(void)
+{
     tu_suite_set_init_cb((void*)nffs_test_suite_gen_32_1024_init, NULL);
     nffs_test_suite();
+}
 
+static void
+nffs_test_suite_cache(void)
+{
     tu_suite_set_init_cb((void*)nffs_test_suite_cache_init, NULL);
     nffs_suite_cache();
+}
 
-    return tu_any_failed;
+static const struct ts_suite nffs_test_suites[] = {
+    TEST_SUITE_ENTRY(nffs_test_suite_gen_1_1),
+    TEST_SUITE_ENTRY(nffs_test_suite_gen_4_32),
+    TEST_SUITE_ENTRY(nffs_test_suite_gen_32_1024),
+    TEST_SUITE_ENTRY(nffs_test_suite_cache),
+};
+
+int
+main(void)
+{
+    nffs_config.nc_num_inodes = 1024 * 8;
+    nffs_config.nc_num_blocks = 1024 * 20;
+    nffs_current_area_descs = nffs_selftest_area_descs;
+
+    sysinit();
+
+    return tu_suite_run_parallel(nffs_test_suites,
+                                 sizeof nffs_test_suites /
+                                 sizeof nffs_test_suites[0],
+                                 MYNEWT_VAL(TESTUTIL_PARALLEL_JOBS));
 }
 
 #if 0
@@ -404,12 +460,6 @@ print_nffs_flash_areas(int verbose)
     }
 }
 
-static int
-nffs_hash_fn(uint32_t id)
-{
-    return id % NFFS_HASH_SIZE;
-}
-
 void
 print_hashlist(struct nffs_hash_entry *he)
 {
@@ -685,7 +735,7 @@ print_hash_entries(int verbose)
     struct nffs_hash_entry *next;
 
     printf("\nnffs_hash_entries:\n");
-    for (i = 0; i < NFFS_HASH_SIZE; i++) {
+    for (i = 0; i < nffs_hash_size; i++) {
         he = SLIST_FIRST(nffs_hash + i);
         while (he != NULL) {
             next = SLIST_NEXT(he, nhe_next);
@@ -581,28 +581,42 @@ nffs_test_assert_children_sorted(struct nffs_inode_entry *inode_entry)
 void
 nffs_test_assert_system_once(const struct nffs_test_file_desc *root_dir)
 {
+    static struct nffs_hash_entry *bucket_entries[NFFS_TEST_TOUCHED_ARR_SZ];
     struct nffs_inode_entry *inode_entry;
     struct nffs_hash_entry *entry;
-    struct nffs_hash_entry *next;
+    int num_entries;
     int i;
+    int j;
 
     nffs_test_num_touched_entries = 0;
     nffs_test_assert_file(root_dir, nffs_root_dir, "");
     nffs_test_assert_branch_touched(nffs_root_dir);
 
-    /* Ensure no orphaned inodes or blocks. */
-    NFFS_HASH_FOREACH(entry, i, next) {
-        TEST_ASSERT(entry->nhe_flash_loc != NFFS_FLASH_LOC_NONE);
-        if (nffs_hash_id_is_inode(entry->nhe_id)) {
-            inode_entry = (void *)entry;
-            TEST_ASSERT(inode_entry->nie_refcnt == 1);
-            if (entry->nhe_id == NFFS_ID_ROOT_DIR) {
-                TEST_ASSERT(inode_entry == nffs_root_dir);
+    /* Ensure no orphaned inodes or blocks.  Inode lookups move entries to the
+     * front of their hash bucket, so each bucket is copied before it is
+     * checked.
+     */
+    for (i = 0; i < nffs_hash_size; i++) {
+        num_entries = 0;
+        SLIST_FOREACH(entry, nffs_hash + i, nhe_next) {
+            TEST_ASSERT_FATAL(num_entries < NFFS_TEST_TOUCHED_ARR_SZ);
+            bucket_entries[num_entries++] = entry;
+        }
+
+        for (j = 0; j < num_entries; j++) {
+            entry = bucket_entries[j];
+            TEST_ASSERT(entry->nhe_flash_loc != NFFS_FLASH_LOC_NONE);
+            if (nffs_hash_id_is_inode(entry->nhe_id)) {
+                inode_entry = (void *)entry;
+                TEST_ASSERT(inode_entry->nie_refcnt == 1);
+                if (entry->nhe_id == NFFS_ID_ROOT_DIR) {
+                    TEST_ASSERT(inode_entry == nffs_root_dir);
+                } else {
+                    nffs_test_assert_child_inode_present(inode_entry);
+                }
             } else {
-                nffs_test_assert_child_inode_present(inode_entry);
+                nffs_test_assert_block_present(entry);
             }
-        } else {
-            nffs_test_assert_block_present(entry);
         }
     }
 
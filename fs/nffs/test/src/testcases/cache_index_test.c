@@ -0,0 +1,138 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "nffs_test_utils.h"
+
+#if MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE) > 0
+static void
+nffs_test_cache_index_read(struct fs_file *file, const uint8_t *data,
+                           uint32_t offset)
+{
+    uint32_t bytes_read;
+    uint8_t b;
+    int rc;
+
+    rc = fs_seek(file, offset);
+    TEST_ASSERT(rc == 0);
+    rc = fs_read(file, 1, &b, &bytes_read);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(bytes_read == 1);
+    TEST_ASSERT(b == data[offset]);
+}
+
+TEST_CASE(nffs_test_cache_index)
+{
+    static uint8_t data[NFFS_BLOCK_MAX_DATA_SZ_MAX * 24];
+    static uint8_t expected[NFFS_BLOCK_MAX_DATA_SZ_MAX * 25];
+    struct nffs_cache_inode *cache_inode;
+    struct fs_file *file;
+    uint32_t stride;
+    uint32_t bsz;
+    int rc;
+    int i;
+
+    /*** Setup. */
+    rc = nffs_format(nffs_current_area_descs);
+    TEST_ASSERT(rc == 0);
+
+    for (i = 0; i < sizeof data; i++) {
+        data[i] = i * 7;
+    }
+    nffs_test_util_create_file("/myfile.txt", (char *)data, sizeof data);
+    nffs_cache_clear();
+
+    bsz = nffs_block_max_data_sz;
+
+    rc = fs_open("/myfile.txt", FS_ACCESS_READ | FS_ACCESS_WRITE, &file);
+    TEST_ASSERT(rc == 0);
+    rc = nffs_cache_inode_ensure(&cache_inode,
+                                 ((struct nffs_file *)file)->nf_inode_entry);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(cache_inode->nci_index_stride == 0);
+
+    /* Seeking to the start walks the whole chain and fills the index. */
+    nffs_test_cache_index_read(file, data, 0);
+    TEST_ASSERT(cache_inode->nci_index_stride != 0);
+    for (i = 0; i < MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE); i++) {
+        TEST_ASSERT(cache_inode->nci_index[i].ncie_block_entry != NULL);
+    }
+
+    /* Seeks beyond the cache start from an indexed block. */
+    nffs_test_cache_index_read(file, data, bsz * 12 + 5);
+    nffs_test_util_assert_cache_range("/myfile.txt", bsz * 12, bsz * 13);
+
+    /* Long gaps before the cache are not bridged. */
+    nffs_test_cache_index_read(file, data, bsz * 2);
+    nffs_test_util_assert_cache_range("/myfile.txt", bsz * 2, bsz * 3);
+
+    nffs_test_cache_index_read(file, data, bsz * 22 + bsz - 1);
+    nffs_test_util_assert_cache_range("/myfile.txt", bsz * 22, bsz * 23);
+
+    nffs_test_cache_index_read(file, data, bsz * 13);
+    nffs_test_util_assert_cache_range("/myfile.txt", bsz * 13, bsz * 14);
+
+    /* Short gaps still are. */
+    nffs_test_cache_index_read(file, data, bsz * 12);
+    nffs_test_util_assert_cache_range("/myfile.txt", bsz * 12, bsz * 14);
+
+    /* An append past the indexed range widens the index. */
+    stride = cache_inode->nci_index_stride;
+    rc = fs_seek(file, sizeof data);
+    TEST_ASSERT(rc == 0);
+    rc = fs_write(file, data, bsz / 2);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(cache_inode->nci_index_stride == stride * 2);
+    nffs_test_cache_index_read(file, data, bsz * 7 + 3);
+
+    /* Extending the last block by overwriting it only drops that block's
+     * index entry.
+     */
+    stride = cache_inode->nci_index_stride;
+    rc = fs_seek(file, sizeof data + bsz / 2 - 4);
+    TEST_ASSERT(rc == 0);
+    rc = fs_write(file, data, 8);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(cache_inode->nci_index_stride == stride);
+    TEST_ASSERT(cache_inode->nci_index[0].ncie_block_entry != NULL);
+    for (i = 0; i < MYNEWT_VAL(NFFS_CACHE_INDEX_SIZE); i++) {
+        if (cache_inode->nci_index[i].ncie_block_entry != NULL) {
+            TEST_ASSERT(cache_inode->nci_index[i].ncie_block_end <=
+                        sizeof data);
+        }
+    }
+    nffs_test_cache_index_read(file, data, bsz * 1);
+
+    /* Garbage collection clears the index. */
+    rc = nffs_gc(NULL);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(cache_inode->nci_index_stride == 0);
+    nffs_test_cache_index_read(file, data, bsz * 9 + 1);
+    nffs_test_cache_index_read(file, data, bsz * 3);
+
+    rc = fs_close(file);
+    TEST_ASSERT(rc == 0);
+
+    memcpy(expected, data, sizeof data);
+    memcpy(expected + sizeof data, data, bsz / 2 - 4);
+    memcpy(expected + sizeof data + bsz / 2 - 4, data, 8);
+    nffs_test_util_assert_contents("/myfile.txt", (char *)expected,
+                                   sizeof data + bsz / 2 + 4);
+    nffs_test_util_assert_cache_is_sane("/myfile.txt");
+}
+#endif
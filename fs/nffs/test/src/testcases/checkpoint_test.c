@@ -0,0 +1,118 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "nffs_test_utils.h"
+
+#if MYNEWT_VAL(NFFS_CHECKPOINT)
+TEST_CASE(nffs_test_checkpoint)
+{
+    int rc;
+
+    static const struct nffs_area_desc area_descs[] = {
+        { 0x00000000, 16 * 1024 },
+        { 0x00004000, 16 * 1024 },
+        { 0x00008000, 16 * 1024 },
+        { 0x0000c000, 16 * 1024 },
+        { 0, 0 },
+    };
+
+    static const struct nffs_area_desc slot_descs[] = {
+        { 0x00020000, 128 * 1024 },
+        { 0x00040000, 128 * 1024 },
+    };
+
+    struct nffs_test_file_desc *expected_system =
+        (struct nffs_test_file_desc[]) { {
+            .filename = "",
+            .is_dir = 1,
+            .children = (struct nffs_test_file_desc[]) { {
+                .filename = "a.txt",
+                .contents = "aaaaAAAA",
+                .contents_len = 8,
+            }, {
+                .filename = "mydir",
+                .is_dir = 1,
+                .children = (struct nffs_test_file_desc[]) { {
+                    .filename = "c.txt",
+                    .contents = "cccc",
+                    .contents_len = 4,
+                }, {
+                    .filename = NULL,
+                } },
+            }, {
+                .filename = NULL,
+            } },
+    } };
+
+    rc = nffs_checkpoint_init(slot_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    rc = nffs_format(area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    nffs_test_util_create_file("/a.txt", "aaaa", 4);
+    nffs_test_util_create_file("/b.txt", "bbbb", 4);
+    rc = fs_mkdir("/mydir");
+    TEST_ASSERT_FATAL(rc == 0);
+
+    rc = nffs_checkpoint();
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* Objects written after the checkpoint get replayed from the areas. */
+    nffs_test_util_append_file("/a.txt", "AAAA", 4);
+    rc = fs_unlink("/b.txt");
+    TEST_ASSERT_FATAL(rc == 0);
+    nffs_test_util_create_file("/mydir/c.txt", "cccc", 4);
+
+    rc = nffs_misc_reset();
+    TEST_ASSERT(rc == 0);
+    rc = nffs_detect(area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(nffs_checkpoint_restored_gen == 1);
+    nffs_test_assert_system_once(expected_system);
+
+    /* Garbage collection writes a new checkpoint every cycle by default. */
+    nffs_test_assert_system(expected_system, area_descs);
+#if MYNEWT_VAL(NFFS_CHECKPOINT_GC_INTERVAL) == 1
+    TEST_ASSERT(nffs_checkpoint_restored_gen == 2);
+#endif
+
+    /* A corrupt checkpoint is ignored.  The older one no longer matches the
+     * areas, so restore falls back to a full scan.
+     */
+    rc = flash_native_memset(slot_descs[1].nad_offset + 4, 0, 4);
+    TEST_ASSERT(rc == 0);
+    rc = nffs_detect(area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(nffs_checkpoint_restored_gen == 0);
+    nffs_test_assert_system_once(expected_system);
+
+    /* Formatting invalidates all checkpoints. */
+    rc = nffs_checkpoint();
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = nffs_format(area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = nffs_detect(area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(nffs_checkpoint_restored_gen == 0);
+
+    rc = nffs_checkpoint_init(NULL);
+    TEST_ASSERT(rc == 0);
+}
+#endif
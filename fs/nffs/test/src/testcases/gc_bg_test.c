@@ -0,0 +1,132 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "nffs_test_utils.h"
+
+#if MYNEWT_VAL(NFFS_GC_BG)
+/*
+ * Runs background garbage collection cycles, as the callout would, until one
+ * compacts an area or there is nothing left to do.
+ */
+static int
+nffs_test_gc_bg_run(int *out_cycles)
+{
+    unsigned int gc_count;
+    int rc;
+
+    gc_count = nffs_gc_count;
+    *out_cycles = 0;
+    do {
+        rc = nffs_gc_bg_step();
+        (*out_cycles)++;
+    } while (rc == 0 && nffs_gc_count == gc_count);
+
+    return rc;
+}
+
+TEST_CASE(nffs_test_gc_bg)
+{
+    static const struct nffs_area_desc area_descs[] = {
+        { 0x00000000, 16 * 1024 },
+        { 0x00004000, 16 * 1024 },
+        { 0x00008000, 16 * 1024 },
+        { 0x0000c000, 16 * 1024 },
+        { 0, 0 },
+    };
+
+    static char data[1000];
+    unsigned int gc_count;
+    char filename[16];
+    int num_writes;
+    int cycles;
+    int rc;
+    int i;
+
+    memset(data, 'x', sizeof data);
+
+    rc = nffs_format(area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* Nothing to do on an empty disk. */
+    TEST_ASSERT(!nffs_gc_bg_needed());
+    TEST_ASSERT(nffs_gc_bg_step() == FS_ENOENT);
+
+    /* Fill the disk with live files; there is no garbage to collect. */
+    for (i = 0; !nffs_gc_bg_needed(); i++) {
+        snprintf(filename, sizeof filename, "/file%d", i);
+        nffs_test_util_create_file(filename, data, sizeof data);
+    }
+    TEST_ASSERT(nffs_test_gc_bg_run(&cycles) == FS_ENOENT);
+
+    /* Each file has an inode and a data block; tallying them is spread over
+     * several cycles.
+     */
+    if (2 * i > MYNEWT_VAL(NFFS_GC_BG_SCAN_ENTRIES)) {
+        TEST_ASSERT(cycles > 1);
+    }
+
+    /* Repeatedly rewrite a single file so that old copies become garbage. */
+    rc = nffs_format(area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    gc_count = nffs_gc_count;
+    for (i = 0; !nffs_gc_bg_needed(); i++) {
+        data[0] = 'a' + i % 26;
+        nffs_test_util_create_file("/myfile", data, sizeof data);
+    }
+    TEST_ASSERT(nffs_gc_count == gc_count);
+
+    /* One cycle compacts an area that held nothing but garbage. */
+    rc = nffs_gc_bg_step();
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(nffs_gc_count == gc_count + 1);
+    TEST_ASSERT(!nffs_gc_bg_needed());
+    nffs_test_util_assert_contents("/myfile", data, sizeof data);
+
+    /* The reclaimed space absorbs further writes without a synchronous
+     * garbage collection cycle.
+     */
+    gc_count = nffs_gc_count;
+    for (num_writes = 0; !nffs_gc_bg_needed(); num_writes++) {
+        data[0] = 'a' + num_writes % 26;
+        nffs_test_util_create_file("/myfile", data, sizeof data);
+    }
+    TEST_ASSERT(num_writes > 0);
+    TEST_ASSERT(nffs_gc_count == gc_count);
+
+    rc = nffs_gc_bg_step();
+    TEST_ASSERT(rc == 0);
+    nffs_test_util_assert_contents("/myfile", data, sizeof data);
+
+    /* Write latency percentile tracking. */
+    nffs_write_lat_reset();
+    TEST_ASSERT(nffs_write_lat_p99() == 0);
+
+    for (i = 0; i < 99; i++) {
+        nffs_write_lat_record(1);
+    }
+    TEST_ASSERT(nffs_write_lat_p99() == 1);
+
+    /* One slow write in 100 stays above the percentile; two do not. */
+    nffs_write_lat_record(300);
+    TEST_ASSERT(nffs_write_lat_p99() == 1);
+    nffs_write_lat_record(300);
+    TEST_ASSERT(nffs_write_lat_p99() == 300);
+}
+#endif
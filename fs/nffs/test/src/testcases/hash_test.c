@@ -0,0 +1,124 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "nffs_test_utils.h"
+
+#define NFFS_TEST_HASH_LEGACY_SIZE  256
+
+/**
+ * Restores a synthetic volume of `num_files` files with `blocks_per_file`
+ * blocks each, and compares the cost of finding every hash entry against the
+ * fixed 256-bucket modulo hash that nffs used to have.
+ *
+ * Restore looks up every object it reads, so the probe count stands in for
+ * the restore time: one build only has one hash sizing, and the time of a
+ * simulated restore is mostly flash reads and too noisy to compare.
+ */
+static void
+nffs_test_hash_restore_volume(int num_files, int blocks_per_file)
+{
+    static uint32_t legacy_lens[NFFS_TEST_HASH_LEGACY_SIZE];
+    struct nffs_hash_chain_info info;
+    struct nffs_hash_entry *entry;
+    struct nffs_hash_entry *next;
+    struct fs_file *file;
+    uint32_t legacy_probe_sum;
+    uint32_t legacy_max_len;
+    char filename[16];
+    uint8_t data[8];
+    int rc;
+    int i;
+    int j;
+
+    rc = nffs_format(nffs_current_area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    for (i = 0; i < num_files; i++) {
+        snprintf(filename, sizeof filename, "/file%d", i);
+        rc = fs_open(filename, FS_ACCESS_WRITE, &file);
+        TEST_ASSERT_FATAL(rc == 0);
+
+        /* Each write appends a new block. */
+        for (j = 0; j < blocks_per_file; j++) {
+            memset(data, j, sizeof data);
+            rc = fs_write(file, data, sizeof data);
+            TEST_ASSERT_FATAL(rc == 0);
+        }
+
+        rc = fs_close(file);
+        TEST_ASSERT(rc == 0);
+    }
+
+    rc = nffs_misc_reset();
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = nffs_detect(nffs_current_area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    nffs_hash_chain_info(&info);
+    TEST_ASSERT(info.nhci_num_entries >=
+                num_files * (blocks_per_file + 1) + 1);
+
+    memset(legacy_lens, 0, sizeof legacy_lens);
+    legacy_probe_sum = 0;
+    legacy_max_len = 0;
+    NFFS_HASH_FOREACH(entry, i, next) {
+        j = entry->nhe_id % NFFS_TEST_HASH_LEGACY_SIZE;
+        legacy_lens[j]++;
+        legacy_probe_sum += legacy_lens[j];
+        if (legacy_lens[j] > legacy_max_len) {
+            legacy_max_len = legacy_lens[j];
+        }
+    }
+
+#if MYNEWT_VAL(NFFS_HASH_SIZE) == 0
+    /* A table sized for the configuration keeps chains at a few entries. */
+    TEST_ASSERT(info.nhci_max_len <= legacy_max_len);
+    TEST_ASSERT(info.nhci_probe_sum <= legacy_probe_sum);
+    TEST_ASSERT(info.nhci_probe_sum <=
+                info.nhci_num_entries * (NFFS_HASH_AUTO_LOAD + 1));
+#endif
+
+    /* Spot check the restored volume. */
+    snprintf(filename, sizeof filename, "/file%d", num_files - 1);
+    rc = fs_open(filename, FS_ACCESS_READ, &file);
+    TEST_ASSERT_FATAL(rc == 0);
+    nffs_test_util_assert_file_len(file, blocks_per_file * sizeof data);
+    rc = fs_close(file);
+    TEST_ASSERT(rc == 0);
+}
+
+TEST_CASE(nffs_test_hash)
+{
+    int a;
+    int b;
+    int c;
+
+    /* Directories, files, and blocks with the same low ID bits land in
+     * different buckets.
+     */
+    a = nffs_hash_fn(NFFS_ID_DIR_MIN + 1);
+    b = nffs_hash_fn(NFFS_ID_FILE_MIN + 1);
+    c = nffs_hash_fn(NFFS_ID_BLOCK_MIN + 1);
+    TEST_ASSERT(a != b && b != c && a != c);
+    TEST_ASSERT(a < nffs_hash_size && b < nffs_hash_size &&
+                c < nffs_hash_size);
+
+    nffs_test_hash_restore_volume(8, 32);
+    nffs_test_hash_restore_volume(16, 48);
+}
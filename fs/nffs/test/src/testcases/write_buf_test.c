@@ -0,0 +1,235 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "nffs_test_utils.h"
+
+#if MYNEWT_VAL(NFFS_WRITE_BUF_SIZE) > 0
+static int
+nffs_test_write_buf_num_blocks(const char *filename)
+{
+    struct nffs_inode_entry *inode_entry;
+    struct nffs_hash_entry *entry;
+    struct nffs_block block;
+    int num_blocks;
+    int rc;
+
+    rc = nffs_path_find_inode_entry(filename, &inode_entry);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    num_blocks = 0;
+    for (entry = inode_entry->nie_last_block_entry;
+         entry != NULL;
+         entry = block.nb_prev) {
+
+        rc = nffs_block_from_hash_entry(&block, entry);
+        TEST_ASSERT_FATAL(rc == 0);
+        num_blocks++;
+    }
+
+    return num_blocks;
+}
+
+#if MYNEWT_VAL(NFFS_WRITE_BUF_FLUSH_MS) > 0
+/*
+ * Moves OS time forward and runs the callouts that expire, as the OS would if
+ * it were running.
+ */
+static void
+nffs_test_write_buf_advance(os_time_t ticks)
+{
+    struct os_event *ev;
+
+    os_time_advance(ticks);
+    os_callout_tick();
+    while ((ev = os_eventq_get_no_wait(os_eventq_dflt_get())) != NULL) {
+        ev->ev_cb(ev);
+    }
+}
+#endif
+
+TEST_CASE(nffs_test_write_buf)
+{
+    struct fs_file *files[3];
+    struct fs_file *file;
+    char expected[1024];
+    char record[20];
+    uint32_t len;
+#if MYNEWT_VAL(NFFS_WRITE_BUF_FLUSH_MS) > 0
+    os_time_t ticks;
+#endif
+    int buf_size;
+    int rc;
+    int i;
+
+    buf_size = MYNEWT_VAL(NFFS_WRITE_BUF_SIZE);
+    if (buf_size > nffs_block_max_data_sz) {
+        buf_size = nffs_block_max_data_sz;
+    }
+
+    rc = nffs_format(nffs_current_area_descs);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /*** Small appends are held in RAM until the handle is closed. */
+    rc = fs_open("/log", FS_ACCESS_WRITE | FS_ACCESS_APPEND, &file);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    for (i = 0; i < 5; i++) {
+        memset(record, 'a' + i, sizeof record);
+        memcpy(expected + i * sizeof record, record, sizeof record);
+        rc = fs_write(file, record, sizeof record);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+    TEST_ASSERT(fs_getpos(file) == 5 * sizeof record);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/log") == 0);
+
+    rc = fs_close(file);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/log") == 1);
+    nffs_test_util_assert_contents("/log", expected, 5 * sizeof record);
+
+    /*** A full buffer is written as a single block. */
+    rc = fs_open("/log", FS_ACCESS_WRITE | FS_ACCESS_APPEND, &file);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    len = 5 * sizeof record;
+    while (len + sizeof record <= sizeof expected) {
+        memset(record, 'a' + len % 26, sizeof record);
+        memcpy(expected + len, record, sizeof record);
+        rc = fs_write(file, record, sizeof record);
+        TEST_ASSERT_FATAL(rc == 0);
+        len += sizeof record;
+    }
+
+    /* fs_flush() writes out the partial buffer. */
+    rc = fs_flush(file);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/log") ==
+                1 + (len - 5 * sizeof record + buf_size - 1) / buf_size);
+    nffs_test_util_assert_contents("/log", expected, len);
+
+    rc = fs_close(file);
+    TEST_ASSERT(rc == 0);
+
+    /*** Other accesses to the file see buffered data. */
+    rc = fs_unlink("/log");
+    TEST_ASSERT(rc == 0);
+
+    rc = fs_open("/log", FS_ACCESS_WRITE | FS_ACCESS_APPEND, &files[0]);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = fs_open("/log", FS_ACCESS_WRITE | FS_ACCESS_APPEND, &files[1]);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = fs_open("/log", FS_ACCESS_READ | FS_ACCESS_WRITE, &files[2]);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    rc = fs_write(files[0], "abcd", 4);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/log") == 0);
+    rc = fs_filelen(files[2], &len);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(len == 4);
+
+    /* Appends through two handles stay in order. */
+    rc = fs_write(files[0], "efgh", 4);
+    TEST_ASSERT(rc == 0);
+    rc = fs_write(files[1], "ijkl", 4);
+    TEST_ASSERT(rc == 0);
+
+    /* Handles opened without FS_ACCESS_APPEND write straight through. */
+    rc = fs_seek(files[2], 2);
+    TEST_ASSERT(rc == 0);
+    nffs_test_util_assert_file_len(files[2], 12);
+    rc = fs_write(files[2], "XY", 2);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/log") == 3);
+
+    for (i = 0; i < 3; i++) {
+        rc = fs_close(files[i]);
+        TEST_ASSERT(rc == 0);
+    }
+    nffs_test_util_assert_contents("/log", "abXYefghijkl", 12);
+
+    /*** Large writes and writes without a free buffer bypass buffering. */
+    for (i = 0; i < 3; i++) {
+        snprintf(record, sizeof record, "/file%d", i);
+        rc = fs_open(record, FS_ACCESS_WRITE | FS_ACCESS_APPEND, &files[i]);
+        TEST_ASSERT_FATAL(rc == 0);
+
+        rc = fs_write(files[i], "12345678", 8);
+        TEST_ASSERT(rc == 0);
+        TEST_ASSERT(nffs_test_write_buf_num_blocks(record) ==
+                    (i >= MYNEWT_VAL(NFFS_WRITE_BUF_COUNT)));
+    }
+    for (i = 0; i < 3; i++) {
+        rc = fs_close(files[i]);
+        TEST_ASSERT(rc == 0);
+    }
+
+    rc = fs_open("/big", FS_ACCESS_WRITE | FS_ACCESS_APPEND, &file);
+    TEST_ASSERT_FATAL(rc == 0);
+    memset(expected, 'z', buf_size);
+    rc = fs_write(file, expected, buf_size);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/big") == 1);
+    rc = fs_close(file);
+    TEST_ASSERT(rc == 0);
+    nffs_test_util_assert_contents("/big", expected, buf_size);
+
+#if MYNEWT_VAL(NFFS_WRITE_BUF_FLUSH_MS) > 0
+    /*** Buffered data is written out by a timer. */
+    ticks = os_time_ms_to_ticks32(MYNEWT_VAL(NFFS_WRITE_BUF_FLUSH_MS));
+
+    /* Let the timer armed by the writes above expire. */
+    nffs_test_write_buf_advance(ticks);
+
+    rc = fs_open("/timed", FS_ACCESS_WRITE | FS_ACCESS_APPEND, &files[0]);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = fs_open("/timed2", FS_ACCESS_WRITE | FS_ACCESS_APPEND, &files[1]);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* The timer starts with the first buffered write; later ones leave it. */
+    rc = fs_write(files[0], "abcd", 4);
+    TEST_ASSERT(rc == 0);
+    nffs_test_write_buf_advance(ticks / 2);
+    rc = fs_write(files[0], "efgh", 4);
+    TEST_ASSERT(rc == 0);
+    nffs_test_write_buf_advance(ticks - ticks / 2 - 1);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/timed") == 0);
+
+    nffs_test_write_buf_advance(1);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/timed") == 1);
+    nffs_test_util_assert_contents("/timed", "abcdefgh", 8);
+
+    /* One expiry writes out every handle's buffer. */
+    rc = fs_write(files[0], "ijkl", 4);
+    TEST_ASSERT(rc == 0);
+    rc = fs_write(files[1], "1234", 4);
+    TEST_ASSERT(rc == 0);
+    nffs_test_write_buf_advance(ticks);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/timed") == 2);
+    TEST_ASSERT(nffs_test_write_buf_num_blocks("/timed2") == 1);
+
+    for (i = 0; i < 2; i++) {
+        rc = fs_close(files[i]);
+        TEST_ASSERT(rc == 0);
+    }
+    nffs_test_util_assert_contents("/timed", "abcdefghijkl", 12);
+    nffs_test_util_assert_contents("/timed2", "1234", 4);
+#endif
+}
+#endif
@@ -48,8 +48,9 @@ _sbrk(int incr)
     }
     result = mmap(NULL, incr, PROT_READ | PROT_WRITE, MAP_ANON | MAP_SHARED,
       -1, 0);
-    if (result) {
-        cont_left = sys_pagesize - (incr % sys_pagesize);
+    if (result != MAP_FAILED) {
+        /* The rest of the last page is handed out by the next calls. */
+        cont_left = (sys_pagesize - (incr % sys_pagesize)) % sys_pagesize;
         if (cont_left) {
             cont = (char *)result + incr;
         } else {
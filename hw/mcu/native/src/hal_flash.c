@@ -94,6 +94,7 @@ static void
 flash_native_file_open(char *name)
 {
     int created = 0;
+    int flags;
     extern int ftruncate(int fd, off_t length);
 
     if (name) {
@@ -103,11 +104,18 @@ flash_native_file_open(char *name)
             assert(file > 0);
             created = 1;
         }
+        flags = MAP_SHARED;
     } else {
         char tmpl[] = "/tmp/native_flash.XXXXXX";
         file = mkstemp(tmpl);
         assert(file > 0);
         created = 1;
+        /*
+         * Nothing else reads a temporary image, so keep it private: a
+         * process forked after this point (e.g., by tu_suite_run_parallel())
+         * then gets its own copy of the flash instead of sharing it.
+         */
+        flags = MAP_PRIVATE;
     }
 
     if (created) {
@@ -117,7 +125,7 @@ flash_native_file_open(char *name)
     }
 
     file_loc = mmap(0, native_flash_dev.hf_size,
-          PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+          PROT_READ | PROT_WRITE, flags, file, 0);
     assert(file_loc != MAP_FAILED);
     if (created) {
         flash_native_erase(0, native_flash_dev.hf_size);
@@ -25,7 +25,6 @@
 /*
  * For native cpu implementation.
  */
-static uint8_t native_timer_task_started;
 #define NATIVE_TIMER_STACK_SIZE   (1024)
 static os_stack_t native_timer_stack[NATIVE_TIMER_STACK_SIZE];
 static struct os_task native_timer_task_struct;
@@ -80,6 +79,26 @@ native_timer_task(void *arg)
     }
 }
 
+/**
+ * Tells whether the timer task is in the OS task list.  The sim can restart
+ * the OS (the test suites do so for every case), which drops every task, so
+ * a flag set when the task was first created is not enough.
+ */
+static int
+native_timer_task_running(void)
+{
+    struct os_task_info oti;
+    struct os_task *t;
+
+    t = NULL;
+    while ((t = os_task_info_get_next(t, &oti)) != NULL) {
+        if (t == &native_timer_task_struct) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 int
 hal_timer_init(int num, void *cfg)
 {
@@ -104,14 +123,15 @@ hal_timer_config(int num, uint32_t clock_freq)
     nt->num = num;
     nt->cnt = 0;
     nt->last_ostime = os_time_get();
-    if (!native_timer_task_started) {
-        os_task_init(&native_timer_task_struct, "native_timer",
-          native_timer_task, NULL, OS_TASK_PRI_HIGHEST, OS_WAIT_FOREVER,
-          native_timer_stack, NATIVE_TIMER_STACK_SIZE);
+    if (!native_timer_task_running()) {
+        /* Timers armed before an OS restart belong to tasks that are gone. */
+        TAILQ_INIT(&nt->timers);
 
         /* Initialize the eventq and task */
         os_eventq_init(&native_timer_evq);
-        native_timer_task_started = 1;
+        os_task_init(&native_timer_task_struct, "native_timer",
+          native_timer_task, NULL, OS_TASK_PRI_HIGHEST, OS_WAIT_FOREVER,
+          native_timer_stack, NATIVE_TIMER_STACK_SIZE);
     }
 
     /* Initialize the callout function */
@@ -116,6 +116,7 @@ void os_start(void);
 #include "os/os_eventq.h"
 #include "os/os_fault.h"
 #include "os/os_heap.h"
+#include "os/os_idle.h"
 #include "os/os_mbuf.h"
 #include "os/os_mempool.h"
 #include "os/os_mutex.h"
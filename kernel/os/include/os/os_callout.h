@@ -45,7 +45,10 @@ struct os_callout {
     struct os_eventq *c_evq;
     /** Number of ticks in the future to expire the callout */
     os_time_t c_ticks;
-
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    /** Number of ticks the callout may run late by, see os_callout_set_slack */
+    os_time_t c_slack;
+#endif
 
     TAILQ_ENTRY(os_callout) c_next;
 };
@@ -99,6 +102,32 @@ void os_callout_stop(struct os_callout *);
  */
 int os_callout_reset(struct os_callout *, os_time_t);
 
+/**
+ * Reset the callout to fire off when the 64-bit OS time (see
+ * os_time_get64()) reaches 'deadline'.  A deadline in the past fires on the
+ * next tick.
+ *
+ * @param c The callout to reset
+ * @param deadline Absolute OS time, in ticks, at which to post the event
+ *
+ * @return 0 on success; OS_EINVAL if the deadline is more than INT32_MAX
+ *         ticks away
+ */
+int os_callout_reset_at(struct os_callout *c, uint64_t deadline);
+
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+/**
+ * Sets how many ticks late the callout may fire.  When the OS is idle, it
+ * sleeps until the latest time that still honours the slack of every pending
+ * timer, so callouts and timed waits whose windows overlap share a single
+ * wakeup.  The slack is kept across resets; os_callout_init() sets it to 0.
+ *
+ * @param c The callout
+ * @param slack Maximum delay past the expiry time, in ticks
+ */
+void os_callout_set_slack(struct os_callout *c, os_time_t slack);
+#endif
+
 /**
  * Returns the number of ticks which remains to callout.
  *
@@ -128,6 +157,9 @@ os_callout_queued(struct os_callout *c)
 
 void os_callout_tick(void);
 os_time_t os_callout_wakeup_ticks(os_time_t now);
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+os_time_t os_callout_wakeup_slack_ticks(os_time_t now);
+#endif
 
 /**
  * @endcond
@@ -180,6 +180,33 @@ void os_cputime_delay_ticks(uint32_t ticks);
  */
 void os_cputime_delay_usecs(uint32_t usecs);
 
+/**
+ * Put the calling task to sleep until the number of ticks has elapsed.
+ * Unlike os_cputime_delay_ticks(), the CPU is given to other tasks (or the
+ * idle task) in the meantime, and unlike os_time_delay() the wakeup is not
+ * rounded to an OS tick.
+ *
+ * The part of the delay more than OS_CPUTIME_SLEEP_TIMER_USECS from the end
+ * is slept on the OS tick; the remainder is timed with the cputime timer.
+ * Delays of 2^31 ticks or more are slept on the OS tick in several chunks
+ * first.  Must be called from a task.
+ *
+ * @param ticks The number of ticks to sleep.
+ */
+void os_cputime_sleep_ticks(uint32_t ticks);
+
+/**
+ * Put the calling task to sleep until 'usecs' microseconds have elapsed.
+ * See os_cputime_sleep_ticks().
+ *
+ * The delay is converted to cputime ticks first, so it is limited to 2^32 - 1
+ * ticks: with an OS_CPUTIME_FREQ above 1 MHz, that is less than the full
+ * range of 'usecs' (about 268 seconds at 16 MHz).
+ *
+ * @param usecs The number of usecs to sleep.
+ */
+void os_cputime_sleep_usecs(uint32_t usecs);
+
 /**
  * Initialize a CPU timer, using the given HAL timer.
  *
@@ -140,6 +140,10 @@ struct os_dev {
     /** Device name */
     char *od_name;
     STAILQ_ENTRY(os_dev) od_next;
+#if MYNEWT_VAL(OS_DEV_HASH_BUCKETS) > 0
+    /** Next device in the same name hash bucket */
+    SLIST_ENTRY(os_dev) od_hash_next;
+#endif
 };
 
 #define OS_DEV_SETHANDLERS(__dev, __open, __close)          \
@@ -236,6 +240,20 @@ int os_dev_resume_all(void);
  */
 struct os_dev *os_dev_open(char *devname, uint32_t timo, void *arg);
 
+/**
+ * Open a device without looking it up by name.  Callers that reopen the same
+ * device often can keep the pointer returned by os_dev_lookup() (or a
+ * previous os_dev_open()) and use it as a handle here.
+ *
+ * @param dev The device to open
+ * @param timo The timeout to open the device, if not specified.
+ * @param arg The argument to the device open() call.
+ *
+ * @return The device on success, NULL on failure.
+ */
+struct os_dev *os_dev_open_handle(struct os_dev *dev, uint32_t timo,
+                                  void *arg);
+
 /**
  * Close a device.
  *
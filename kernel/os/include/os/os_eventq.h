@@ -29,6 +29,7 @@
 #define _OS_EVENTQ_H
 
 #include <inttypes.h>
+#include "syscfg/syscfg.h"
 #include "os/os_time.h"
 #include "os/queue.h"
 
@@ -46,6 +47,12 @@ typedef void os_event_fn(struct os_event *ev);
 struct os_event {
     /** Whether this OS event is queued on an event queue. */
     uint8_t ev_queued;
+    /**
+     * Priority level the event is queued at when OS_EVENTQ_PRIOS is greater
+     * than 1; 0 is the most urgent.  Must not change while the event is
+     * queued.
+     */
+    uint8_t ev_prio;
     /**
      * Callback to call when the event is taken off of an event queue.
      * APIs, except for os_eventq_run(), assume this callback will be called by
@@ -62,6 +69,8 @@ struct os_event {
 /** Return whether or not the given event is queued. */
 #define OS_EVENT_QUEUED(__ev) ((__ev)->ev_queued)
 
+struct os_eventq_set;
+
 struct os_eventq {
     /** Pointer to task that "owns" this event queue. */
     struct os_task *evq_owner;
@@ -71,10 +80,39 @@ struct os_eventq {
      */
     struct os_task *evq_task;
 
-
+#if MYNEWT_VAL(OS_EVENTQ_PRIOS) > 1
+    /** Bitmap of priority levels with queued events; bit 0 is level 0. */
+    uint32_t evq_prio_map;
+    STAILQ_HEAD(, os_event) evq_list[MYNEWT_VAL(OS_EVENTQ_PRIOS)];
+#else
     STAILQ_HEAD(, os_event) evq_list;
+#endif
+
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+    /** The set this queue is a member of, if any. */
+    struct os_eventq_set *evq_set;
+    /** Index of this queue within its set. */
+    uint16_t evq_set_idx;
+#endif
 };
 
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+/**
+ * A set of event queues which a single task can wait on (similar to epoll).
+ * Member queues flag themselves ready in a bitmap when an event is put on
+ * them and clear their bit when they become empty, so waiting on the set
+ * does not depend on the number of members.
+ */
+struct os_eventq_set {
+    /** Pointer to the task that is sleeping on this set, if any. */
+    struct os_task *evs_task;
+    /** Bitmap of member queues that have events; bit n is evs_queues[n]. */
+    uint32_t evs_ready[(MYNEWT_VAL(OS_EVENTQ_SET_MAX) + 31) / 32];
+    /** Member queues, indexed by their ready bit. */
+    struct os_eventq *evs_queues[MYNEWT_VAL(OS_EVENTQ_SET_MAX)];
+};
+#endif
+
 
 /**
  * Initialize the event queue
@@ -124,6 +162,19 @@ struct os_event *os_eventq_get(struct os_eventq *);
  */
 void os_eventq_run(struct os_eventq *evq);
 
+/**
+ * Pull up to max events off an event queue and call the callback of each.
+ * Blocks until at least one event is available, then keeps dispatching
+ * queued events, most urgent first, without going back through the
+ * scheduler.
+ *
+ * @param evq The event queue to pull events from
+ * @param max The maximum number of events to dispatch; must be at least 1
+ *
+ * @return The number of events dispatched
+ */
+int os_eventq_run_batch(struct os_eventq *evq, int max);
+
 
 /**
  * Poll the list of event queues specified by the evq parameter
@@ -147,6 +198,54 @@ struct os_event *os_eventq_poll(struct os_eventq **, int, os_time_t);
  */
 void os_eventq_remove(struct os_eventq *, struct os_event *);
 
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+/**
+ * Initialize an event queue set.
+ *
+ * @param set The set to initialize
+ */
+void os_eventq_set_init(struct os_eventq_set *set);
+
+/**
+ * Add an event queue to a set.  A queue can be a member of at most one set.
+ * Events already on the queue make it ready immediately.
+ *
+ * @param set The set to add the queue to
+ * @param evq The event queue to add
+ *
+ * @return 0 on success;
+ *         OS_EINVAL if the queue already belongs to a set;
+ *         OS_ENOMEM if the set already has OS_EVENTQ_SET_MAX members.
+ */
+int os_eventq_set_add(struct os_eventq_set *set, struct os_eventq *evq);
+
+/**
+ * Remove an event queue from a set.
+ *
+ * @param set The set to remove the queue from
+ * @param evq The event queue to remove
+ *
+ * @return 0 on success; OS_EINVAL if the queue is not a member of the set.
+ */
+int os_eventq_set_remove(struct os_eventq_set *set, struct os_eventq *evq);
+
+/**
+ * Pull an event off the first ready member of a set (members are searched
+ * in the order of their index), waiting for one to become ready if
+ * necessary.  Only one task may wait on a set at a time.
+ *
+ * @param set     The set to wait on
+ * @param timo    Timeout in ticks; 0 does not wait, OS_WAIT_FOREVER waits
+ *                    until an event is available.
+ * @param out_evq On success, the queue the event was taken from; may be
+ *                    NULL.
+ *
+ * @return An event, or NULL if none became available before the timeout.
+ */
+struct os_event *os_eventq_set_poll(struct os_eventq_set *set, os_time_t timo,
+                                    struct os_eventq **out_evq);
+#endif
+
 /**
  * Retrieves the default event queue processed by OS main task.
  *
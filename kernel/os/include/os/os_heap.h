@@ -30,6 +30,7 @@
 #define H_OS_HEAP_
 
 #include <stddef.h>
+#include <inttypes.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -70,6 +71,41 @@ void os_free(void *mem);
  */
 void *os_realloc(void *ptr, size_t size);
 
+/**
+ * Heap usage statistics, see os_heap_info_get().
+ */
+struct os_heap_info {
+    /** Bytes under management of the allocator, including block headers */
+    uint32_t ohi_total;
+    /** Bytes currently allocated, including block headers */
+    uint32_t ohi_used;
+    /** High water mark of ohi_used */
+    uint32_t ohi_max_used;
+    /** Bytes currently free */
+    uint32_t ohi_free;
+    /**
+     * Largest free block; compared to ohi_free this gives the heap
+     * fragmentation.
+     */
+    uint32_t ohi_largest_free;
+    /** Number of non-contiguous memory regions obtained from the BSP */
+    uint32_t ohi_pools;
+    /** Number of successful allocations */
+    uint32_t ohi_alloc_cnt;
+    /** Number of failed allocations */
+    uint32_t ohi_fail_cnt;
+};
+
+/**
+ * Retrieves heap usage statistics.  Only available with the TLSF heap
+ * backend (OS_HEAP_TLSF).
+ *
+ * @param info On success, filled with the current statistics
+ *
+ * @return 0 on success; OS_ENOENT if the heap backend keeps no statistics.
+ */
+int os_heap_info_get(struct os_heap_info *info);
+
 #ifdef __cplusplus
 }
 #endif
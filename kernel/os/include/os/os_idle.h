@@ -0,0 +1,105 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+/**
+ * @addtogroup OSKernel
+ * @{
+ *   @defgroup OSIdleWork Idle Work
+ *   @{
+ */
+
+#ifndef _OS_IDLE_H
+#define _OS_IDLE_H
+
+#include <stdint.h>
+
+#include "syscfg/syscfg.h"
+#include "os/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct os_idle_work;
+
+/**
+ * Idle work function.  Does a bounded amount of work and returns; it should
+ * return early once os_cputime_get32() passes 'deadline'.
+ *
+ * @param work The work item being run.
+ * @param deadline cputime by which the idle task wants control back.
+ *
+ * @return 0 if the job is finished and can be removed from the queue;
+ *         non-zero if it has more work and should run again.
+ */
+typedef int os_idle_work_fn(struct os_idle_work *work, uint32_t deadline);
+
+/**
+ * Job run by the idle task when no other task is ready.
+ */
+struct os_idle_work {
+    /** Function doing the work */
+    os_idle_work_fn *oiw_fn;
+    /** Argument for the work function */
+    void *oiw_arg;
+    /** Whether the item is on the idle work queue */
+    uint8_t oiw_queued;
+    STAILQ_ENTRY(os_idle_work) oiw_next;
+};
+
+#if MYNEWT_VAL(OS_IDLE_WORK)
+/**
+ * Initializes an idle work item.
+ *
+ * @param work The work item to initialize.
+ * @param fn The function to run from the idle task.
+ * @param arg Argument for the function, available as work->oiw_arg.
+ */
+void os_idle_work_init(struct os_idle_work *work, os_idle_work_fn *fn,
+                       void *arg);
+
+/**
+ * Queues a work item to run in idle time.  Does nothing if the item is
+ * already queued.  May be called from interrupt context.
+ *
+ * @param work The work item to queue.
+ */
+void os_idle_work_add(struct os_idle_work *work);
+
+/**
+ * Removes a work item from the idle work queue, if it is queued.
+ *
+ * @param work The work item to remove.
+ */
+void os_idle_work_remove(struct os_idle_work *work);
+
+/** @cond INTERNAL_HIDDEN */
+int os_idle_work_run(void);
+/** @endcond */
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OS_IDLE_H */
+
+/**
+ *   @} OSIdleWork
+ * @} OSKernel
+ */
@@ -31,11 +31,29 @@
 
 #include "os/queue.h"
 #include "os/os_eventq.h"
+#if MYNEWT_VAL(MSYS_STATS)
+#include "stats/stats.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#if MYNEWT_VAL(MSYS_STATS)
+/**
+ * @cond INTERNAL_HIDDEN
+ */
+STATS_SECT_START(os_msys_stats)
+    STATS_SECT_ENTRY(hit)
+    STATS_SECT_ENTRY(miss)
+    STATS_SECT_ENTRY(fallback)
+    STATS_SECT_ENTRY(chain)
+STATS_SECT_END
+/**
+ * @endcond
+ */
+#endif
+
 /**
  * A mbuf pool from which to allocate mbufs. This contains a pointer to the os
  * mempool to allocate mbufs out of, the total number of elements in the pool,
@@ -55,6 +73,13 @@ struct os_mbuf_pool {
     struct os_mempool *omp_pool;
 
     STAILQ_ENTRY(os_mbuf_pool) omp_next;
+#if MYNEWT_VAL(MSYS_STATS)
+    /**
+     * Allocation counters of the pool as an msys size class, registered by
+     * os_msys_register() under the name of the mempool.
+     */
+    STATS_SECT_DECL(os_msys_stats) omp_stats;
+#endif
 };
 
 
@@ -108,6 +133,44 @@ struct os_mbuf {
     uint8_t om_databuf[0];
 };
 
+struct os_mbuf_ext;
+
+/**
+ * Called when the last mbuf referencing an external buffer is freed.
+ *
+ * @param ext The external buffer descriptor which is no longer referenced
+ */
+typedef void os_mbuf_ext_free_fn(struct os_mbuf_ext *ext);
+
+/**
+ * Descriptor of a reference counted buffer that lives outside of any mbuf
+ * pool (e.g. a flash mapped image chunk, a static table or a DMA buffer).
+ * Mbufs created with os_mbuf_get_ext() point into it instead of carrying a
+ * copy of the data.  The data is treated as read-only by the mbuf API.
+ */
+struct os_mbuf_ext {
+    /**
+     * Start of the external data
+     */
+    uint8_t *ome_buf;
+    /**
+     * Length of the external data
+     */
+    uint16_t ome_len;
+    /**
+     * Number of mbufs referencing the buffer
+     */
+    uint16_t ome_refcnt;
+    /**
+     * Called when the reference count drops to zero, may be NULL
+     */
+    os_mbuf_ext_free_fn *ome_free_cb;
+    /**
+     * Argument for the free callback
+     */
+    void *ome_arg;
+};
+
 /**
  * Structure representing a queue of mbufs.
  */
@@ -124,6 +187,22 @@ struct os_mqueue {
  */
 #define OS_MBUF_F_MASK(__n) (1 << (__n))
 
+/** The mbuf data points into a struct os_mbuf_ext buffer */
+#define OS_MBUF_F_EXT       OS_MBUF_F_MASK(0)
+
+/*
+ * Checks whether a given mbuf references an external buffer
+ *
+ * @param __om The mbuf to check
+ */
+#define OS_MBUF_IS_EXT(__om) ((__om)->om_flags & OS_MBUF_F_EXT)
+
+/**
+ * Get the external buffer descriptor of an external mbuf.  The pointer is
+ * kept at the start of the (otherwise unused) mbuf data buffer.
+ */
+#define OS_MBUF_EXT(__om) (*(struct os_mbuf_ext **)&(__om)->om_databuf[0])
+
 /*
  * Checks whether a given mbuf is a packet header mbuf
  *
@@ -184,6 +263,11 @@ _os_mbuf_leadingspace(struct os_mbuf *om)
     uint16_t startoff;
     uint16_t leadingspace;
 
+    /* External data is shared; never write in front of it. */
+    if (OS_MBUF_IS_EXT(om)) {
+        return (0);
+    }
+
     startoff = 0;
     if (OS_MBUF_IS_PKTHDR(om)) {
         startoff = om->om_pkthdr_len;
@@ -218,6 +302,11 @@ _os_mbuf_trailingspace(struct os_mbuf *om)
 {
     struct os_mbuf_pool *omp;
 
+    /* External data is shared; never write behind it. */
+    if (OS_MBUF_IS_EXT(om)) {
+        return (0);
+    }
+
     omp = om->om_omp;
 
     return (&om->om_databuf[0] + omp->omp_databuf_len) -
@@ -285,7 +374,11 @@ int os_mqueue_put(struct os_mqueue *, struct os_eventq *, struct os_mbuf *);
  *
  * Mbuf pools are created in the system initialization code, and then when
  * a mbuf is allocated out of msys, it will try and find the best fit based
- * upon estimated mbuf size.
+ * upon estimated mbuf size.  Registered pools are kept sorted by buffer size
+ * and act as size classes: with MSYS_SIZE_CLASS_FALLBACK an exhausted class
+ * falls back to the next larger one.  With MSYS_SIZE_CLASS_CHAIN, the
+ * os_msys_get_chained() variants may also fall back to a smaller class with
+ * enough free blocks to chain the data.
  *
  * os_msys_register() registers a mbuf pool with MSYS, and allows MSYS to
  * allocate mbufs out of it.
@@ -323,6 +416,35 @@ void os_msys_reset(void);
  */
 struct os_mbuf *os_msys_get_pkthdr(uint16_t dsize, uint16_t user_hdr_len);
 
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_CHAIN)
+/**
+ * Like os_msys_get(), but if no pool large enough to hold dsize bytes has a
+ * free block, the mbuf is taken from the largest smaller pool which has
+ * enough free blocks to hold dsize bytes as a chain.  The returned mbuf may
+ * therefore be too small for dsize bytes; the caller must build the chain
+ * with os_mbuf_append() (or similar) and must not assume the data is
+ * contiguous.
+ *
+ * @param dsize The estimated size of the data being stored in the mbuf chain
+ * @param leadingspace The amount of leadingspace to allocate in the mbuf
+ *
+ * @return A freshly allocated mbuf on success, NULL on failure.
+ */
+struct os_mbuf *os_msys_get_chained(uint16_t dsize, uint16_t leadingspace);
+
+/**
+ * Like os_msys_get_pkthdr(), but may return a mbuf from a smaller pool which
+ * the packet has to be chained in; see os_msys_get_chained().
+ *
+ * @param dsize The estimated size of the data being stored in the mbuf chain
+ * @param user_hdr_len The length to allocate for the packet header structure
+ *
+ * @return A freshly allocated mbuf on success, NULL on failure.
+ */
+struct os_mbuf *os_msys_get_pkthdr_chained(uint16_t dsize,
+                                           uint16_t user_hdr_len);
+#endif
+
 /**
  * Count the number of blocks in all the mbuf pools that are allocated.
  *
@@ -383,6 +505,58 @@ struct os_mbuf *os_mbuf_get_pkthdr(struct os_mbuf_pool *omp,
  */
 struct os_mbuf *os_mbuf_dup(struct os_mbuf *m);
 
+/**
+ * Initializes an external buffer descriptor.  The descriptor starts with no
+ * references; the free callback runs once the last mbuf created from it is
+ * freed.
+ *
+ * @param ext                   The descriptor to initialize.
+ * @param buf                   The external data.
+ * @param len                   The length of the external data.
+ * @param free_cb               Called when the last reference is dropped;
+ *                                  may be NULL.
+ * @param arg                   Argument for the free callback.
+ */
+void os_mbuf_ext_init(struct os_mbuf_ext *ext, void *buf, uint16_t len,
+                      os_mbuf_ext_free_fn *free_cb, void *arg);
+
+/**
+ * Allocates an mbuf which references part of an external buffer instead of
+ * holding the data itself, and takes a reference on the buffer.  The mbuf
+ * header is allocated out of omp; the data is not copied.  External mbufs
+ * have no leading or trailing space, so data appended or prepended to them
+ * goes into regular mbufs from the same pool.
+ *
+ * @param omp                   The mbuf pool to allocate the header out of.
+ * @param ext                   The external buffer to reference.
+ * @param off                   The offset of the data within the buffer.
+ * @param len                   The length of the data.
+ *
+ * @return                      The new mbuf on success;
+ *                              NULL on allocation failure or if off / len
+ *                                  exceed the external buffer.
+ */
+struct os_mbuf *os_mbuf_get_ext(struct os_mbuf_pool *omp,
+                                struct os_mbuf_ext *ext, uint16_t off,
+                                uint16_t len);
+
+/**
+ * Appends part of an external buffer to the end of an mbuf chain without
+ * copying it.  The new mbuf is allocated out of the pool of the chain's first
+ * mbuf.
+ *
+ * @param om                    The mbuf chain to append to.
+ * @param ext                   The external buffer to reference.
+ * @param off                   The offset of the data within the buffer.
+ * @param len                   The length of the data.
+ *
+ * @return                      0 on success;
+ *                              OS_ENOMEM on allocation failure;
+ *                              OS_EINVAL on bad offset / length.
+ */
+int os_mbuf_append_ext(struct os_mbuf *om, struct os_mbuf_ext *ext,
+                       uint16_t off, uint16_t len);
+
 /**
  * Locates the specified absolute offset within an mbuf chain.  The offset
  * can be one past than the total length of the chain, but no greater.
@@ -50,6 +50,31 @@ struct os_memblock {
 /* XXX: Change how I coded the SLIST_HEAD here. It should be named:
    SLIST_HEAD(,os_memblock) mp_head; */
 
+struct os_mempool;
+
+/**
+ * Low watermark callback.  Called from os_memblock_get(), possibly in
+ * interrupt context, when the number of free blocks in the pool drops to the
+ * threshold given to os_mempool_set_low_cb().
+ *
+ * @param mp The memory pool.
+ * @param arg The argument given to os_mempool_set_low_cb().
+ */
+typedef void os_mempool_low_fn(struct os_mempool *mp, void *arg);
+
+#if MYNEWT_VAL(OS_MEMPOOL_LOCKFREE)
+/**
+ * Free list head of a pool built with OS_MEMPOOL_LOCKFREE.  Where the core
+ * lacks exclusive load/store, the pointer and tag are swapped as one with a
+ * double-word compare-and-swap; every pop bumps the tag, so a head that was
+ * popped and pushed back in between does not compare equal.
+ */
+struct os_mempool_head {
+    struct os_memblock *slh_first;
+    uintptr_t mph_tag;
+} __attribute__((aligned(2 * sizeof(void *))));
+#endif
+
 /**
  * Memory pool
  */
@@ -67,10 +92,36 @@ struct os_mempool {
     /** Address of memory buffer used by pool */
     uint32_t mp_membuf_addr;
     STAILQ_ENTRY(os_mempool) mp_list;
+#if MYNEWT_VAL(OS_MEMPOOL_LOCKFREE)
+    union {
+        SLIST_HEAD(,os_memblock);
+        struct os_mempool_head mp_head;
+    };
+#else
     SLIST_HEAD(,os_memblock);
+#endif
     /** Name for memory block */
     char *name;
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+    /** Called when the number of free blocks drops to mp_low_thresh */
+    os_mempool_low_fn *mp_low_cb;
+    void *mp_low_arg;
+    uint16_t mp_low_thresh;
+#endif
+};
+
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+/**
+ * Owner of an allocated block.  One of these is kept after each block of a
+ * pool when OS_MEMPOOL_TRACE is enabled.
+ */
+struct os_memblock_owner {
+    /** Return address of the os_memblock_get() call; NULL if block is free */
+    void *omo_addr;
+    /** os_time_get() when the block was allocated */
+    os_time_t omo_time;
 };
+#endif
 
 /**
  * Indicates an extended mempool.  Address can be safely cast to
@@ -150,10 +201,20 @@ struct os_mempool *os_mempool_info_get_next(struct os_mempool *,
 /*
  * Leave extra 4 bytes of guard area at the end.
  */
-#define OS_MEMPOOL_BLOCK_SZ(sz) ((sz) + sizeof(os_membuf_t))
+#define OS_MEMPOOL_GUARD_SZ     sizeof(os_membuf_t)
 #else
-#define OS_MEMPOOL_BLOCK_SZ(sz) (sz)
+#define OS_MEMPOOL_GUARD_SZ     0
 #endif
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+/*
+ * Followed by the owner record.
+ */
+#define OS_MEMPOOL_TRACE_SZ     sizeof(struct os_memblock_owner)
+#else
+#define OS_MEMPOOL_TRACE_SZ     0
+#endif
+#define OS_MEMPOOL_BLOCK_SZ(sz) \
+    ((sz) + OS_MEMPOOL_GUARD_SZ + OS_MEMPOOL_TRACE_SZ)
 #if (OS_CFG_ALIGNMENT == OS_CFG_ALIGN_4)
 #define OS_MEMPOOL_SIZE(n, blksize)                                     \
     (((OS_MEMPOOL_BLOCK_SZ(blksize) + 3) / 4) * (n))
@@ -230,6 +291,41 @@ os_error_t os_mempool_clear(struct os_mempool *mp);
  */
 bool os_mempool_is_sane(const struct os_mempool *mp);
 
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+/**
+ * Sets the function called when the number of free blocks in a pool drops to
+ * the given threshold.  The callback runs once each time the pool reaches the
+ * threshold on the way down; a threshold of 0 reports the allocation of the
+ * last free block.
+ *
+ * @param mp                    The mempool to watch.
+ * @param thresh                Number of free blocks at which to call 'cb'.
+ * @param cb                    The callback, or NULL to disable it.
+ * @param arg                   Argument passed to the callback.
+ */
+void os_mempool_set_low_cb(struct os_mempool *mp, uint16_t thresh,
+                           os_mempool_low_fn *cb, void *arg);
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+/**
+ * Finds the blocks of a pool that have been allocated for the longest time.
+ * The owner recorded for a block is the address the allocation was made
+ * from: os_memblock_get(), os_mbuf_get(), os_msys_get() and their variants
+ * pass their caller's return address down, so a block is attributed to the
+ * code that asked for it rather than to the allocator wrapper.
+ *
+ * @param mp                    The mempool to inspect.
+ * @param owners                Filled with the owners of the oldest blocks,
+ *                                  oldest first.
+ * @param max                   Number of entries in 'owners'.
+ *
+ * @return                      The number of entries filled in.
+ */
+int os_mempool_trace_oldest(const struct os_mempool *mp,
+                            struct os_memblock_owner *owners, int max);
+#endif
+
 /**
  * Checks if a memory block was allocated from the specified mempool.
  *
@@ -272,6 +368,12 @@ os_error_t os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr);
  */
 os_error_t os_memblock_put(struct os_mempool *mp, void *block_addr);
 
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+/** @cond INTERNAL_HIDDEN */
+struct os_mempool *os_mempool_sweep(void);
+/** @endcond */
+#endif
+
 #ifdef __cplusplus
 }
 #endif
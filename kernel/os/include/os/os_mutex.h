@@ -46,6 +46,16 @@ struct os_mutex {
     uint16_t    mu_level;
     /** Task that owns the mutex */
     struct os_task *mu_owner;
+#if MYNEWT_VAL(OS_MUTEX_STATS)
+    /** Number of times the mutex was acquired (nested pends not counted) */
+    uint32_t    mu_acq_cnt;
+    /** Number of pends that had to wait for another owner */
+    uint32_t    mu_pend_cnt;
+    /** Longest time the mutex has been held, in cputime ticks */
+    uint32_t    mu_max_hold;
+    /** Time at which the current owner acquired the mutex, in cputime */
+    uint32_t    mu_acq_time;
+#endif
 };
 
 /*
@@ -89,6 +99,11 @@ os_error_t os_mutex_release(struct os_mutex *mu);
 /**
  * Pend (wait) for a mutex.
  *
+ * If the mutex is owned by a lower priority task, the owner inherits the
+ * priority of the caller until it releases the mutex. If that owner is in
+ * turn waiting for another mutex, the boost is propagated along the chain
+ * of owners, up to OS_MUTEX_PI_DEPTH tasks.
+ *
  * @param mu Pointer to mutex.
  * @param timeout Timeout, in os ticks.
  *                A timeout of 0 means do not wait if not available.
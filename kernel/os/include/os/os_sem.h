@@ -95,6 +95,40 @@ os_error_t os_sem_release(struct os_sem *sem);
  */
 os_error_t os_sem_pend(struct os_sem *sem, os_time_t timeout);
 
+/**
+ * Pend (wait) for a semaphore until an absolute deadline.
+ *
+ * @param sem Pointer to semaphore.
+ * @param deadline 64-bit OS time, in ticks (see os_time_get64()), after
+ *                 which to give up.  A deadline in the past does not wait.
+ *
+ * @return os_error_t
+ *      OS_INVALID_PARM     Semaphore passed in was NULL.
+ *      OS_TIMEOUT          No token became available before the deadline.
+ *      OS_OK               no error.
+ */
+os_error_t os_sem_pend_until(struct os_sem *sem, uint64_t deadline);
+
+/**
+ * Pend (wait) for a semaphore with a timeout in microseconds.
+ *
+ * The timeout is not rounded to OS ticks: the last
+ * OS_CPUTIME_SLEEP_TIMER_USECS of it are timed with the cputime timer.  A
+ * timeout of 2^31 cputime ticks or more is waited out on the OS tick in
+ * several pends before that.  The timeout is converted to cputime ticks, so
+ * it is limited to 2^32 - 1 ticks: with an OS_CPUTIME_FREQ above 1 MHz, that
+ * is less than the full range of 'usecs'.
+ *
+ * @param sem Pointer to semaphore.
+ * @param usecs Timeout, in microseconds. 0 means do not wait.
+ *
+ * @return os_error_t
+ *      OS_INVALID_PARM     Semaphore passed in was NULL.
+ *      OS_TIMEOUT          No token became available within 'usecs'.
+ *      OS_OK               no error.
+ */
+os_error_t os_sem_pend_usecs(struct os_sem *sem, uint32_t usecs);
+
 /**
  * Get current semaphore's count
  */
@@ -75,9 +75,38 @@ typedef enum os_task_state {
 #define OS_TASK_FLAG_MUTEX_WAIT     (0x04U)
 /** Task waiting on a event queue */
 #define OS_TASK_FLAG_EVQ_WAIT       (0x08U)
+/** Stack high-water threshold has been reported for this task */
+#define OS_TASK_FLAG_STACK_HWM      (0x10U)
 
 typedef void (*os_task_func_t)(void *);
 
+#if MYNEWT_VAL(OS_TASK_PROF)
+/** Number of buckets in the ready-to-run latency histogram */
+#define OS_TASK_PROF_LAT_BUCKETS    MYNEWT_VAL(OS_TASK_PROF_LAT_BUCKETS)
+
+/**
+ * Per-task profiling data.  All times are in os_cputime ticks.
+ */
+struct os_task_prof {
+    /** Total time the task has been running */
+    uint64_t otp_run_time;
+    /** Time spent in interrupt handlers while the task was running */
+    uint64_t otp_isr_time;
+    /** Number of times the task was switched out while still ready */
+    uint32_t otp_preempt_cnt;
+    /** Time at which the task last became ready to run */
+    uint32_t otp_ready_time;
+    /** Longest time the task waited to run after becoming ready */
+    uint32_t otp_lat_max;
+    /**
+     * Ready-to-run latency histogram.  Bucket n counts latencies of less
+     * than 2^n ticks (and at least 2^(n-1)); the last bucket also counts
+     * everything longer.
+     */
+    uint32_t otp_lat_hist[OS_TASK_PROF_LAT_BUCKETS];
+};
+#endif
+
 #define OS_TASK_MAX_NAME_LEN (32)
 
 /**
@@ -99,7 +128,8 @@ struct os_task {
     /** Task flags, bitmask */
     uint8_t t_flags;
     uint8_t t_lockcnt;
-    uint8_t t_pad;
+    /** Priority the task was queued at in the run list */
+    uint8_t t_run_prio;
 
     /** Task name */
     const char *t_name;
@@ -116,6 +146,10 @@ struct os_task {
 
     /** Next scheduled wakeup if this task is sleeping */
     os_time_t t_next_wakeup;
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    /** Number of ticks a timed wait may end late by, see os_task_set_slack */
+    os_time_t t_slack;
+#endif
     /** Total task run time */
     os_time_t t_run_time;
     /**
@@ -124,9 +158,30 @@ struct os_task {
      */
     uint32_t t_ctx_sw_cnt;
 
+#if MYNEWT_VAL(OS_STACK_HWM)
+    /**
+     * Deepest stack usage seen so far by the background scanner, in
+     * os_stack_t units.
+     */
+    uint16_t t_stack_hwm;
+#endif
+
+#if MYNEWT_VAL(OS_TASK_PROF)
+    /** Profiling data, timestamped with os_cputime */
+    struct os_task_prof t_prof;
+#endif
+
     STAILQ_ENTRY(os_task) t_os_task_list;
     TAILQ_ENTRY(os_task) t_os_list;
     SLIST_ENTRY(os_task) t_obj_list;
+
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+    /** Sleep heap linkage, used while sleeping with a timeout */
+    struct os_task *t_sleep_child;
+    struct os_task *t_sleep_sibling;
+    /** Left sibling, or parent if this is the leftmost child */
+    struct os_task *t_sleep_prev;
+#endif
 };
 
 /** @cond INTERNAL_HIDDEN */
@@ -197,6 +252,10 @@ struct os_task_info {
     os_time_t oti_next_checkin;
     /** Name of this task */
     char oti_name[OS_TASK_MAX_NAME_LEN];
+#if MYNEWT_VAL(OS_TASK_PROF)
+    /** Profiling data */
+    struct os_task_prof oti_prof;
+#endif
 };
 
 /**
@@ -232,6 +291,64 @@ struct os_task_info {
 struct os_task *os_task_info_get_next(const struct os_task *,
         struct os_task_info *);
 
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+/**
+ * Sets how many ticks late the timed waits of a task (os_time_delay() and
+ * pends with a timeout) may end.  When the OS is idle, it sleeps until the
+ * latest time that still honours the slack of every pending timer, so waits
+ * and callouts whose windows overlap share a single wakeup.  Tasks start
+ * with a slack of 0.
+ *
+ * @param t The task
+ * @param slack Maximum delay past the timeout, in ticks
+ */
+void os_task_set_slack(struct os_task *t, os_time_t slack);
+#endif
+
+#if MYNEWT_VAL(OS_STACK_HWM)
+/**
+ * Called the first time a task's stack high-water mark reaches
+ * OS_STACK_HWM_THRESH percent of its stack.  Runs in the idle task, so it
+ * must not block.
+ *
+ * @param t The task.
+ * @param used Deepest stack usage seen, in os_stack_t units.
+ * @param size Size of the task's stack, in os_stack_t units.
+ */
+typedef void os_stack_hwm_fn(struct os_task *t, uint16_t used, uint16_t size);
+
+/**
+ * Sets the function called when a task crosses the stack usage threshold.
+ *
+ * @param cb The callback, or NULL to disable the notification.
+ */
+void os_stack_hwm_set_cb(os_stack_hwm_fn *cb);
+
+/** @cond INTERNAL_HIDDEN */
+void os_stack_hwm_scan(void);
+/** @endcond */
+#endif
+
+#if MYNEWT_VAL(OS_TASK_PROF)
+/**
+ * Clears the profiling data of all tasks and the total interrupt time.
+ */
+void os_task_prof_reset(void);
+
+/**
+ * Returns the total time spent in interrupt handlers, in os_cputime ticks,
+ * since startup or the last call to os_task_prof_reset().  Only interrupt
+ * handlers which call os_trace_isr_enter() and os_trace_isr_exit() are
+ * accounted for.
+ */
+uint64_t os_task_prof_isr_time(void);
+
+/** @cond INTERNAL_HIDDEN */
+void os_task_prof_isr_enter(void);
+void os_task_prof_isr_exit(void);
+/** @endcond */
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -93,6 +93,23 @@ typedef int32_t os_stime_t;
  */
 os_time_t os_time_get(void);
 
+/**
+ * Get the current OS time in ticks, as a 64-bit value that does not wrap.
+ * Does not disable interrupts.
+ *
+ * @return OS time in ticks since boot
+ */
+uint64_t os_time_get64(void);
+
+/**
+ * Get the time since boot in microseconds, at OS tick resolution.  The
+ * counter is maintained by the tick handler, so this is cheap and does not
+ * disable interrupts.
+ *
+ * @return Microseconds since boot
+ */
+uint64_t os_time_get_usec64(void);
+
 /**
  * Move OS time forward ticks.
  *
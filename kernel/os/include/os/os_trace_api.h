@@ -91,6 +91,9 @@ os_trace_module_desc(const os_trace_module_t *m, const char *desc)
 static inline void
 os_trace_isr_enter(void)
 {
+#if MYNEWT_VAL(OS_TASK_PROF)
+    os_task_prof_isr_enter();
+#endif
     SEGGER_SYSVIEW_RecordEnterISR();
 }
 
@@ -98,6 +101,9 @@ static inline void
 os_trace_isr_exit(void)
 {
     SEGGER_SYSVIEW_RecordExitISR();
+#if MYNEWT_VAL(OS_TASK_PROF)
+    os_task_prof_isr_exit();
+#endif
 }
 
 static inline void
@@ -209,11 +215,17 @@ os_trace_api_ret_u32(unsigned id, uint32_t ret)
 static inline void
 os_trace_isr_enter(void)
 {
+#if MYNEWT_VAL(OS_TASK_PROF)
+    os_task_prof_isr_enter();
+#endif
 }
 
 static inline void
 os_trace_isr_exit(void)
 {
+#if MYNEWT_VAL(OS_TASK_PROF)
+    os_task_prof_isr_exit();
+#endif
 }
 
 static inline void
@@ -90,6 +90,9 @@ os_idle_task(void *arg)
     os_time_t iticks, sticks, cticks;
     os_time_t sanity_last;
     os_time_t sanity_itvl_ticks;
+#if MYNEWT_VAL(OS_IDLE_WORK)
+    int idle_work_time;
+#endif
 
     sanity_itvl_ticks = (MYNEWT_VAL(SANITY_INTERVAL) * OS_TICKS_PER_SEC) / 1000;
     sanity_last = 0;
@@ -115,16 +118,41 @@ os_idle_task(void *arg)
             sanity_last = now;
         }
 
+#if MYNEWT_VAL(OS_STACK_HWM)
+        os_stack_hwm_scan();
+#endif
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+        os_mempool_sweep();
+#endif
+#if MYNEWT_VAL(OS_IDLE_WORK)
+        idle_work_time = os_idle_work_run();
+#endif
+
         OS_ENTER_CRITICAL(sr);
         now = os_time_get();
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+        /* Sleep until the last moment that honours every timer's slack. */
+        sticks = os_sched_wakeup_slack_ticks(now);
+        cticks = os_callout_wakeup_slack_ticks(now);
+#else
         sticks = os_sched_wakeup_ticks(now);
         cticks = os_callout_wakeup_ticks(now);
+#endif
         iticks = min(sticks, cticks);
         /* Wakeup in time to run sanity as well from the idle context,
          * as the idle task does not schedule itself.
          */
         iticks = min(iticks, ((sanity_last + sanity_itvl_ticks) - now));
 
+#if MYNEWT_VAL(OS_IDLE_WORK)
+        /* Don't sleep while deferred work is still queued, unless the next
+         * wakeup is too close to run any of it; then sleep until it.
+         */
+        if (idle_work_time && os_idle_work_pending()) {
+            iticks = 0;
+        }
+#endif
+
         if (iticks < MIN_IDLE_TICKS) {
             iticks = 0;
         } else if (iticks > MAX_IDLE_TICKS) {
@@ -215,8 +243,11 @@ os_init(int (*main_fn)(int argc, char **arg))
     SEGGER_RTT_Init();
 #endif
 
-    TAILQ_INIT(&g_callout_list);
+    os_callout_list_init();
     STAILQ_INIT(&g_os_task_list);
+#if MYNEWT_VAL(OS_STACK_HWM)
+    os_stack_hwm_reset();
+#endif
     os_eventq_init(os_eventq_dflt_get());
 
     /* Initialize device list. */
@@ -250,6 +281,10 @@ os_start(void)
     /* Enable the watchdog prior to starting the OS */
     hal_watchdog_enable();
 
+#if MYNEWT_VAL(OS_TASK_PROF)
+    os_task_prof_start();
+#endif
+
     err = os_arch_os_start();
     assert(err == OS_OK);
 #else
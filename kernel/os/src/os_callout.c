@@ -28,6 +28,299 @@
 
 struct os_callout_list g_callout_list;
 
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+/*
+ * Hashed timing wheel.  A pending callout lives in the slot indexed by the low
+ * bits of its expiry time; slots are unsorted, so reset and stop are O(1).
+ * os_callout_tick() visits the slots of every tick that has elapsed since it
+ * last ran and fires the callouts in them which have expired (a slot also
+ * holds callouts due in later revolutions of the wheel).
+ *
+ * Every slot caches the earliest expiry time of its callouts, and the
+ * earliest of all of them is cached for os_callout_wakeup_ticks().  Removing
+ * the earliest callout of a slot only marks that slot dirty; the next
+ * os_callout_wakeup_ticks() call, which normally happens from the idle task,
+ * rescans the dirty slots (usually just the one that last fired) and takes the
+ * minimum of the per-slot values, so its cost does not grow with the number
+ * of pending callouts.
+ */
+#define OS_CALLOUT_WHEEL_SLOTS  MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+#define OS_CALLOUT_WHEEL_MASK   (OS_CALLOUT_WHEEL_SLOTS - 1)
+
+#if OS_CALLOUT_WHEEL_SLOTS & OS_CALLOUT_WHEEL_MASK
+#error "OS_CALLOUT_WHEEL_SLOTS must be a power of 2"
+#endif
+
+struct os_callout_wheel_slot {
+    struct os_callout_list ws_list;
+    /* Earliest expiry time in ws_list; valid if the slot is not dirty. */
+    os_time_t ws_next;
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    /* Earliest expiry time plus slack in ws_list, valid likewise. */
+    os_time_t ws_latest;
+#endif
+    uint8_t ws_dirty;
+};
+
+static struct os_callout_wheel_slot os_callout_wheel[OS_CALLOUT_WHEEL_SLOTS];
+
+/* Last tick processed by os_callout_tick(). */
+static os_time_t os_callout_wheel_time;
+
+/* Number of pending callouts. */
+static uint32_t os_callout_wheel_cnt;
+
+/* Earliest expiry time of all pending callouts; valid if next_valid is set. */
+static os_time_t os_callout_wheel_next;
+static uint8_t os_callout_wheel_next_valid;
+
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+/* Earliest expiry time plus slack of all pending callouts, cached likewise. */
+static os_time_t os_callout_wheel_latest;
+static uint8_t os_callout_wheel_latest_valid;
+#endif
+
+static inline struct os_callout_wheel_slot *
+os_callout_slot(os_time_t ticks)
+{
+    return &os_callout_wheel[ticks & OS_CALLOUT_WHEEL_MASK];
+}
+
+/**
+ * Recomputes the cached earliest expiry time(s) of a dirty slot.
+ *
+ * NOTE: must be called with interrupts disabled.
+ */
+static void
+os_callout_slot_update(struct os_callout_wheel_slot *ws)
+{
+    struct os_callout *c;
+
+    c = TAILQ_FIRST(&ws->ws_list);
+    if (c == NULL) {
+        ws->ws_dirty = 0;
+        return;
+    }
+
+    ws->ws_next = c->c_ticks;
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    ws->ws_latest = c->c_ticks + c->c_slack;
+#endif
+    while ((c = TAILQ_NEXT(c, c_next)) != NULL) {
+        if (OS_TIME_TICK_LT(c->c_ticks, ws->ws_next)) {
+            ws->ws_next = c->c_ticks;
+        }
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+        if (OS_TIME_TICK_LT(c->c_ticks + c->c_slack, ws->ws_latest)) {
+            ws->ws_latest = c->c_ticks + c->c_slack;
+        }
+#endif
+    }
+    ws->ws_dirty = 0;
+}
+
+/**
+ * Recomputes the cached earliest expiry time(s) of the whole wheel from the
+ * per-slot values.  Only dirty slots are walked.
+ *
+ * NOTE: must be called with interrupts disabled.
+ */
+static void
+os_callout_wheel_update(void)
+{
+    struct os_callout_wheel_slot *ws;
+    int i;
+
+    os_callout_wheel_next_valid = 0;
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    os_callout_wheel_latest_valid = 0;
+#endif
+
+    for (i = 0; i < OS_CALLOUT_WHEEL_SLOTS; i++) {
+        ws = &os_callout_wheel[i];
+        if (ws->ws_dirty) {
+            os_callout_slot_update(ws);
+        }
+        if (TAILQ_EMPTY(&ws->ws_list)) {
+            continue;
+        }
+
+        if (!os_callout_wheel_next_valid ||
+            OS_TIME_TICK_LT(ws->ws_next, os_callout_wheel_next)) {
+            os_callout_wheel_next = ws->ws_next;
+            os_callout_wheel_next_valid = 1;
+        }
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+        if (!os_callout_wheel_latest_valid ||
+            OS_TIME_TICK_LT(ws->ws_latest, os_callout_wheel_latest)) {
+            os_callout_wheel_latest = ws->ws_latest;
+            os_callout_wheel_latest_valid = 1;
+        }
+#endif
+    }
+}
+#endif
+
+/**
+ * Empties the list of pending callouts.
+ */
+void
+os_callout_list_init(void)
+{
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    int i;
+
+    for (i = 0; i < OS_CALLOUT_WHEEL_SLOTS; i++) {
+        TAILQ_INIT(&os_callout_wheel[i].ws_list);
+        os_callout_wheel[i].ws_dirty = 0;
+    }
+    os_callout_wheel_time = os_time_get();
+    os_callout_wheel_cnt = 0;
+    os_callout_wheel_next_valid = 0;
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    os_callout_wheel_latest_valid = 0;
+#endif
+#else
+    TAILQ_INIT(&g_callout_list);
+#endif
+}
+
+/**
+ * Adds a callout to the list of pending callouts.  The callout's expiry time
+ * must already be set.
+ *
+ * NOTE: must be called with interrupts disabled.
+ */
+static void
+os_callout_enqueue(struct os_callout *c)
+{
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    struct os_callout_wheel_slot *ws;
+
+    ws = os_callout_slot(c->c_ticks);
+    if (TAILQ_EMPTY(&ws->ws_list)) {
+        ws->ws_next = c->c_ticks;
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+        ws->ws_latest = c->c_ticks + c->c_slack;
+#endif
+        ws->ws_dirty = 0;
+    } else if (!ws->ws_dirty) {
+        if (OS_TIME_TICK_LT(c->c_ticks, ws->ws_next)) {
+            ws->ws_next = c->c_ticks;
+        }
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+        if (OS_TIME_TICK_LT(c->c_ticks + c->c_slack, ws->ws_latest)) {
+            ws->ws_latest = c->c_ticks + c->c_slack;
+        }
+#endif
+    }
+    TAILQ_INSERT_TAIL(&ws->ws_list, c, c_next);
+
+    if (os_callout_wheel_cnt++ == 0) {
+        os_callout_wheel_next = c->c_ticks;
+        os_callout_wheel_next_valid = 1;
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+        os_callout_wheel_latest = c->c_ticks + c->c_slack;
+        os_callout_wheel_latest_valid = 1;
+#endif
+        return;
+    }
+
+    if (os_callout_wheel_next_valid &&
+        OS_TIME_TICK_LT(c->c_ticks, os_callout_wheel_next)) {
+        os_callout_wheel_next = c->c_ticks;
+    }
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    if (os_callout_wheel_latest_valid &&
+        OS_TIME_TICK_LT(c->c_ticks + c->c_slack, os_callout_wheel_latest)) {
+        os_callout_wheel_latest = c->c_ticks + c->c_slack;
+    }
+#endif
+#else
+    struct os_callout *entry;
+
+    entry = NULL;
+    TAILQ_FOREACH(entry, &g_callout_list, c_next) {
+        if (OS_TIME_TICK_LT(c->c_ticks, entry->c_ticks)) {
+            break;
+        }
+    }
+
+    if (entry) {
+        TAILQ_INSERT_BEFORE(entry, c, c_next);
+    } else {
+        TAILQ_INSERT_TAIL(&g_callout_list, c, c_next);
+    }
+#endif
+}
+
+/**
+ * Removes a queued callout from the list of pending callouts.
+ *
+ * NOTE: must be called with interrupts disabled.
+ */
+static void
+os_callout_dequeue(struct os_callout *c)
+{
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    struct os_callout_wheel_slot *ws;
+
+    ws = os_callout_slot(c->c_ticks);
+    TAILQ_REMOVE(&ws->ws_list, c, c_next);
+
+    os_callout_wheel_cnt--;
+    if (c->c_ticks == ws->ws_next) {
+        ws->ws_dirty = 1;
+    }
+    if (c->c_ticks == os_callout_wheel_next) {
+        os_callout_wheel_next_valid = 0;
+    }
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    if (c->c_ticks + c->c_slack == ws->ws_latest) {
+        ws->ws_dirty = 1;
+    }
+    if (c->c_ticks + c->c_slack == os_callout_wheel_latest) {
+        os_callout_wheel_latest_valid = 0;
+    }
+#endif
+#else
+    TAILQ_REMOVE(&g_callout_list, c, c_next);
+#endif
+    c->c_next.tqe_prev = NULL;
+}
+
+/**
+ * Removes and returns a callout which has expired at 'now', or NULL if there
+ * is none.  With the timing wheel only the slot of tick 'slot_ticks' is
+ * searched.
+ *
+ * NOTE: must be called with interrupts disabled.
+ */
+static struct os_callout *
+os_callout_dequeue_expired(os_time_t slot_ticks, os_time_t now)
+{
+    struct os_callout *c;
+
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    TAILQ_FOREACH(c, &os_callout_slot(slot_ticks)->ws_list, c_next) {
+        if (OS_TIME_TICK_GEQ(now, c->c_ticks)) {
+            break;
+        }
+    }
+#else
+    c = TAILQ_FIRST(&g_callout_list);
+    if (c && !OS_TIME_TICK_GEQ(now, c->c_ticks)) {
+        c = NULL;
+    }
+#endif
+
+    if (c) {
+        os_callout_dequeue(c);
+    }
+
+    return c;
+}
+
 void os_callout_init(struct os_callout *c, struct os_eventq *evq,
                      os_event_fn *ev_cb, void *ev_arg)
 {
@@ -51,8 +344,7 @@ os_callout_stop(struct os_callout *c)
     OS_ENTER_CRITICAL(sr);
 
     if (os_callout_queued(c)) {
-        TAILQ_REMOVE(&g_callout_list, c, c_next);
-        c->c_next.tqe_prev = NULL;
+        os_callout_dequeue(c);
     }
 
     if (c->c_evq) {
@@ -67,7 +359,6 @@ os_callout_stop(struct os_callout *c)
 int
 os_callout_reset(struct os_callout *c, os_time_t ticks)
 {
-    struct os_callout *entry;
     os_sr_t sr;
     int ret;
 
@@ -87,19 +378,7 @@ os_callout_reset(struct os_callout *c, os_time_t ticks)
     }
 
     c->c_ticks = os_time_get() + ticks;
-
-    entry = NULL;
-    TAILQ_FOREACH(entry, &g_callout_list, c_next) {
-        if (OS_TIME_TICK_LT(c->c_ticks, entry->c_ticks)) {
-            break;
-        }
-    }
-
-    if (entry) {
-        TAILQ_INSERT_BEFORE(entry, c, c_next);
-    } else {
-        TAILQ_INSERT_TAIL(&g_callout_list, c, c_next);
-    }
+    os_callout_enqueue(c);
 
     OS_EXIT_CRITICAL(sr);
 
@@ -111,6 +390,50 @@ err:
 }
 
 
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+void
+os_callout_set_slack(struct os_callout *c, os_time_t slack)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+
+    /* Requeue a pending callout so the cached wakeup times stay right. */
+    if (os_callout_queued(c)) {
+        os_callout_dequeue(c);
+        c->c_slack = slack;
+        os_callout_enqueue(c);
+    } else {
+        c->c_slack = slack;
+    }
+
+    OS_EXIT_CRITICAL(sr);
+}
+#endif
+
+int
+os_callout_reset_at(struct os_callout *c, uint64_t deadline)
+{
+    uint64_t now;
+    os_sr_t sr;
+    int ret;
+
+    OS_ENTER_CRITICAL(sr);
+
+    now = os_time_get64();
+    if (deadline <= now) {
+        ret = os_callout_reset(c, 0);
+    } else if (deadline - now > INT32_MAX) {
+        ret = OS_EINVAL;
+    } else {
+        ret = os_callout_reset(c, deadline - now);
+    }
+
+    OS_EXIT_CRITICAL(sr);
+
+    return ret;
+}
+
 /**
  * This function is called by the OS in the time tick.  It searches the list
  * of callouts, and sees if any of them are ready to run.  If they are ready
@@ -123,22 +446,26 @@ os_callout_tick(void)
     os_sr_t sr;
     struct os_callout *c;
     uint32_t now;
+    os_time_t slot_ticks;
+    uint32_t nslots;
 
     os_trace_api_void(OS_TRACE_ID_CALLOUT_TICK);
 
     now = os_time_get();
 
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    /* Visit the slot of every tick since the last call, but no slot twice. */
+    slot_ticks = os_callout_wheel_time + 1;
+    nslots = min(now - os_callout_wheel_time, OS_CALLOUT_WHEEL_SLOTS);
+    os_callout_wheel_time = now;
+#else
+    slot_ticks = now;
+    nslots = 1;
+#endif
+
     while (1) {
         OS_ENTER_CRITICAL(sr);
-        c = TAILQ_FIRST(&g_callout_list);
-        if (c) {
-            if (OS_TIME_TICK_GEQ(now, c->c_ticks)) {
-                TAILQ_REMOVE(&g_callout_list, c, c_next);
-                c->c_next.tqe_prev = NULL;
-            } else {
-                c = NULL;
-            }
-        }
+        c = os_callout_dequeue_expired(slot_ticks, now);
         OS_EXIT_CRITICAL(sr);
 
         if (c) {
@@ -147,6 +474,9 @@ os_callout_tick(void)
             } else {
                 c->c_ev.ev_cb(&c->c_ev);
             }
+        } else if (nslots > 1) {
+            nslots--;
+            slot_ticks++;
         } else {
             break;
         }
@@ -167,10 +497,27 @@ os_time_t
 os_callout_wakeup_ticks(os_time_t now)
 {
     os_time_t rt;
+#if !MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
     struct os_callout *c;
+#endif
 
     OS_ASSERT_CRITICAL();
 
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    if (os_callout_wheel_cnt != 0 && !os_callout_wheel_next_valid) {
+        os_callout_wheel_update();
+    }
+
+    if (os_callout_wheel_cnt != 0) {
+        if (OS_TIME_TICK_GEQ(os_callout_wheel_next, now)) {
+            rt = os_callout_wheel_next - now;
+        } else {
+            rt = 0;     /* callout time is in the past */
+        }
+    } else {
+        rt = OS_TIMEOUT_NEVER;
+    }
+#else
     c = TAILQ_FIRST(&g_callout_list);
     if (c != NULL) {
         if (OS_TIME_TICK_GEQ(c->c_ticks, now)) {
@@ -181,10 +528,67 @@ os_callout_wakeup_ticks(os_time_t now)
     } else {
         rt = OS_TIMEOUT_NEVER;
     }
+#endif
 
     return (rt);
 }
 
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+/*
+ * Returns the number of ticks to the latest time at which all pending
+ * callouts can still be run within their slack, i.e. the earliest expiry time
+ * plus slack.  If there are no pending callouts then return OS_TIMEOUT_NEVER
+ * instead.
+ *
+ * @param now The time now
+ *
+ * @return Number of ticks the idle task may sleep for
+ */
+os_time_t
+os_callout_wakeup_slack_ticks(os_time_t now)
+{
+#if !MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    struct os_callout *c;
+#endif
+    os_time_t latest;
+
+    OS_ASSERT_CRITICAL();
+
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    if (os_callout_wheel_cnt == 0) {
+        return (OS_TIMEOUT_NEVER);
+    }
+
+    if (!os_callout_wheel_latest_valid) {
+        os_callout_wheel_update();
+    }
+    latest = os_callout_wheel_latest;
+#else
+    c = TAILQ_FIRST(&g_callout_list);
+    if (c == NULL) {
+        return (OS_TIMEOUT_NEVER);
+    }
+
+    /*
+     * The list is sorted by expiry time, so no callout after one expiring at
+     * or after 'latest' can bring it forward.
+     */
+    latest = c->c_ticks + c->c_slack;
+    while ((c = TAILQ_NEXT(c, c_next)) != NULL &&
+           OS_TIME_TICK_LT(c->c_ticks, latest)) {
+        if (OS_TIME_TICK_LT(c->c_ticks + c->c_slack, latest)) {
+            latest = c->c_ticks + c->c_slack;
+        }
+    }
+#endif
+
+    if (OS_TIME_TICK_GEQ(latest, now)) {
+        return (latest - now);
+    } else {
+        return (0);
+    }
+}
+#endif
 
 os_time_t
 os_callout_remaining_ticks(struct os_callout *c, os_time_t now)
@@ -21,6 +21,7 @@
 #include <stdint.h>
 #include <assert.h>
 #include "os/mynewt.h"
+#include "os_priv.h"
 
 #if defined(OS_CPUTIME_FREQ_HIGH)
 struct os_cputime_data g_os_cputime;
@@ -75,6 +76,105 @@ os_cputime_delay_usecs(uint32_t usecs)
     os_cputime_delay_ticks(ticks);
 }
 
+/**
+ * Timer callback used by the sleeping APIs: makes the task passed as 'arg'
+ * runnable again.  Does nothing if the task has already been woken by
+ * something else (e.g. it got the semaphore it was waiting for).
+ */
+void
+os_cputime_task_wakeup(void *arg)
+{
+    struct os_task *t;
+    os_sr_t sr;
+
+    t = arg;
+
+    OS_ENTER_CRITICAL(sr);
+    if (t->t_state == OS_TASK_SLEEP) {
+        os_sched_wakeup(t);
+    }
+    OS_EXIT_CRITICAL(sr);
+
+    os_sched(NULL);
+}
+
+/**
+ * Returns the number of OS ticks a task can sleep on the OS tick before it
+ * has to switch to the cputime timer to end a wait of 'ticks' cputime ticks
+ * started at cputime 'start'.  Returns 0 once the rest is close enough to be
+ * timed with the cputime timer only.
+ *
+ * The wait is tracked as time elapsed since 'start' rather than as a
+ * deadline, which can only be compared with the current cputime while it is
+ * less than 2^31 ticks away.  A longer wait is slept on the OS tick in one or
+ * more chunks until the rest fits.
+ */
+os_time_t
+os_cputime_ostime_left(uint32_t start, uint32_t ticks)
+{
+    uint32_t elapsed;
+    uint32_t remaining;
+    uint32_t slack;
+
+    elapsed = os_cputime_get32() - start;
+    if (elapsed >= ticks) {
+        return 0;
+    }
+
+    remaining = ticks - elapsed;
+    slack = os_cputime_usecs_to_ticks(
+                MYNEWT_VAL(OS_CPUTIME_SLEEP_TIMER_USECS));
+    if (remaining <= slack) {
+        return 0;
+    }
+
+    return min((uint64_t)(remaining - slack) * OS_TICKS_PER_SEC /
+               MYNEWT_VAL(OS_CPUTIME_FREQ), INT32_MAX);
+}
+
+void
+os_cputime_sleep_ticks(uint32_t ticks)
+{
+    struct hal_timer timer;
+    struct os_task *t;
+    uint32_t start;
+    os_time_t osticks;
+    os_sr_t sr;
+
+    start = os_cputime_get32();
+
+    /* Sleep through most of a long delay on the OS tick. */
+    while ((osticks = os_cputime_ostime_left(start, ticks)) > 0) {
+        os_time_delay(osticks);
+    }
+
+    if (os_cputime_get32() - start >= ticks) {
+        return;
+    }
+
+    t = os_sched_get_current_task();
+    os_cputime_timer_init(&timer, os_cputime_task_wakeup, t);
+
+    /*
+     * Arm the timer only once the task is on the sleep list, so that an
+     * expiry right away still finds it asleep.
+     */
+    OS_ENTER_CRITICAL(sr);
+    os_sched_sleep(t, OS_TIMEOUT_NEVER);
+    os_cputime_timer_start(&timer, start + ticks);
+    OS_EXIT_CRITICAL(sr);
+
+    os_sched(NULL);
+
+    os_cputime_timer_stop(&timer);
+}
+
+void
+os_cputime_sleep_usecs(uint32_t usecs)
+{
+    os_cputime_sleep_ticks(os_cputime_usecs_to_ticks(usecs));
+}
+
 void
 os_cputime_timer_init(struct hal_timer *timer, hal_timer_cb fp, void *arg)
 {
@@ -22,6 +22,62 @@
 
 static STAILQ_HEAD(, os_dev) g_os_dev_list;
 
+#if MYNEWT_VAL(OS_DEV_HASH_BUCKETS) > 0
+#if (MYNEWT_VAL(OS_DEV_HASH_BUCKETS) & (MYNEWT_VAL(OS_DEV_HASH_BUCKETS) - 1))
+#error "OS_DEV_HASH_BUCKETS must be a power of 2"
+#endif
+
+/* Name index over g_os_dev_list; see os_dev_lookup(). */
+static SLIST_HEAD(, os_dev) g_os_dev_hash[MYNEWT_VAL(OS_DEV_HASH_BUCKETS)];
+
+/**
+ * FNV-1a hash of a device name, reduced to a bucket index.
+ */
+static int
+os_dev_hash_idx(const char *name)
+{
+    uint32_t hash;
+
+    hash = 2166136261u;
+    while (*name != '\0') {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+
+    return hash & (MYNEWT_VAL(OS_DEV_HASH_BUCKETS) - 1);
+}
+
+/**
+ * Links a device, already in g_os_dev_list, into its hash bucket.  Each
+ * bucket is kept in g_os_dev_list order, so that os_dev_lookup() finds the
+ * same device for a duplicate name as a walk of g_os_dev_list would.
+ */
+static void
+os_dev_hash_add(struct os_dev *dev)
+{
+    struct os_dev *cur_dev;
+    struct os_dev *prev;
+    int idx;
+
+    idx = os_dev_hash_idx(dev->od_name);
+    prev = NULL;
+    STAILQ_FOREACH(cur_dev, &g_os_dev_list, od_next) {
+        if (cur_dev == dev) {
+            break;
+        }
+        if (os_dev_hash_idx(cur_dev->od_name) == idx) {
+            prev = cur_dev;
+        }
+    }
+
+    if (prev) {
+        SLIST_INSERT_AFTER(prev, dev, od_hash_next);
+    } else {
+        SLIST_INSERT_HEAD(&g_os_dev_hash[idx], dev, od_hash_next);
+    }
+}
+#endif
+
 static int
 os_dev_init(struct os_dev *dev, char *name, uint8_t stage,
         uint8_t priority, os_dev_init_func_t od_init, void *arg)
@@ -54,29 +110,32 @@ os_dev_add(struct os_dev *dev)
     /* If no devices present, insert into head */
     if (STAILQ_FIRST(&g_os_dev_list) == NULL) {
         STAILQ_INSERT_HEAD(&g_os_dev_list, dev, od_next);
-        return (0);
-    }
+    } else {
+        /* Add devices to the list, sorted first by stage, then by
+         * priority.  Keep sorted in this order for initialization
+         * stage.
+         */
+        cur_dev = NULL;
+        STAILQ_FOREACH(cur_dev, &g_os_dev_list, od_next) {
+            if (cur_dev->od_stage > dev->od_stage) {
+                continue;
+            }
 
-    /* Add devices to the list, sorted first by stage, then by
-     * priority.  Keep sorted in this order for initialization
-     * stage.
-     */
-    cur_dev = NULL;
-    STAILQ_FOREACH(cur_dev, &g_os_dev_list, od_next) {
-        if (cur_dev->od_stage > dev->od_stage) {
-            continue;
+            if (dev->od_priority >= cur_dev->od_priority) {
+                break;
+            }
         }
 
-        if (dev->od_priority >= cur_dev->od_priority) {
-            break;
+        if (cur_dev) {
+            STAILQ_INSERT_AFTER(&g_os_dev_list, cur_dev, dev, od_next);
+        } else {
+            STAILQ_INSERT_TAIL(&g_os_dev_list, dev, od_next);
         }
     }
 
-    if (cur_dev) {
-        STAILQ_INSERT_AFTER(&g_os_dev_list, cur_dev, dev, od_next);
-    } else {
-        STAILQ_INSERT_TAIL(&g_os_dev_list, dev, od_next);
-    }
+#if MYNEWT_VAL(OS_DEV_HASH_BUCKETS) > 0
+    os_dev_hash_add(dev);
+#endif
 
     return (0);
 }
@@ -190,11 +249,19 @@ os_dev_lookup(char *name)
     struct os_dev *dev;
 
     dev = NULL;
+#if MYNEWT_VAL(OS_DEV_HASH_BUCKETS) > 0
+    SLIST_FOREACH(dev, &g_os_dev_hash[os_dev_hash_idx(name)], od_hash_next) {
+        if (!strcmp(dev->od_name, name)) {
+            break;
+        }
+    }
+#else
     STAILQ_FOREACH(dev, &g_os_dev_list, od_next) {
         if (!strcmp(dev->od_name, name)) {
             break;
         }
     }
+#endif
     return (dev);
 }
 
@@ -202,14 +269,21 @@ struct os_dev *
 os_dev_open(char *devname, uint32_t timo, void *arg)
 {
     struct os_dev *dev;
-    os_sr_t sr;
-    int rc;
 
     dev = os_dev_lookup(devname);
     if (dev == NULL) {
         return (NULL);
     }
 
+    return os_dev_open_handle(dev, timo, arg);
+}
+
+struct os_dev *
+os_dev_open_handle(struct os_dev *dev, uint32_t timo, void *arg)
+{
+    os_sr_t sr;
+    int rc;
+
     /* Device is not ready to be opened. */
     if ((dev->od_flags & OS_DEV_F_STATUS_READY) == 0) {
         return (NULL);
@@ -318,5 +392,8 @@ void
 os_dev_reset(void)
 {
     STAILQ_INIT(&g_os_dev_list);
+#if MYNEWT_VAL(OS_DEV_HASH_BUCKETS) > 0
+    memset(g_os_dev_hash, 0, sizeof g_os_dev_hash);
+#endif
 }
 
@@ -25,19 +25,125 @@
 #endif
 #include "os/mynewt.h"
 
+#define OS_EVENTQ_PRIOS     MYNEWT_VAL(OS_EVENTQ_PRIOS)
+
+#if OS_EVENTQ_PRIOS < 1 || OS_EVENTQ_PRIOS > 32
+#error "OS_EVENTQ_PRIOS must be between 1 and 32"
+#endif
+
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+#define OS_EVENTQ_SET_MAX   MYNEWT_VAL(OS_EVENTQ_SET_MAX)
+#define OS_EVENTQ_SET_WORDS ((OS_EVENTQ_SET_MAX + 31) / 32)
+
+#if OS_EVENTQ_SET_MAX < 1 || OS_EVENTQ_SET_MAX > UINT16_MAX
+#error "OS_EVENTQ_SET_MAX must be between 1 and 65535"
+#endif
+#endif
+
 static struct os_eventq os_eventq_main;
 
+#if OS_EVENTQ_PRIOS > 1
+/* Level an event is queued at; out of range priorities use the last one. */
+#define OS_EVENTQ_LEVEL(ev)     min((ev)->ev_prio, OS_EVENTQ_PRIOS - 1)
+#endif
+
+/*
+ * Queue manipulation; all must be called with interrupts disabled, except on
+ * a queue nothing else can touch.
+ */
+static inline struct os_event *
+os_eventq_first(struct os_eventq *evq)
+{
+#if OS_EVENTQ_PRIOS > 1
+    if (evq->evq_prio_map == 0) {
+        return NULL;
+    }
+    return STAILQ_FIRST(&evq->evq_list[__builtin_ctz(evq->evq_prio_map)]);
+#else
+    return STAILQ_FIRST(&evq->evq_list);
+#endif
+}
+
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+static inline void
+os_eventq_set_mark(struct os_eventq *evq, int ready)
+{
+    struct os_eventq_set *set;
+    uint32_t bit;
+    int word;
+
+    set = evq->evq_set;
+    if (set == NULL) {
+        return;
+    }
+
+    word = evq->evq_set_idx / 32;
+    bit = 1UL << (evq->evq_set_idx % 32);
+    if (ready) {
+        set->evs_ready[word] |= bit;
+    } else {
+        set->evs_ready[word] &= ~bit;
+    }
+}
+#endif
+
+static inline void
+os_eventq_insert(struct os_eventq *evq, struct os_event *ev)
+{
+#if OS_EVENTQ_PRIOS > 1
+    STAILQ_INSERT_TAIL(&evq->evq_list[OS_EVENTQ_LEVEL(ev)], ev, ev_next);
+    evq->evq_prio_map |= 1UL << OS_EVENTQ_LEVEL(ev);
+#else
+    STAILQ_INSERT_TAIL(&evq->evq_list, ev, ev_next);
+#endif
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+    os_eventq_set_mark(evq, 1);
+#endif
+}
+
+static inline void
+os_eventq_unlink(struct os_eventq *evq, struct os_event *ev)
+{
+#if OS_EVENTQ_PRIOS > 1
+    STAILQ_REMOVE(&evq->evq_list[OS_EVENTQ_LEVEL(ev)], ev, os_event, ev_next);
+    if (STAILQ_EMPTY(&evq->evq_list[OS_EVENTQ_LEVEL(ev)])) {
+        evq->evq_prio_map &= ~(1UL << OS_EVENTQ_LEVEL(ev));
+    }
+#else
+    STAILQ_REMOVE(&evq->evq_list, ev, os_event, ev_next);
+#endif
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+    if (os_eventq_first(evq) == NULL) {
+        os_eventq_set_mark(evq, 0);
+    }
+#endif
+}
+
 void
 os_eventq_init(struct os_eventq *evq)
 {
+#if OS_EVENTQ_PRIOS > 1
+    int i;
+#endif
+
     memset(evq, 0, sizeof(*evq));
+#if OS_EVENTQ_PRIOS > 1
+    for (i = 0; i < OS_EVENTQ_PRIOS; i++) {
+        STAILQ_INIT(&evq->evq_list[i]);
+    }
+#else
     STAILQ_INIT(&evq->evq_list);
+#endif
 }
 
 int
 os_eventq_inited(const struct os_eventq *evq)
 {
+#if OS_EVENTQ_PRIOS > 1
+    return evq->evq_list[0].stqh_last != NULL;
+#else
     return evq->evq_list.stqh_last != NULL;
+#endif
 }
 
 void
@@ -59,7 +165,7 @@ os_eventq_put(struct os_eventq *evq, struct os_event *ev)
 
     /* Queue the event */
     ev->ev_queued = 1;
-    STAILQ_INSERT_TAIL(&evq->evq_list, ev, ev_next);
+    os_eventq_insert(evq, ev);
 
     resched = 0;
     if (evq->evq_task) {
@@ -77,6 +183,17 @@ os_eventq_put(struct os_eventq *evq, struct os_event *ev)
         evq->evq_task = NULL;
     }
 
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+    /* Likewise for a task waiting on the set this queue belongs to. */
+    if (evq->evq_set != NULL && evq->evq_set->evs_task != NULL) {
+        if (evq->evq_set->evs_task->t_state == OS_TASK_SLEEP) {
+            os_sched_wakeup(evq->evq_set->evs_task);
+            resched = 1;
+        }
+        evq->evq_set->evs_task = NULL;
+    }
+#endif
+
     OS_EXIT_CRITICAL(sr);
 
     if (resched) {
@@ -93,9 +210,9 @@ os_eventq_get_no_wait(struct os_eventq *evq)
 
     os_trace_api_u32(OS_TRACE_ID_EVENTQ_GET_NO_WAIT, (uint32_t)evq);
 
-    ev = STAILQ_FIRST(&evq->evq_list);
+    ev = os_eventq_first(evq);
     if (ev) {
-        STAILQ_REMOVE(&evq->evq_list, ev, os_event, ev_next);
+        os_eventq_unlink(evq, ev);
         ev->ev_queued = 0;
     }
 
@@ -127,9 +244,9 @@ os_eventq_get(struct os_eventq *evq)
     }
     OS_ENTER_CRITICAL(sr);
 pull_one:
-    ev = STAILQ_FIRST(&evq->evq_list);
+    ev = os_eventq_first(evq);
     if (ev) {
-        STAILQ_REMOVE(&evq->evq_list, ev, os_event, ev_next);
+        os_eventq_unlink(evq, ev);
         ev->ev_queued = 0;
         t->t_flags &= ~OS_TASK_FLAG_EVQ_WAIT;
     } else {
@@ -162,6 +279,41 @@ os_eventq_run(struct os_eventq *evq)
     ev->ev_cb(ev);
 }
 
+int
+os_eventq_run_batch(struct os_eventq *evq, int max)
+{
+    struct os_event *ev;
+    os_sr_t sr;
+    int cnt;
+
+    assert(max > 0);
+
+    ev = os_eventq_get(evq);
+    cnt = 0;
+    while (1) {
+        assert(ev->ev_cb != NULL);
+        ev->ev_cb(ev);
+
+        if (++cnt >= max) {
+            break;
+        }
+
+        OS_ENTER_CRITICAL(sr);
+        ev = os_eventq_first(evq);
+        if (ev) {
+            os_eventq_unlink(evq, ev);
+            ev->ev_queued = 0;
+        }
+        OS_EXIT_CRITICAL(sr);
+
+        if (ev == NULL) {
+            break;
+        }
+    }
+
+    return cnt;
+}
+
 static struct os_event *
 os_eventq_poll_0timo(struct os_eventq **evq, int nevqs)
 {
@@ -176,9 +328,9 @@ os_eventq_poll_0timo(struct os_eventq **evq, int nevqs)
 
     OS_ENTER_CRITICAL(sr);
     for (i = 0; i < nevqs; i++) {
-        ev = STAILQ_FIRST(&evq[i]->evq_list);
+        ev = os_eventq_first(evq[i]);
         if (ev) {
-            STAILQ_REMOVE(&evq[i]->evq_list, ev, os_event, ev_next);
+            os_eventq_unlink(evq[i], ev);
             ev->ev_queued = 0;
             break;
         }
@@ -214,9 +366,9 @@ os_eventq_poll(struct os_eventq **evq, int nevqs, os_time_t timo)
     cur_t = os_sched_get_current_task();
 
     for (i = 0; i < nevqs; i++) {
-        ev = STAILQ_FIRST(&evq[i]->evq_list);
+        ev = os_eventq_first(evq[i]);
         if (ev) {
-            STAILQ_REMOVE(&evq[i]->evq_list, ev, os_event, ev_next);
+            os_eventq_unlink(evq[i], ev);
             ev->ev_queued = 0;
             /* Reset the items that already have an evq task set. */
             for (j = 0; j < i; j++) {
@@ -245,9 +397,9 @@ os_eventq_poll(struct os_eventq **evq, int nevqs, os_time_t timo)
          * we haven't found one.
          */
         if (!ev) {
-            ev = STAILQ_FIRST(&evq[i]->evq_list);
+            ev = os_eventq_first(evq[i]);
             if (ev) {
-                STAILQ_REMOVE(&evq[i]->evq_list, ev, os_event, ev_next);
+                os_eventq_unlink(evq[i], ev);
                 ev->ev_queued = 0;
             }
         }
@@ -270,7 +422,7 @@ os_eventq_remove(struct os_eventq *evq, struct os_event *ev)
 
     OS_ENTER_CRITICAL(sr);
     if (OS_EVENT_QUEUED(ev)) {
-        STAILQ_REMOVE(&evq->evq_list, ev, os_event, ev_next);
+        os_eventq_unlink(evq, ev);
     }
     ev->ev_queued = 0;
     OS_EXIT_CRITICAL(sr);
@@ -278,6 +430,136 @@ os_eventq_remove(struct os_eventq *evq, struct os_event *ev)
     os_trace_api_ret(OS_TRACE_ID_EVENTQ_REMOVE);
 }
 
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+void
+os_eventq_set_init(struct os_eventq_set *set)
+{
+    memset(set, 0, sizeof(*set));
+}
+
+int
+os_eventq_set_add(struct os_eventq_set *set, struct os_eventq *evq)
+{
+    os_sr_t sr;
+    int rc;
+    int i;
+
+    OS_ENTER_CRITICAL(sr);
+    if (evq->evq_set != NULL) {
+        rc = OS_EINVAL;
+        goto done;
+    }
+
+    for (i = 0; i < OS_EVENTQ_SET_MAX; i++) {
+        if (set->evs_queues[i] == NULL) {
+            break;
+        }
+    }
+    if (i == OS_EVENTQ_SET_MAX) {
+        rc = OS_ENOMEM;
+        goto done;
+    }
+
+    set->evs_queues[i] = evq;
+    evq->evq_set = set;
+    evq->evq_set_idx = i;
+    os_eventq_set_mark(evq, os_eventq_first(evq) != NULL);
+    rc = 0;
+
+done:
+    OS_EXIT_CRITICAL(sr);
+    return rc;
+}
+
+int
+os_eventq_set_remove(struct os_eventq_set *set, struct os_eventq *evq)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    if (evq->evq_set != set) {
+        OS_EXIT_CRITICAL(sr);
+        return OS_EINVAL;
+    }
+
+    os_eventq_set_mark(evq, 0);
+    set->evs_queues[evq->evq_set_idx] = NULL;
+    evq->evq_set = NULL;
+    OS_EXIT_CRITICAL(sr);
+
+    return 0;
+}
+
+/**
+ * Takes the first event off the lowest numbered ready member of a set.
+ * Must be called with interrupts disabled.
+ */
+static struct os_event *
+os_eventq_set_pull(struct os_eventq_set *set, struct os_eventq **out_evq)
+{
+    struct os_eventq *evq;
+    struct os_event *ev;
+    int i;
+
+    for (i = 0; i < OS_EVENTQ_SET_WORDS; i++) {
+        if (set->evs_ready[i] != 0) {
+            break;
+        }
+    }
+    if (i == OS_EVENTQ_SET_WORDS) {
+        return NULL;
+    }
+
+    evq = set->evs_queues[i * 32 + __builtin_ctz(set->evs_ready[i])];
+    ev = os_eventq_first(evq);
+    assert(ev != NULL);
+    os_eventq_unlink(evq, ev);
+    ev->ev_queued = 0;
+
+    if (out_evq != NULL) {
+        *out_evq = evq;
+    }
+
+    return ev;
+}
+
+struct os_event *
+os_eventq_set_poll(struct os_eventq_set *set, os_time_t timo,
+                   struct os_eventq **out_evq)
+{
+    struct os_event *ev;
+    struct os_task *cur_t;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    ev = os_eventq_set_pull(set, out_evq);
+    if (ev != NULL || timo == 0) {
+        OS_EXIT_CRITICAL(sr);
+        return ev;
+    }
+
+    cur_t = os_sched_get_current_task();
+    assert(set->evs_task == NULL || set->evs_task == cur_t);
+
+    do {
+        set->evs_task = cur_t;
+        cur_t->t_flags |= OS_TASK_FLAG_EVQ_WAIT;
+        os_sched_sleep(cur_t, timo);
+        OS_EXIT_CRITICAL(sr);
+
+        os_sched(NULL);
+
+        OS_ENTER_CRITICAL(sr);
+        cur_t->t_flags &= ~OS_TASK_FLAG_EVQ_WAIT;
+        set->evs_task = NULL;
+        ev = os_eventq_set_pull(set, out_evq);
+    } while (ev == NULL && timo == OS_WAIT_FOREVER);
+    OS_EXIT_CRITICAL(sr);
+
+    return ev;
+}
+#endif
+
 struct os_eventq *
 os_eventq_dflt_get(void)
 {
@@ -0,0 +1,478 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*
+ * Two-Level Segregated Fit allocator used as the os_malloc() backend when
+ * OS_HEAP_TLSF is enabled.
+ *
+ * Free blocks are kept in FL x SL segregated lists: the first level splits
+ * sizes by power of two, the second level linearly subdivides each power of
+ * two into OS_TLSF_SL_COUNT ranges.  Two bitmaps record which lists are
+ * non-empty, so finding a fitting block, splitting it and coalescing a freed
+ * block with its physical neighbours all take constant time.
+ *
+ * Memory is obtained from _sbrk() in chunks of at least OS_HEAP_TLSF_GROW
+ * bytes.  Each chunk ends in a zero sized, permanently used sentinel block so
+ * coalescing never runs off its end.  Callers serialize access.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "os/mynewt.h"
+#include "hal/hal_bsp.h"
+#include "os_priv.h"
+
+#if MYNEWT_VAL(OS_HEAP_TLSF)
+
+#define OS_TLSF_ALIGN_LOG2      (3)
+#define OS_TLSF_ALIGN           (1 << OS_TLSF_ALIGN_LOG2)
+#define OS_TLSF_SL_LOG2         (4)
+#define OS_TLSF_SL_COUNT        (1 << OS_TLSF_SL_LOG2)
+#define OS_TLSF_FL_SHIFT        (OS_TLSF_SL_LOG2 + OS_TLSF_ALIGN_LOG2)
+#define OS_TLSF_SMALL_BLOCK     (1 << OS_TLSF_FL_SHIFT)
+/*
+ * Sizes are indexed up to 2^OS_TLSF_FL_MAX_LOG2 bytes (16MB); larger free
+ * blocks all share the last list.  Requests are limited to half of that.
+ */
+#define OS_TLSF_FL_MAX_LOG2     (24)
+#define OS_TLSF_FL_COUNT        (OS_TLSF_FL_MAX_LOG2 - OS_TLSF_FL_SHIFT + 1)
+#define OS_TLSF_MAX_REQUEST     ((size_t)1 << (OS_TLSF_FL_MAX_LOG2 - 1))
+
+/* Low bits of the size field. */
+#define OS_TLSF_F_FREE          (0x1)
+#define OS_TLSF_F_PREV_FREE     (0x2)
+#define OS_TLSF_F_MASK          (0x3)
+
+struct os_tlsf_block {
+    /* Previous block in memory; only valid if that block is free. */
+    struct os_tlsf_block *prev_phys;
+    /* Size of the payload in bytes, plus OS_TLSF_F_* flags. */
+    size_t size;
+    /* Free list links; overlap the payload of used blocks. */
+    struct os_tlsf_block *next_free;
+    struct os_tlsf_block *prev_free;
+};
+
+#define OS_TLSF_HDR_SIZE        offsetof(struct os_tlsf_block, next_free)
+#define OS_TLSF_MIN_SIZE        \
+    (sizeof(struct os_tlsf_block) - OS_TLSF_HDR_SIZE)
+
+_Static_assert(OS_TLSF_HDR_SIZE % OS_TLSF_ALIGN == 0,
+               "TLSF block header must keep payloads aligned");
+
+static uint32_t os_tlsf_fl_map;
+static uint32_t os_tlsf_sl_map[OS_TLSF_FL_COUNT];
+static struct os_tlsf_block *os_tlsf_lists[OS_TLSF_FL_COUNT][OS_TLSF_SL_COUNT];
+static struct os_heap_info os_tlsf_info;
+/* End of the most recently added pool, just past its sentinel. */
+static uintptr_t os_tlsf_pool_end;
+
+static inline size_t
+os_tlsf_size(const struct os_tlsf_block *b)
+{
+    return b->size & ~(size_t)OS_TLSF_F_MASK;
+}
+
+static inline void
+os_tlsf_set_size(struct os_tlsf_block *b, size_t size)
+{
+    b->size = size | (b->size & OS_TLSF_F_MASK);
+}
+
+static inline void *
+os_tlsf_payload(struct os_tlsf_block *b)
+{
+    return (uint8_t *)b + OS_TLSF_HDR_SIZE;
+}
+
+static inline struct os_tlsf_block *
+os_tlsf_from_payload(void *ptr)
+{
+    return (struct os_tlsf_block *)((uint8_t *)ptr - OS_TLSF_HDR_SIZE);
+}
+
+static inline struct os_tlsf_block *
+os_tlsf_next_phys(struct os_tlsf_block *b)
+{
+    return (struct os_tlsf_block *)((uint8_t *)os_tlsf_payload(b) +
+                                    os_tlsf_size(b));
+}
+
+static inline int
+os_tlsf_fls(size_t x)
+{
+    return 31 - __builtin_clz((uint32_t)x);
+}
+
+/**
+ * Maps a block size to the list holding blocks of that size.
+ */
+static void
+os_tlsf_mapping(size_t size, int *fl, int *sl)
+{
+    int f;
+
+    if (size < OS_TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = size / (OS_TLSF_SMALL_BLOCK / OS_TLSF_SL_COUNT);
+    } else if (size >= (size_t)1 << OS_TLSF_FL_MAX_LOG2) {
+        /* A coalesced block can outgrow the index; it is still larger than
+         * anything the lists below hold, so it goes in the very last one.
+         */
+        *fl = OS_TLSF_FL_COUNT - 1;
+        *sl = OS_TLSF_SL_COUNT - 1;
+    } else {
+        f = os_tlsf_fls(size);
+        *sl = (size >> (f - OS_TLSF_SL_LOG2)) ^ OS_TLSF_SL_COUNT;
+        *fl = f - OS_TLSF_FL_SHIFT + 1;
+    }
+}
+
+/**
+ * Maps a request size to the first list whose blocks are all large enough.
+ */
+static void
+os_tlsf_mapping_search(size_t size, int *fl, int *sl)
+{
+    if (size >= OS_TLSF_SMALL_BLOCK) {
+        size += (1 << (os_tlsf_fls(size) - OS_TLSF_SL_LOG2)) - 1;
+    }
+    os_tlsf_mapping(size, fl, sl);
+}
+
+static void
+os_tlsf_insert(struct os_tlsf_block *b)
+{
+    struct os_tlsf_block *head;
+    int fl;
+    int sl;
+
+    os_tlsf_mapping(os_tlsf_size(b), &fl, &sl);
+
+    head = os_tlsf_lists[fl][sl];
+    b->next_free = head;
+    b->prev_free = NULL;
+    if (head != NULL) {
+        head->prev_free = b;
+    }
+    os_tlsf_lists[fl][sl] = b;
+
+    os_tlsf_fl_map |= 1UL << fl;
+    os_tlsf_sl_map[fl] |= 1UL << sl;
+}
+
+static void
+os_tlsf_remove(struct os_tlsf_block *b)
+{
+    int fl;
+    int sl;
+
+    os_tlsf_mapping(os_tlsf_size(b), &fl, &sl);
+
+    if (b->prev_free != NULL) {
+        b->prev_free->next_free = b->next_free;
+    } else {
+        os_tlsf_lists[fl][sl] = b->next_free;
+    }
+    if (b->next_free != NULL) {
+        b->next_free->prev_free = b->prev_free;
+    }
+
+    if (os_tlsf_lists[fl][sl] == NULL) {
+        os_tlsf_sl_map[fl] &= ~(1UL << sl);
+        if (os_tlsf_sl_map[fl] == 0) {
+            os_tlsf_fl_map &= ~(1UL << fl);
+        }
+    }
+}
+
+static struct os_tlsf_block *
+os_tlsf_find(size_t size)
+{
+    uint32_t map;
+    int fl;
+    int sl;
+
+    os_tlsf_mapping_search(size, &fl, &sl);
+    if (fl >= OS_TLSF_FL_COUNT) {
+        return NULL;
+    }
+
+    map = os_tlsf_sl_map[fl] & (~0UL << sl);
+    if (map == 0) {
+        if (fl + 1 >= OS_TLSF_FL_COUNT) {
+            return NULL;
+        }
+        map = os_tlsf_fl_map & (~0UL << (fl + 1));
+        if (map == 0) {
+            return NULL;
+        }
+        fl = __builtin_ctz(map);
+        map = os_tlsf_sl_map[fl];
+    }
+    sl = __builtin_ctz(map);
+
+    return os_tlsf_lists[fl][sl];
+}
+
+/**
+ * Hands a chunk of memory to the allocator as a new pool.
+ */
+static int
+os_tlsf_add_pool(void *mem, size_t len)
+{
+    struct os_tlsf_block *b;
+    struct os_tlsf_block *sentinel;
+    uintptr_t start;
+    uintptr_t end;
+
+    start = OS_ALIGN((uintptr_t)mem, OS_TLSF_ALIGN);
+    end = ((uintptr_t)mem + len) & ~(uintptr_t)(OS_TLSF_ALIGN - 1);
+    if (end <= start ||
+        end - start < 2 * OS_TLSF_HDR_SIZE + OS_TLSF_MIN_SIZE) {
+        return -1;
+    }
+
+    /*
+     * Consecutive _sbrk() chunks are usually contiguous; turn the previous
+     * pool's sentinel into a block covering the new memory and free it, which
+     * coalesces it with any free block at the end of that pool.
+     */
+    if (start == os_tlsf_pool_end &&
+        end - start >= OS_TLSF_HDR_SIZE + OS_TLSF_MIN_SIZE) {
+        b = (struct os_tlsf_block *)(start - OS_TLSF_HDR_SIZE);
+        b->size = (end - start - OS_TLSF_HDR_SIZE) |
+                  (b->size & OS_TLSF_F_PREV_FREE);
+
+        sentinel = os_tlsf_next_phys(b);
+        sentinel->prev_phys = b;
+        sentinel->size = 0;
+
+        os_tlsf_info.ohi_total += end - start;
+        os_tlsf_info.ohi_used += end - start;
+        os_tlsf_pool_end = end;
+        os_tlsf_free(os_tlsf_payload(b));
+
+        return 0;
+    }
+
+    b = (struct os_tlsf_block *)start;
+    b->prev_phys = NULL;
+    b->size = (end - start - 2 * OS_TLSF_HDR_SIZE) | OS_TLSF_F_FREE;
+
+    sentinel = os_tlsf_next_phys(b);
+    sentinel->prev_phys = b;
+    sentinel->size = OS_TLSF_F_PREV_FREE;
+
+    os_tlsf_insert(b);
+
+    os_tlsf_info.ohi_total += os_tlsf_size(b) + OS_TLSF_HDR_SIZE;
+    os_tlsf_info.ohi_pools++;
+    os_tlsf_pool_end = end;
+
+    return 0;
+}
+
+static int
+os_tlsf_grow(size_t size)
+{
+    size_t len;
+    void *mem;
+
+    /* Room for the block, the sentinel, alignment and list rounding. */
+    len = size + (size >> OS_TLSF_SL_LOG2) + 2 * OS_TLSF_HDR_SIZE +
+          OS_TLSF_ALIGN;
+    len = OS_ALIGN(max(len, MYNEWT_VAL(OS_HEAP_TLSF_GROW)), OS_TLSF_ALIGN);
+
+    mem = _sbrk(len);
+    if (mem == (void *)-1 || mem == NULL) {
+        return -1;
+    }
+
+    return os_tlsf_add_pool(mem, len);
+}
+
+/**
+ * Marks a free block used, splitting off and freeing its tail if that is
+ * large enough to be a block of its own.
+ */
+static void
+os_tlsf_use(struct os_tlsf_block *b, size_t size)
+{
+    struct os_tlsf_block *rem;
+    struct os_tlsf_block *next;
+
+    if (os_tlsf_size(b) >= size + OS_TLSF_HDR_SIZE + OS_TLSF_MIN_SIZE) {
+        rem = (struct os_tlsf_block *)((uint8_t *)os_tlsf_payload(b) + size);
+        rem->size = (os_tlsf_size(b) - size - OS_TLSF_HDR_SIZE) |
+                    OS_TLSF_F_FREE;
+        rem->prev_phys = b;
+        os_tlsf_set_size(b, size);
+
+        next = os_tlsf_next_phys(rem);
+        next->prev_phys = rem;
+        next->size |= OS_TLSF_F_PREV_FREE;
+        os_tlsf_insert(rem);
+    } else {
+        next = os_tlsf_next_phys(b);
+        next->size &= ~(size_t)OS_TLSF_F_PREV_FREE;
+    }
+
+    b->size &= ~(size_t)OS_TLSF_F_FREE;
+}
+
+static size_t
+os_tlsf_adjust(size_t size)
+{
+    size = OS_ALIGN(size, OS_TLSF_ALIGN);
+    return max(size, OS_TLSF_MIN_SIZE);
+}
+
+void *
+os_tlsf_malloc(size_t size)
+{
+    struct os_tlsf_block *b;
+
+    if (size == 0) {
+        return NULL;
+    }
+    if (size > OS_TLSF_MAX_REQUEST) {
+        os_tlsf_info.ohi_fail_cnt++;
+        return NULL;
+    }
+    size = os_tlsf_adjust(size);
+
+    b = os_tlsf_find(size);
+    if (b == NULL) {
+        if (os_tlsf_grow(size) != 0) {
+            os_tlsf_info.ohi_fail_cnt++;
+            return NULL;
+        }
+        b = os_tlsf_find(size);
+        if (b == NULL) {
+            os_tlsf_info.ohi_fail_cnt++;
+            return NULL;
+        }
+    }
+
+    os_tlsf_remove(b);
+    os_tlsf_use(b, size);
+
+    os_tlsf_info.ohi_used += os_tlsf_size(b) + OS_TLSF_HDR_SIZE;
+    if (os_tlsf_info.ohi_used > os_tlsf_info.ohi_max_used) {
+        os_tlsf_info.ohi_max_used = os_tlsf_info.ohi_used;
+    }
+    os_tlsf_info.ohi_alloc_cnt++;
+
+    return os_tlsf_payload(b);
+}
+
+void
+os_tlsf_free(void *ptr)
+{
+    struct os_tlsf_block *b;
+    struct os_tlsf_block *prev;
+    struct os_tlsf_block *next;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    b = os_tlsf_from_payload(ptr);
+    assert(!(b->size & OS_TLSF_F_FREE));
+
+    os_tlsf_info.ohi_used -= os_tlsf_size(b) + OS_TLSF_HDR_SIZE;
+
+    /* Merge with the previous block. */
+    if (b->size & OS_TLSF_F_PREV_FREE) {
+        prev = b->prev_phys;
+        os_tlsf_remove(prev);
+        os_tlsf_set_size(prev, os_tlsf_size(prev) + OS_TLSF_HDR_SIZE +
+                               os_tlsf_size(b));
+        b = prev;
+    }
+
+    /* Merge with the next block. */
+    next = os_tlsf_next_phys(b);
+    if (next->size & OS_TLSF_F_FREE) {
+        os_tlsf_remove(next);
+        os_tlsf_set_size(b, os_tlsf_size(b) + OS_TLSF_HDR_SIZE +
+                            os_tlsf_size(next));
+        next = os_tlsf_next_phys(b);
+    }
+
+    b->size |= OS_TLSF_F_FREE;
+    next->prev_phys = b;
+    next->size |= OS_TLSF_F_PREV_FREE;
+    os_tlsf_insert(b);
+}
+
+void *
+os_tlsf_realloc(void *ptr, size_t size)
+{
+    struct os_tlsf_block *b;
+    void *new_ptr;
+
+    if (ptr == NULL) {
+        return os_tlsf_malloc(size);
+    }
+    if (size == 0) {
+        os_tlsf_free(ptr);
+        return NULL;
+    }
+
+    b = os_tlsf_from_payload(ptr);
+    if (os_tlsf_size(b) >= size) {
+        return ptr;
+    }
+
+    new_ptr = os_tlsf_malloc(size);
+    if (new_ptr != NULL) {
+        memcpy(new_ptr, ptr, os_tlsf_size(b));
+        os_tlsf_free(ptr);
+    }
+
+    return new_ptr;
+}
+
+void
+os_tlsf_info_get(struct os_heap_info *info)
+{
+    struct os_tlsf_block *b;
+    size_t largest;
+    int fl;
+    int sl;
+
+    /* The largest free block is in the highest non-empty list. */
+    largest = 0;
+    if (os_tlsf_fl_map != 0) {
+        fl = os_tlsf_fls(os_tlsf_fl_map);
+        sl = os_tlsf_fls(os_tlsf_sl_map[fl]);
+        for (b = os_tlsf_lists[fl][sl]; b != NULL; b = b->next_free) {
+            largest = max(largest, os_tlsf_size(b));
+        }
+    }
+
+    *info = os_tlsf_info;
+    info->ohi_free = info->ohi_total - info->ohi_used;
+    info->ohi_largest_free = largest;
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <string.h>
+#include "os/mynewt.h"
+#include "os_priv.h"
+
+#if MYNEWT_VAL(OS_IDLE_WORK)
+
+static STAILQ_HEAD(, os_idle_work) os_idle_work_list =
+    STAILQ_HEAD_INITIALIZER(os_idle_work_list);
+
+void
+os_idle_work_init(struct os_idle_work *work, os_idle_work_fn *fn, void *arg)
+{
+    memset(work, 0, sizeof *work);
+    work->oiw_fn = fn;
+    work->oiw_arg = arg;
+}
+
+void
+os_idle_work_add(struct os_idle_work *work)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    if (!work->oiw_queued) {
+        STAILQ_INSERT_TAIL(&os_idle_work_list, work, oiw_next);
+        work->oiw_queued = 1;
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+void
+os_idle_work_remove(struct os_idle_work *work)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    if (work->oiw_queued) {
+        STAILQ_REMOVE(&os_idle_work_list, work, os_idle_work, oiw_next);
+        work->oiw_queued = 0;
+    }
+    OS_EXIT_CRITICAL(sr);
+}
+
+int
+os_idle_work_pending(void)
+{
+    return !STAILQ_EMPTY(&os_idle_work_list);
+}
+
+/**
+ * Runs queued idle work, round robin, until the queue is empty or the time
+ * budget is spent.  The budget is OS_IDLE_WORK_BUDGET_USECS, cut short so
+ * that it ends before the next task or callout wakeup.  Called by the idle
+ * task with interrupts enabled.
+ *
+ * @return 0 if the next wakeup is too close to run any work; 1 otherwise.
+ */
+int
+os_idle_work_run(void)
+{
+    struct os_idle_work *work;
+    os_time_t ticks;
+    os_time_t now;
+    uint32_t deadline;
+    uint32_t budget;
+    os_sr_t sr;
+
+    if (STAILQ_EMPTY(&os_idle_work_list)) {
+        return 1;
+    }
+
+    OS_ENTER_CRITICAL(sr);
+    now = os_time_get();
+    ticks = min(os_sched_wakeup_ticks(now), os_callout_wakeup_ticks(now));
+    OS_EXIT_CRITICAL(sr);
+
+    /* The current tick is partly over; only count whole ticks. */
+    if (ticks <= 1) {
+        return 0;
+    }
+
+    budget = min((uint64_t)(ticks - 1) * 1000000 / OS_TICKS_PER_SEC,
+                 MYNEWT_VAL(OS_IDLE_WORK_BUDGET_USECS));
+    deadline = os_cputime_get32() + os_cputime_usecs_to_ticks(budget);
+
+    do {
+        OS_ENTER_CRITICAL(sr);
+        work = STAILQ_FIRST(&os_idle_work_list);
+        if (work != NULL) {
+            STAILQ_REMOVE_HEAD(&os_idle_work_list, oiw_next);
+            work->oiw_queued = 0;
+        }
+        OS_EXIT_CRITICAL(sr);
+
+        if (work == NULL) {
+            break;
+        }
+
+        if (work->oiw_fn(work, deadline) != 0) {
+            os_idle_work_add(work);
+        }
+    } while (CPUTIME_LT(os_cputime_get32(), deadline));
+
+    return 1;
+}
+
+#endif
@@ -41,6 +41,10 @@
 #define OS_TRACE_DISABLE_FILE_API
 #endif
 #include "os/mynewt.h"
+#include "os_priv.h"
+#if MYNEWT_VAL(MSYS_STATS)
+#include "stats/stats.h"
+#endif
 
 /**
  * @addtogroup OSKernel
@@ -120,23 +124,81 @@ err:
     return (rc);
 }
 
+#if MYNEWT_VAL(MSYS_STATS)
+STATS_NAME_START(os_msys_stats)
+    STATS_NAME(os_msys_stats, hit)
+    STATS_NAME(os_msys_stats, miss)
+    STATS_NAME(os_msys_stats, fallback)
+    STATS_NAME(os_msys_stats, chain)
+STATS_NAME_END(os_msys_stats)
+
+/* Set once the stats package is initialized, see os_msys_stats_init(). */
+static uint8_t os_msys_stats_ready;
+
+#define OS_MSYS_STATS_INC(pool, var) STATS_INC((pool)->omp_stats, var)
+
+static void
+os_msys_stats_reg(struct os_mbuf_pool *pool)
+{
+    /*
+     * Failure only means the name is taken, e.g. by the same pool registered
+     * again after os_msys_reset(); the pool is still counted, just not listed
+     * under its own name.
+     */
+    stats_init_and_reg(STATS_HDR(pool->omp_stats),
+                       STATS_SIZE_INIT_PARMS(pool->omp_stats, STATS_SIZE_32),
+                       STATS_NAME_INIT_PARMS(os_msys_stats),
+                       pool->omp_pool->name);
+}
+
+/**
+ * Registers the stats of the pools which were registered with msys before the
+ * stats package was initialized.  Pools registered later get their stats
+ * registered by os_msys_register().
+ */
+void
+os_msys_stats_init(void)
+{
+    struct os_mbuf_pool *pool;
+
+    /* Ensure this function only gets called by sysinit. */
+    SYSINIT_ASSERT_ACTIVE();
+
+    STAILQ_FOREACH(pool, &g_msys_pool_list, omp_next) {
+        os_msys_stats_reg(pool);
+    }
+    os_msys_stats_ready = 1;
+}
+#else
+#define OS_MSYS_STATS_INC(pool, var)
+#endif
+
 int
 os_msys_register(struct os_mbuf_pool *new_pool)
 {
     struct os_mbuf_pool *pool;
+    struct os_mbuf_pool *prev;
 
-    pool = NULL;
+    /* Keep the list sorted by ascending buffer size. */
+    prev = NULL;
     STAILQ_FOREACH(pool, &g_msys_pool_list, omp_next) {
-        if (new_pool->omp_databuf_len > pool->omp_databuf_len) {
+        if (new_pool->omp_databuf_len < pool->omp_databuf_len) {
             break;
         }
+        prev = pool;
     }
 
-    if (pool) {
-        STAILQ_INSERT_AFTER(&g_msys_pool_list, pool, new_pool, omp_next);
+    if (prev) {
+        STAILQ_INSERT_AFTER(&g_msys_pool_list, prev, new_pool, omp_next);
     } else {
-        STAILQ_INSERT_TAIL(&g_msys_pool_list, new_pool, omp_next);
+        STAILQ_INSERT_HEAD(&g_msys_pool_list, new_pool, omp_next);
+    }
+
+#if MYNEWT_VAL(MSYS_STATS)
+    if (os_msys_stats_ready) {
+        os_msys_stats_reg(new_pool);
     }
+#endif
 
     return (0);
 }
@@ -166,42 +228,145 @@ _os_msys_find_pool(uint16_t dsize)
     return (pool);
 }
 
+static struct os_mbuf *os_mbuf_get_owner(struct os_mbuf_pool *omp,
+                                         uint16_t leadingspace, void *owner);
+static struct os_mbuf *os_mbuf_get_pkthdr_owner(struct os_mbuf_pool *omp,
+                                                uint8_t user_pkthdr_len,
+                                                void *owner);
 
-struct os_mbuf *
-os_msys_get(uint16_t dsize, uint16_t leadingspace)
+static struct os_mbuf *
+os_msys_alloc(struct os_mbuf_pool *pool, int pkthdr, uint16_t len,
+              void *owner)
+{
+    if (pkthdr) {
+        return (os_mbuf_get_pkthdr_owner(pool, len, owner));
+    } else {
+        return (os_mbuf_get_owner(pool, len, owner));
+    }
+}
+
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_CHAIN)
+/**
+ * Allocates the first mbuf of a chain from the largest class smaller than
+ * best that has enough free blocks to hold dsize bytes.  The rest of the
+ * chain is taken from the same pool as the caller appends data.
+ */
+static struct os_mbuf *
+os_msys_alloc_chain(struct os_mbuf_pool *best, uint16_t dsize, int pkthdr,
+                    uint16_t len, void *owner)
 {
+    struct os_mbuf_pool *pool;
+    struct os_mbuf_pool *cand;
     struct os_mbuf *m;
+    uint32_t avail;
+
+    cand = NULL;
+    STAILQ_FOREACH(pool, &g_msys_pool_list, omp_next) {
+        if (pool == best) {
+            break;
+        }
+        avail = (uint32_t)pool->omp_pool->mp_num_free * pool->omp_databuf_len;
+        if (avail >= dsize) {
+            cand = pool;
+        }
+    }
+
+    if (cand == NULL) {
+        return (NULL);
+    }
+
+    m = os_msys_alloc(cand, pkthdr, len, owner);
+    if (m) {
+        OS_MSYS_STATS_INC(cand, chain);
+    }
+
+    return (m);
+}
+#endif
+
+/**
+ * Allocates from the best fitting size class.  If that class is exhausted,
+ * larger classes are tried (MSYS_SIZE_CLASS_FALLBACK), then, if the caller
+ * accepts a chain, smaller ones (MSYS_SIZE_CLASS_CHAIN).  owner is recorded
+ * against the block when OS_MEMPOOL_TRACE is enabled.
+ */
+static struct os_mbuf *
+_os_msys_get(uint16_t dsize, int pkthdr, uint16_t len, int chain, void *owner)
+{
+    struct os_mbuf_pool *best;
+    struct os_mbuf *m;
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_FALLBACK)
     struct os_mbuf_pool *pool;
+#endif
 
-    pool = _os_msys_find_pool(dsize);
-    if (!pool) {
-        goto err;
+    best = _os_msys_find_pool(dsize);
+    if (!best) {
+        return (NULL);
     }
 
-    m = os_mbuf_get(pool, leadingspace);
+    m = os_msys_alloc(best, pkthdr, len, owner);
+    if (m) {
+        OS_MSYS_STATS_INC(best, hit);
+        return (m);
+    }
+    OS_MSYS_STATS_INC(best, miss);
+
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_FALLBACK)
+    for (pool = STAILQ_NEXT(best, omp_next);
+         pool != NULL;
+         pool = STAILQ_NEXT(pool, omp_next)) {
+        m = os_msys_alloc(pool, pkthdr, len, owner);
+        if (m) {
+            OS_MSYS_STATS_INC(pool, fallback);
+            return (m);
+        }
+    }
+#endif
+
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_CHAIN)
+    if (chain) {
+        m = os_msys_alloc_chain(best, dsize, pkthdr, len, owner);
+    }
+#else
+    (void)chain;
+#endif
+
     return (m);
-err:
-    return (NULL);
+}
+
+struct os_mbuf *
+os_msys_get(uint16_t dsize, uint16_t leadingspace)
+{
+    return (_os_msys_get(dsize, 0, leadingspace, 0, os_get_return_addr()));
 }
 
 struct os_mbuf *
 os_msys_get_pkthdr(uint16_t dsize, uint16_t user_hdr_len)
 {
     uint16_t total_pkthdr_len;
-    struct os_mbuf *m;
-    struct os_mbuf_pool *pool;
 
     total_pkthdr_len =  user_hdr_len + sizeof(struct os_mbuf_pkthdr);
-    pool = _os_msys_find_pool(dsize + total_pkthdr_len);
-    if (!pool) {
-        goto err;
-    }
+    return (_os_msys_get(dsize + total_pkthdr_len, 1, user_hdr_len, 0,
+                         os_get_return_addr()));
+}
 
-    m = os_mbuf_get_pkthdr(pool, user_hdr_len);
-    return (m);
-err:
-    return (NULL);
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_CHAIN)
+struct os_mbuf *
+os_msys_get_chained(uint16_t dsize, uint16_t leadingspace)
+{
+    return (_os_msys_get(dsize, 0, leadingspace, 1, os_get_return_addr()));
+}
+
+struct os_mbuf *
+os_msys_get_pkthdr_chained(uint16_t dsize, uint16_t user_hdr_len)
+{
+    uint16_t total_pkthdr_len;
+
+    total_pkthdr_len =  user_hdr_len + sizeof(struct os_mbuf_pkthdr);
+    return (_os_msys_get(dsize + total_pkthdr_len, 1, user_hdr_len, 1,
+                         os_get_return_addr()));
 }
+#endif
 
 int
 os_msys_count(void)
@@ -242,8 +407,8 @@ os_mbuf_pool_init(struct os_mbuf_pool *omp, struct os_mempool *mp,
     return (0);
 }
 
-struct os_mbuf *
-os_mbuf_get(struct os_mbuf_pool *omp, uint16_t leadingspace)
+static struct os_mbuf *
+os_mbuf_get_owner(struct os_mbuf_pool *omp, uint16_t leadingspace, void *owner)
 {
     struct os_mbuf *om;
 
@@ -255,7 +420,7 @@ os_mbuf_get(struct os_mbuf_pool *omp, uint16_t leadingspace)
         goto done;
     }
 
-    om = os_memblock_get(omp->omp_pool);
+    om = os_memblock_get_owner(omp->omp_pool, owner);
     if (!om) {
         goto done;
     }
@@ -273,7 +438,14 @@ done:
 }
 
 struct os_mbuf *
-os_mbuf_get_pkthdr(struct os_mbuf_pool *omp, uint8_t user_pkthdr_len)
+os_mbuf_get(struct os_mbuf_pool *omp, uint16_t leadingspace)
+{
+    return (os_mbuf_get_owner(omp, leadingspace, os_get_return_addr()));
+}
+
+static struct os_mbuf *
+os_mbuf_get_pkthdr_owner(struct os_mbuf_pool *omp, uint8_t user_pkthdr_len,
+                         void *owner)
 {
     uint16_t pkthdr_len;
     struct os_mbuf_pkthdr *pkthdr;
@@ -289,7 +461,7 @@ os_mbuf_get_pkthdr(struct os_mbuf_pool *omp, uint8_t user_pkthdr_len)
         goto done;
     }
 
-    om = os_mbuf_get(omp, 0);
+    om = os_mbuf_get_owner(omp, 0, owner);
     if (om) {
         om->om_pkthdr_len = pkthdr_len;
         om->om_data += pkthdr_len;
@@ -305,6 +477,116 @@ done:
     return om;
 }
 
+struct os_mbuf *
+os_mbuf_get_pkthdr(struct os_mbuf_pool *omp, uint8_t user_pkthdr_len)
+{
+    return (os_mbuf_get_pkthdr_owner(omp, user_pkthdr_len,
+                                     os_get_return_addr()));
+}
+
+void
+os_mbuf_ext_init(struct os_mbuf_ext *ext, void *buf, uint16_t len,
+                 os_mbuf_ext_free_fn *free_cb, void *arg)
+{
+    ext->ome_buf = buf;
+    ext->ome_len = len;
+    ext->ome_refcnt = 0;
+    ext->ome_free_cb = free_cb;
+    ext->ome_arg = arg;
+}
+
+/**
+ * Allocates an mbuf header out of omp which references len bytes at data
+ * within the external buffer ext.
+ */
+static struct os_mbuf *
+os_mbuf_ext_ref(struct os_mbuf_pool *omp, struct os_mbuf_ext *ext,
+                uint8_t *data, uint16_t len)
+{
+    struct os_mbuf *om;
+    os_sr_t sr;
+
+    om = os_mbuf_get(omp, 0);
+    if (om == NULL) {
+        return (NULL);
+    }
+
+    OS_ENTER_CRITICAL(sr);
+    ext->ome_refcnt++;
+    OS_EXIT_CRITICAL(sr);
+
+    om->om_flags |= OS_MBUF_F_EXT;
+    OS_MBUF_EXT(om) = ext;
+    om->om_data = data;
+    om->om_len = len;
+
+    return (om);
+}
+
+/**
+ * Drops the external buffer reference held by an external mbuf, calling the
+ * buffer's free callback if this was the last one.
+ */
+static void
+os_mbuf_ext_unref(struct os_mbuf *om)
+{
+    struct os_mbuf_ext *ext;
+    os_sr_t sr;
+    int last;
+
+    ext = OS_MBUF_EXT(om);
+
+    OS_ENTER_CRITICAL(sr);
+    assert(ext->ome_refcnt > 0);
+    ext->ome_refcnt--;
+    last = (ext->ome_refcnt == 0);
+    OS_EXIT_CRITICAL(sr);
+
+    if (last && ext->ome_free_cb != NULL) {
+        ext->ome_free_cb(ext);
+    }
+}
+
+struct os_mbuf *
+os_mbuf_get_ext(struct os_mbuf_pool *omp, struct os_mbuf_ext *ext,
+                uint16_t off, uint16_t len)
+{
+    if ((uint32_t)off + len > ext->ome_len) {
+        return (NULL);
+    }
+
+    return (os_mbuf_ext_ref(omp, ext, ext->ome_buf + off, len));
+}
+
+int
+os_mbuf_append_ext(struct os_mbuf *om, struct os_mbuf_ext *ext,
+                   uint16_t off, uint16_t len)
+{
+    struct os_mbuf *last;
+    struct os_mbuf *new;
+
+    if (om == NULL || (uint32_t)off + len > ext->ome_len) {
+        return (OS_EINVAL);
+    }
+
+    new = os_mbuf_ext_ref(om->om_omp, ext, ext->ome_buf + off, len);
+    if (new == NULL) {
+        return (OS_ENOMEM);
+    }
+
+    last = om;
+    while (SLIST_NEXT(last, om_next) != NULL) {
+        last = SLIST_NEXT(last, om_next);
+    }
+    SLIST_NEXT(last, om_next) = new;
+
+    if (OS_MBUF_IS_PKTHDR(om)) {
+        OS_MBUF_PKTHDR(om)->omp_len += len;
+    }
+
+    return (0);
+}
+
 int
 os_mbuf_free(struct os_mbuf *om)
 {
@@ -312,6 +594,10 @@ os_mbuf_free(struct os_mbuf *om)
 
     os_trace_api_u32(OS_TRACE_ID_MBUF_FREE, (uint32_t)om);
 
+    if (OS_MBUF_IS_EXT(om)) {
+        os_mbuf_ext_unref(om);
+    }
+
     if (om->om_omp != NULL) {
         rc = os_memblock_put(om->om_omp->omp_pool, om);
         if (rc != 0) {
@@ -493,6 +779,7 @@ os_mbuf_dup(struct os_mbuf *om)
     struct os_mbuf_pool *omp;
     struct os_mbuf *head;
     struct os_mbuf *copy;
+    struct os_mbuf *ref;
 
     omp = om->om_omp;
 
@@ -500,6 +787,23 @@ os_mbuf_dup(struct os_mbuf *om)
     copy = NULL;
 
     for (; om != NULL; om = SLIST_NEXT(om, om_next)) {
+        /* External data is shared rather than copied. */
+        if (OS_MBUF_IS_EXT(om)) {
+            ref = os_mbuf_ext_ref(omp, OS_MBUF_EXT(om), om->om_data,
+                                  om->om_len);
+            if (ref == NULL) {
+                os_mbuf_free_chain(head);
+                goto err;
+            }
+            if (head) {
+                SLIST_NEXT(copy, om_next) = ref;
+            } else {
+                head = ref;
+            }
+            copy = ref;
+            continue;
+        }
+
         if (head) {
             SLIST_NEXT(copy, om_next) = os_mbuf_get(omp,
                     OS_MBUF_LEADINGSPACE(om));
@@ -853,6 +1157,10 @@ os_mbuf_copyinto(struct os_mbuf *om, int off, const void *src, int len)
     while (1) {
         copylen = min(cur->om_len - cur_off, len);
         if (copylen > 0) {
+            /* External data is read-only. */
+            if (OS_MBUF_IS_EXT(cur)) {
+                return SYS_EINVAL;
+            }
             memcpy(cur->om_data + cur_off, sptr, copylen);
             sptr += copylen;
             len -= copylen;
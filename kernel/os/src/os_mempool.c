@@ -25,15 +25,18 @@
 #define OS_TRACE_DISABLE_FILE_API
 #endif
 #include "os/mynewt.h"
+#include "os_priv.h"
 
 #define OS_MEM_TRUE_BLOCK_SIZE(bsize)   OS_ALIGN(bsize, OS_ALIGNMENT)
 #if MYNEWT_VAL(OS_MEMPOOL_GUARD)
 #define OS_MEMPOOL_TRUE_BLOCK_SIZE(mp)                                  \
-    (((mp)->mp_flags & OS_MEMPOOL_F_EXT) ?                              \
+    ((((mp)->mp_flags & OS_MEMPOOL_F_EXT) ?                             \
       OS_MEM_TRUE_BLOCK_SIZE(mp->mp_block_size) :                       \
-      (OS_MEM_TRUE_BLOCK_SIZE(mp->mp_block_size) + sizeof(os_membuf_t)))
+      (OS_MEM_TRUE_BLOCK_SIZE(mp->mp_block_size) + sizeof(os_membuf_t))) \
+     + OS_MEMPOOL_TRACE_SZ)
 #else
-#define OS_MEMPOOL_TRUE_BLOCK_SIZE(mp) OS_MEM_TRUE_BLOCK_SIZE(mp->mp_block_size)
+#define OS_MEMPOOL_TRUE_BLOCK_SIZE(mp)                                  \
+    (OS_MEM_TRUE_BLOCK_SIZE(mp->mp_block_size) + OS_MEMPOOL_TRACE_SZ)
 #endif
 
 STAILQ_HEAD(, os_mempool) g_os_mempool_list =
@@ -115,6 +118,65 @@ os_mempool_guard_check(const struct os_mempool *mp, void *start)
 #define os_mempool_guard_check(mp, start)
 #endif
 
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+/* The owner record is the last thing in each block. */
+#define OS_MEMPOOL_OWNER(mp, start)                                     \
+    ((struct os_memblock_owner *)((uintptr_t)(start) +                  \
+        OS_MEMPOOL_TRUE_BLOCK_SIZE(mp) - OS_MEMPOOL_TRACE_SZ))
+
+/*
+ * No critical section here, so the lock-free get/put paths stay lock-free.
+ * The stores are ordered through a volatile pointer instead: a record is only
+ * reported while omo_addr is set, so on get the time goes in first and on put
+ * omo_addr is cleared.
+ */
+static void
+os_mempool_trace_set(const struct os_mempool *mp, void *start, void *addr)
+{
+    volatile struct os_memblock_owner *omo;
+
+    omo = OS_MEMPOOL_OWNER(mp, start);
+
+    if (addr == NULL) {
+        omo->omo_addr = NULL;
+    } else {
+        omo->omo_time = os_time_get();
+        omo->omo_addr = addr;
+    }
+}
+#else
+#define os_mempool_trace_set(mp, start, addr)
+#endif
+
+#if (MYNEWT_VAL(OS_MEMPOOL_POISON) || MYNEWT_VAL(OS_MEMPOOL_GUARD)) && \
+    MYNEWT_VAL(OS_MEMPOOL_CHECK_SAMPLE) > 1
+static uint32_t os_mempool_check_ctr;
+
+/*
+ * Returns 1 on every OS_MEMPOOL_CHECK_SAMPLE'th call.  The counter is shared by
+ * all pools and is not locked; a lost update only shifts which operation gets
+ * checked.
+ */
+static inline int
+os_mempool_check_sample(void)
+{
+    if (++os_mempool_check_ctr < MYNEWT_VAL(OS_MEMPOOL_CHECK_SAMPLE)) {
+        return 0;
+    }
+    os_mempool_check_ctr = 0;
+    return 1;
+}
+#else
+#define os_mempool_check_sample() 1
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+/* Where the next os_mempool_sweep() call resumes. */
+static struct os_mempool *os_mempool_sweep_pool;
+static struct os_memblock *os_mempool_sweep_block;
+static uint16_t os_mempool_sweep_pos;
+#endif
+
 static os_error_t
 os_mempool_init_internal(struct os_mempool *mp, uint16_t blocks,
                          uint32_t block_size, void *membuf, char *name,
@@ -123,6 +185,7 @@ os_mempool_init_internal(struct os_mempool *mp, uint16_t blocks,
     int true_block_size;
     uint8_t *block_addr;
     struct os_memblock *block_ptr;
+    struct os_mempool *cur;
 
     /* Check for valid parameters */
     if (!mp || (blocks < 0) || (block_size <= 0)) {
@@ -150,28 +213,51 @@ os_mempool_init_internal(struct os_mempool *mp, uint16_t blocks,
     mp->mp_num_blocks = blocks;
     mp->mp_membuf_addr = (uint32_t)membuf;
     mp->name = name;
-    os_mempool_poison(mp, membuf);
-    os_mempool_guard(mp, membuf);
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+    mp->mp_low_cb = NULL;
+    mp->mp_low_arg = NULL;
+    mp->mp_low_thresh = 0;
+#endif
     SLIST_FIRST(mp) = membuf;
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+    if (mp == os_mempool_sweep_pool) {
+        os_mempool_sweep_block = NULL;
+    }
+#endif
 
-    true_block_size = OS_MEMPOOL_TRUE_BLOCK_SIZE(mp);
+    if (membuf != NULL) {
+        os_mempool_poison(mp, membuf);
+        os_mempool_guard(mp, membuf);
+        os_mempool_trace_set(mp, membuf, NULL);
+
+        true_block_size = OS_MEMPOOL_TRUE_BLOCK_SIZE(mp);
 
-    /* Chain the memory blocks to the free list */
-    block_addr = (uint8_t *)membuf;
-    block_ptr = (struct os_memblock *)block_addr;
-    while (blocks > 1) {
-        block_addr += true_block_size;
-        os_mempool_poison(mp, block_addr);
-        os_mempool_guard(mp, block_addr);
-        SLIST_NEXT(block_ptr, mb_next) = (struct os_memblock *)block_addr;
+        /* Chain the memory blocks to the free list */
+        block_addr = (uint8_t *)membuf;
         block_ptr = (struct os_memblock *)block_addr;
-        --blocks;
-    }
+        while (blocks > 1) {
+            block_addr += true_block_size;
+            os_mempool_poison(mp, block_addr);
+            os_mempool_guard(mp, block_addr);
+            os_mempool_trace_set(mp, block_addr, NULL);
+            SLIST_NEXT(block_ptr, mb_next) = (struct os_memblock *)block_addr;
+            block_ptr = (struct os_memblock *)block_addr;
+            --blocks;
+        }
 
-    /* Last one in the list should be NULL */
-    SLIST_NEXT(block_ptr, mb_next) = NULL;
+        /* Last one in the list should be NULL */
+        SLIST_NEXT(block_ptr, mb_next) = NULL;
+    }
 
-    STAILQ_INSERT_TAIL(&g_os_mempool_list, mp, mp_list);
+    /* A pool that is initialized again must not be linked in twice. */
+    STAILQ_FOREACH(cur, &g_os_mempool_list, mp_list) {
+        if (cur == mp) {
+            break;
+        }
+    }
+    if (cur == NULL) {
+        STAILQ_INSERT_TAIL(&g_os_mempool_list, mp, mp_list);
+    }
 
     return OS_OK;
 }
@@ -256,26 +342,36 @@ os_mempool_clear(struct os_mempool *mp)
     /* cleanup the memory pool structure */
     mp->mp_num_free = mp->mp_num_blocks;
     mp->mp_min_free = mp->mp_num_blocks;
-    os_mempool_poison(mp, (void *)mp->mp_membuf_addr);
-    os_mempool_guard(mp, (void *)mp->mp_membuf_addr);
     SLIST_FIRST(mp) = (void *)mp->mp_membuf_addr;
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+    if (mp == os_mempool_sweep_pool) {
+        os_mempool_sweep_block = NULL;
+    }
+#endif
 
-    /* Chain the memory blocks to the free list */
-    block_addr = (uint8_t *)mp->mp_membuf_addr;
-    block_ptr = (struct os_memblock *)block_addr;
-    blocks = mp->mp_num_blocks;
-
-    while (blocks > 1) {
-        block_addr += true_block_size;
-        os_mempool_poison(mp, block_addr);
-        os_mempool_guard(mp, block_addr);
-        SLIST_NEXT(block_ptr, mb_next) = (struct os_memblock *)block_addr;
+    if (mp->mp_membuf_addr != 0) {
+        os_mempool_poison(mp, (void *)mp->mp_membuf_addr);
+        os_mempool_guard(mp, (void *)mp->mp_membuf_addr);
+        os_mempool_trace_set(mp, (void *)mp->mp_membuf_addr, NULL);
+
+        /* Chain the memory blocks to the free list */
+        block_addr = (uint8_t *)mp->mp_membuf_addr;
         block_ptr = (struct os_memblock *)block_addr;
-        --blocks;
-    }
+        blocks = mp->mp_num_blocks;
+
+        while (blocks > 1) {
+            block_addr += true_block_size;
+            os_mempool_poison(mp, block_addr);
+            os_mempool_guard(mp, block_addr);
+            os_mempool_trace_set(mp, block_addr, NULL);
+            SLIST_NEXT(block_ptr, mb_next) = (struct os_memblock *)block_addr;
+            block_ptr = (struct os_memblock *)block_addr;
+            --blocks;
+        }
 
-    /* Last one in the list should be NULL */
-    SLIST_NEXT(block_ptr, mb_next) = NULL;
+        /* Last one in the list should be NULL */
+        SLIST_NEXT(block_ptr, mb_next) = NULL;
+    }
 
     return OS_OK;
 }
@@ -324,58 +420,289 @@ os_memblock_from(const struct os_mempool *mp, const void *block_addr)
     return 1;
 }
 
-void *
-os_memblock_get(struct os_mempool *mp)
+/*
+ * The lock-free free list prefers exclusive load/store of words and halfwords
+ * with Thumb-2 (ARMv7-M and later mainline cores).  Exception entry and
+ * return clear the local exclusive monitor on these cores, so a
+ * store-exclusive fails whenever an interrupt or context switch occurred
+ * since the matching load-exclusive.  That makes a plain LDREX/STREX pop
+ * immune to ABA without needing the tag in the list head.
+ *
+ * Elsewhere, a double-word compare-and-swap of the head and its tag is used
+ * if the compiler can inline one; otherwise the free list stays behind a
+ * critical section.
+ */
+#if MYNEWT_VAL(OS_MEMPOOL_LOCKFREE) && defined(__thumb2__) &&  \
+    defined(__ARM_FEATURE_LDREX) && ((__ARM_FEATURE_LDREX & 0x6) == 0x6)
+#define OS_MEMPOOL_LLSC     (1)
+#else
+#define OS_MEMPOOL_LLSC     (0)
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_LOCKFREE) && !OS_MEMPOOL_LLSC &&                  \
+    ((__SIZEOF_POINTER__ == 4 && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)) || \
+     (__SIZEOF_POINTER__ == 8 && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)))
+#define OS_MEMPOOL_CAS      (1)
+#else
+#define OS_MEMPOOL_CAS      (0)
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+/*
+ * Called once block has been unlinked from the free list.  A lock-free pop
+ * calls this after the unlink, but os_mempool_sweep() runs with interrupts
+ * disabled and the block is left untouched until the pop returns, so a sweep
+ * in between still finds it as it was on the list.
+ */
+static inline void
+os_mempool_sweep_taken(const struct os_memblock *block)
+{
+    if (block == os_mempool_sweep_block) {
+        os_mempool_sweep_block = NULL;
+    }
+}
+#else
+#define os_mempool_sweep_taken(block)
+#endif
+
+#if OS_MEMPOOL_LLSC
+/**
+ * Atomically adds delta to the free block count of a pool.
+ *
+ * @return The new free block count.
+ */
+static inline uint16_t
+os_mempool_num_free_add(struct os_mempool *mp, int delta)
+{
+    uint32_t val;
+    uint32_t fail;
+
+    __asm__ volatile(
+        "1: ldrexh  %[val], [%[addr]]           \n"
+        "   add     %[val], %[val], %[delta]    \n"
+        "   strexh  %[fail], %[val], [%[addr]]  \n"
+        "   cmp     %[fail], #0                 \n"
+        "   bne     1b                          \n"
+        : [val] "=&r" (val), [fail] "=&r" (fail)
+        : [addr] "r" (&mp->mp_num_free), [delta] "r" (delta)
+        : "cc", "memory");
+
+    return (uint16_t)val;
+}
+
+/**
+ * Atomically lowers the low water mark of a pool to num_free.
+ */
+static inline void
+os_mempool_min_free_update(struct os_mempool *mp, uint16_t num_free)
+{
+    uint32_t min;
+    uint32_t fail;
+
+    __asm__ volatile(
+        "1: ldrexh  %[min], [%[addr]]           \n"
+        "   cmp     %[min], %[val]              \n"
+        "   bls     2f                          \n"
+        "   strexh  %[fail], %[val], [%[addr]]  \n"
+        "   cmp     %[fail], #0                 \n"
+        "   bne     1b                          \n"
+        "   b       3f                          \n"
+        "2: clrex                               \n"
+        "3:                                     \n"
+        : [min] "=&r" (min), [fail] "=&r" (fail)
+        : [addr] "r" (&mp->mp_min_free), [val] "r" ((uint32_t)num_free)
+        : "cc", "memory");
+}
+
+/**
+ * Unlinks the head of the free list of a pool.
+ *
+ * @return The unlinked block or NULL if the free list is empty.
+ */
+static inline struct os_memblock *
+os_mempool_head_pop(struct os_mempool *mp)
 {
-    os_sr_t sr;
     struct os_memblock *block;
+    struct os_memblock *next;
+    uint32_t fail;
+
+    /* mb_next is the first member of a memblock. */
+    __asm__ volatile(
+        "1: ldrex   %[blk], [%[head]]           \n"
+        "   cmp     %[blk], #0                  \n"
+        "   beq     2f                          \n"
+        "   ldr     %[nxt], [%[blk]]            \n"
+        "   strex   %[fail], %[nxt], [%[head]]  \n"
+        "   cmp     %[fail], #0                 \n"
+        "   bne     1b                          \n"
+        "   b       3f                          \n"
+        "2: clrex                               \n"
+        "3:                                     \n"
+        : [blk] "=&r" (block), [nxt] "=&r" (next), [fail] "=&r" (fail)
+        : [head] "r" (&SLIST_FIRST(mp))
+        : "cc", "memory");
+
+    return block;
+}
 
-    os_trace_api_u32(OS_TRACE_ID_MEMBLOCK_GET, (uint32_t)mp);
+/**
+ * Links a block at the head of the free list of a pool.
+ */
+static inline void
+os_mempool_head_push(struct os_mempool *mp, struct os_memblock *block)
+{
+    struct os_memblock *head;
+    struct os_memblock *cur;
+    uint32_t fail;
 
-    /* Check to make sure they passed in a memory pool (or something) */
-    block = NULL;
-    if (mp) {
-        OS_ENTER_CRITICAL(sr);
-        /* Check for any free */
-        if (mp->mp_num_free) {
-            /* Get a free block */
-            block = SLIST_FIRST(mp);
-
-            /* Set new free list head */
-            SLIST_FIRST(mp) = SLIST_NEXT(block, mb_next);
-
-            /* Decrement number free by 1 */
-            mp->mp_num_free--;
-            if (mp->mp_min_free > mp->mp_num_free) {
-                mp->mp_min_free = mp->mp_num_free;
-            }
-        }
-        OS_EXIT_CRITICAL(sr);
+    /*
+     * The block is chained to the head before the exclusive load; no other
+     * store happens while the monitor is held.
+     */
+    __asm__ volatile(
+        "1: ldr     %[head], [%[lhead]]         \n"
+        "   str     %[head], [%[blk]]           \n"
+        "   ldrex   %[cur], [%[lhead]]          \n"
+        "   cmp     %[cur], %[head]             \n"
+        "   beq     2f                          \n"
+        "   clrex                               \n"
+        "   b       1b                          \n"
+        "2: strex   %[fail], %[blk], [%[lhead]] \n"
+        "   cmp     %[fail], #0                 \n"
+        "   bne     1b                          \n"
+        : [head] "=&r" (head), [cur] "=&r" (cur), [fail] "=&r" (fail)
+        : [lhead] "r" (&SLIST_FIRST(mp)), [blk] "r" (block)
+        : "cc", "memory");
+}
+#elif OS_MEMPOOL_CAS
+static inline uint16_t
+os_mempool_num_free_add(struct os_mempool *mp, int delta)
+{
+    return __atomic_add_fetch(&mp->mp_num_free, delta, __ATOMIC_RELAXED);
+}
 
-        if (block) {
-            os_mempool_poison_check(mp, block);
-            os_mempool_guard_check(mp, block);
-        }
+static inline void
+os_mempool_min_free_update(struct os_mempool *mp, uint16_t num_free)
+{
+    uint16_t min;
+
+    min = __atomic_load_n(&mp->mp_min_free, __ATOMIC_RELAXED);
+    while (min > num_free &&
+           !__atomic_compare_exchange_n(&mp->mp_min_free, &min, num_free, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
     }
+}
 
-    os_trace_api_ret_u32(OS_TRACE_ID_MEMBLOCK_GET, (uint32_t)block);
+/*
+ * The next pointer of a block that another context has taken in the
+ * meantime may be garbage, but the block is still pool memory and the tag
+ * makes the swap fail, so the value is never used.
+ */
+static inline struct os_memblock *
+os_mempool_head_pop(struct os_mempool *mp)
+{
+    struct os_mempool_head cur;
+    struct os_mempool_head new;
 
-    return (void *)block;
+    __atomic_load(&mp->mp_head, &cur, __ATOMIC_ACQUIRE);
+    do {
+        if (cur.slh_first == NULL) {
+            return NULL;
+        }
+        new.slh_first = SLIST_NEXT(cur.slh_first, mb_next);
+        new.mph_tag = cur.mph_tag + 1;
+    } while (!__atomic_compare_exchange(&mp->mp_head, &cur, &new, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    return cur.slh_first;
 }
 
-os_error_t
-os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr)
+static inline void
+os_mempool_head_push(struct os_mempool *mp, struct os_memblock *block)
+{
+    struct os_mempool_head cur;
+    struct os_mempool_head new;
+
+    __atomic_load(&mp->mp_head, &cur, __ATOMIC_RELAXED);
+    do {
+        SLIST_NEXT(block, mb_next) = cur.slh_first;
+        new.slh_first = block;
+        new.mph_tag = cur.mph_tag;
+    } while (!__atomic_compare_exchange(&mp->mp_head, &cur, &new, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+#endif
+
+#if OS_MEMPOOL_LLSC || OS_MEMPOOL_CAS
+/**
+ * Unlinks the head of the free list of a pool without disabling interrupts.
+ *
+ * The free count is decremented after the block is unlinked and incremented
+ * before a block is linked (see os_mempool_free_list_push()), so mp_num_free
+ * may briefly overstate the length of the free list but never understates it.
+ *
+ * @return The unlinked block or NULL if the pool is empty.
+ */
+static struct os_memblock *
+os_mempool_free_list_pop(struct os_mempool *mp)
+{
+    struct os_memblock *block;
+
+    block = os_mempool_head_pop(mp);
+    if (block) {
+        os_mempool_sweep_taken(block);
+        os_mempool_min_free_update(mp, os_mempool_num_free_add(mp, -1));
+    }
+
+    return block;
+}
+
+/**
+ * Links a block at the head of the free list of a pool without disabling
+ * interrupts.
+ */
+static void
+os_mempool_free_list_push(struct os_mempool *mp, struct os_memblock *block)
+{
+    os_mempool_num_free_add(mp, 1);
+    os_mempool_head_push(mp, block);
+}
+#else
+static struct os_memblock *
+os_mempool_free_list_pop(struct os_mempool *mp)
 {
     os_sr_t sr;
     struct os_memblock *block;
 
-    os_trace_api_u32x2(OS_TRACE_ID_MEMBLOCK_PUT_FROM_CB, (uint32_t)mp,
-                       (uint32_t)block_addr);
+    block = NULL;
 
-    os_mempool_guard_check(mp, block_addr);
-    os_mempool_poison(mp, block_addr);
+    OS_ENTER_CRITICAL(sr);
+    /* Check for any free */
+    if (mp->mp_num_free) {
+        /* Get a free block */
+        block = SLIST_FIRST(mp);
+
+        /* Set new free list head */
+        SLIST_FIRST(mp) = SLIST_NEXT(block, mb_next);
+        /* The sweep cannot resume from a block that is no longer free. */
+        os_mempool_sweep_taken(block);
+
+        /* Decrement number free by 1 */
+        mp->mp_num_free--;
+        if (mp->mp_min_free > mp->mp_num_free) {
+            mp->mp_min_free = mp->mp_num_free;
+        }
+    }
+    OS_EXIT_CRITICAL(sr);
+
+    return block;
+}
+
+static void
+os_mempool_free_list_push(struct os_mempool *mp, struct os_memblock *block)
+{
+    os_sr_t sr;
 
-    block = (struct os_memblock *)block_addr;
     OS_ENTER_CRITICAL(sr);
 
     /* Chain current free list pointer to this block; make this block head */
@@ -387,6 +714,59 @@ os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr)
     mp->mp_num_free++;
 
     OS_EXIT_CRITICAL(sr);
+}
+#endif
+
+void *
+os_memblock_get_owner(struct os_mempool *mp, void *owner)
+{
+    struct os_memblock *block;
+
+    os_trace_api_u32(OS_TRACE_ID_MEMBLOCK_GET, (uint32_t)mp);
+
+    /* Check to make sure they passed in a memory pool (or something) */
+    block = NULL;
+    if (mp) {
+        block = os_mempool_free_list_pop(mp);
+        if (block && os_mempool_check_sample()) {
+            os_mempool_poison_check(mp, block);
+            os_mempool_guard_check(mp, block);
+        }
+        if (block) {
+            os_mempool_trace_set(mp, block, owner);
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+            if (mp->mp_low_cb != NULL &&
+                mp->mp_num_free == mp->mp_low_thresh) {
+                mp->mp_low_cb(mp, mp->mp_low_arg);
+            }
+#endif
+        }
+    }
+
+    os_trace_api_ret_u32(OS_TRACE_ID_MEMBLOCK_GET, (uint32_t)block);
+
+    return (void *)block;
+}
+
+void *
+os_memblock_get(struct os_mempool *mp)
+{
+    return os_memblock_get_owner(mp, os_get_return_addr());
+}
+
+os_error_t
+os_memblock_put_from_cb(struct os_mempool *mp, void *block_addr)
+{
+    os_trace_api_u32x2(OS_TRACE_ID_MEMBLOCK_PUT_FROM_CB, (uint32_t)mp,
+                       (uint32_t)block_addr);
+
+    if (os_mempool_check_sample()) {
+        os_mempool_guard_check(mp, block_addr);
+    }
+    os_mempool_poison(mp, block_addr);
+    os_mempool_trace_set(mp, block_addr, NULL);
+
+    os_mempool_free_list_push(mp, (struct os_memblock *)block_addr);
 
     os_trace_api_ret_u32(OS_TRACE_ID_MEMBLOCK_PUT_FROM_CB, (uint32_t)OS_OK);
 
@@ -441,6 +821,141 @@ done:
     return ret;
 }
 
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+void
+os_mempool_set_low_cb(struct os_mempool *mp, uint16_t thresh,
+                      os_mempool_low_fn *cb, void *arg)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    mp->mp_low_cb = cb;
+    mp->mp_low_arg = arg;
+    mp->mp_low_thresh = thresh;
+    OS_EXIT_CRITICAL(sr);
+}
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+int
+os_mempool_trace_oldest(const struct os_mempool *mp,
+                        struct os_memblock_owner *owners, int max)
+{
+    struct os_memblock_owner omo;
+    uint8_t *block_addr;
+    int true_block_size;
+    int num;
+    int i;
+    int j;
+    os_sr_t sr;
+
+    true_block_size = OS_MEMPOOL_TRUE_BLOCK_SIZE(mp);
+    block_addr = (uint8_t *)mp->mp_membuf_addr;
+    num = 0;
+
+    for (i = 0; i < mp->mp_num_blocks; i++, block_addr += true_block_size) {
+        OS_ENTER_CRITICAL(sr);
+        omo = *OS_MEMPOOL_OWNER(mp, block_addr);
+        OS_EXIT_CRITICAL(sr);
+
+        if (omo.omo_addr == NULL) {
+            continue;
+        }
+
+        /* Insertion sort, oldest allocation first. */
+        for (j = num; j > 0; j--) {
+            if (!OS_TIME_TICK_LT(omo.omo_time, owners[j - 1].omo_time)) {
+                break;
+            }
+            if (j < max) {
+                owners[j] = owners[j - 1];
+            }
+        }
+        if (j < max) {
+            owners[j] = omo;
+            if (num < max) {
+                num++;
+            }
+        }
+    }
+
+    return num;
+}
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+/*
+ * The idle task calls os_mempool_sweep() once per loop.  Each call validates
+ * at most OS_MEMPOOL_SWEEP_BLOCKS blocks of one pool's free list and saves
+ * the next block to check.  Blocks are only linked in and taken off at the
+ * head of the list, so the blocks past the saved one stay put until the saved
+ * block itself is taken; only then, or when the pool is reinitialized, does
+ * the next call start over from the head.
+ *
+ * @return                      The pool whose free list this call finished
+ *                                  checking; NULL if it stopped part way.
+ */
+struct os_mempool *
+os_mempool_sweep(void)
+{
+    struct os_memblock *block;
+    struct os_mempool *mp;
+    uint16_t pos;
+    int n;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+
+    /* The pool may have been unregistered since the previous call. */
+    STAILQ_FOREACH(mp, &g_os_mempool_list, mp_list) {
+        if (mp == os_mempool_sweep_pool) {
+            break;
+        }
+    }
+    if (mp == NULL) {
+        mp = STAILQ_FIRST(&g_os_mempool_list);
+        os_mempool_sweep_block = NULL;
+        if (mp == NULL) {
+            OS_EXIT_CRITICAL(sr);
+            return NULL;
+        }
+    }
+
+    if (os_mempool_sweep_block != NULL) {
+        block = os_mempool_sweep_block;
+        pos = os_mempool_sweep_pos;
+    } else {
+        block = SLIST_FIRST(mp);
+        pos = 0;
+    }
+
+    for (n = 0; block != NULL && n < MYNEWT_VAL(OS_MEMPOOL_SWEEP_BLOCKS); n++) {
+        assert(os_memblock_from(mp, block));
+        os_mempool_poison_check(mp, block);
+        os_mempool_guard_check(mp, block);
+        block = SLIST_NEXT(block, mb_next);
+
+        /* A free list longer than the pool has a loop in it. */
+        pos++;
+        assert(pos <= mp->mp_num_blocks);
+    }
+
+    if (block == NULL) {
+        os_mempool_sweep_pool = STAILQ_NEXT(mp, mp_list);
+        os_mempool_sweep_block = NULL;
+    } else {
+        os_mempool_sweep_pool = mp;
+        os_mempool_sweep_block = block;
+        os_mempool_sweep_pos = pos;
+        mp = NULL;
+    }
+
+    OS_EXIT_CRITICAL(sr);
+
+    return mp;
+}
+#endif
+
 struct os_mempool *
 os_mempool_info_get_next(struct os_mempool *mp, struct os_mempool_info *omi)
 {
@@ -24,6 +24,86 @@
 #endif
 #include "os/mynewt.h"
 
+#if MYNEWT_VAL(OS_MUTEX_STATS)
+static void
+os_mutex_stats_acquire(struct os_mutex *mu)
+{
+    mu->mu_acq_cnt++;
+    mu->mu_acq_time = os_cputime_get32();
+}
+
+static void
+os_mutex_stats_release(struct os_mutex *mu)
+{
+    uint32_t held;
+
+    held = os_cputime_get32() - mu->mu_acq_time;
+    if (held > mu->mu_max_hold) {
+        mu->mu_max_hold = held;
+    }
+}
+#endif
+
+/**
+ * Insert a task in the mutex wait list, highest priority first.  Tasks of
+ * equal priority are kept in FIFO order.
+ */
+static void
+os_mutex_waiter_insert(struct os_mutex *mu, struct os_task *t)
+{
+    struct os_task *entry;
+    struct os_task *last;
+
+    last = NULL;
+    SLIST_FOREACH(entry, &mu->mu_head, t_obj_list) {
+        if (t->t_prio < entry->t_prio) {
+            break;
+        }
+        last = entry;
+    }
+
+    if (last) {
+        SLIST_INSERT_AFTER(last, t, t_obj_list);
+    } else {
+        SLIST_INSERT_HEAD(&mu->mu_head, t, t_obj_list);
+    }
+}
+
+/**
+ * Raise the priority of the mutex owner to 'prio'.  If the owner is itself
+ * waiting for another mutex, the boost is passed on to that mutex's owner,
+ * and so on, for at most OS_MUTEX_PI_DEPTH owners.  The depth bound also
+ * terminates the walk if the wait graph contains a cycle (deadlock).
+ *
+ * Must be called with interrupts disabled.
+ */
+static void
+os_mutex_prio_inherit(struct os_mutex *mu, uint8_t prio)
+{
+    struct os_task *owner;
+    int depth;
+
+    for (depth = 0; depth < MYNEWT_VAL(OS_MUTEX_PI_DEPTH); depth++) {
+        owner = mu->mu_owner;
+        if (owner == NULL || owner->t_prio <= prio) {
+            break;
+        }
+
+        owner->t_prio = prio;
+        os_sched_resort(owner);
+
+        if (!(owner->t_flags & OS_TASK_FLAG_MUTEX_WAIT) ||
+            owner->t_obj == NULL) {
+            break;
+        }
+
+        /* Owner is blocked; keep its position in the wait list sorted. */
+        mu = owner->t_obj;
+        SLIST_REMOVE(&mu->mu_head, owner, os_task, t_obj_list);
+        os_mutex_waiter_insert(mu, owner);
+    }
+}
+
 os_error_t
 os_mutex_init(struct os_mutex *mu)
 {
@@ -41,6 +121,12 @@ os_mutex_init(struct os_mutex *mu)
     mu->mu_level = 0;
     mu->mu_owner = NULL;
     SLIST_FIRST(&mu->mu_head) = NULL;
+#if MYNEWT_VAL(OS_MUTEX_STATS)
+    mu->mu_acq_cnt = 0;
+    mu->mu_pend_cnt = 0;
+    mu->mu_max_hold = 0;
+    mu->mu_acq_time = 0;
+#endif
 
     ret = OS_OK;
 
@@ -88,6 +174,10 @@ os_mutex_release(struct os_mutex *mu)
 
     OS_ENTER_CRITICAL(sr);
 
+#if MYNEWT_VAL(OS_MUTEX_STATS)
+    os_mutex_stats_release(mu);
+#endif
+
     /* Restore owner task's priority; resort list if different  */
     if (current->t_prio != mu->mu_prio) {
         current->t_prio = mu->mu_prio;
@@ -104,6 +194,9 @@ os_mutex_release(struct os_mutex *mu)
         /* Set mutex internals */
         mu->mu_level = 1;
         mu->mu_prio = rdy->t_prio;
+#if MYNEWT_VAL(OS_MUTEX_STATS)
+        os_mutex_stats_acquire(mu);
+#endif
     }
 
     /* Set new owner of mutex (or NULL if not owned) */
@@ -139,8 +232,6 @@ os_mutex_pend(struct os_mutex *mu, os_time_t timeout)
     os_sr_t sr;
     os_error_t ret;
     struct os_task *current;
-    struct os_task *entry;
-    struct os_task *last;
 
     os_trace_api_u32x2(OS_TRACE_ID_MUTEX_PEND, (uint32_t)mu, (uint32_t)timeout);
 
@@ -165,6 +256,9 @@ os_mutex_pend(struct os_mutex *mu, os_time_t timeout)
         mu->mu_prio  = current->t_prio;
         current->t_lockcnt++;
         mu->mu_level = 1;
+#if MYNEWT_VAL(OS_MUTEX_STATS)
+        os_mutex_stats_acquire(mu);
+#endif
         OS_EXIT_CRITICAL(sr);
         ret = OS_OK;
         goto done;
@@ -185,29 +279,15 @@ os_mutex_pend(struct os_mutex *mu, os_time_t timeout)
         goto done;
     }
 
-    /* Change priority of owner if needed */
-    if (mu->mu_owner->t_prio > current->t_prio) {
-        mu->mu_owner->t_prio = current->t_prio;
-        os_sched_resort(mu->mu_owner);
-    }
+#if MYNEWT_VAL(OS_MUTEX_STATS)
+    mu->mu_pend_cnt++;
+#endif
 
-    /* Link current task to tasks waiting for mutex */
-    last = NULL;
-    if (!SLIST_EMPTY(&mu->mu_head)) {
-        /* Insert in priority order */
-        SLIST_FOREACH(entry, &mu->mu_head, t_obj_list) {
-            if (current->t_prio < entry->t_prio) {
-                break;
-            }
-            last = entry;
-        }
-    }
+    /* Change priority of owner (and whoever it is waiting on) if needed */
+    os_mutex_prio_inherit(mu, current->t_prio);
 
-    if (last) {
-        SLIST_INSERT_AFTER(last, current, t_obj_list);
-    } else {
-        SLIST_INSERT_HEAD(&mu->mu_head, current, t_obj_list);
-    }
+    /* Link current task to tasks waiting for mutex */
+    os_mutex_waiter_insert(mu, current);
 
     /* Set mutex pointer in task */
     current->t_obj = mu;
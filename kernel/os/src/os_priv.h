@@ -38,6 +38,29 @@ extern struct os_task_stailq g_os_task_list;
 extern struct os_callout_list g_callout_list;
 
 void os_msys_init(void);
+void *os_memblock_get_owner(struct os_mempool *mp, void *owner);
+#if MYNEWT_VAL(OS_HEAP_TLSF)
+void *os_tlsf_malloc(size_t size);
+void os_tlsf_free(void *ptr);
+void *os_tlsf_realloc(void *ptr, size_t size);
+void os_tlsf_info_get(struct os_heap_info *info);
+#endif
+#if MYNEWT_VAL(MSYS_STATS)
+void os_msys_stats_init(void);
+#endif
+void os_cputime_task_wakeup(void *arg);
+os_time_t os_cputime_ostime_left(uint32_t start, uint32_t ticks);
+void os_callout_list_init(void);
+#if MYNEWT_VAL(OS_STACK_HWM)
+void os_stack_hwm_task_removed(struct os_task *t);
+void os_stack_hwm_reset(void);
+#endif
+#if MYNEWT_VAL(OS_IDLE_WORK)
+int os_idle_work_pending(void);
+#endif
+#if MYNEWT_VAL(OS_TASK_PROF)
+void os_task_prof_start(void);
+#endif
 
 /**
  * Prints information about a crash to the console.  This functionality is
@@ -18,6 +18,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 #include "os/mynewt.h"
 #include "os_priv.h"
 
@@ -29,6 +30,284 @@ struct os_task *g_current_task;
 extern os_time_t g_os_time;
 os_time_t g_os_last_ctx_sw_time;
 
+#if MYNEWT_VAL(OS_SCHED_BITMAP)
+/*
+ * Priority bitmap for the run list.  The run list itself stays sorted by
+ * priority (the architecture specific context switch code reads its head
+ * directly), but the insertion point is found without walking it: a bit is
+ * set for every priority with at least one ready task, and the last ready
+ * task queued at each priority is remembered.
+ */
+#define OS_SCHED_PRIO_CNT       (OS_TASK_PRI_LOWEST + 1)
+#define OS_SCHED_PRIO_WORDS     (OS_SCHED_PRIO_CNT / 32)
+
+static uint32_t os_sched_prio_map[OS_SCHED_PRIO_WORDS];
+static struct os_task *os_sched_prio_last[OS_SCHED_PRIO_CNT];
+
+/**
+ * Returns the last ready task queued at a priority equal to or higher than
+ * 'prio' (i.e. numerically lower or equal), or NULL if there is none. A task
+ * of priority 'prio' is inserted right after this task.
+ */
+static struct os_task *
+os_sched_prio_find(uint8_t prio)
+{
+    uint32_t bits;
+    int word;
+
+    word = prio >> 5;
+    bits = os_sched_prio_map[word] & (0xffffffffUL >> (31 - (prio & 31)));
+    while (bits == 0) {
+        if (word == 0) {
+            return (NULL);
+        }
+        bits = os_sched_prio_map[--word];
+    }
+
+    return (os_sched_prio_last[(word << 5) + 31 - __builtin_clz(bits)]);
+}
+#endif
+
+/**
+ * Removes a ready task from the run list.
+ *
+ * NOTE: must be called with interrupts disabled!
+ */
+static void
+os_sched_run_list_remove(struct os_task *t)
+{
+#if MYNEWT_VAL(OS_SCHED_BITMAP)
+    struct os_task *prev;
+    uint8_t prio;
+
+    prio = t->t_run_prio;
+    if (os_sched_prio_last[prio] == t) {
+        prev = TAILQ_PREV(t, os_task_list, t_os_list);
+        if (prev && prev->t_run_prio == prio) {
+            os_sched_prio_last[prio] = prev;
+        } else {
+            os_sched_prio_last[prio] = NULL;
+            os_sched_prio_map[prio >> 5] &= ~(1UL << (prio & 31));
+        }
+    }
+#endif
+    TAILQ_REMOVE(&g_os_run_list, t, t_os_list);
+}
+
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+/*
+ * Pairing heap of the tasks sleeping with a timeout, ordered by wakeup time.
+ * Tasks sleeping without a timeout stay on g_os_sleep_list.
+ */
+static struct os_task *os_sched_sleep_heap;
+
+/**
+ * Melds two heaps and returns the root of the result.  Both arguments must be
+ * roots (no siblings, no parent) or NULL.
+ */
+static struct os_task *
+os_sched_sleep_heap_meld(struct os_task *a, struct os_task *b)
+{
+    struct os_task *tmp;
+
+    if (a == NULL) {
+        return (b);
+    }
+    if (b == NULL) {
+        return (a);
+    }
+
+    if (OS_TIME_TICK_LT(b->t_next_wakeup, a->t_next_wakeup)) {
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    b->t_sleep_prev = a;
+    b->t_sleep_sibling = a->t_sleep_child;
+    if (b->t_sleep_sibling) {
+        b->t_sleep_sibling->t_sleep_prev = b;
+    }
+    a->t_sleep_child = b;
+
+    return (a);
+}
+
+/**
+ * Melds a list of sibling heaps with the standard two-pass pairing and
+ * returns the root of the result.
+ */
+static struct os_task *
+os_sched_sleep_heap_merge_pairs(struct os_task *first)
+{
+    struct os_task *pairs;
+    struct os_task *root;
+    struct os_task *a;
+    struct os_task *b;
+
+    /* Left to right: meld pairs, stacking the results via t_sleep_sibling. */
+    pairs = NULL;
+    while (first) {
+        a = first;
+        b = a->t_sleep_sibling;
+        first = b ? b->t_sleep_sibling : NULL;
+
+        a->t_sleep_sibling = NULL;
+        a->t_sleep_prev = NULL;
+        if (b) {
+            b->t_sleep_sibling = NULL;
+            b->t_sleep_prev = NULL;
+        }
+
+        a = os_sched_sleep_heap_meld(a, b);
+        a->t_sleep_sibling = pairs;
+        pairs = a;
+    }
+
+    /* Right to left: meld the pairs into one heap. */
+    root = NULL;
+    while (pairs) {
+        a = pairs;
+        pairs = a->t_sleep_sibling;
+        a->t_sleep_sibling = NULL;
+        root = os_sched_sleep_heap_meld(root, a);
+    }
+
+    return (root);
+}
+
+static void
+os_sched_sleep_heap_insert(struct os_task *t)
+{
+    t->t_sleep_child = NULL;
+    t->t_sleep_sibling = NULL;
+    t->t_sleep_prev = NULL;
+    os_sched_sleep_heap = os_sched_sleep_heap_meld(os_sched_sleep_heap, t);
+}
+
+static void
+os_sched_sleep_heap_remove(struct os_task *t)
+{
+    struct os_task *sub;
+
+    sub = os_sched_sleep_heap_merge_pairs(t->t_sleep_child);
+    if (t == os_sched_sleep_heap) {
+        os_sched_sleep_heap = sub;
+    } else {
+        if (t->t_sleep_prev->t_sleep_child == t) {
+            t->t_sleep_prev->t_sleep_child = t->t_sleep_sibling;
+        } else {
+            t->t_sleep_prev->t_sleep_sibling = t->t_sleep_sibling;
+        }
+        if (t->t_sleep_sibling) {
+            t->t_sleep_sibling->t_sleep_prev = t->t_sleep_prev;
+        }
+        os_sched_sleep_heap = os_sched_sleep_heap_meld(os_sched_sleep_heap,
+                                                       sub);
+    }
+
+    t->t_sleep_child = NULL;
+    t->t_sleep_sibling = NULL;
+    t->t_sleep_prev = NULL;
+}
+#endif
+
+/**
+ * Returns the sleeping task which has the earliest wakeup time, or NULL if no
+ * task is sleeping with a timeout.
+ *
+ * NOTE: must be called with interrupts disabled!
+ */
+static struct os_task *
+os_sched_sleep_list_first(void)
+{
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+    return (os_sched_sleep_heap);
+#else
+    struct os_task *t;
+
+    t = TAILQ_FIRST(&g_os_sleep_list);
+    if (t && (t->t_flags & OS_TASK_FLAG_NO_TIMEOUT)) {
+        t = NULL;
+    }
+    return (t);
+#endif
+}
+
+/**
+ * Inserts a task into the sleep list.  Tasks without a timeout go to the end
+ * of the list; others are ordered by wakeup time.
+ *
+ * NOTE: must be called with interrupts disabled!
+ */
+static void
+os_sched_sleep_list_insert(struct os_task *t)
+{
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+    if (t->t_flags & OS_TASK_FLAG_NO_TIMEOUT) {
+        TAILQ_INSERT_TAIL(&g_os_sleep_list, t, t_os_list);
+    } else {
+        os_sched_sleep_heap_insert(t);
+    }
+#else
+    struct os_task *entry;
+
+    if (t->t_flags & OS_TASK_FLAG_NO_TIMEOUT) {
+        TAILQ_INSERT_TAIL(&g_os_sleep_list, t, t_os_list);
+        return;
+    }
+
+    TAILQ_FOREACH(entry, &g_os_sleep_list, t_os_list) {
+        if ((entry->t_flags & OS_TASK_FLAG_NO_TIMEOUT) ||
+                OS_TIME_TICK_GT(entry->t_next_wakeup, t->t_next_wakeup)) {
+            break;
+        }
+    }
+    if (entry) {
+        TAILQ_INSERT_BEFORE(entry, t, t_os_list);
+    } else {
+        TAILQ_INSERT_TAIL(&g_os_sleep_list, t, t_os_list);
+    }
+#endif
+}
+
+/**
+ * Removes a sleeping task from the sleep list.
+ *
+ * NOTE: must be called with interrupts disabled!
+ */
+static void
+os_sched_sleep_list_remove(struct os_task *t)
+{
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+    if (!(t->t_flags & OS_TASK_FLAG_NO_TIMEOUT)) {
+        os_sched_sleep_heap_remove(t);
+        return;
+    }
+#endif
+    TAILQ_REMOVE(&g_os_sleep_list, t, t_os_list);
+}
+
+/**
+ * os sched init
+ *
+ * Empties the run and sleep lists.  Called by the architecture specific code
+ * when the OS is (re)initialized.
+ */
+void
+os_sched_init(void)
+{
+    TAILQ_INIT(&g_os_run_list);
+    TAILQ_INIT(&g_os_sleep_list);
+#if MYNEWT_VAL(OS_SCHED_BITMAP)
+    memset(os_sched_prio_map, 0, sizeof os_sched_prio_map);
+    memset(os_sched_prio_last, 0, sizeof os_sched_prio_last);
+#endif
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+    os_sched_sleep_heap = NULL;
+#endif
+}
+
 /**
  * os sched insert
  *
@@ -54,6 +333,17 @@ os_sched_insert(struct os_task *t)
 
     entry = NULL;
     OS_ENTER_CRITICAL(sr);
+#if MYNEWT_VAL(OS_SCHED_BITMAP)
+    entry = os_sched_prio_find(t->t_prio);
+    if (entry) {
+        TAILQ_INSERT_AFTER(&g_os_run_list, entry, t, t_os_list);
+    } else {
+        TAILQ_INSERT_HEAD(&g_os_run_list, t, t_os_list);
+    }
+    t->t_run_prio = t->t_prio;
+    os_sched_prio_last[t->t_prio] = t;
+    os_sched_prio_map[t->t_prio >> 5] |= 1UL << (t->t_prio & 31);
+#else
     TAILQ_FOREACH(entry, &g_os_run_list, t_os_list) {
         if (t->t_prio < entry->t_prio) {
             break;
@@ -64,6 +354,10 @@ os_sched_insert(struct os_task *t)
     } else {
         TAILQ_INSERT_TAIL(&g_os_run_list, (struct os_task *) t, t_os_list);
     }
+#endif
+#if MYNEWT_VAL(OS_TASK_PROF)
+    t->t_prof.otp_ready_time = os_cputime_get32();
+#endif
     OS_EXIT_CRITICAL(sr);
 
     return (0);
@@ -71,6 +365,122 @@ err:
     return (rc);
 }
 
+#if MYNEWT_VAL(OS_TASK_PROF)
+/* Time of the last context switch, in os_cputime ticks. */
+static uint32_t os_task_prof_sw_time;
+
+static uint64_t os_task_prof_isr_total;
+static uint32_t os_task_prof_isr_start;
+static uint8_t os_task_prof_isr_nesting;
+
+static void
+os_task_prof_ctx_sw(struct os_task *next_t)
+{
+    struct os_task_prof *prof;
+    uint32_t now;
+    uint32_t lat;
+    int bucket;
+
+    now = os_cputime_get32();
+
+    prof = &g_current_task->t_prof;
+    prof->otp_run_time += now - os_task_prof_sw_time;
+    os_task_prof_sw_time = now;
+
+    if (next_t == g_current_task) {
+        return;
+    }
+
+    /* Outgoing task is still ready to run if it was preempted. */
+    if (g_current_task->t_state == OS_TASK_READY) {
+        prof->otp_preempt_cnt++;
+        prof->otp_ready_time = now;
+    }
+
+    prof = &next_t->t_prof;
+    lat = now - prof->otp_ready_time;
+    if (lat > prof->otp_lat_max) {
+        prof->otp_lat_max = lat;
+    }
+    bucket = lat ? 32 - __builtin_clz(lat) : 0;
+    if (bucket >= OS_TASK_PROF_LAT_BUCKETS) {
+        bucket = OS_TASK_PROF_LAT_BUCKETS - 1;
+    }
+    prof->otp_lat_hist[bucket]++;
+}
+
+void
+os_task_prof_isr_enter(void)
+{
+    if (os_task_prof_isr_nesting++ == 0) {
+        os_task_prof_isr_start = os_cputime_get32();
+    }
+}
+
+void
+os_task_prof_isr_exit(void)
+{
+    uint32_t ticks;
+
+    if (--os_task_prof_isr_nesting == 0) {
+        ticks = os_cputime_get32() - os_task_prof_isr_start;
+        os_task_prof_isr_total += ticks;
+        if (g_current_task) {
+            g_current_task->t_prof.otp_isr_time += ticks;
+        }
+    }
+}
+
+uint64_t
+os_task_prof_isr_time(void)
+{
+    uint64_t ticks;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    ticks = os_task_prof_isr_total;
+    OS_EXIT_CRITICAL(sr);
+
+    return (ticks);
+}
+
+void
+os_task_prof_reset(void)
+{
+    struct os_task *t;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    STAILQ_FOREACH(t, &g_os_task_list, t_os_task_list) {
+        memset(&t->t_prof, 0, sizeof t->t_prof);
+    }
+    os_task_prof_isr_total = 0;
+    os_task_prof_sw_time = os_cputime_get32();
+    OS_EXIT_CRITICAL(sr);
+}
+
+/**
+ * Starts the task profiler clock.  Called right before the first task is
+ * started, so that neither the first task's run time nor the ready latency of
+ * tasks created before os_cputime was initialized include the startup time.
+ */
+void
+os_task_prof_start(void)
+{
+    struct os_task *t;
+    uint32_t now;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    now = os_cputime_get32();
+    TAILQ_FOREACH(t, &g_os_run_list, t_os_list) {
+        t->t_prof.otp_ready_time = now;
+    }
+    os_task_prof_sw_time = now;
+    OS_EXIT_CRITICAL(sr);
+}
+#endif
+
 void
 os_sched_ctx_sw_hook(struct os_task *next_t)
 {
@@ -82,6 +492,9 @@ os_sched_ctx_sw_hook(struct os_task *next_t)
     for (i = 0; i < MYNEWT_VAL(OS_CTX_SW_STACK_GUARD); i++) {
         assert(top[i] == OS_STACK_PATTERN);
     }
+#endif
+#if MYNEWT_VAL(OS_TASK_PROF)
+    os_task_prof_ctx_sw(next_t);
 #endif
     next_t->t_ctx_sw_cnt++;
     g_current_task->t_run_time += g_os_time - g_os_last_ctx_sw_time;
@@ -141,29 +554,13 @@ os_sched(struct os_task *next_t)
 int
 os_sched_sleep(struct os_task *t, os_time_t nticks)
 {
-    struct os_task *entry;
-
-    entry = NULL;
-
-    TAILQ_REMOVE(&g_os_run_list, t, t_os_list);
+    os_sched_run_list_remove(t);
     t->t_state = OS_TASK_SLEEP;
     t->t_next_wakeup = os_time_get() + nticks;
     if (nticks == OS_TIMEOUT_NEVER) {
         t->t_flags |= OS_TASK_FLAG_NO_TIMEOUT;
-        TAILQ_INSERT_TAIL(&g_os_sleep_list, t, t_os_list);
-    } else {
-        TAILQ_FOREACH(entry, &g_os_sleep_list, t_os_list) {
-            if ((entry->t_flags & OS_TASK_FLAG_NO_TIMEOUT) ||
-                    OS_TIME_TICK_GT(entry->t_next_wakeup, t->t_next_wakeup)) {
-                break;
-            }
-        }
-        if (entry) {
-            TAILQ_INSERT_BEFORE(entry, t, t_os_list);
-        } else {
-            TAILQ_INSERT_TAIL(&g_os_sleep_list, t, t_os_list);
-        }
     }
+    os_sched_sleep_list_insert(t);
 
     os_trace_task_stop_ready(t, OS_TASK_SLEEP);
     return (0);
@@ -187,9 +584,9 @@ os_sched_remove(struct os_task *t)
 {
 
     if (t->t_state == OS_TASK_SLEEP) {
-        TAILQ_REMOVE(&g_os_sleep_list, t, t_os_list);
+        os_sched_sleep_list_remove(t);
     } else if (t->t_state == OS_TASK_READY) {
-        TAILQ_REMOVE(&g_os_run_list, t, t_os_list);
+        os_sched_run_list_remove(t);
     }
     t->t_next_wakeup = 0;
     t->t_flags |= OS_TASK_FLAG_NO_TIMEOUT;
@@ -229,10 +626,10 @@ os_sched_wakeup(struct os_task *t)
     }
 
     /* Remove task from sleep list */
+    os_sched_sleep_list_remove(t);
     t->t_state = OS_TASK_READY;
     t->t_next_wakeup = 0;
     t->t_flags &= ~OS_TASK_FLAG_NO_TIMEOUT;
-    TAILQ_REMOVE(&g_os_sleep_list, t, t_os_list);
     os_sched_insert(t);
 
     os_trace_task_start_ready(t);
@@ -253,7 +650,6 @@ void
 os_sched_os_timer_exp(void)
 {
     struct os_task *t;
-    struct os_task *next;
     os_time_t now;
     os_sr_t sr;
 
@@ -264,19 +660,12 @@ os_sched_os_timer_exp(void)
     /*
      * Wakeup any tasks that have their sleep timer expired
      */
-    t = TAILQ_FIRST(&g_os_sleep_list);
-    while (t) {
-        /* If task waiting forever, do not check next wakeup time */
-        if (t->t_flags & OS_TASK_FLAG_NO_TIMEOUT) {
-            break;
-        }
-        next = TAILQ_NEXT(t, t_os_list);
+    while ((t = os_sched_sleep_list_first()) != NULL) {
         if (OS_TIME_TICK_GEQ(now, t->t_next_wakeup)) {
             os_sched_wakeup(t);
         } else {
             break;
         }
-        t = next;
     }
 
     OS_EXIT_CRITICAL(sr);
@@ -294,8 +683,8 @@ os_sched_wakeup_ticks(os_time_t now)
 
     OS_ASSERT_CRITICAL();
 
-    t = TAILQ_FIRST(&g_os_sleep_list);
-    if (t == NULL || (t->t_flags & OS_TASK_FLAG_NO_TIMEOUT)) {
+    t = os_sched_sleep_list_first();
+    if (t == NULL) {
         rt = OS_TIMEOUT_NEVER;
     } else if (OS_TIME_TICK_GEQ(t->t_next_wakeup, now)) {
         rt = t->t_next_wakeup - now;
@@ -305,6 +694,129 @@ os_sched_wakeup_ticks(os_time_t now)
     return (rt);
 }
 
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+/* Number of sleeping tasks os_sched_wakeup_slack_ticks() looks at. */
+#define OS_SCHED_SLACK_SCAN     (8)
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+/* Number of sleep heap sibling chains it keeps pending. */
+#define OS_SCHED_SLACK_CHAINS   (4)
+#endif
+
+/**
+ * Returns the number of ticks to the latest time at which every task sleeping
+ * with a timeout can still be woken within its slack, i.e. the earliest
+ * wakeup time plus slack.  If there are no such tasks then return
+ * OS_TIMEOUT_NEVER instead.
+ *
+ * At most OS_SCHED_SLACK_SCAN tasks waking up before the running result are
+ * looked at; tasks waking up later cannot bring it forward and are skipped
+ * without descending into their subheaps.  Once the limit is hit, the rest is
+ * covered by the wakeup time it cannot precede, which may wake the idle task
+ * early but never late.
+ */
+os_time_t
+os_sched_wakeup_slack_ticks(os_time_t now)
+{
+    struct os_task *t;
+    os_time_t latest;
+    int n;
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+    struct os_task *chain[OS_SCHED_SLACK_CHAINS];
+    os_time_t bound[OS_SCHED_SLACK_CHAINS];
+    struct os_task *c;
+    os_time_t parent;
+    int nchain;
+    int i;
+    int j;
+#endif
+
+    OS_ASSERT_CRITICAL();
+
+    t = os_sched_sleep_list_first();
+    if (t == NULL) {
+        return (OS_TIMEOUT_NEVER);
+    }
+    latest = t->t_next_wakeup + t->t_slack;
+
+    n = 0;
+#if MYNEWT_VAL(OS_SCHED_SLEEP_HEAP)
+    /*
+     * Children wake up no earlier than their parent, but siblings are not
+     * ordered.  Pending sibling chains are kept with their parent's wakeup
+     * time as the bound, and the chain with the lowest bound is walked next.
+     */
+    nchain = 0;
+    if (t->t_sleep_child != NULL) {
+        chain[0] = t->t_sleep_child;
+        bound[0] = t->t_next_wakeup;
+        nchain = 1;
+    }
+    while (nchain > 0) {
+        i = 0;
+        for (j = 1; j < nchain; j++) {
+            if (OS_TIME_TICK_LT(bound[j], bound[i])) {
+                i = j;
+            }
+        }
+        if (!OS_TIME_TICK_LT(bound[i], latest)) {
+            break;
+        }
+        c = chain[i];
+        parent = bound[i];
+        nchain--;
+        chain[i] = chain[nchain];
+        bound[i] = bound[nchain];
+
+        for (; c != NULL; c = c->t_sleep_sibling) {
+            if (!OS_TIME_TICK_LT(c->t_next_wakeup, latest)) {
+                continue;
+            }
+            if (n++ == OS_SCHED_SLACK_SCAN) {
+                /* No other chain has a lower bound. */
+                if (OS_TIME_TICK_LT(parent, latest)) {
+                    latest = parent;
+                }
+                nchain = 0;
+                break;
+            }
+            if (OS_TIME_TICK_LT(c->t_next_wakeup + c->t_slack, latest)) {
+                latest = c->t_next_wakeup + c->t_slack;
+            }
+            if (c->t_sleep_child == NULL) {
+                continue;
+            }
+            if (nchain < OS_SCHED_SLACK_CHAINS) {
+                chain[nchain] = c->t_sleep_child;
+                bound[nchain] = c->t_next_wakeup;
+                nchain++;
+            } else if (OS_TIME_TICK_LT(c->t_next_wakeup, latest)) {
+                latest = c->t_next_wakeup;
+            }
+        }
+    }
+#else
+    /* The list is sorted; the first task not looked at bounds the rest. */
+    while ((t = TAILQ_NEXT(t, t_os_list)) != NULL &&
+           !(t->t_flags & OS_TASK_FLAG_NO_TIMEOUT) &&
+           OS_TIME_TICK_LT(t->t_next_wakeup, latest)) {
+        if (n++ == OS_SCHED_SLACK_SCAN) {
+            latest = t->t_next_wakeup;
+            break;
+        }
+        if (OS_TIME_TICK_LT(t->t_next_wakeup + t->t_slack, latest)) {
+            latest = t->t_next_wakeup + t->t_slack;
+        }
+    }
+#endif
+
+    if (OS_TIME_TICK_GEQ(latest, now)) {
+        return (latest - now);
+    } else {
+        return (0);
+    }
+}
+#endif
+
 /**
  * os sched next task
  *
@@ -338,8 +850,19 @@ os_sched_next_task(void)
 void
 os_sched_resort(struct os_task *t)
 {
+#if MYNEWT_VAL(OS_TASK_PROF)
+    uint32_t ready_time;
+#endif
+
     if (t->t_state == OS_TASK_READY) {
-        TAILQ_REMOVE(&g_os_run_list, t, t_os_list);
+#if MYNEWT_VAL(OS_TASK_PROF)
+        /* The task has been waiting since it was made ready, not resorted. */
+        ready_time = t->t_prof.otp_ready_time;
+#endif
+        os_sched_run_list_remove(t);
         os_sched_insert(t);
+#if MYNEWT_VAL(OS_TASK_PROF)
+        t->t_prof.otp_ready_time = ready_time;
+#endif
     }
 }
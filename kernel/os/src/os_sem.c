@@ -23,6 +23,7 @@
 #define OS_TRACE_DISABLE_FILE_API
 #endif
 #include "os/mynewt.h"
+#include "os_priv.h"
 
 /* XXX:
  * 1) Should I check to see if we are within an ISR for some of these?
@@ -111,8 +112,14 @@ done:
     return ret;
 }
 
-os_error_t
-os_sem_pend(struct os_sem *sem, os_time_t timeout)
+/**
+ * Common implementation of os_sem_pend() and os_sem_pend_usecs().  If
+ * 'wakeup' is not NULL and the task has to wait, the timer is started at
+ * cputime 'deadline' once the task is asleep.
+ */
+static os_error_t
+os_sem_pend_common(struct os_sem *sem, os_time_t timeout,
+                   struct hal_timer *wakeup, uint32_t deadline)
 {
     os_sr_t sr;
     int sched;
@@ -177,6 +184,9 @@ os_sem_pend(struct os_sem *sem, os_time_t timeout)
         /* We will put this task to sleep */
         sched = 1;
         os_sched_sleep(current, timeout);
+        if (wakeup != NULL) {
+            os_cputime_timer_start(wakeup, deadline);
+        }
     }
 
     OS_EXIT_CRITICAL(sr);
@@ -198,3 +208,67 @@ done:
     os_trace_api_ret_u32(OS_TRACE_ID_SEM_PEND, (uint32_t)ret);
     return ret;
 }
+
+os_error_t
+os_sem_pend(struct os_sem *sem, os_time_t timeout)
+{
+    return os_sem_pend_common(sem, timeout, NULL, 0);
+}
+
+os_error_t
+os_sem_pend_until(struct os_sem *sem, uint64_t deadline)
+{
+    uint64_t now;
+    os_time_t ticks;
+    os_error_t ret;
+
+    /* Long waits are split into several pends of at most INT32_MAX ticks. */
+    do {
+        now = os_time_get64();
+        if (deadline <= now) {
+            ticks = 0;
+        } else {
+            ticks = min(deadline - now, INT32_MAX);
+        }
+
+        ret = os_sem_pend(sem, ticks);
+    } while (ret == OS_TIMEOUT && ticks != 0);
+
+    return ret;
+}
+
+os_error_t
+os_sem_pend_usecs(struct os_sem *sem, uint32_t usecs)
+{
+    struct hal_timer timer;
+    uint32_t start;
+    uint32_t ticks;
+    os_time_t osticks;
+    os_error_t ret;
+
+    if (usecs == 0) {
+        return os_sem_pend_common(sem, 0, NULL, 0);
+    }
+
+    start = os_cputime_get32();
+    ticks = os_cputime_usecs_to_ticks(usecs);
+
+    /* Wait out most of a long timeout on the OS tick, a chunk at a time. */
+    while ((osticks = os_cputime_ostime_left(start, ticks)) > 0) {
+        ret = os_sem_pend_common(sem, osticks, NULL, 0);
+        if (ret != OS_TIMEOUT) {
+            return ret;
+        }
+    }
+
+    if (os_cputime_get32() - start >= ticks) {
+        return os_sem_pend_common(sem, 0, NULL, 0);
+    }
+
+    os_cputime_timer_init(&timer, os_cputime_task_wakeup,
+                          os_sched_get_current_task());
+    ret = os_sem_pend_common(sem, OS_TIMEOUT_NEVER, &timer, start + ticks);
+    os_cputime_timer_stop(&timer);
+
+    return ret;
+}
@@ -0,0 +1,240 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include "os/mynewt.h"
+#include "os_priv.h"
+
+#if MYNEWT_VAL(OS_STACK_HWM)
+#if MYNEWT_VAL(OS_STACK_HWM_STATS)
+#include "stats/stats.h"
+#endif
+
+/*
+ * Incremental stack high-water tracking.
+ *
+ * The idle task calls os_stack_hwm_scan() once per loop.  Each call checks at
+ * most OS_STACK_HWM_SCAN_WORDS words of one task's stack for the fill pattern,
+ * walking up from the bottom of the stack towards the deepest point already
+ * known to be used.  When the walk hits a used word, or reaches that point,
+ * the scanner records the result and moves on to the next task.  A full pass
+ * over all tasks therefore costs the same as os_task_info_get_next() would,
+ * but is spread over many short critical sections.
+ */
+
+static struct os_task *os_stack_hwm_task;
+static os_stack_t *os_stack_hwm_pos;
+static os_stack_hwm_fn *os_stack_hwm_cb;
+
+#if MYNEWT_VAL(OS_STACK_HWM_STATS)
+STATS_SECT_START(os_stack_stats)
+    STATS_SECT_ENTRY(size)
+    STATS_SECT_ENTRY(hwm)
+STATS_SECT_END
+
+STATS_NAME_START(os_stack_stats)
+    STATS_NAME(os_stack_stats, size)
+    STATS_NAME(os_stack_stats, hwm)
+STATS_NAME_END(os_stack_stats)
+
+/*
+ * Per task stack statistics.  A task is given a free slot the first time the
+ * scanner finishes with it and keeps it until it is removed or the OS is
+ * restarted.  While all OS_STACK_HWM_STATS_TASKS slots are taken, further
+ * tasks are not published.
+ */
+static STATS_SECT_DECL(os_stack_stats)
+    os_stack_stats[MYNEWT_VAL(OS_STACK_HWM_STATS_TASKS)];
+static char os_stack_stats_names[MYNEWT_VAL(OS_STACK_HWM_STATS_TASKS)][16];
+/* Task published in each slot; NULL if the slot is free. */
+static struct os_task *
+    os_stack_stats_task[MYNEWT_VAL(OS_STACK_HWM_STATS_TASKS)];
+
+static void
+os_stack_hwm_stats_free(int slot)
+{
+    (void)stats_deregister(STATS_HDR(os_stack_stats[slot]));
+    os_stack_stats_task[slot] = NULL;
+}
+
+static void
+os_stack_hwm_stats_update(struct os_task *t)
+{
+    char name[sizeof os_stack_stats_names[0]];
+    int slot;
+    int rc;
+    int i;
+
+    snprintf(name, sizeof name, "stk_%s", t->t_name);
+
+    slot = -1;
+    for (i = 0; i < MYNEWT_VAL(OS_STACK_HWM_STATS_TASKS); i++) {
+        if (os_stack_stats_task[i] == t) {
+            if (!strcmp(os_stack_stats_names[i], name)) {
+                break;
+            }
+            /* The task structure was set up again under another name. */
+            os_stack_hwm_stats_free(i);
+        }
+        if (os_stack_stats_task[i] == NULL && slot < 0) {
+            slot = i;
+        }
+    }
+
+    if (i < MYNEWT_VAL(OS_STACK_HWM_STATS_TASKS)) {
+        slot = i;
+    } else {
+        if (slot < 0) {
+            return;
+        }
+
+        strcpy(os_stack_stats_names[slot], name);
+        rc = stats_init_and_reg(STATS_HDR(os_stack_stats[slot]),
+                                STATS_SIZE_INIT_PARMS(os_stack_stats[slot],
+                                                      STATS_SIZE_32),
+                                STATS_NAME_INIT_PARMS(os_stack_stats),
+                                os_stack_stats_names[slot]);
+        if (rc != 0) {
+            /* Another section already has this name. */
+            return;
+        }
+        os_stack_stats_task[slot] = t;
+    }
+
+    /* Values are in os_stack_t units. */
+    STATS_CLEAR(os_stack_stats[slot], size);
+    STATS_INCN(os_stack_stats[slot], size, t->t_stacksize);
+    STATS_CLEAR(os_stack_stats[slot], hwm);
+    STATS_INCN(os_stack_stats[slot], hwm, t->t_stack_hwm);
+}
+#endif
+
+void
+os_stack_hwm_set_cb(os_stack_hwm_fn *cb)
+{
+    os_stack_hwm_cb = cb;
+}
+
+void
+os_stack_hwm_task_removed(struct os_task *t)
+{
+#if MYNEWT_VAL(OS_STACK_HWM_STATS)
+    int i;
+
+    for (i = 0; i < MYNEWT_VAL(OS_STACK_HWM_STATS_TASKS); i++) {
+        if (os_stack_stats_task[i] == t) {
+            os_stack_hwm_stats_free(i);
+        }
+    }
+#endif
+
+    if (os_stack_hwm_task == t) {
+        os_stack_hwm_task = NULL;
+    }
+}
+
+void
+os_stack_hwm_reset(void)
+{
+#if MYNEWT_VAL(OS_STACK_HWM_STATS)
+    int i;
+
+    /* The tasks of the previous run are gone; unpublish them. */
+    for (i = 0; i < MYNEWT_VAL(OS_STACK_HWM_STATS_TASKS); i++) {
+        if (os_stack_stats_task[i] != NULL) {
+            os_stack_hwm_stats_free(i);
+        }
+    }
+#endif
+
+    os_stack_hwm_task = NULL;
+}
+
+void
+os_stack_hwm_scan(void)
+{
+    struct os_task *report;
+    struct os_task *t;
+    os_stack_t *limit;
+    os_stack_t *pos;
+    int done;
+    int n;
+    os_sr_t sr;
+
+    report = NULL;
+
+    OS_ENTER_CRITICAL(sr);
+
+    t = os_stack_hwm_task;
+    if (t == NULL) {
+        t = STAILQ_FIRST(&g_os_task_list);
+        if (t == NULL) {
+            OS_EXIT_CRITICAL(sr);
+            return;
+        }
+        os_stack_hwm_task = t;
+        os_stack_hwm_pos = t->t_stacktop - t->t_stacksize;
+    }
+
+    /* Everything from 'limit' up is already known to have been used. */
+    limit = t->t_stacktop - t->t_stack_hwm;
+    pos = os_stack_hwm_pos;
+    done = 0;
+    for (n = 0; n < MYNEWT_VAL(OS_STACK_HWM_SCAN_WORDS); n++) {
+        if (pos >= limit) {
+            done = 1;
+            break;
+        }
+        if (*pos != OS_STACK_PATTERN) {
+            t->t_stack_hwm = t->t_stacktop - pos;
+            done = 1;
+            break;
+        }
+        pos++;
+    }
+    os_stack_hwm_pos = pos;
+
+    if (done) {
+        if (!(t->t_flags & OS_TASK_FLAG_STACK_HWM) &&
+            (uint32_t)t->t_stack_hwm * 100 >=
+            (uint32_t)t->t_stacksize * MYNEWT_VAL(OS_STACK_HWM_THRESH)) {
+
+            t->t_flags |= OS_TASK_FLAG_STACK_HWM;
+            report = t;
+        }
+#if MYNEWT_VAL(OS_STACK_HWM_STATS)
+        os_stack_hwm_stats_update(t);
+#endif
+
+        os_stack_hwm_task = STAILQ_NEXT(t, t_os_task_list);
+        if (os_stack_hwm_task != NULL) {
+            os_stack_hwm_pos = os_stack_hwm_task->t_stacktop -
+                               os_stack_hwm_task->t_stacksize;
+        }
+    }
+
+    OS_EXIT_CRITICAL(sr);
+
+    if (report != NULL && os_stack_hwm_cb != NULL) {
+        os_stack_hwm_cb(report, report->t_stack_hwm, report->t_stacksize);
+    }
+}
+#endif
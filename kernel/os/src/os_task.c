@@ -164,17 +164,35 @@ os_task_remove(struct os_task *t)
 
     OS_ENTER_CRITICAL(sr);
     rc = os_sched_remove(t);
+#if MYNEWT_VAL(OS_STACK_HWM)
+    os_stack_hwm_task_removed(t);
+#endif
     OS_EXIT_CRITICAL(sr);
     return rc;
 }
 
 
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+void
+os_task_set_slack(struct os_task *t, os_time_t slack)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    t->t_slack = slack;
+    OS_EXIT_CRITICAL(sr);
+}
+#endif
+
 struct os_task *
 os_task_info_get_next(const struct os_task *prev, struct os_task_info *oti)
 {
     struct os_task *next;
     os_stack_t *top;
     os_stack_t *bottom;
+#if MYNEWT_VAL(OS_TASK_PROF)
+    os_sr_t sr;
+#endif
 
     if (prev != NULL) {
         next = STAILQ_NEXT(prev, t_os_task_list);
@@ -210,6 +228,11 @@ os_task_info_get_next(const struct os_task *prev, struct os_task_info *oti)
     oti->oti_next_checkin = next->t_sanity_check.sc_checkin_last +
         next->t_sanity_check.sc_checkin_itvl;
     strncpy(oti->oti_name, next->t_name, sizeof(oti->oti_name));
+#if MYNEWT_VAL(OS_TASK_PROF)
+    OS_ENTER_CRITICAL(sr);
+    oti->oti_prof = next->t_prof;
+    OS_EXIT_CRITICAL(sr);
+#endif
 
     return (next);
 }
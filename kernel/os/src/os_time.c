@@ -26,6 +26,25 @@ CTASSERT(sizeof(os_time_t) == 4);
 
 os_time_t g_os_time;
 
+/*
+ * 64-bit time base.  The low 32 bits of the tick count are g_os_time itself;
+ * os_time_hi counts its wraps.  The microsecond counter is advanced
+ * incrementally, with the sub-microsecond part kept in os_time_usec_rem (in
+ * units of 1/OS_TICKS_PER_SEC usec), so no 64-bit division is needed.
+ *
+ * Both are only written with interrupts disabled, by the tick handler.
+ * os_time_seq is odd while an update is in progress; readers retry if it was
+ * odd or changed while they were reading.  The compiler barriers keep the
+ * reads and writes of the time base between the two accesses of
+ * os_time_seq.
+ */
+static volatile uint32_t os_time_hi;
+static volatile uint32_t os_time_seq;
+static volatile uint64_t os_time_usec;
+static uint32_t os_time_usec_rem;
+
+#define OS_TIME_BARRIER()   __asm__ volatile("" ::: "memory")
+
 static STAILQ_HEAD(, os_time_change_listener) os_time_change_listeners =
     STAILQ_HEAD_INITIALIZER(os_time_change_listeners);
 
@@ -56,6 +75,70 @@ os_time_get(void)
     return (g_os_time);
 }
 
+uint64_t
+os_time_get64(void)
+{
+    uint32_t seq;
+    uint32_t hi;
+    uint32_t lo;
+
+    do {
+        seq = os_time_seq;
+        OS_TIME_BARRIER();
+        hi = os_time_hi;
+        lo = *(volatile os_time_t *)&g_os_time;
+        OS_TIME_BARRIER();
+    } while ((seq & 1) || seq != os_time_seq);
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+uint64_t
+os_time_get_usec64(void)
+{
+    uint64_t usec;
+    uint32_t seq;
+
+    do {
+        seq = os_time_seq;
+        OS_TIME_BARRIER();
+        usec = os_time_usec;
+        OS_TIME_BARRIER();
+    } while ((seq & 1) || seq != os_time_seq);
+
+    return usec;
+}
+
+/**
+ * Advances g_os_time and the 64-bit time base.  Must be called with
+ * interrupts disabled.
+ */
+static void
+os_time_count(int ticks)
+{
+    os_time_t prev_os_time;
+
+    os_time_seq++;
+    OS_TIME_BARRIER();
+
+    prev_os_time = g_os_time;
+    g_os_time += ticks;
+    if (g_os_time < prev_os_time) {
+        os_time_hi++;
+    }
+
+    /* Whole seconds first, so the remainder product stays in 32 bits. */
+    os_time_usec += (uint64_t)(ticks / OS_TICKS_PER_SEC) * 1000000;
+    ticks %= OS_TICKS_PER_SEC;
+    os_time_usec_rem += ticks * (1000000 % OS_TICKS_PER_SEC);
+    os_time_usec += ticks * (1000000 / OS_TICKS_PER_SEC) +
+                    os_time_usec_rem / OS_TICKS_PER_SEC;
+    os_time_usec_rem %= OS_TICKS_PER_SEC;
+
+    OS_TIME_BARRIER();
+    os_time_seq++;
+}
+
 #if MYNEWT_VAL(OS_SCHEDULING)
 static void
 os_time_tick(int ticks)
@@ -67,7 +150,7 @@ os_time_tick(int ticks)
 
     OS_ENTER_CRITICAL(sr);
     prev_os_time = g_os_time;
-    g_os_time += ticks;
+    os_time_count(ticks);
 
     /*
      * Update 'basetod' when 'g_os_time' crosses the 0x00000000 and
@@ -85,11 +168,15 @@ os_time_tick(int ticks)
 void
 os_time_advance(int ticks)
 {
+    os_sr_t sr;
+
     assert(ticks >= 0);
 
     if (ticks > 0) {
         if (!os_started()) {
-            g_os_time += ticks;
+            OS_ENTER_CRITICAL(sr);
+            os_time_count(ticks);
+            OS_EXIT_CRITICAL(sr);
         } else {
             os_time_tick(ticks);
             os_callout_tick();
@@ -102,7 +189,11 @@ os_time_advance(int ticks)
 void
 os_time_advance(int ticks)
 {
-    g_os_time += ticks;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    os_time_count(ticks);
+    OS_EXIT_CRITICAL(sr);
 }
 #endif
 
@@ -308,11 +399,7 @@ os_get_uptime(struct os_timeval *tvp)
 int64_t
 os_get_uptime_usec(void)
 {
-  struct os_timeval tv;
-
-  os_get_uptime(&tv);
-
-  return (tv.tv_sec * 1000000 + tv.tv_usec);
+    return os_time_get_usec64();
 }
 
 int
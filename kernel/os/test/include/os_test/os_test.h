@@ -32,6 +32,26 @@ TEST_SUITE_DECL(os_mempool_test_suite);
 
 TEST_SUITE_DECL(os_time_test_suite);
 TEST_CASE_DECL(os_time_test_change);
+TEST_CASE_DECL(os_time_test_get64);
+TEST_CASE_DECL(os_time_test_sleep_order);
+TEST_CASE_DECL(os_time_test_sleep_usecs);
+
+TEST_SUITE_DECL(os_idle_test_suite);
+TEST_CASE_DECL(os_idle_test_work);
+TEST_CASE_DECL(os_idle_test_stack_hwm);
+TEST_CASE_DECL(os_idle_test_stack_hwm_stats);
+
+TEST_SUITE_DECL(os_dev_test_suite);
+TEST_CASE_DECL(os_dev_test_lookup);
+
+TEST_SUITE_DECL(os_sched_test_suite);
+TEST_CASE_DECL(os_sched_test_run_list);
+TEST_CASE_DECL(os_sched_test_prof);
+TEST_CASE_DECL(os_sched_test_slack);
+
+TEST_SUITE_DECL(os_heap_test_suite);
+TEST_CASE_DECL(os_heap_test_realloc);
+TEST_CASE_DECL(os_heap_test_coalesce);
 
 int os_test_all(void);
 
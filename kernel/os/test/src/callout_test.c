@@ -228,9 +228,13 @@ callout_task_stop_listen(void *arg)
 TEST_CASE_DECL(callout_test_speak)
 TEST_CASE_DECL(callout_test_stop)
 TEST_CASE_DECL(callout_test)
+TEST_CASE_DECL(callout_test_slack)
+TEST_CASE_DECL(callout_test_wheel)
 
 TEST_SUITE(os_callout_test_suite)
 {
+    callout_test_slack();
+    callout_test_wheel();
     callout_test();
     callout_test_stop();
     callout_test_speak();
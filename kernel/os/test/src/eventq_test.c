@@ -71,11 +71,19 @@ os_stack_t eventq_task_stack_poll_single_s[POLL_STACK_SIZE];
 struct os_task eventq_task_poll_single_r;
 os_stack_t eventq_task_stack_poll_single_r[POLL_STACK_SIZE];
 
+/* Define the task stack for the eventq_task_set_receive */
+struct os_task eventq_task_set_r;
+os_stack_t eventq_task_stack_set_r[POLL_STACK_SIZE];
+
 TEST_CASE_DECL(event_test_sr)
 TEST_CASE_DECL(event_test_poll_sr)
 TEST_CASE_DECL(event_test_poll_timeout_sr)
 TEST_CASE_DECL(event_test_poll_single_sr)
 TEST_CASE_DECL(event_test_poll_0timo)
+TEST_CASE_DECL(event_test_prio)
+TEST_CASE_DECL(event_test_prio_batch)
+TEST_CASE_DECL(event_test_set)
+TEST_CASE_DECL(event_test_set_wakeup)
 
 /* This is the task function  to send data */
 void
@@ -259,4 +267,8 @@ TEST_SUITE(os_eventq_test_suite)
     event_test_poll_timeout_sr();
     event_test_poll_single_sr();
     event_test_poll_0timo();
+    event_test_prio();
+    event_test_prio_batch();
+    event_test_set();
+    event_test_set_wakeup();
 }
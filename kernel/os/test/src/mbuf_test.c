@@ -79,9 +79,12 @@ os_mbuf_test_misc_assert_sane(struct os_mbuf *om, void *data,
             TEST_ASSERT(om->om_pkthdr_len == pkthdr_len);
         }
 
-        data_min = om->om_databuf + om->om_pkthdr_len;
-        data_max = om->om_databuf + om->om_omp->omp_databuf_len - om->om_len;
-        TEST_ASSERT(om->om_data >= data_min && om->om_data <= data_max);
+        if (!OS_MBUF_IS_EXT(om)) {
+            data_min = om->om_databuf + om->om_pkthdr_len;
+            data_max = om->om_databuf + om->om_omp->omp_databuf_len -
+                       om->om_len;
+            TEST_ASSERT(om->om_data >= data_min && om->om_data <= data_max);
+        }
 
         if (data != NULL) {
             TEST_ASSERT(memcmp(om->om_data, data + totlen, om->om_len) == 0);
@@ -102,6 +105,8 @@ TEST_CASE_DECL(os_mbuf_test_extend)
 TEST_CASE_DECL(os_mbuf_test_adj)
 TEST_CASE_DECL(os_mbuf_test_get_pkthdr)
 TEST_CASE_DECL(os_mbuf_test_widen)
+TEST_CASE_DECL(os_mbuf_test_ext)
+TEST_CASE_DECL(os_mbuf_test_msys)
 
 TEST_SUITE(os_mbuf_test_suite)
 {
@@ -113,4 +118,6 @@ TEST_SUITE(os_mbuf_test_suite)
     os_mbuf_test_adj();
     os_mbuf_test_get_pkthdr();
     os_mbuf_test_widen();
+    os_mbuf_test_ext();
+    os_mbuf_test_msys();
 }
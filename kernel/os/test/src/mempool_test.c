@@ -46,6 +46,9 @@ mempool_test_get_pool_size(int num_blocks, int block_size)
 {
     int mem_pool_size;
 
+    /* Guard word and owner record, if configured. */
+    block_size += OS_MEMPOOL_GUARD_SZ + OS_MEMPOOL_TRACE_SZ;
+
 #if OS_CFG_ALIGNMENT == OS_CFG_ALIGN_4
     mem_pool_size = (num_blocks * ((block_size + 3)/4) * sizeof(os_membuf_t));
 #else
@@ -58,6 +61,14 @@ mempool_test_get_pool_size(int num_blocks, int block_size)
 TEST_CASE_DECL(os_mempool_test_case)
 TEST_CASE_DECL(os_mempool_test_ext_basic)
 TEST_CASE_DECL(os_mempool_test_ext_nested)
+TEST_CASE_DECL(os_mempool_test_trace)
+#if MYNEWT_VAL(OS_MEMPOOL_POISON)
+TEST_CASE_DECL(os_mempool_test_check_sample)
+#endif
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+TEST_CASE_DECL(os_mempool_test_sweep)
+#endif
+TEST_CASE_DECL(os_mempool_test_concurrent)
 
 TEST_SUITE(os_mempool_test_suite)
 {
@@ -69,7 +80,16 @@ TEST_SUITE(os_mempool_test_suite)
     os_mempool_test_case();
     os_mempool_test_ext_basic();
     os_mempool_test_ext_nested();
+    os_mempool_test_trace();
+#if MYNEWT_VAL(OS_MEMPOOL_POISON)
+    os_mempool_test_check_sample();
+#endif
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+    os_mempool_test_sweep();
+#endif
+    os_mempool_test_concurrent();
 
+    os_mempool_unregister(&g_TstMempool);
     free(TstMembuf);
     TstMembufSz = 0;
     TstMembuf = NULL;
@@ -306,13 +306,104 @@ mutex_task4_handler(void *arg)
     }
 }
 
+/*
+ * Chained priority inheritance: task3 owns mutex2, task2 owns mutex1 and
+ * waits for mutex2, task1 waits for mutex1.  Task3 must run at task1's
+ * priority until it releases mutex2.
+ */
+void
+mutex_test_chain_task1_handler(void *arg)
+{
+    os_error_t err;
+
+    os_test_task1 = os_sched_get_current_task();
+
+    os_time_delay(OS_TICKS_PER_SEC / 10);
+
+    err = os_mutex_pend(&g_mutex1, OS_TICKS_PER_SEC);
+    TEST_ASSERT(err == OS_OK, "err=%d", err);
+    TEST_ASSERT(g_task3_val == 1);
+    TEST_ASSERT(g_task2_val == 1);
+
+    err = os_mutex_release(&g_mutex1);
+    TEST_ASSERT(err == OS_OK);
+
+#if MYNEWT_VAL(OS_MUTEX_STATS)
+    TEST_ASSERT(g_mutex1.mu_acq_cnt == 2);
+    TEST_ASSERT(g_mutex1.mu_pend_cnt == 1);
+    TEST_ASSERT(g_mutex2.mu_acq_cnt == 2);
+    TEST_ASSERT(g_mutex2.mu_pend_cnt == 1);
+    TEST_ASSERT(g_mutex2.mu_max_hold > 0);
+#endif
+
+    os_test_restart();
+}
+
+void
+mutex_test_chain_task2_handler(void *arg)
+{
+    os_error_t err;
+
+    os_test_task2 = os_sched_get_current_task();
+
+    os_time_delay(OS_TICKS_PER_SEC / 20);
+
+    err = os_mutex_pend(&g_mutex1, 0);
+    TEST_ASSERT(err == OS_OK, "err=%d", err);
+
+    err = os_mutex_pend(&g_mutex2, OS_TICKS_PER_SEC);
+    TEST_ASSERT(err == OS_OK, "err=%d", err);
+    TEST_ASSERT(g_task3_val == 1);
+    g_task2_val = 1;
+
+    os_mutex_release(&g_mutex2);
+    os_mutex_release(&g_mutex1);
+    TEST_ASSERT(os_test_task2->t_prio == TASK2_PRIO);
+
+    while (1) {
+        os_time_delay(OS_TICKS_PER_SEC);
+    }
+}
+
+void
+mutex_test_chain_task3_handler(void *arg)
+{
+    os_error_t err;
+
+    os_test_task3 = os_sched_get_current_task();
+
+    err = os_mutex_pend(&g_mutex2, 0);
+    TEST_ASSERT(err == OS_OK, "err=%d", err);
+
+    /* Let task2 and task1 block behind us. */
+    os_time_delay(OS_TICKS_PER_SEC / 5);
+
+#if MYNEWT_VAL(OS_MUTEX_PI_DEPTH) > 1
+    TEST_ASSERT(os_test_task3->t_prio == TASK1_PRIO,
+                "prio=%u", os_test_task3->t_prio);
+#else
+    TEST_ASSERT(os_test_task3->t_prio == TASK2_PRIO,
+                "prio=%u", os_test_task3->t_prio);
+#endif
+    g_task3_val = 1;
+
+    os_mutex_release(&g_mutex2);
+    TEST_ASSERT(os_test_task3->t_prio == TASK3_PRIO);
+
+    while (1) {
+        os_time_delay(OS_TICKS_PER_SEC);
+    }
+}
+
 TEST_CASE_DECL(os_mutex_test_basic)
 TEST_CASE_DECL(os_mutex_test_case_1)
 TEST_CASE_DECL(os_mutex_test_case_2)
+TEST_CASE_DECL(os_mutex_test_chain)
 
 TEST_SUITE(os_mutex_test_suite)
 {
     os_mutex_test_basic();
     os_mutex_test_case_1();
     os_mutex_test_case_2();
+    os_mutex_test_chain();
 }
@@ -45,6 +45,9 @@ void mutex_test2_task1_handler(void *arg);
 void mutex_task2_handler(void *arg);
 void mutex_task3_handler(void *arg);
 void mutex_task4_handler(void *arg);
+void mutex_test_chain_task1_handler(void *arg);
+void mutex_test_chain_task2_handler(void *arg);
+void mutex_test_chain_task3_handler(void *arg);
 
 #ifdef __cplusplus
 }
@@ -61,18 +61,27 @@ os_test_restart(void)
    tu_restart();
 }
 
+static const struct ts_suite os_test_suites[] = {
+    TEST_SUITE_ENTRY(os_mempool_test_suite),
+    TEST_SUITE_ENTRY(os_mutex_test_suite),
+    TEST_SUITE_ENTRY(os_sem_test_suite),
+    TEST_SUITE_ENTRY(os_mbuf_test_suite),
+    TEST_SUITE_ENTRY(os_eventq_test_suite),
+    TEST_SUITE_ENTRY(os_callout_test_suite),
+    TEST_SUITE_ENTRY(os_time_test_suite),
+    TEST_SUITE_ENTRY(os_idle_test_suite),
+    TEST_SUITE_ENTRY(os_dev_test_suite),
+    TEST_SUITE_ENTRY(os_sched_test_suite),
+    TEST_SUITE_ENTRY(os_heap_test_suite),
+};
+
 int
 os_test_all(void)
 {
-    os_mempool_test_suite();
-    os_mutex_test_suite();
-    os_sem_test_suite();
-    os_mbuf_test_suite();
-    os_eventq_test_suite();
-    os_callout_test_suite();
-    os_time_test_suite();
-
-    return tu_case_failed;
+    return tu_suite_run_parallel(os_test_suites,
+                                 sizeof os_test_suites /
+                                 sizeof os_test_suites[0],
+                                 MYNEWT_VAL(TESTUTIL_PARALLEL_JOBS));
 }
 
 int
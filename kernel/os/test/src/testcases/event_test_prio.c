@@ -0,0 +1,121 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_EVENTQ_PRIOS) > 1
+#define EVENT_TEST_PRIO_CNT     (6)
+
+static struct os_event *event_test_prio_order[EVENT_TEST_PRIO_CNT];
+static int event_test_prio_ran;
+
+static void
+event_test_prio_cb(struct os_event *ev)
+{
+    event_test_prio_order[event_test_prio_ran++] = ev;
+}
+
+static void
+event_test_prio_init(struct os_event *ev, uint8_t prio)
+{
+    memset(ev, 0, sizeof *ev);
+    ev->ev_prio = prio;
+    ev->ev_cb = event_test_prio_cb;
+}
+#endif
+
+/**
+ * Tests that events are taken off a queue by priority level, FIFO within a
+ * level.
+ * Does not involve the scheduler, so it runs without starting the OS.
+ */
+TEST_CASE(event_test_prio)
+{
+#if MYNEWT_VAL(OS_EVENTQ_PRIOS) > 1
+    struct os_event ev[EVENT_TEST_PRIO_CNT];
+    struct os_event *evp;
+
+    os_eventq_init(&my_eventq);
+
+    /* Levels 2, 0, 1, 0, last and out of range (clamped to the last). */
+    event_test_prio_init(&ev[0], 2);
+    event_test_prio_init(&ev[1], 0);
+    event_test_prio_init(&ev[2], 1);
+    event_test_prio_init(&ev[3], 0);
+    event_test_prio_init(&ev[4], MYNEWT_VAL(OS_EVENTQ_PRIOS) - 1);
+    event_test_prio_init(&ev[5], UINT8_MAX);
+
+    os_eventq_put(&my_eventq, &ev[0]);
+    os_eventq_put(&my_eventq, &ev[1]);
+    os_eventq_put(&my_eventq, &ev[2]);
+    os_eventq_put(&my_eventq, &ev[3]);
+    os_eventq_put(&my_eventq, &ev[4]);
+    os_eventq_put(&my_eventq, &ev[5]);
+
+    /* Removing the only event of a level empties that level. */
+    os_eventq_remove(&my_eventq, &ev[2]);
+    TEST_ASSERT(!OS_EVENT_QUEUED(&ev[2]));
+
+    TEST_ASSERT(os_eventq_get_no_wait(&my_eventq) == &ev[1]);
+    TEST_ASSERT(os_eventq_get_no_wait(&my_eventq) == &ev[3]);
+    TEST_ASSERT(os_eventq_get_no_wait(&my_eventq) == &ev[0]);
+    TEST_ASSERT(os_eventq_get_no_wait(&my_eventq) == &ev[4]);
+    TEST_ASSERT(os_eventq_get_no_wait(&my_eventq) == &ev[5]);
+
+    evp = os_eventq_get_no_wait(&my_eventq);
+    TEST_ASSERT(evp == NULL);
+#endif
+}
+
+/**
+ * Tests that os_eventq_run_batch() keeps the priority order and stops after
+ * max events.
+ */
+TEST_CASE_TASK(event_test_prio_batch)
+{
+#if MYNEWT_VAL(OS_EVENTQ_PRIOS) > 1
+    struct os_event ev[4];
+    int rc;
+
+    os_eventq_init(&my_eventq);
+    event_test_prio_ran = 0;
+
+    event_test_prio_init(&ev[0], MYNEWT_VAL(OS_EVENTQ_PRIOS) - 1);
+    event_test_prio_init(&ev[1], 2);
+    event_test_prio_init(&ev[2], 1);
+    event_test_prio_init(&ev[3], 0);
+
+    /* The urgent event put behind the less urgent ones is dispatched first. */
+    os_eventq_put(&my_eventq, &ev[0]);
+    os_eventq_put(&my_eventq, &ev[1]);
+    os_eventq_put(&my_eventq, &ev[2]);
+    os_eventq_put(&my_eventq, &ev[3]);
+
+    rc = os_eventq_run_batch(&my_eventq, 3);
+    TEST_ASSERT(rc == 3);
+    TEST_ASSERT(event_test_prio_order[0] == &ev[3]);
+    TEST_ASSERT(event_test_prio_order[1] == &ev[2]);
+    TEST_ASSERT(event_test_prio_order[2] == &ev[1]);
+    TEST_ASSERT(OS_EVENT_QUEUED(&ev[0]));
+
+    rc = os_eventq_run_batch(&my_eventq, 4);
+    TEST_ASSERT(rc == 1);
+    TEST_ASSERT(event_test_prio_order[3] == &ev[0]);
+    TEST_ASSERT(os_eventq_get_no_wait(&my_eventq) == NULL);
+#endif
+}
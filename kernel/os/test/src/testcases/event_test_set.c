@@ -0,0 +1,156 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+static struct os_eventq_set event_test_set_s;
+static struct os_eventq *event_test_set_last_evq;
+static struct os_event *event_test_set_last_ev;
+static volatile int event_test_set_woken;
+
+/* Waits on the set forever, recording what each wakeup returned. */
+void
+eventq_task_set_receive(void *arg)
+{
+    struct os_eventq *evq;
+    struct os_event *ev;
+
+    while (1) {
+        ev = os_eventq_set_poll(&event_test_set_s, OS_WAIT_FOREVER, &evq);
+        event_test_set_last_ev = ev;
+        event_test_set_last_evq = evq;
+        event_test_set_woken++;
+    }
+}
+#endif
+
+/**
+ * Tests adding and removing set members and polling a set with a timeout of
+ * 0.  Does not involve the scheduler, so it runs without starting the OS.
+ */
+TEST_CASE(event_test_set)
+{
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+    struct os_eventq_set set;
+    struct os_eventq *evq;
+    struct os_event ev[2];
+    int rc;
+    int i;
+
+    os_eventq_set_init(&set);
+    os_eventq_init(&my_eventq);
+    for (i = 0; i < SIZE_MULTI_EVENT; i++) {
+        os_eventq_init(&multi_eventq[i]);
+    }
+    memset(ev, 0, sizeof ev);
+
+    TEST_ASSERT(os_eventq_set_poll(&set, 0, NULL) == NULL);
+
+    for (i = 0; i < SIZE_MULTI_EVENT; i++) {
+        rc = os_eventq_set_add(&set, &multi_eventq[i]);
+        TEST_ASSERT(rc == 0);
+    }
+
+    /* A queue can only be added once, and the set has a fixed size. */
+    rc = os_eventq_set_add(&set, &multi_eventq[0]);
+    TEST_ASSERT(rc == OS_EINVAL);
+    rc = os_eventq_set_add(&set, &my_eventq);
+    TEST_ASSERT(rc == OS_ENOMEM);
+    rc = os_eventq_set_remove(&set, &my_eventq);
+    TEST_ASSERT(rc == OS_EINVAL);
+
+    /* The event comes from whichever member it was put on. */
+    os_eventq_put(&multi_eventq[2], &ev[0]);
+    TEST_ASSERT(os_eventq_set_poll(&set, 0, &evq) == &ev[0]);
+    TEST_ASSERT(evq == &multi_eventq[2]);
+    TEST_ASSERT(os_eventq_set_poll(&set, 0, NULL) == NULL);
+
+    /* Removing a ready queue clears it from the set but keeps its event. */
+    os_eventq_put(&multi_eventq[1], &ev[0]);
+    rc = os_eventq_set_remove(&set, &multi_eventq[1]);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(os_eventq_set_poll(&set, 0, NULL) == NULL);
+    TEST_ASSERT(OS_EVENT_QUEUED(&ev[0]));
+
+    /* Its slot is free again, and re-adding makes it ready right away. */
+    rc = os_eventq_set_add(&set, &my_eventq);
+    TEST_ASSERT(rc == 0);
+    rc = os_eventq_set_remove(&set, &my_eventq);
+    TEST_ASSERT(rc == 0);
+    rc = os_eventq_set_add(&set, &multi_eventq[1]);
+    TEST_ASSERT(rc == 0);
+
+    /* A queue emptied directly is no longer reported as ready. */
+    os_eventq_put(&multi_eventq[3], &ev[1]);
+    TEST_ASSERT(os_eventq_get_no_wait(&multi_eventq[3]) == &ev[1]);
+
+    TEST_ASSERT(os_eventq_set_poll(&set, 0, &evq) == &ev[0]);
+    TEST_ASSERT(evq == &multi_eventq[1]);
+    TEST_ASSERT(os_eventq_set_poll(&set, 0, NULL) == NULL);
+#endif
+}
+
+/**
+ * Tests that a task waiting on a set is woken by a put on any member queue,
+ * and no longer by a put on a queue that was removed from the set.
+ */
+TEST_CASE_TASK(event_test_set_wakeup)
+{
+#if MYNEWT_VAL(OS_EVENTQ_SET)
+    struct os_event ev[SIZE_MULTI_EVENT];
+    int rc;
+    int i;
+
+    os_eventq_set_init(&event_test_set_s);
+    for (i = 0; i < SIZE_MULTI_EVENT; i++) {
+        os_eventq_init(&multi_eventq[i]);
+        rc = os_eventq_set_add(&event_test_set_s, &multi_eventq[i]);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+    memset(ev, 0, sizeof ev);
+    event_test_set_woken = 0;
+
+    /* The receiver has a higher priority, so it runs and blocks at once. */
+    os_task_init(&eventq_task_set_r, "eventq_task_set_r",
+                 eventq_task_set_receive, NULL, RECEIVE_TASK_SET_PRIO,
+                 OS_WAIT_FOREVER, eventq_task_stack_set_r, POLL_STACK_SIZE);
+    TEST_ASSERT(event_test_set_woken == 0);
+
+    /* Each put preempts this task and is picked up by the receiver. */
+    for (i = SIZE_MULTI_EVENT - 1; i >= 0; i--) {
+        os_eventq_put(&multi_eventq[i], &ev[i]);
+        TEST_ASSERT(event_test_set_woken == SIZE_MULTI_EVENT - i);
+        TEST_ASSERT(event_test_set_last_ev == &ev[i]);
+        TEST_ASSERT(event_test_set_last_evq == &multi_eventq[i]);
+    }
+
+    /* A removed queue no longer wakes the receiver. */
+    rc = os_eventq_set_remove(&event_test_set_s, &multi_eventq[0]);
+    TEST_ASSERT(rc == 0);
+    os_eventq_put(&multi_eventq[0], &ev[0]);
+    os_time_delay(1);
+    TEST_ASSERT(event_test_set_woken == SIZE_MULTI_EVENT);
+    TEST_ASSERT(os_eventq_get_no_wait(&multi_eventq[0]) == &ev[0]);
+
+    /* The remaining members still do. */
+    os_eventq_put(&multi_eventq[1], &ev[1]);
+    TEST_ASSERT(event_test_set_woken == SIZE_MULTI_EVENT + 1);
+    TEST_ASSERT(event_test_set_last_evq == &multi_eventq[1]);
+#endif
+}
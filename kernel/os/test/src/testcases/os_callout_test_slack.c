@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+static void
+callout_slack_cb(struct os_event *ev)
+{
+}
+
+static void
+callout_slack_check(os_time_t exact, os_time_t latest)
+{
+    os_time_t now;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    now = os_time_get();
+    TEST_ASSERT(os_callout_wakeup_ticks(now) == exact);
+    TEST_ASSERT(os_callout_wakeup_slack_ticks(now) == latest);
+    OS_EXIT_CRITICAL(sr);
+}
+#endif
+
+/* Test case to test merging of callout wakeups within their slack */
+TEST_CASE(callout_test_slack)
+{
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    struct os_callout c1;
+    struct os_callout c2;
+    struct os_callout c3;
+
+    os_callout_init(&c1, NULL, callout_slack_cb, NULL);
+    os_callout_init(&c2, NULL, callout_slack_cb, NULL);
+    os_callout_init(&c3, NULL, callout_slack_cb, NULL);
+
+    callout_slack_check(OS_TIMEOUT_NEVER, OS_TIMEOUT_NEVER);
+
+    /* Windows [10, 30] and [15, 20] overlap; wake up once at 20. */
+    os_callout_set_slack(&c1, 20);
+    os_callout_set_slack(&c2, 5);
+    os_callout_reset(&c1, 10);
+    os_callout_reset(&c2, 15);
+    callout_slack_check(10, 20);
+
+    /* A callout without slack due earlier pulls the wakeup in. */
+    os_callout_reset(&c3, 18);
+    callout_slack_check(10, 18);
+    os_callout_stop(&c3);
+    callout_slack_check(10, 20);
+
+    /* Changing the slack of a pending callout takes effect. */
+    os_callout_set_slack(&c2, 30);
+    callout_slack_check(10, 30);
+    os_callout_stop(&c1);
+    callout_slack_check(15, 45);
+
+    os_callout_stop(&c2);
+    callout_slack_check(OS_TIMEOUT_NEVER, OS_TIMEOUT_NEVER);
+#endif
+}
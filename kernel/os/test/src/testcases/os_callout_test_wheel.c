@@ -0,0 +1,142 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+
+#define OCTW_SLOTS  MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+
+struct octw_entry {
+    struct os_callout oe_callout;
+    os_time_t oe_fired;
+    int oe_count;
+};
+
+/* All armed on the same tick; every deadline but moved's hashes to one slot. */
+static struct octw_entry octw_short;    /* start + 2 */
+static struct octw_entry octw_stopped;  /* start + SLOTS + 2, then stopped */
+static struct octw_entry octw_moved;    /* start + 2 * SLOTS + 2, then moved */
+static struct octw_entry octw_long;     /* start + 3 * SLOTS + 2 */
+
+static void
+octw_cb(struct os_event *ev)
+{
+    struct octw_entry *oe;
+
+    oe = ev->ev_arg;
+    oe->oe_fired = os_time_get();
+    oe->oe_count++;
+}
+
+static void
+octw_init(struct octw_entry *oe)
+{
+    oe->oe_fired = 0;
+    oe->oe_count = 0;
+    os_callout_init(&oe->oe_callout, NULL, octw_cb, oe);
+}
+
+static void
+octw_check_wakeup(os_time_t deadline)
+{
+    os_time_t now;
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    now = os_time_get();
+    TEST_ASSERT(os_callout_wakeup_ticks(now) == deadline - now);
+    OS_EXIT_CRITICAL(sr);
+}
+
+static void
+octw_delay_until(os_time_t when)
+{
+    os_time_t now;
+
+    now = os_time_get();
+    if (OS_TIME_TICK_LT(now, when)) {
+        os_time_delay(when - now);
+    }
+}
+#endif
+
+/**
+ * Tests the callout timing wheel: a callout due several rotations out shares
+ * its slot with earlier ones and must be skipped on each visit until its own
+ * revolution, and stopping or resetting a callout in a shared slot must
+ * leave its neighbours alone.
+ */
+TEST_CASE_TASK(callout_test_wheel)
+{
+#if MYNEWT_VAL(OS_CALLOUT_WHEEL_SLOTS)
+    os_time_t start;
+    os_sr_t sr;
+
+    octw_init(&octw_short);
+    octw_init(&octw_stopped);
+    octw_init(&octw_moved);
+    octw_init(&octw_long);
+
+    OS_ENTER_CRITICAL(sr);
+    start = os_time_get();
+    os_callout_reset(&octw_short.oe_callout, 2);
+    os_callout_reset(&octw_stopped.oe_callout, OCTW_SLOTS + 2);
+    os_callout_reset(&octw_moved.oe_callout, 2 * OCTW_SLOTS + 2);
+    os_callout_reset(&octw_long.oe_callout, 3 * OCTW_SLOTS + 2);
+
+    /* Take two callouts out of the shared slot; the others stay put. */
+    os_callout_stop(&octw_stopped.oe_callout);
+    os_callout_reset(&octw_moved.oe_callout, OCTW_SLOTS + 5);
+    OS_EXIT_CRITICAL(sr);
+
+    TEST_ASSERT(!os_callout_queued(&octw_stopped.oe_callout));
+    TEST_ASSERT(os_callout_queued(&octw_short.oe_callout));
+    TEST_ASSERT(os_callout_queued(&octw_moved.oe_callout));
+    TEST_ASSERT(os_callout_queued(&octw_long.oe_callout));
+    octw_check_wakeup(start + 2);
+
+    /* First visit of the shared slot: only the short callout is due. */
+    octw_delay_until(start + OCTW_SLOTS);
+    TEST_ASSERT(octw_short.oe_count == 1);
+    TEST_ASSERT(OS_TIME_TICK_GEQ(octw_short.oe_fired, start + 2));
+    TEST_ASSERT(octw_long.oe_count == 0);
+    TEST_ASSERT(octw_moved.oe_count == 0);
+    octw_check_wakeup(start + OCTW_SLOTS + 5);
+
+    /* The moved callout fires at its new time, not its old one. */
+    octw_delay_until(start + 2 * OCTW_SLOTS + 3);
+    TEST_ASSERT(octw_moved.oe_count == 1);
+    TEST_ASSERT(OS_TIME_TICK_GEQ(octw_moved.oe_fired,
+                                 start + OCTW_SLOTS + 5));
+    TEST_ASSERT(octw_long.oe_count == 0);
+    TEST_ASSERT(os_callout_queued(&octw_long.oe_callout));
+    octw_check_wakeup(start + 3 * OCTW_SLOTS + 2);
+
+    /* The long callout survived two earlier visits of its slot. */
+    octw_delay_until(start + 3 * OCTW_SLOTS + 3);
+    TEST_ASSERT(octw_long.oe_count == 1);
+    TEST_ASSERT(OS_TIME_TICK_GEQ(octw_long.oe_fired,
+                                 start + 3 * OCTW_SLOTS + 2));
+    TEST_ASSERT(!os_callout_queued(&octw_long.oe_callout));
+
+    TEST_ASSERT(octw_stopped.oe_count == 0);
+    TEST_ASSERT(octw_short.oe_count == 1);
+    TEST_ASSERT(octw_moved.oe_count == 1);
+#endif
+}
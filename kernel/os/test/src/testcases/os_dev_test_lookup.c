@@ -0,0 +1,136 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <stdio.h>
+#include "os/mynewt.h"
+#include "os_test_priv.h"
+
+#define OSTDL_NUM_DEVS  8
+/* A stage of its own, so that only the duplicates are initialized in it. */
+#define OSTDL_DUP_STAGE 200
+
+static struct os_dev ostdl_devs[OSTDL_NUM_DEVS];
+static char ostdl_names[OSTDL_NUM_DEVS][8];
+static struct os_dev ostdl_broken;
+static int ostdl_open_cnt;
+static struct os_dev ostdl_dups[2];
+static struct os_dev *ostdl_dup_order[2];
+static int ostdl_dup_cnt;
+
+static int
+ostdl_open(struct os_dev *dev, uint32_t timo, void *arg)
+{
+    ostdl_open_cnt++;
+    return 0;
+}
+
+static int
+ostdl_init(struct os_dev *dev, void *arg)
+{
+    OS_DEV_SETHANDLERS(dev, ostdl_open, NULL);
+    return 0;
+}
+
+/* Records the order os_dev_initialize_all() reaches the duplicates in. */
+static int
+ostdl_init_dup(struct os_dev *dev, void *arg)
+{
+    if (ostdl_dup_cnt < 2) {
+        ostdl_dup_order[ostdl_dup_cnt] = dev;
+    }
+    ostdl_dup_cnt++;
+    return 0;
+}
+
+static int
+ostdl_init_fail(struct os_dev *dev, void *arg)
+{
+    return OS_ERROR;
+}
+
+/**
+ * Tests os_dev_lookup() with more devices than OS_DEV_HASH_BUCKETS, so that
+ * buckets are shared, and with a duplicate name, and opening devices both by
+ * name and by handle.
+ */
+TEST_CASE_TASK(os_dev_test_lookup)
+{
+    struct os_dev *dev;
+    int rc;
+    int i;
+
+    for (i = 0; i < OSTDL_NUM_DEVS; i++) {
+        snprintf(ostdl_names[i], sizeof ostdl_names[i], "ostdl%d", i);
+        rc = os_dev_create(ostdl_devs + i, ostdl_names[i],
+                           OS_DEV_INIT_PRIMARY, OS_DEV_INIT_PRIO_DEFAULT,
+                           ostdl_init, NULL);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+    rc = os_dev_create(&ostdl_broken, "ostdl_broken", OS_DEV_INIT_PRIMARY,
+                       OS_DEV_INIT_PRIO_DEFAULT, ostdl_init_fail, NULL);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    for (i = 0; i < OSTDL_NUM_DEVS; i++) {
+        TEST_ASSERT(os_dev_lookup(ostdl_names[i]) == ostdl_devs + i,
+                    "lookup of %s", ostdl_names[i]);
+    }
+    TEST_ASSERT(os_dev_lookup("ostdl") == NULL);
+    TEST_ASSERT(os_dev_lookup("ostdl8") == NULL);
+    TEST_ASSERT(os_dev_open("ostdl8", 0, NULL) == NULL);
+
+    /* Opening by handle and by name share the reference count. */
+    ostdl_open_cnt = 0;
+    dev = os_dev_open_handle(ostdl_devs + 3, 0, NULL);
+    TEST_ASSERT_FATAL(dev == ostdl_devs + 3);
+    TEST_ASSERT(dev->od_flags & OS_DEV_F_STATUS_OPEN);
+    dev = os_dev_open(ostdl_names[3], 0, NULL);
+    TEST_ASSERT_FATAL(dev == ostdl_devs + 3);
+    TEST_ASSERT(dev->od_open_ref == 2);
+    TEST_ASSERT(ostdl_open_cnt == 2);
+
+    rc = os_dev_close(dev);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(dev->od_flags & OS_DEV_F_STATUS_OPEN);
+    rc = os_dev_close(dev);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(!(dev->od_flags & OS_DEV_F_STATUS_OPEN));
+
+    /* A device that failed to initialize is found but cannot be opened. */
+    TEST_ASSERT(os_dev_lookup("ostdl_broken") == &ostdl_broken);
+    TEST_ASSERT(os_dev_open_handle(&ostdl_broken, 0, NULL) == NULL);
+    TEST_ASSERT(os_dev_open("ostdl_broken", 0, NULL) == NULL);
+    TEST_ASSERT(ostdl_open_cnt == 2);
+
+    /*
+     * A duplicate name resolves to the device that comes first in the device
+     * list, as it does without the hash.  These priorities put the older
+     * device first, not the one most recently added.
+     */
+    rc = os_dev_create(ostdl_dups + 0, "ostdl_dup", OSTDL_DUP_STAGE,
+                       OS_DEV_INIT_PRIO_DEFAULT, ostdl_init_dup, NULL);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = os_dev_create(ostdl_dups + 1, "ostdl_dup", OSTDL_DUP_STAGE, 0,
+                       ostdl_init_dup, NULL);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    ostdl_dup_cnt = 0;
+    rc = os_dev_initialize_all(OSTDL_DUP_STAGE);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT_FATAL(ostdl_dup_cnt == 2);
+    TEST_ASSERT(os_dev_lookup("ostdl_dup") == ostdl_dup_order[0]);
+}
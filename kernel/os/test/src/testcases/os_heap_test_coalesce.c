@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+/**
+ * Tests that the heap grows when no free block is large enough, and that
+ * freeing physically adjacent blocks in any order merges them back into a
+ * single free block.
+ */
+TEST_CASE(os_heap_test_coalesce)
+{
+#if MYNEWT_VAL(OS_HEAP_TLSF)
+    struct os_heap_info info0;
+    struct os_heap_info info;
+    uint32_t largest;
+    size_t piece;
+    void *a;
+    void *b;
+    void *c;
+    void *p;
+
+    os_heap_info_get(&info0);
+
+    /*
+     * Each piece is larger than any block already free, so all three come
+     * out of the memory added below, one after the other.
+     */
+    piece = info0.ohi_largest_free + 64;
+
+    p = os_malloc(4 * piece);
+    TEST_ASSERT_FATAL(p != NULL);
+
+    os_heap_info_get(&info);
+    TEST_ASSERT(info.ohi_total >= info0.ohi_total + 4 * piece);
+    TEST_ASSERT(info.ohi_pools >= info0.ohi_pools);
+    TEST_ASSERT(info.ohi_pools >= 1);
+    TEST_ASSERT(info.ohi_fail_cnt == info0.ohi_fail_cnt);
+
+    os_free(p);
+    os_heap_info_get(&info);
+    TEST_ASSERT(info.ohi_used == info0.ohi_used);
+    TEST_ASSERT(info.ohi_largest_free >= 4 * piece);
+    largest = info.ohi_largest_free;
+
+    a = os_malloc(piece);
+    b = os_malloc(piece);
+    c = os_malloc(piece);
+    TEST_ASSERT_FATAL(a != NULL && b != NULL && c != NULL);
+    TEST_ASSERT((uint8_t *)b > (uint8_t *)a + piece);
+    TEST_ASSERT((uint8_t *)c > (uint8_t *)b + piece);
+
+    /* With the middle block still in use the free space stays split. */
+    os_free(a);
+    os_free(c);
+    os_heap_info_get(&info);
+    TEST_ASSERT(info.ohi_largest_free < largest);
+
+    /* Freeing it merges with both neighbours. */
+    os_free(b);
+    os_heap_info_get(&info);
+    TEST_ASSERT(info.ohi_largest_free == largest);
+    TEST_ASSERT(info.ohi_used == info0.ohi_used);
+    TEST_ASSERT(info.ohi_max_used >= info0.ohi_used + 3 * piece);
+#endif
+}
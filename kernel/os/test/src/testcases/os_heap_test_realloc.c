@@ -0,0 +1,84 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <string.h>
+#include "os_test_priv.h"
+
+/**
+ * Tests os_malloc(), os_realloc() and os_free() against the heap statistics:
+ * every byte handed out is accounted for and given back, realloc keeps the
+ * contents, and requests that cannot be met are counted as failures.
+ */
+TEST_CASE(os_heap_test_realloc)
+{
+#if MYNEWT_VAL(OS_HEAP_TLSF)
+    struct os_heap_info info0;
+    struct os_heap_info info;
+    uint8_t *p;
+    uint8_t *q;
+    int rc;
+    int i;
+
+    rc = os_heap_info_get(&info0);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(info0.ohi_free == info0.ohi_total - info0.ohi_used);
+
+    p = os_malloc(24);
+    TEST_ASSERT_FATAL(p != NULL);
+    TEST_ASSERT(((uintptr_t)p & 7) == 0);
+    for (i = 0; i < 24; i++) {
+        p[i] = i;
+    }
+
+    os_heap_info_get(&info);
+    TEST_ASSERT(info.ohi_used >= info0.ohi_used + 24);
+    TEST_ASSERT(info.ohi_max_used >= info.ohi_used);
+    TEST_ASSERT(info.ohi_alloc_cnt == info0.ohi_alloc_cnt + 1);
+    TEST_ASSERT(info.ohi_free == info.ohi_total - info.ohi_used);
+
+    /* Shrinking stays in place. */
+    q = os_realloc(p, 16);
+    TEST_ASSERT(q == p);
+
+    /* Growing moves the data along. */
+    q = os_realloc(p, 200);
+    TEST_ASSERT_FATAL(q != NULL);
+    for (i = 0; i < 24; i++) {
+        TEST_ASSERT(q[i] == i);
+    }
+
+    /* A NULL pointer allocates; a zero size frees. */
+    p = os_realloc(NULL, 32);
+    TEST_ASSERT_FATAL(p != NULL);
+    TEST_ASSERT(os_realloc(p, 0) == NULL);
+    os_free(q);
+
+    os_heap_info_get(&info);
+    TEST_ASSERT(info.ohi_used == info0.ohi_used);
+    TEST_ASSERT(info.ohi_alloc_cnt == info0.ohi_alloc_cnt + 3);
+    TEST_ASSERT(info.ohi_fail_cnt == info0.ohi_fail_cnt);
+
+    /* Nothing to allocate is not a failure; too much is. */
+    TEST_ASSERT(os_malloc(0) == NULL);
+    TEST_ASSERT(os_malloc((size_t)1 << 24) == NULL);
+
+    os_heap_info_get(&info);
+    TEST_ASSERT(info.ohi_used == info0.ohi_used);
+    TEST_ASSERT(info.ohi_fail_cnt == info0.ohi_fail_cnt + 1);
+#endif
+}
@@ -0,0 +1,147 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_STACK_HWM)
+#define OISH_STACK_SIZE     256
+#define OISH_SCANS          8192
+#define OISH_MAX_REPORTS    4
+
+static struct os_task oish_task1;
+static struct os_task oish_task2;
+static os_stack_t oish_stack1[OISH_STACK_SIZE];
+static os_stack_t oish_stack2[OISH_STACK_SIZE];
+
+/** Callback invocations in the order they happened. */
+static struct {
+    struct os_task *t;
+    uint16_t used;
+    uint16_t size;
+} oish_reports[OISH_MAX_REPORTS];
+static int oish_num_reports;
+
+static void
+oish_cb(struct os_task *t, uint16_t used, uint16_t size)
+{
+    TEST_ASSERT_FATAL(oish_num_reports < OISH_MAX_REPORTS);
+    oish_reports[oish_num_reports].t = t;
+    oish_reports[oish_num_reports].used = used;
+    oish_reports[oish_num_reports].size = size;
+    oish_num_reports++;
+}
+
+static void
+oish_task_handler(void *arg)
+{
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/* Marks the stack as used down to 'used' words below the top. */
+static void
+oish_use_stack(os_stack_t *stack, int used)
+{
+    stack[OISH_STACK_SIZE - used] = 0;
+}
+
+/* Enough scanner steps for several passes over every task. */
+static void
+oish_scan(void)
+{
+    int i;
+
+    for (i = 0; i < OISH_SCANS; i++) {
+        os_stack_hwm_scan();
+    }
+}
+#endif
+
+/**
+ * Tests the background stack high-water scanner: the mark follows the
+ * deepest used word, the callback fires once per task when the threshold is
+ * crossed, and removed tasks are dropped from the scan.  Does not start the
+ * OS; os_stack_hwm_scan() is called directly.
+ */
+TEST_CASE(os_idle_test_stack_hwm)
+{
+#if MYNEWT_VAL(OS_STACK_HWM)
+    int deep;
+    int half;
+    int rc;
+
+    deep = OISH_STACK_SIZE * (MYNEWT_VAL(OS_STACK_HWM_THRESH) + 5) / 100;
+    half = OISH_STACK_SIZE / 2;
+
+    oish_num_reports = 0;
+    os_stack_hwm_set_cb(oish_cb);
+
+    rc = os_task_init(&oish_task1, "oish1", oish_task_handler, NULL,
+                      TASK4_PRIO + 1, OS_WAIT_FOREVER,
+                      oish_stack1, OISH_STACK_SIZE);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = os_task_init(&oish_task2, "oish2", oish_task_handler, NULL,
+                      TASK4_PRIO + 2, OS_WAIT_FOREVER,
+                      oish_stack2, OISH_STACK_SIZE);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* Only the task above the threshold is reported. */
+    oish_use_stack(oish_stack1, deep);
+    oish_use_stack(oish_stack2, half);
+    oish_scan();
+
+    TEST_ASSERT(oish_task1.t_stack_hwm == deep);
+    TEST_ASSERT(oish_task2.t_stack_hwm == half);
+    TEST_ASSERT_FATAL(oish_num_reports == 1);
+    TEST_ASSERT(oish_reports[0].t == &oish_task1);
+    TEST_ASSERT(oish_reports[0].used == deep);
+    TEST_ASSERT(oish_reports[0].size == OISH_STACK_SIZE);
+    TEST_ASSERT(oish_task1.t_flags & OS_TASK_FLAG_STACK_HWM);
+    TEST_ASSERT(!(oish_task2.t_flags & OS_TASK_FLAG_STACK_HWM));
+
+    /* Deeper use raises the mark; a reported task is not reported again. */
+    oish_use_stack(oish_stack1, deep + 8);
+    oish_use_stack(oish_stack2, deep);
+    oish_scan();
+
+    TEST_ASSERT(oish_task1.t_stack_hwm == deep + 8);
+    TEST_ASSERT(oish_task2.t_stack_hwm == deep);
+    TEST_ASSERT_FATAL(oish_num_reports == 2);
+    TEST_ASSERT(oish_reports[1].t == &oish_task2);
+    TEST_ASSERT(oish_reports[1].used == deep);
+
+    /* The mark never goes down. */
+    oish_stack1[OISH_STACK_SIZE - deep - 8] = OS_STACK_PATTERN;
+    oish_scan();
+    TEST_ASSERT(oish_task1.t_stack_hwm == deep + 8);
+
+    /* Removed tasks are no longer scanned. */
+    os_stack_hwm_scan();
+    rc = os_task_remove(&oish_task1);
+    TEST_ASSERT(rc == 0);
+    rc = os_task_remove(&oish_task2);
+    TEST_ASSERT(rc == 0);
+    oish_use_stack(oish_stack1, OISH_STACK_SIZE);
+    oish_scan();
+    TEST_ASSERT(oish_task1.t_stack_hwm == deep + 8);
+    TEST_ASSERT(oish_num_reports == 2);
+
+    os_stack_hwm_set_cb(NULL);
+#endif
+}
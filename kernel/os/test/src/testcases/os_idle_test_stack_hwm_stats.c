@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_STACK_HWM_STATS)
+#include "stats/stats.h"
+
+#define OISHS_STACK_SIZE    256
+#define OISHS_SCANS         8192
+
+static struct os_task oishs_task1;
+static struct os_task oishs_task2;
+static os_stack_t oishs_stack1[OISHS_STACK_SIZE];
+static os_stack_t oishs_stack2[OISHS_STACK_SIZE];
+
+static void
+oishs_task_handler(void *arg)
+{
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/* Enough scanner steps for several passes over every task. */
+static void
+oishs_scan(void)
+{
+    int i;
+
+    for (i = 0; i < OISHS_SCANS; i++) {
+        os_stack_hwm_scan();
+    }
+}
+#endif
+
+/**
+ * Tests the per task stack statistics: a removed task is unpublished, and a
+ * task structure set up again under another name is published under the new
+ * name.  Does not start the OS; os_stack_hwm_scan() is called directly.
+ */
+TEST_CASE(os_idle_test_stack_hwm_stats)
+{
+#if MYNEWT_VAL(OS_STACK_HWM_STATS)
+    int rc;
+
+    rc = os_task_init(&oishs_task1, "oishs1", oishs_task_handler, NULL,
+                      TASK4_PRIO + 1, OS_WAIT_FOREVER,
+                      oishs_stack1, OISHS_STACK_SIZE);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = os_task_init(&oishs_task2, "oishs2", oishs_task_handler, NULL,
+                      TASK4_PRIO + 2, OS_WAIT_FOREVER,
+                      oishs_stack2, OISHS_STACK_SIZE);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    oishs_scan();
+    TEST_ASSERT(stats_group_find("stk_oishs1") != NULL);
+    TEST_ASSERT(stats_group_find("stk_oishs2") != NULL);
+
+    /* A removed task is no longer published. */
+    rc = os_task_remove(&oishs_task1);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(stats_group_find("stk_oishs1") == NULL);
+    TEST_ASSERT(stats_group_find("stk_oishs2") != NULL);
+
+    /*
+     * The same task structure, set up again, is published under its new
+     * name only.
+     */
+    rc = os_task_init(&oishs_task1, "oishs3", oishs_task_handler, NULL,
+                      TASK4_PRIO + 1, OS_WAIT_FOREVER,
+                      oishs_stack1, OISHS_STACK_SIZE);
+    TEST_ASSERT_FATAL(rc == 0);
+    oishs_scan();
+    TEST_ASSERT(stats_group_find("stk_oishs1") == NULL);
+    TEST_ASSERT(stats_group_find("stk_oishs3") != NULL);
+
+    rc = os_task_remove(&oishs_task1);
+    TEST_ASSERT(rc == 0);
+    rc = os_task_remove(&oishs_task2);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(stats_group_find("stk_oishs3") == NULL);
+    TEST_ASSERT(stats_group_find("stk_oishs2") == NULL);
+#endif
+}
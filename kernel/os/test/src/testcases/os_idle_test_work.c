@@ -0,0 +1,122 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_IDLE_WORK)
+#define OITW_MAX_RUNS   8
+
+/** Work items in the order they ran. */
+static struct os_idle_work *oitw_runs[OITW_MAX_RUNS];
+static int oitw_num_runs;
+
+/* oiw_arg points to the number of times the item still wants to run. */
+static int
+oitw_fn(struct os_idle_work *work, uint32_t deadline)
+{
+    int *remaining;
+
+    TEST_ASSERT_FATAL(oitw_num_runs < OITW_MAX_RUNS);
+    oitw_runs[oitw_num_runs++] = work;
+
+    remaining = work->oiw_arg;
+    return --*remaining > 0;
+}
+
+static void
+oitw_cb(struct os_event *ev)
+{
+}
+#endif
+
+/**
+ * Tests queueing and removing idle work, round robin between items that
+ * need more than one run, and that no work runs when the next wakeup is too
+ * close.  Does not start the OS; os_idle_work_run() is called directly.
+ */
+TEST_CASE(os_idle_test_work)
+{
+#if MYNEWT_VAL(OS_IDLE_WORK)
+    struct os_idle_work work1;
+    struct os_idle_work work2;
+    struct os_callout callout;
+    struct os_eventq evq;
+    int remaining1;
+    int remaining2;
+    int rc;
+
+    os_idle_work_init(&work1, oitw_fn, &remaining1);
+    os_idle_work_init(&work2, oitw_fn, &remaining2);
+    oitw_num_runs = 0;
+
+    /* Nothing queued. */
+    rc = os_idle_work_run();
+    TEST_ASSERT(rc == 1);
+    TEST_ASSERT(oitw_num_runs == 0);
+
+    /* Adding an item twice queues it once; items take turns. */
+    remaining1 = 2;
+    remaining2 = 1;
+    os_idle_work_add(&work1);
+    os_idle_work_add(&work2);
+    os_idle_work_add(&work1);
+    TEST_ASSERT(work1.oiw_queued && work2.oiw_queued);
+
+    rc = os_idle_work_run();
+    TEST_ASSERT(rc == 1);
+    TEST_ASSERT_FATAL(oitw_num_runs == 3);
+    TEST_ASSERT(oitw_runs[0] == &work1);
+    TEST_ASSERT(oitw_runs[1] == &work2);
+    TEST_ASSERT(oitw_runs[2] == &work1);
+    TEST_ASSERT(!work1.oiw_queued && !work2.oiw_queued);
+
+    /* A removed item does not run; removing it again does nothing. */
+    oitw_num_runs = 0;
+    remaining1 = 1;
+    remaining2 = 1;
+    os_idle_work_add(&work1);
+    os_idle_work_add(&work2);
+    os_idle_work_remove(&work1);
+    os_idle_work_remove(&work1);
+    TEST_ASSERT(!work1.oiw_queued);
+
+    rc = os_idle_work_run();
+    TEST_ASSERT(rc == 1);
+    TEST_ASSERT(oitw_num_runs == 1);
+    TEST_ASSERT(oitw_runs[0] == &work2);
+
+    /* With a callout due on the next tick there is no time for work. */
+    oitw_num_runs = 0;
+    os_eventq_init(&evq);
+    os_callout_init(&callout, &evq, oitw_cb, NULL);
+    os_callout_reset(&callout, 1);
+    os_idle_work_add(&work1);
+
+    rc = os_idle_work_run();
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(oitw_num_runs == 0);
+    TEST_ASSERT(work1.oiw_queued);
+
+    /* Once the callout is gone the work runs. */
+    os_callout_stop(&callout);
+    rc = os_idle_work_run();
+    TEST_ASSERT(rc == 1);
+    TEST_ASSERT(oitw_num_runs == 1);
+    TEST_ASSERT(!work1.oiw_queued);
+#endif
+}
@@ -0,0 +1,96 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+static int os_mbuf_test_ext_freed;
+
+static void
+os_mbuf_test_ext_free_cb(struct os_mbuf_ext *ext)
+{
+    TEST_ASSERT(ext->ome_arg == &os_mbuf_test_ext_freed);
+    os_mbuf_test_ext_freed++;
+}
+
+TEST_CASE(os_mbuf_test_ext)
+{
+    struct os_mbuf_ext ext;
+    struct os_mbuf *om;
+    struct os_mbuf *dup;
+    uint8_t buf[8];
+    int rc;
+
+    os_mbuf_test_setup();
+    os_mbuf_test_ext_freed = 0;
+
+    os_mbuf_ext_init(&ext, os_mbuf_test_data, 600, os_mbuf_test_ext_free_cb,
+                     &os_mbuf_test_ext_freed);
+
+    /* Out of range references are rejected. */
+    om = os_mbuf_get_ext(&os_mbuf_pool, &ext, 500, 101);
+    TEST_ASSERT(om == NULL);
+    TEST_ASSERT(ext.ome_refcnt == 0);
+
+    /* Chain 600 external bytes behind a packet header without copying. */
+    om = os_mbuf_get_pkthdr(&os_mbuf_pool, 0);
+    TEST_ASSERT_FATAL(om != NULL);
+    rc = os_mbuf_append(om, os_mbuf_test_data, 10);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = os_mbuf_append_ext(om, &ext, 10, 590);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(ext.ome_refcnt == 1);
+    TEST_ASSERT(SLIST_NEXT(om, om_next)->om_data == os_mbuf_test_data + 10);
+    TEST_ASSERT(os_mbuf_mempool.mp_num_free == MBUF_TEST_POOL_BUF_COUNT - 2);
+    os_mbuf_test_misc_assert_sane(om, os_mbuf_test_data, 10, 600,
+                                  sizeof(struct os_mbuf_pkthdr));
+
+    /* External mbufs have no room; appended data goes into a new mbuf. */
+    TEST_ASSERT(OS_MBUF_TRAILINGSPACE(SLIST_NEXT(om, om_next)) == 0);
+    rc = os_mbuf_append(om, os_mbuf_test_data + 600, 20);
+    TEST_ASSERT_FATAL(rc == 0);
+    os_mbuf_test_misc_assert_sane(om, os_mbuf_test_data, 10, 620,
+                                  sizeof(struct os_mbuf_pkthdr));
+
+    /* External data is read-only. */
+    rc = os_mbuf_copyinto(om, 100, buf, sizeof buf);
+    TEST_ASSERT(rc != 0);
+
+    /* Duplicating shares the external buffer. */
+    dup = os_mbuf_dup(om);
+    TEST_ASSERT_FATAL(dup != NULL);
+    TEST_ASSERT(ext.ome_refcnt == 2);
+    os_mbuf_test_misc_assert_sane(dup, os_mbuf_test_data, 10, 620,
+                                  sizeof(struct os_mbuf_pkthdr));
+
+    /* Trimming the front drops into the external data. */
+    os_mbuf_adj(dup, 15);
+    rc = os_mbuf_copydata(dup, 0, sizeof buf, buf);
+    TEST_ASSERT(rc == 0);
+    TEST_ASSERT(memcmp(buf, os_mbuf_test_data + 15, sizeof buf) == 0);
+
+    rc = os_mbuf_free_chain(om);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(ext.ome_refcnt == 1);
+    TEST_ASSERT(os_mbuf_test_ext_freed == 0);
+
+    rc = os_mbuf_free_chain(dup);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(ext.ome_refcnt == 0);
+    TEST_ASSERT(os_mbuf_test_ext_freed == 1);
+    TEST_ASSERT(os_mbuf_mempool.mp_num_free == MBUF_TEST_POOL_BUF_COUNT);
+}
@@ -0,0 +1,167 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#define MSYS_TEST_SMALL_BUF_SIZE    (64)
+#define MSYS_TEST_SMALL_BUF_COUNT   (4)
+#define MSYS_TEST_LARGE_BUF_SIZE    (256)
+#define MSYS_TEST_LARGE_BUF_COUNT   (2)
+
+static os_membuf_t msys_test_small_membuf[
+    OS_MEMPOOL_SIZE(MSYS_TEST_SMALL_BUF_COUNT, MSYS_TEST_SMALL_BUF_SIZE)];
+static os_membuf_t msys_test_large_membuf[
+    OS_MEMPOOL_SIZE(MSYS_TEST_LARGE_BUF_COUNT, MSYS_TEST_LARGE_BUF_SIZE)];
+
+static struct os_mempool msys_test_small_mempool;
+static struct os_mempool msys_test_large_mempool;
+static struct os_mbuf_pool msys_test_small_pool;
+static struct os_mbuf_pool msys_test_large_pool;
+
+static void
+os_mbuf_test_msys_setup(void)
+{
+    int rc;
+
+    rc = os_mempool_init(&msys_test_small_mempool, MSYS_TEST_SMALL_BUF_COUNT,
+                         MSYS_TEST_SMALL_BUF_SIZE, msys_test_small_membuf,
+                         "msys_test_small");
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = os_mbuf_pool_init(&msys_test_small_pool, &msys_test_small_mempool,
+                           MSYS_TEST_SMALL_BUF_SIZE,
+                           MSYS_TEST_SMALL_BUF_COUNT);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    rc = os_mempool_init(&msys_test_large_mempool, MSYS_TEST_LARGE_BUF_COUNT,
+                         MSYS_TEST_LARGE_BUF_SIZE, msys_test_large_membuf,
+                         "msys_test_large");
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = os_mbuf_pool_init(&msys_test_large_pool, &msys_test_large_mempool,
+                           MSYS_TEST_LARGE_BUF_SIZE,
+                           MSYS_TEST_LARGE_BUF_COUNT);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* Register out of order; msys keeps the pools sorted by size. */
+    os_msys_reset();
+    rc = os_msys_register(&msys_test_large_pool);
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = os_msys_register(&msys_test_small_pool);
+    TEST_ASSERT_FATAL(rc == 0);
+}
+
+TEST_CASE(os_mbuf_test_msys)
+{
+    struct os_mbuf *large[MSYS_TEST_LARGE_BUF_COUNT];
+    struct os_mbuf *small[MSYS_TEST_SMALL_BUF_COUNT];
+    struct os_mbuf *om;
+    uint16_t small_len;
+    uint16_t large_len;
+    int rc;
+    int i;
+
+    os_mbuf_test_msys_setup();
+    small_len = msys_test_small_pool.omp_databuf_len;
+    large_len = msys_test_large_pool.omp_databuf_len;
+
+#if MYNEWT_VAL(MSYS_STATS)
+    /* Pools registered after sysinit get their stats registered, too. */
+    TEST_ASSERT(stats_group_find("msys_test_small") ==
+                STATS_HDR(msys_test_small_pool.omp_stats));
+    TEST_ASSERT(stats_group_find("msys_test_large") ==
+                STATS_HDR(msys_test_large_pool.omp_stats));
+#endif
+
+    /* Best fit. */
+    for (i = 0; i < MSYS_TEST_SMALL_BUF_COUNT; i++) {
+        small[i] = os_msys_get(small_len, 0);
+        TEST_ASSERT_FATAL(small[i] != NULL);
+        TEST_ASSERT(small[i]->om_omp == &msys_test_small_pool);
+    }
+    large[0] = os_msys_get(small_len + 1, 0);
+    TEST_ASSERT_FATAL(large[0] != NULL);
+    TEST_ASSERT(large[0]->om_omp == &msys_test_large_pool);
+
+    /* The small class is exhausted; fall back to the large one. */
+    om = os_msys_get(1, 0);
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_FALLBACK)
+    TEST_ASSERT_FATAL(om != NULL);
+    TEST_ASSERT(om->om_omp == &msys_test_large_pool);
+    large[1] = om;
+#else
+    TEST_ASSERT(om == NULL);
+    large[1] = os_msys_get(large_len, 0);
+    TEST_ASSERT_FATAL(large[1] != NULL);
+#endif
+
+    /* Nothing left. */
+    TEST_ASSERT(os_msys_get(1, 0) == NULL);
+    TEST_ASSERT(os_msys_get_pkthdr(large_len / 2, 0) == NULL);
+
+#if MYNEWT_VAL(MSYS_STATS)
+    TEST_ASSERT(STATS_GET(msys_test_small_pool.omp_stats, hit) ==
+                MSYS_TEST_SMALL_BUF_COUNT);
+    TEST_ASSERT(STATS_GET(msys_test_small_pool.omp_stats, miss) == 2);
+    TEST_ASSERT(STATS_GET(msys_test_large_pool.omp_stats, miss) == 1);
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_FALLBACK)
+    TEST_ASSERT(STATS_GET(msys_test_large_pool.omp_stats, hit) == 1);
+    TEST_ASSERT(STATS_GET(msys_test_large_pool.omp_stats, fallback) == 1);
+#endif
+#endif
+
+    for (i = 0; i < MSYS_TEST_SMALL_BUF_COUNT; i++) {
+        rc = os_mbuf_free(small[i]);
+        TEST_ASSERT(rc == 0);
+    }
+
+#if MYNEWT_VAL(MSYS_SIZE_CLASS_CHAIN)
+    /*
+     * The large class is exhausted and the small one can only hold the data
+     * as a chain: plain gets fail, chained gets return a small mbuf.
+     */
+    TEST_ASSERT(os_msys_get_pkthdr(large_len / 2, 0) == NULL);
+
+    om = os_msys_get_pkthdr_chained(large_len / 2, 0);
+    TEST_ASSERT_FATAL(om != NULL);
+    TEST_ASSERT(om->om_omp == &msys_test_small_pool);
+    rc = os_mbuf_append(om, os_mbuf_test_data, large_len / 2);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(SLIST_NEXT(om, om_next) != NULL);
+    TEST_ASSERT(OS_MBUF_PKTLEN(om) == large_len / 2);
+    rc = os_mbuf_free_chain(om);
+    TEST_ASSERT(rc == 0);
+
+    /* Not enough free small blocks for the whole request. */
+    TEST_ASSERT(os_msys_get_chained(small_len * MSYS_TEST_SMALL_BUF_COUNT + 1,
+                                    0) == NULL);
+
+#if MYNEWT_VAL(MSYS_STATS)
+    TEST_ASSERT(STATS_GET(msys_test_small_pool.omp_stats, chain) == 1);
+#endif
+#endif
+
+    for (i = 0; i < MSYS_TEST_LARGE_BUF_COUNT; i++) {
+        rc = os_mbuf_free(large[i]);
+        TEST_ASSERT(rc == 0);
+    }
+    TEST_ASSERT(msys_test_small_mempool.mp_num_free ==
+                MSYS_TEST_SMALL_BUF_COUNT);
+    TEST_ASSERT(msys_test_large_mempool.mp_num_free ==
+                MSYS_TEST_LARGE_BUF_COUNT);
+
+    os_msys_reset();
+}
@@ -63,6 +63,7 @@ retest:
 #else
     true_block_size = (g_TstMempool.mp_block_size + 7) & ~7;
 #endif
+    true_block_size += OS_MEMPOOL_GUARD_SZ + OS_MEMPOOL_TRACE_SZ;
 
     /* Traverse free list. Better add up to number of blocks! */
     cnt = 0;
@@ -0,0 +1,72 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_MEMPOOL_POISON)
+
+#define OMTCS_NUM_BLOCKS    4
+#define OMTCS_BLOCK_SIZE    32
+
+static os_membuf_t omtcs_buf[
+    OS_MEMPOOL_SIZE(OMTCS_NUM_BLOCKS, OMTCS_BLOCK_SIZE)];
+static struct os_mempool omtcs_pool;
+
+/**
+ * Tests that a freed block is poisoned on every put even when only every
+ * OS_MEMPOOL_CHECK_SAMPLE'th get checks the poison: a get that is checked
+ * after a put that skipped the poison would fail its assert.
+ */
+TEST_CASE(os_mempool_test_check_sample)
+{
+    uint8_t *untouched;
+    uint8_t *block;
+    int rc;
+    int i;
+
+    rc = os_mempool_init(&omtcs_pool, OMTCS_NUM_BLOCKS, OMTCS_BLOCK_SIZE,
+                         omtcs_buf, "omtcs");
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* The second free block is never handed out below. */
+    untouched = (uint8_t *)SLIST_NEXT(SLIST_FIRST(&omtcs_pool), mb_next);
+
+    for (i = 0; i < MYNEWT_VAL(OS_MEMPOOL_CHECK_SAMPLE) * 3; i++) {
+        block = os_memblock_get(&omtcs_pool);
+        TEST_ASSERT_FATAL(block != NULL);
+        TEST_ASSERT(block != untouched);
+
+        memset(block + sizeof (struct os_memblock), i,
+               OMTCS_BLOCK_SIZE - sizeof (struct os_memblock));
+
+        rc = os_memblock_put(&omtcs_pool, block);
+        TEST_ASSERT_FATAL(rc == 0);
+
+        /* Freed: the payload holds the same pattern as a never-used block. */
+        TEST_ASSERT(memcmp(block + sizeof (struct os_memblock),
+                           untouched + sizeof (struct os_memblock),
+                           OMTCS_BLOCK_SIZE -
+                           sizeof (struct os_memblock)) == 0);
+    }
+
+    TEST_ASSERT(omtcs_pool.mp_num_free == OMTCS_NUM_BLOCKS);
+
+    os_mempool_unregister(&omtcs_pool);
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os/mynewt.h"
+#include "runtest/runtest.h"
+#include "os_test_priv.h"
+
+#define OMTC_NUM_BLOCKS     8
+#define OMTC_BLOCK_SIZE     16
+#define OMTC_TICKS          20
+
+static os_membuf_t omtc_buf[OS_MEMPOOL_SIZE(OMTC_NUM_BLOCKS, OMTC_BLOCK_SIZE)];
+static struct os_mempool omtc_pool;
+static volatile int omtc_done;
+static int omtc_helper_gets;
+
+/*
+ * Takes a block, stamps it and checks the stamp survives until it is freed;
+ * a block handed out twice would be overwritten by the other user.
+ */
+static void *
+omtc_get(uint32_t stamp)
+{
+    uint32_t *block;
+
+    block = os_memblock_get(&omtc_pool);
+    if (block != NULL) {
+        *block = stamp;
+    }
+    return block;
+}
+
+static void
+omtc_put(uint32_t *block, uint32_t stamp)
+{
+    int rc;
+
+    TEST_ASSERT(*block == stamp, "block %p stamp 0x%x", block,
+                (unsigned)*block);
+    rc = os_memblock_put(&omtc_pool, block);
+    TEST_ASSERT(rc == 0);
+}
+
+/* Preempts the test task on every tick to take and free a few blocks. */
+static void
+omtc_helper(void *arg)
+{
+    void *blocks[3];
+    int i;
+
+    while (!omtc_done) {
+        for (i = 0; i < 3; i++) {
+            blocks[i] = omtc_get(0x55555555);
+            if (blocks[i] != NULL) {
+                omtc_helper_gets++;
+            }
+        }
+        for (i = 0; i < 3; i++) {
+            if (blocks[i] != NULL) {
+                omtc_put(blocks[i], 0x55555555);
+            }
+        }
+        os_time_delay(1);
+    }
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/**
+ * Tests memory block get and put from two tasks at once.  With
+ * OS_MEMPOOL_LOCKFREE, this exercises the lock-free pop and push retries:
+ * the tagged compare-and-swap on sim, LDREX/STREX on ARMv7-M.
+ */
+TEST_CASE_TASK(os_mempool_test_concurrent)
+{
+    void *blocks[OMTC_NUM_BLOCKS];
+    os_time_t start;
+    int num;
+    int rc;
+    int i;
+
+    rc = os_mempool_init(&omtc_pool, OMTC_NUM_BLOCKS, OMTC_BLOCK_SIZE,
+                         omtc_buf, "omtc");
+    TEST_ASSERT_FATAL(rc == 0);
+
+    omtc_done = 0;
+    omtc_helper_gets = 0;
+    runtest_init_task(omtc_helper, MYNEWT_VAL(OS_MAIN_TASK_PRIO) - 1);
+
+    /* Keep the pool close to empty so the helper sometimes finds none. */
+    start = os_time_get();
+    while (os_time_get() - start < OMTC_TICKS) {
+        for (num = 0; num < OMTC_NUM_BLOCKS - 2; num++) {
+            blocks[num] = omtc_get(0xaaaaaaaa);
+            if (blocks[num] == NULL) {
+                break;
+            }
+        }
+        for (i = 0; i < num; i++) {
+            omtc_put(blocks[i], 0xaaaaaaaa);
+        }
+    }
+    omtc_done = 1;
+    os_time_delay(2);
+
+    TEST_ASSERT(omtc_helper_gets > 0);
+    TEST_ASSERT(omtc_pool.mp_num_free == OMTC_NUM_BLOCKS);
+    TEST_ASSERT(omtc_pool.mp_min_free < OMTC_NUM_BLOCKS - 2);
+    TEST_ASSERT(os_mempool_is_sane(&omtc_pool));
+
+    /* Every block is on the free list exactly once. */
+    for (i = 0; i < OMTC_NUM_BLOCKS; i++) {
+        blocks[i] = os_memblock_get(&omtc_pool);
+        TEST_ASSERT_FATAL(blocks[i] != NULL);
+    }
+    TEST_ASSERT(os_memblock_get(&omtc_pool) == NULL);
+    TEST_ASSERT(omtc_pool.mp_min_free == 0);
+    for (i = 0; i < OMTC_NUM_BLOCKS; i++) {
+        os_memblock_put(&omtc_pool, blocks[i]);
+    }
+
+    os_mempool_unregister(&omtc_pool);
+}
@@ -77,4 +77,6 @@ TEST_CASE(os_mempool_test_ext_basic)
 
     TEST_ASSERT(freed_pool == NULL);
     TEST_ASSERT(freed_block == NULL);
+
+    os_mempool_unregister(&pool.mpe_mp);
 }
@@ -62,4 +62,6 @@ TEST_CASE(os_mempool_test_ext_nested)
 
     /* Verify callback was called within callback. */
     TEST_ASSERT(num_frees == 2);
+
+    os_mempool_unregister(&pool.mpe_mp);
 }
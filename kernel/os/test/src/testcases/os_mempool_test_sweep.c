@@ -0,0 +1,160 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_MEMPOOL_SWEEP)
+
+#define OMTS_NUM_BLOCKS     (MYNEWT_VAL(OS_MEMPOOL_SWEEP_BLOCKS) * 3)
+#define OMTS_BLOCK_SIZE     32
+
+static os_membuf_t omts_buf[OS_MEMPOOL_SIZE(OMTS_NUM_BLOCKS, OMTS_BLOCK_SIZE)];
+static os_membuf_t omts_next_buf[OS_MEMPOOL_SIZE(1, OMTS_BLOCK_SIZE)];
+static struct os_mempool omts_pool;
+static struct os_mempool omts_next_pool;
+
+/* Takes the head of omts_pool and puts it back, as a busy user would. */
+static void
+omts_churn(void)
+{
+    void *block;
+    int rc;
+
+    block = os_memblock_get(&omts_pool);
+    TEST_ASSERT_FATAL(block != NULL);
+    rc = os_memblock_put(&omts_pool, block);
+    TEST_ASSERT_FATAL(rc == 0);
+}
+
+/*
+ * Sweeps, churning omts_pool before every call, until the sweep finishes
+ * the free list of 'mp'.  Gives up after two passes over every registered
+ * pool.
+ */
+static void
+omts_sweep_until(struct os_mempool *mp)
+{
+    struct os_mempool_info omi;
+    struct os_mempool *cur;
+    int limit;
+    int i;
+
+    limit = 0;
+    cur = NULL;
+    while ((cur = os_mempool_info_get_next(cur, &omi)) != NULL) {
+        limit += omi.omi_num_free / MYNEWT_VAL(OS_MEMPOOL_SWEEP_BLOCKS) + 1;
+    }
+    limit *= 2;
+
+    for (i = 0; i < limit; i++) {
+        omts_churn();
+        if (os_mempool_sweep() == mp) {
+            return;
+        }
+    }
+
+    TEST_ASSERT_FATAL(0, "sweep never finished pool %s", mp->name);
+}
+
+/*
+ * Sweeps until the next call starts at the head of omts_pool's free list,
+ * then makes that call.
+ */
+static void
+omts_sweep_into_pool(void)
+{
+    struct os_mempool_info omi;
+    struct os_mempool *prev;
+    struct os_mempool *cur;
+
+    /* The pool swept just before omts_pool; the list wraps around. */
+    prev = NULL;
+    cur = NULL;
+    while ((cur = os_mempool_info_get_next(cur, &omi)) != NULL) {
+        if (STAILQ_NEXT(cur, mp_list) == &omts_pool ||
+            (prev == NULL && STAILQ_NEXT(cur, mp_list) == NULL)) {
+            prev = cur;
+        }
+    }
+    TEST_ASSERT_FATAL(prev != NULL);
+
+    omts_sweep_until(prev);
+    TEST_ASSERT_FATAL(os_mempool_sweep() == NULL);
+}
+
+/**
+ * Tests that the idle-time sweep resumes where it left off while the pool
+ * is in use, restarts when the block it would resume from is taken, and moves
+ * on to the following pool.
+ */
+TEST_CASE(os_mempool_test_sweep)
+{
+    void *blocks[MYNEWT_VAL(OS_MEMPOOL_SWEEP_BLOCKS) + 1];
+    int rc;
+    int i;
+
+    rc = os_mempool_init(&omts_pool, OMTS_NUM_BLOCKS, OMTS_BLOCK_SIZE,
+                         omts_buf, "omts");
+    TEST_ASSERT_FATAL(rc == 0);
+    rc = os_mempool_init(&omts_next_pool, 1, OMTS_BLOCK_SIZE, omts_next_buf,
+                         "omts_next");
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* A pool in use between calls is still swept to the end... */
+    omts_sweep_until(&omts_pool);
+
+    /* ...and the sweep then moves on to the next pool. */
+    TEST_ASSERT(os_mempool_sweep() == &omts_next_pool);
+
+    /* Resumed: the remaining two thirds of the list take two calls. */
+    omts_sweep_into_pool();
+    omts_churn();
+    TEST_ASSERT(os_mempool_sweep() == NULL);
+    omts_churn();
+    TEST_ASSERT(os_mempool_sweep() == &omts_pool);
+
+    /*
+     * Taking the block the sweep would resume from makes it start over from
+     * the head: three more calls.
+     */
+    omts_sweep_into_pool();
+    for (i = 0; i < MYNEWT_VAL(OS_MEMPOOL_SWEEP_BLOCKS) + 1; i++) {
+        blocks[i] = os_memblock_get(&omts_pool);
+        TEST_ASSERT_FATAL(blocks[i] != NULL);
+    }
+    for (i = 0; i < MYNEWT_VAL(OS_MEMPOOL_SWEEP_BLOCKS) + 1; i++) {
+        rc = os_memblock_put(&omts_pool, blocks[i]);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+    TEST_ASSERT(os_mempool_sweep() == NULL);
+    TEST_ASSERT(os_mempool_sweep() == NULL);
+    TEST_ASSERT(os_mempool_sweep() == &omts_pool);
+
+    /* Reinitializing the pool also starts over. */
+    omts_sweep_into_pool();
+    rc = os_mempool_clear(&omts_pool);
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(os_mempool_sweep() == NULL);
+    TEST_ASSERT(os_mempool_sweep() == NULL);
+    TEST_ASSERT(os_mempool_sweep() == &omts_pool);
+
+    os_mempool_unregister(&omts_next_pool);
+    os_mempool_unregister(&omts_pool);
+}
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+static int low_cb_cnt;
+
+static void
+low_cb(struct os_mempool *mp, void *arg)
+{
+    TEST_ASSERT(arg == &low_cb_cnt);
+    TEST_ASSERT(mp->mp_num_free == 2);
+    low_cb_cnt++;
+}
+#endif
+
+TEST_CASE(os_mempool_test_trace)
+{
+    os_membuf_t buf[OS_MEMPOOL_SIZE(5, 32)];
+    struct os_mempool pool;
+    struct os_mempool empty;
+    void *blocks[5];
+    int rc;
+    int i;
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+    struct os_memblock_owner owners[3];
+    int num;
+#endif
+
+    rc = os_mempool_init(&pool, 5, 32, buf, "test_trace");
+    TEST_ASSERT_FATAL(rc == 0);
+
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+    low_cb_cnt = 0;
+    os_mempool_set_low_cb(&pool, 2, low_cb, &low_cb_cnt);
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+    num = os_mempool_trace_oldest(&pool, owners, 3);
+    TEST_ASSERT(num == 0);
+#endif
+
+    /* Allocate the blocks one tick apart. */
+    for (i = 0; i < 5; i++) {
+        blocks[i] = os_memblock_get(&pool);
+        TEST_ASSERT_FATAL(blocks[i] != NULL);
+        os_time_advance(1);
+    }
+
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+    /* Called on the way down through 2 free blocks only. */
+    TEST_ASSERT(low_cb_cnt == 1);
+    TEST_ASSERT(os_memblock_get(&pool) == NULL);
+    TEST_ASSERT(low_cb_cnt == 1);
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+    /* Free the oldest block; the next three are reported in order. */
+    rc = os_memblock_put(&pool, blocks[0]);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    num = os_mempool_trace_oldest(&pool, owners, 3);
+    TEST_ASSERT_FATAL(num == 3);
+    for (i = 0; i < num; i++) {
+        TEST_ASSERT(owners[i].omo_addr != NULL);
+        TEST_ASSERT(owners[i].omo_time == owners[0].omo_time + i);
+    }
+
+    /* Reallocating the freed block makes it the newest. */
+    blocks[0] = os_memblock_get(&pool);
+    TEST_ASSERT_FATAL(blocks[0] != NULL);
+    num = os_mempool_trace_oldest(&pool, owners, 3);
+    TEST_ASSERT(num == 3);
+    TEST_ASSERT(OS_TIME_TICK_LT(owners[2].omo_time, os_time_get()));
+    for (i = 1; i < 5; i++) {
+        os_memblock_put(&pool, blocks[i]);
+    }
+    num = os_mempool_trace_oldest(&pool, owners, 3);
+    TEST_ASSERT(num == 1);
+    TEST_ASSERT(owners[0].omo_time == os_time_get());
+    os_memblock_put(&pool, blocks[0]);
+#else
+    for (i = 0; i < 5; i++) {
+        os_memblock_put(&pool, blocks[i]);
+    }
+#endif
+
+#if MYNEWT_VAL(OS_MEMPOOL_LOW_CB)
+    os_mempool_set_low_cb(&pool, 0, NULL, NULL);
+#endif
+    os_mempool_unregister(&pool);
+
+    /* A pool without a buffer has no blocks to poison or trace. */
+    rc = os_mempool_init(&empty, 0, 32, NULL, "test_trace_empty");
+    TEST_ASSERT_FATAL(rc == 0);
+    TEST_ASSERT(os_memblock_get(&empty) == NULL);
+    rc = os_mempool_clear(&empty);
+    TEST_ASSERT(rc == 0);
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+    num = os_mempool_trace_oldest(&empty, owners, 3);
+    TEST_ASSERT(num == 0);
+#endif
+    os_mempool_unregister(&empty);
+}
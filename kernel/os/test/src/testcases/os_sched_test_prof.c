@@ -0,0 +1,129 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os/mynewt.h"
+#include "runtest/runtest.h"
+#include "os_test_priv.h"
+
+/* Lower priority than the test task, so the helper only runs when it waits. */
+#define OSTP_PRIO           (MYNEWT_VAL(OS_MAIN_TASK_PRIO) + 4)
+#define OSTP_ROUNDS         4
+
+static struct os_sem ostp_sem;
+
+static void
+ostp_handler(void *arg)
+{
+    int i;
+
+    /* Each release readies the test task, which preempts this one. */
+    for (i = 0; i < OSTP_ROUNDS; i++) {
+        os_sem_release(&ostp_sem);
+    }
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+static int
+ostp_bucket(uint32_t lat)
+{
+    int bucket;
+
+    bucket = lat ? 32 - __builtin_clz(lat) : 0;
+    if (bucket >= OS_TASK_PROF_LAT_BUCKETS) {
+        bucket = OS_TASK_PROF_LAT_BUCKETS - 1;
+    }
+    return bucket;
+}
+
+static struct os_task *
+ostp_info(struct os_task *t, struct os_task_info *oti)
+{
+    struct os_task *cur;
+
+    cur = NULL;
+    while ((cur = os_task_info_get_next(cur, oti)) != NULL) {
+        if (cur == t) {
+            break;
+        }
+    }
+    return cur;
+}
+
+/**
+ * Tests the OS_TASK_PROF counters: a task switched out while still ready
+ * counts as preempted, every switch in adds one ready latency sample, and
+ * the run times of all tasks add up to no more than the time that passed.
+ */
+TEST_CASE_TASK(os_sched_test_prof)
+{
+    struct os_task_info oti;
+    struct os_task *helper;
+    struct os_task *t;
+    uint64_t run_time;
+    uint32_t start;
+    uint32_t samples;
+    int rc;
+    int i;
+
+    /* The native BSP leaves cputime, the profiler's clock, to the app. */
+    os_cputime_init(MYNEWT_VAL(OS_CPUTIME_FREQ));
+
+    rc = os_sem_init(&ostp_sem, 0);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    os_task_prof_reset();
+    start = os_cputime_get32();
+    TEST_ASSERT(os_task_prof_isr_time() == 0);
+
+    /* Let the idle task run for a while so that cputime moves on. */
+    os_time_delay(2);
+
+    helper = runtest_init_task(ostp_handler, OSTP_PRIO);
+    for (i = 0; i < OSTP_ROUNDS; i++) {
+        rc = os_sem_pend(&ostp_sem, OS_TIMEOUT_NEVER);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+
+    TEST_ASSERT_FATAL(ostp_info(helper, &oti) != NULL);
+    TEST_ASSERT(oti.oti_prof.otp_preempt_cnt >= OSTP_ROUNDS,
+                "preempted %lu times",
+                (unsigned long)oti.oti_prof.otp_preempt_cnt);
+
+    /* One latency sample per switch in, and the maximum is one of them. */
+    samples = 0;
+    for (i = 0; i < OS_TASK_PROF_LAT_BUCKETS; i++) {
+        samples += oti.oti_prof.otp_lat_hist[i];
+    }
+    TEST_ASSERT(samples == oti.oti_cswcnt, "%lu samples, %lu switches",
+                (unsigned long)samples, (unsigned long)oti.oti_cswcnt);
+    TEST_ASSERT(samples >= OSTP_ROUNDS);
+    TEST_ASSERT(oti.oti_prof.otp_lat_hist[
+                    ostp_bucket(oti.oti_prof.otp_lat_max)] != 0);
+
+    /* Run time is only handed out between context switches. */
+    run_time = 0;
+    t = NULL;
+    while ((t = os_task_info_get_next(t, &oti)) != NULL) {
+        run_time += oti.oti_prof.otp_run_time;
+    }
+    TEST_ASSERT(run_time > 0);
+    TEST_ASSERT(run_time <= (uint32_t)(os_cputime_get32() - start));
+}
@@ -0,0 +1,147 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os/mynewt.h"
+#include "runtest/runtest.h"
+#include "os_test_priv.h"
+
+#define OSTRL_NUM_TASKS     3
+/* Lower priority than the test task, so the helpers only run once it sleeps. */
+#define OSTRL_PRIO          (MYNEWT_VAL(OS_MAIN_TASK_PRIO) + 4)
+
+static struct os_task *ostrl_tasks[OSTRL_NUM_TASKS];
+static int ostrl_order[OSTRL_NUM_TASKS];
+static int ostrl_num_ran;
+
+static void
+ostrl_handler(void *arg)
+{
+    struct os_task *t;
+    int i;
+
+    t = os_sched_get_current_task();
+    for (i = 0; i < OSTRL_NUM_TASKS; i++) {
+        if (ostrl_tasks[i] == t) {
+            ostrl_order[ostrl_num_ran++] = i;
+        }
+    }
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/* Gives a ready task a new priority, as priority inheritance does. */
+static void
+ostrl_set_prio(struct os_task *t, uint8_t prio)
+{
+    os_sr_t sr;
+
+    OS_ENTER_CRITICAL(sr);
+    t->t_prio = prio;
+    os_sched_resort(t);
+    OS_EXIT_CRITICAL(sr);
+}
+
+/*
+ * Checks that the run list is sorted by priority and, unless 'expected' is
+ * NULL, that the helper tasks are queued in the given order.
+ */
+static void
+ostrl_check(const int *expected)
+{
+    struct os_task *prev;
+    struct os_task *t;
+    os_sr_t sr;
+    int i;
+
+    i = 0;
+    prev = NULL;
+    OS_ENTER_CRITICAL(sr);
+    TAILQ_FOREACH(t, &g_os_run_list, t_os_list) {
+        TEST_ASSERT(prev == NULL || prev->t_prio <= t->t_prio,
+                    "%s (%d) queued before %s (%d)", prev->t_name,
+                    prev->t_prio, t->t_name, t->t_prio);
+        if (expected != NULL && i < OSTRL_NUM_TASKS &&
+            t == ostrl_tasks[expected[i]]) {
+            i++;
+        }
+        prev = t;
+    }
+    OS_EXIT_CRITICAL(sr);
+
+    if (expected != NULL) {
+        TEST_ASSERT(i == OSTRL_NUM_TASKS, "helper %d out of order", i);
+    }
+}
+
+/**
+ * Tests the run list ordering, with or without OS_SCHED_BITMAP: tasks at
+ * the same priority run in the order they became ready, a task that is
+ * requeued goes behind its peers, and a priority change moves a ready task
+ * to its new place.
+ */
+TEST_CASE_TASK(os_sched_test_run_list)
+{
+    static const int queued[OSTRL_NUM_TASKS] = { 0, 1, 2 };
+    static const int same_prio[OSTRL_NUM_TASKS] = { 0, 1, 2 };
+    static const int requeued[OSTRL_NUM_TASKS] = { 1, 0, 2 };
+    static const int raised[OSTRL_NUM_TASKS] = { 2, 1, 0 };
+    static const int lowered[OSTRL_NUM_TASKS] = { 1, 0, 2 };
+    int i;
+
+    ostrl_num_ran = 0;
+    for (i = 0; i < OSTRL_NUM_TASKS; i++) {
+        ostrl_tasks[i] = runtest_init_task(ostrl_handler, OSTRL_PRIO + i * 2);
+    }
+    ostrl_check(queued);
+
+    /* Task 1 joins task 0's priority: it queues behind task 0. */
+    ostrl_set_prio(ostrl_tasks[1], OSTRL_PRIO);
+    ostrl_check(same_prio);
+
+    /* Requeuing task 0 at the same priority puts it behind task 1. */
+    ostrl_set_prio(ostrl_tasks[0], OSTRL_PRIO);
+    ostrl_check(requeued);
+
+    /* Task 2 is raised above both of them. */
+    ostrl_set_prio(ostrl_tasks[2], OSTRL_PRIO - 1);
+    ostrl_check(raised);
+
+    /* ...and lowered below them again. */
+    ostrl_set_prio(ostrl_tasks[2], OSTRL_PRIO + 1);
+    ostrl_check(lowered);
+
+    /* Raised once more; now let them run. */
+    ostrl_set_prio(ostrl_tasks[2], OSTRL_PRIO - 1);
+    os_time_delay(1);
+
+    TEST_ASSERT_FATAL(ostrl_num_ran == OSTRL_NUM_TASKS,
+                      "%d tasks ran", ostrl_num_ran);
+    for (i = 0; i < OSTRL_NUM_TASKS; i++) {
+        TEST_ASSERT(ostrl_order[i] == raised[i],
+                    "run %d was task %d", i, ostrl_order[i]);
+    }
+
+    /*
+     * The helpers left the run list; a task queued now must not be placed
+     * relative to any of them.
+     */
+    runtest_init_task(ostrl_handler, OSTRL_PRIO + 5);
+    ostrl_check(NULL);
+}
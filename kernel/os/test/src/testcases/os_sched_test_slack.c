@@ -0,0 +1,180 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os/mynewt.h"
+#include "os_test_priv.h"
+
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+
+/*
+ * The first OSTSL_FEW tasks fit within the search limit and get an exact
+ * answer; the rest are more than the search looks at.
+ */
+#define OSTSL_FEW           4
+#define OSTSL_NUM_TASKS     (OSTSL_FEW + 12)
+#define OSTSL_STACK_SIZE    OS_STACK_ALIGN(1024)
+/* Above the test task, so each helper goes to sleep as soon as it is made. */
+#define OSTSL_PRIO          (MYNEWT_VAL(OS_MAIN_TASK_PRIO) - 1)
+
+static struct os_task ostsl_tasks[OSTSL_NUM_TASKS];
+static os_stack_t ostsl_stacks[OSTSL_NUM_TASKS][OSTSL_STACK_SIZE];
+static os_time_t ostsl_delay[OSTSL_NUM_TASKS];
+static os_time_t ostsl_slack[OSTSL_NUM_TASKS];
+static os_time_t ostsl_deadline[OSTSL_NUM_TASKS];
+static os_time_t ostsl_woke[OSTSL_NUM_TASKS];
+static struct os_sem ostsl_sem;
+
+static void
+ostsl_handler(void *arg)
+{
+    int idx;
+
+    idx = (intptr_t)arg;
+
+    os_task_set_slack(os_sched_get_current_task(), ostsl_slack[idx]);
+    os_time_delay(ostsl_delay[idx]);
+    ostsl_woke[idx] = os_time_get();
+    os_sem_release(&ostsl_sem);
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/* Starts tasks 'first' up to 'last', which all go to sleep right away. */
+static void
+ostsl_start(int first, int last)
+{
+    int rc;
+    int i;
+
+    for (i = first; i < last; i++) {
+        rc = os_task_init(&ostsl_tasks[i], "slack", ostsl_handler,
+                          (void *)(intptr_t)i, OSTSL_PRIO - i,
+                          OS_WAIT_FOREVER, ostsl_stacks[i], OSTSL_STACK_SIZE);
+        TEST_ASSERT_FATAL(rc == 0);
+        ostsl_deadline[i] = ostsl_tasks[i].t_next_wakeup;
+    }
+}
+
+/*
+ * Checks the idle wakeup time against tasks 'first' up to 'last': it is
+ * never past any task's slack, and never before the first deadline.
+ * Returns 1 if it is the latest time that honours all of them.
+ */
+static int
+ostsl_check(int first, int last)
+{
+    os_time_t earliest;
+    os_time_t latest;
+    os_time_t wakeup;
+    os_time_t now;
+    os_sr_t sr;
+    int i;
+
+    earliest = ostsl_deadline[first];
+    latest = ostsl_deadline[first] + ostsl_slack[first];
+    for (i = first + 1; i < last; i++) {
+        if (OS_TIME_TICK_LT(ostsl_deadline[i], earliest)) {
+            earliest = ostsl_deadline[i];
+        }
+        if (OS_TIME_TICK_LT(ostsl_deadline[i] + ostsl_slack[i], latest)) {
+            latest = ostsl_deadline[i] + ostsl_slack[i];
+        }
+    }
+
+    OS_ENTER_CRITICAL(sr);
+    now = os_time_get();
+    wakeup = now + os_sched_wakeup_slack_ticks(now);
+    OS_EXIT_CRITICAL(sr);
+
+    TEST_ASSERT(OS_TIME_TICK_GEQ(wakeup, earliest),
+                "wakeup %lu before first deadline %lu",
+                (unsigned long)wakeup, (unsigned long)earliest);
+    TEST_ASSERT(OS_TIME_TICK_GEQ(latest, wakeup),
+                "wakeup %lu past the slack of a task (%lu)",
+                (unsigned long)wakeup, (unsigned long)latest);
+
+    return latest == wakeup;
+}
+
+/* Waits for tasks 'first' up to 'last' and checks none woke up early. */
+static void
+ostsl_wait(int first, int last)
+{
+    int rc;
+    int i;
+
+    for (i = first; i < last; i++) {
+        rc = os_sem_pend(&ostsl_sem, OS_TIMEOUT_NEVER);
+        TEST_ASSERT_FATAL(rc == 0);
+    }
+    for (i = first; i < last; i++) {
+        TEST_ASSERT(OS_TIME_TICK_GEQ(ostsl_woke[i], ostsl_deadline[i]),
+                    "task %d woke at %lu, deadline %lu", i,
+                    (unsigned long)ostsl_woke[i],
+                    (unsigned long)ostsl_deadline[i]);
+    }
+}
+#endif
+
+/**
+ * Tests that the idle task sleeps until the latest tick that honours the
+ * slack of every sleeping task, both when all of them are looked at and
+ * when there are more than os_sched_wakeup_slack_ticks() searches, and that
+ * no task is woken before its deadline.
+ */
+TEST_CASE_TASK(os_sched_test_slack)
+{
+#if MYNEWT_VAL(OS_TIMER_SLACK)
+    int rc;
+    int i;
+
+    rc = os_sem_init(&ostsl_sem, 0);
+    TEST_ASSERT_FATAL(rc == 0);
+
+    /* Windows [10, 30], [15, 20], [25, 25] and [40, 140]: wake up at 20. */
+    ostsl_delay[0] = 10;
+    ostsl_slack[0] = 20;
+    ostsl_delay[1] = 15;
+    ostsl_slack[1] = 5;
+    ostsl_delay[2] = 25;
+    ostsl_slack[2] = 0;
+    ostsl_delay[3] = 40;
+    ostsl_slack[3] = 100;
+
+    ostsl_start(0, OSTSL_FEW);
+    TEST_ASSERT(ostsl_check(0, OSTSL_FEW) != 0);
+    ostsl_wait(0, OSTSL_FEW);
+
+    /*
+     * One task with a wide window, then more tasks inside it than the
+     * search looks at; the answer may be earlier, but never late.
+     */
+    ostsl_delay[OSTSL_FEW] = 10;
+    ostsl_slack[OSTSL_FEW] = 100;
+    for (i = OSTSL_FEW + 1; i < OSTSL_NUM_TASKS; i++) {
+        ostsl_delay[i] = 10 + i - OSTSL_FEW;
+        ostsl_slack[i] = 50;
+    }
+
+    ostsl_start(OSTSL_FEW, OSTSL_NUM_TASKS);
+    ostsl_check(OSTSL_FEW, OSTSL_NUM_TASKS);
+    ostsl_wait(OSTSL_FEW, OSTSL_NUM_TASKS);
+#endif
+}
@@ -0,0 +1,157 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os/mynewt.h"
+#include "runtest/runtest.h"
+#include "os_test_priv.h"
+#include "sem_test.h"
+
+#define OSTPU_TIMER_USECS   MYNEWT_VAL(OS_CPUTIME_SLEEP_TIMER_USECS)
+/* Lateness allowed on a wakeup: the sim only fires timers on an OS tick. */
+#define OSTPU_LATE_USECS    (3 * 1000000 / OS_TICKS_PER_SEC)
+
+/* More than INT32_MAX cputime ticks at the test's 1 MHz OS_CPUTIME_FREQ. */
+#define OSTPU_LONG_USECS    ((uint32_t)INT32_MAX + 1000000)
+/* How far the warp task pushes the OS clock on each of its ticks. */
+#define OSTPU_WARP_SECS     16
+
+static os_time_t ostpu_release_delay;
+static volatile int ostpu_warp_done;
+
+/* Releases g_sem1 once, ostpu_release_delay ticks after being started. */
+static void
+ostpu_release_handler(void *arg)
+{
+    os_time_delay(ostpu_release_delay);
+    os_sem_release(&g_sem1);
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/* Starts a higher priority task which releases g_sem1 after 'ms'. */
+static void
+ostpu_release_after(uint32_t ms, uint8_t prio)
+{
+    ostpu_release_delay = os_time_ms_to_ticks32(ms);
+    runtest_init_task(ostpu_release_handler, prio);
+}
+
+/*
+ * Runs the OS clock OSTPU_WARP_SECS ahead on every tick until
+ * ostpu_warp_done is set, so that a timeout of more than half an hour of
+ * cputime runs out in a second or two.
+ */
+static void
+ostpu_warp_handler(void *arg)
+{
+    while (!ostpu_warp_done) {
+        os_time_delay(1);
+        os_time_advance(OSTPU_WARP_SECS * OS_TICKS_PER_SEC);
+    }
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/* Pends on g_sem1 for 'usecs'; returns the time it actually waited. */
+static uint32_t
+ostpu_pend(uint32_t usecs, os_error_t expected)
+{
+    uint32_t start;
+    os_error_t err;
+
+    start = os_cputime_get32();
+    err = os_sem_pend_usecs(&g_sem1, usecs);
+    TEST_ASSERT(err == expected, "err=%d expected=%d", err, expected);
+
+    return os_cputime_ticks_to_usecs(os_cputime_get32() - start);
+}
+
+/**
+ * Tests os_sem_pend_usecs(): timeouts and releases both while the task waits
+ * on the OS tick and while it waits on the cputime timer, and a timeout too
+ * long to be expressed as a cputime deadline.
+ */
+TEST_CASE_TASK(os_sem_test_pend_usecs)
+{
+    uint32_t waited;
+    os_time_t start;
+
+    /*
+     * The native BSP leaves cputime to the application.  This also re-creates
+     * the native timer task if an earlier case restarted the OS.
+     */
+    os_cputime_init(MYNEWT_VAL(OS_CPUTIME_FREQ));
+
+    os_sem_init(&g_sem1, 1);
+
+    /* A free token is taken without waiting; a timeout of 0 never waits. */
+    waited = ostpu_pend(1000000, OS_OK);
+    TEST_ASSERT(waited < OSTPU_LATE_USECS);
+    waited = ostpu_pend(0, OS_TIMEOUT);
+    TEST_ASSERT(waited < OSTPU_LATE_USECS);
+
+    /* Timeout on the cputime timer only. */
+    waited = ostpu_pend(OSTPU_TIMER_USECS / 2, OS_TIMEOUT);
+    TEST_ASSERT(waited >= OSTPU_TIMER_USECS / 2);
+    TEST_ASSERT(waited <= OSTPU_TIMER_USECS / 2 + OSTPU_LATE_USECS);
+
+    /* Timeout after waiting on the OS tick, then on the cputime timer. */
+    waited = ostpu_pend(OSTPU_TIMER_USECS * 4, OS_TIMEOUT);
+    TEST_ASSERT(waited >= OSTPU_TIMER_USECS * 4);
+    TEST_ASSERT(waited <= OSTPU_TIMER_USECS * 4 + OSTPU_LATE_USECS);
+
+    /* Released during the OS tick wait. */
+    ostpu_release_after(OSTPU_TIMER_USECS / 1000,
+                        MYNEWT_VAL(OS_MAIN_TASK_PRIO) - 1);
+    waited = ostpu_pend(1000000, OS_OK);
+    TEST_ASSERT(waited < 1000000 - OSTPU_TIMER_USECS);
+
+    /* Released during the cputime timer wait that follows the tick wait. */
+    ostpu_release_after(OSTPU_TIMER_USECS * 3 / 2 / 1000,
+                        MYNEWT_VAL(OS_MAIN_TASK_PRIO) - 2);
+    waited = ostpu_pend(OSTPU_TIMER_USECS * 2, OS_OK);
+    TEST_ASSERT(waited < OSTPU_TIMER_USECS * 2);
+
+    /*
+     * The cputime timer was stopped on release: a full delay past the old
+     * deadline is not cut short by it.
+     */
+    start = os_time_get();
+    os_time_delay(os_time_ms_to_ticks32(OSTPU_TIMER_USECS * 2 / 1000));
+    TEST_ASSERT(os_time_get() - start >=
+                os_time_ms_to_ticks32(OSTPU_TIMER_USECS * 2 / 1000));
+
+    /*
+     * A timeout of 2^31 cputime ticks or more is waited out in full, not
+     * taken as a deadline that has already passed.
+     */
+    TEST_ASSERT_FATAL(os_cputime_usecs_to_ticks(OSTPU_LONG_USECS) > INT32_MAX);
+    ostpu_warp_done = 0;
+    runtest_init_task(ostpu_warp_handler, MYNEWT_VAL(OS_MAIN_TASK_PRIO) - 3);
+    waited = ostpu_pend(OSTPU_LONG_USECS, OS_TIMEOUT);
+    ostpu_warp_done = 1;
+    TEST_ASSERT(waited >= OSTPU_LONG_USECS, "waited %u usecs",
+                (unsigned)waited);
+    TEST_ASSERT(waited <= OSTPU_LONG_USECS + OSTPU_WARP_SECS * 1000000 +
+                          OSTPU_LATE_USECS, "waited %u usecs",
+                (unsigned)waited);
+}
@@ -0,0 +1,70 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os_test_priv.h"
+
+/* Advances the OS time by 'ticks', which may be more than INT32_MAX. */
+static void
+ottg_advance(uint32_t ticks)
+{
+    uint32_t step;
+
+    while (ticks > 0) {
+        step = min(ticks, INT32_MAX);
+        os_time_advance(step);
+        ticks -= step;
+    }
+}
+
+TEST_CASE(os_time_test_get64)
+{
+    uint64_t ticks;
+    uint64_t usecs;
+    uint32_t to_wrap;
+    int i;
+
+    ticks = os_time_get64();
+    usecs = os_time_get_usec64();
+    TEST_ASSERT((uint32_t)ticks == os_time_get());
+
+    /* Advance by one second in uneven steps. */
+    for (i = 0; i < OS_TICKS_PER_SEC; i += 3) {
+        os_time_advance(min(3, OS_TICKS_PER_SEC - i));
+    }
+
+    TEST_ASSERT(os_time_get64() - ticks == OS_TICKS_PER_SEC);
+    TEST_ASSERT(os_time_get_usec64() - usecs == 1000000);
+    TEST_ASSERT((uint32_t)os_time_get64() == os_time_get());
+
+    /* Run the 32-bit tick counter up to its last value... */
+    ticks = os_time_get64();
+    usecs = os_time_get_usec64();
+    to_wrap = UINT32_MAX - os_time_get();
+    ottg_advance(to_wrap);
+    TEST_ASSERT(os_time_get() == UINT32_MAX);
+    TEST_ASSERT(os_time_get64() == ticks + to_wrap);
+
+    /* ...and across the wrap; the 64-bit counters keep counting up. */
+    os_time_advance(2);
+    TEST_ASSERT(os_time_get() == 1);
+    TEST_ASSERT(os_time_get64() == ticks + to_wrap + 2);
+    TEST_ASSERT(os_time_get64() >> 32 == (ticks >> 32) + 1);
+    TEST_ASSERT(os_time_get_usec64() - usecs ==
+                ((ticks + to_wrap + 2) * 1000000 / OS_TICKS_PER_SEC) -
+                (ticks * 1000000 / OS_TICKS_PER_SEC));
+}
@@ -0,0 +1,98 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os/mynewt.h"
+#include "runtest/runtest.h"
+#include "os_test_priv.h"
+
+#define OTTSO_NUM_TASKS     4
+#define OTTSO_PRIO          (MYNEWT_VAL(OS_MAIN_TASK_PRIO) + 2)
+
+/* Task 2 pends on a semaphore instead and is released after this long. */
+#define OTTSO_RELEASE_TICKS 15
+
+/* Ticks each helper task sleeps for; all start sleeping on the same tick. */
+static const os_time_t ottso_delay[OTTSO_NUM_TASKS] = { 30, 10, 40, 20 };
+
+static struct os_sem ottso_sem;
+static os_time_t ottso_start[OTTSO_NUM_TASKS];
+static os_time_t ottso_woke[OTTSO_NUM_TASKS];
+static int ottso_order[OTTSO_NUM_TASKS];
+static int ottso_num_woke;
+
+static void
+ottso_handler(void *arg)
+{
+    os_error_t err;
+    int idx;
+
+    idx = os_sched_get_current_task()->t_prio - OTTSO_PRIO;
+
+    ottso_start[idx] = os_time_get();
+    if (idx == 2) {
+        err = os_sem_pend(&ottso_sem, ottso_delay[idx]);
+        TEST_ASSERT(err == OS_OK);
+    } else {
+        os_time_delay(ottso_delay[idx]);
+    }
+    ottso_woke[idx] = os_time_get();
+    ottso_order[ottso_num_woke++] = idx;
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+/**
+ * Tests that tasks sleeping with a timeout wake up in deadline order, and
+ * that a task woken early is taken out of the middle of the sleep list
+ * (or heap, with OS_SCHED_SLEEP_HEAP) without disturbing the others.
+ */
+TEST_CASE_TASK(os_time_test_sleep_order)
+{
+    static const int expected[OTTSO_NUM_TASKS] = { 1, 2, 3, 0 };
+    int i;
+
+    os_sem_init(&ottso_sem, 0);
+    ottso_num_woke = 0;
+
+    /* Lower priority than this task: they start once it sleeps. */
+    for (i = 0; i < OTTSO_NUM_TASKS; i++) {
+        runtest_init_task(ottso_handler, OTTSO_PRIO + i);
+    }
+
+    os_time_delay(OTTSO_RELEASE_TICKS);
+    os_sem_release(&ottso_sem);
+    os_time_delay(50 - OTTSO_RELEASE_TICKS);
+
+    TEST_ASSERT_FATAL(ottso_num_woke == OTTSO_NUM_TASKS,
+                      "%d tasks woke", ottso_num_woke);
+    for (i = 0; i < OTTSO_NUM_TASKS; i++) {
+        TEST_ASSERT(ottso_order[i] == expected[i],
+                    "wakeup %d was task %d", i, ottso_order[i]);
+    }
+
+    for (i = 0; i < OTTSO_NUM_TASKS; i++) {
+        if (i == 2) {
+            TEST_ASSERT(ottso_woke[i] - ottso_start[i] <
+                        ottso_delay[i]);
+        } else {
+            TEST_ASSERT(ottso_woke[i] - ottso_start[i] >= ottso_delay[i]);
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "runtest/runtest.h"
+#include "os_test_priv.h"
+
+/* Lateness allowed on a wakeup: the sim only fires timers on an OS tick. */
+#define OTTS_LATE_USECS     (3 * 1000000 / OS_TICKS_PER_SEC)
+/* How far the warp task pushes the OS clock on each of its ticks. */
+#define OTTS_WARP_SECS      16
+
+static volatile int otts_warp_done;
+
+/*
+ * Runs the OS clock OTTS_WARP_SECS ahead on every tick until otts_warp_done
+ * is set, so that a sleep of more than 2^31 cputime ticks ends in a second or
+ * two.
+ */
+static void
+otts_warp_handler(void *arg)
+{
+    while (!otts_warp_done) {
+        os_time_delay(1);
+        os_time_advance(OTTS_WARP_SECS * OS_TICKS_PER_SEC);
+    }
+
+    while (1) {
+        os_time_delay(OS_TIMEOUT_NEVER);
+    }
+}
+
+static void
+otts_sleep(uint32_t usecs)
+{
+    uint32_t start;
+    uint32_t elapsed;
+
+    start = os_cputime_get32();
+    os_cputime_sleep_usecs(usecs);
+    elapsed = os_cputime_ticks_to_usecs(os_cputime_get32() - start);
+
+    TEST_ASSERT(elapsed >= usecs, "woke after %u of %u usecs",
+                (unsigned)elapsed, (unsigned)usecs);
+    TEST_ASSERT(elapsed <= usecs + OTTS_LATE_USECS,
+                "woke after %u of %u usecs",
+                (unsigned)elapsed, (unsigned)usecs);
+}
+
+/**
+ * Tests that os_cputime_sleep_usecs() sleeps for the requested time, both
+ * when it only needs the cputime timer and when it first sleeps on the OS
+ * tick, and that os_cputime_sleep_ticks() handles delays of 2^31 ticks or
+ * more.
+ */
+TEST_CASE_TASK(os_time_test_sleep_usecs)
+{
+    uint32_t start;
+    uint32_t elapsed;
+    uint32_t ticks;
+
+    /*
+     * The native BSP leaves cputime to the application.  This also re-creates
+     * the native timer task if an earlier case restarted the OS.
+     */
+    os_cputime_init(MYNEWT_VAL(OS_CPUTIME_FREQ));
+
+    /* Within OS_CPUTIME_SLEEP_TIMER_USECS: cputime timer only. */
+    otts_sleep(MYNEWT_VAL(OS_CPUTIME_SLEEP_TIMER_USECS) / 2);
+    otts_sleep(MYNEWT_VAL(OS_CPUTIME_SLEEP_TIMER_USECS));
+
+    /* Longer: OS tick first, then the cputime timer for the rest. */
+    otts_sleep(MYNEWT_VAL(OS_CPUTIME_SLEEP_TIMER_USECS) * 5 / 2);
+    otts_sleep(200000);
+
+    /* A delay that is already over returns without sleeping. */
+    os_cputime_sleep_usecs(0);
+
+    /*
+     * A delay of 2^31 ticks or more is slept in full, not taken as a deadline
+     * that has already passed.
+     */
+    otts_warp_done = 0;
+    runtest_init_task(otts_warp_handler, MYNEWT_VAL(OS_MAIN_TASK_PRIO) - 1);
+    ticks = (uint32_t)INT32_MAX + os_cputime_usecs_to_ticks(1000000);
+    start = os_cputime_get32();
+    os_cputime_sleep_ticks(ticks);
+    elapsed = os_cputime_get32() - start;
+    otts_warp_done = 1;
+    TEST_ASSERT(elapsed >= ticks, "woke after %u of %u ticks",
+                (unsigned)elapsed, (unsigned)ticks);
+    TEST_ASSERT(elapsed <= ticks +
+                os_cputime_usecs_to_ticks(OTTS_WARP_SECS * 1000000 +
+                                          OTTS_LATE_USECS),
+                "woke after %u of %u ticks",
+                (unsigned)elapsed, (unsigned)ticks);
+}
@@ -24,4 +24,7 @@
 TEST_SUITE(os_time_test_suite)
 {
     os_time_test_change();
+    os_time_test_get64();
+    os_time_test_sleep_order();
+    os_time_test_sleep_usecs();
 }
@@ -243,8 +243,7 @@ sim_os_init(void)
     g_current_task = NULL;
 
     STAILQ_INIT(&g_os_task_list);
-    TAILQ_INIT(&g_os_run_list);
-    TAILQ_INIT(&g_os_sleep_list);
+    os_sched_init();
 
     sim_signals_init();
 
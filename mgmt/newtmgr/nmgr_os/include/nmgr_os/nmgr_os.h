@@ -33,6 +33,7 @@ extern "C" {
 #define NMGR_ID_MPSTATS         3
 #define NMGR_ID_DATETIME_STR    4
 #define NMGR_ID_RESET           5
+#define NMGR_ID_MPTRACE         6
 
 int nmgr_os_groups_register(void);
 
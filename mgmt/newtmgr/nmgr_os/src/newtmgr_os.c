@@ -48,6 +48,9 @@ static int nmgr_def_mpstat_read(struct mgmt_cbuf *njb);
 static int nmgr_datetime_get(struct mgmt_cbuf *njb);
 static int nmgr_datetime_set(struct mgmt_cbuf *njb);
 static int nmgr_reset(struct mgmt_cbuf *njb);
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+static int nmgr_def_mptrace_read(struct mgmt_cbuf *njb);
+#endif
 
 static const struct mgmt_handler nmgr_def_group_handlers[] = {
     [NMGR_ID_ECHO] = {
@@ -68,6 +71,11 @@ static const struct mgmt_handler nmgr_def_group_handlers[] = {
     [NMGR_ID_RESET] = {
         NULL, nmgr_reset
     },
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+    [NMGR_ID_MPTRACE] = {
+        nmgr_def_mptrace_read, NULL
+    },
+#endif
 };
 
 #define NMGR_DEF_GROUP_SZ                                               \
@@ -136,6 +144,37 @@ nmgr_def_console_echo(struct mgmt_cbuf *cb)
     return (0);
 }
 
+#if MYNEWT_VAL(OS_TASK_PROF)
+/**
+ * Encodes the profiling data of one task.  Times are in os_cputime ticks.
+ */
+static CborError
+nmgr_def_taskstat_prof_encode(CborEncoder *task,
+                              const struct os_task_prof *prof)
+{
+    CborError g_err = CborNoError;
+    CborEncoder hist;
+    int i;
+
+    g_err |= cbor_encode_text_stringz(task, "run_cputime");
+    g_err |= cbor_encode_uint(task, prof->otp_run_time);
+    g_err |= cbor_encode_text_stringz(task, "isr_cputime");
+    g_err |= cbor_encode_uint(task, prof->otp_isr_time);
+    g_err |= cbor_encode_text_stringz(task, "preempt");
+    g_err |= cbor_encode_uint(task, prof->otp_preempt_cnt);
+    g_err |= cbor_encode_text_stringz(task, "lat_max");
+    g_err |= cbor_encode_uint(task, prof->otp_lat_max);
+    g_err |= cbor_encode_text_stringz(task, "lat_hist");
+    g_err |= cbor_encoder_create_array(task, &hist, OS_TASK_PROF_LAT_BUCKETS);
+    for (i = 0; i < OS_TASK_PROF_LAT_BUCKETS; i++) {
+        g_err |= cbor_encode_uint(&hist, prof->otp_lat_hist[i]);
+    }
+    g_err |= cbor_encoder_close_container(task, &hist);
+
+    return g_err;
+}
+#endif
+
 static int
 nmgr_def_taskstat_read(struct mgmt_cbuf *cb)
 {
@@ -178,6 +217,9 @@ nmgr_def_taskstat_read(struct mgmt_cbuf *cb)
         g_err |= cbor_encode_uint(&task, oti.oti_last_checkin);
         g_err |= cbor_encode_text_stringz(&task, "next_checkin");
         g_err |= cbor_encode_uint(&task, oti.oti_next_checkin);
+#if MYNEWT_VAL(OS_TASK_PROF)
+        g_err |= nmgr_def_taskstat_prof_encode(&task, &oti.oti_prof);
+#endif
         g_err |= cbor_encoder_close_container(&tasks, &task);
     }
     g_err |= cbor_encoder_close_container(&cb->encoder, &tasks);
@@ -231,6 +273,69 @@ nmgr_def_mpstat_read(struct mgmt_cbuf *cb)
     return (0);
 }
 
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+/**
+ * Reports the owners of the longest held blocks of each mempool.  "addr" is
+ * the address of the code that allocated the block, whether it called
+ * os_memblock_get() or one of the mbuf/msys allocators; "age" is in
+ * milliseconds.
+ */
+static int
+nmgr_def_mptrace_read(struct mgmt_cbuf *cb)
+{
+    struct os_memblock_owner owners[MYNEWT_VAL(OS_MEMPOOL_TRACE_OLDEST)];
+    struct os_mempool *prev_mp;
+    struct os_mempool_info omi;
+    CborError g_err = CborNoError;
+    CborEncoder pools;
+    CborEncoder blocks;
+    CborEncoder block;
+    os_time_t now;
+    int num;
+    int i;
+
+    g_err |= cbor_encode_text_stringz(&cb->encoder, "rc");
+    g_err |= cbor_encode_int(&cb->encoder, MGMT_ERR_EOK);
+    g_err |= cbor_encode_text_stringz(&cb->encoder, "mpools");
+    g_err |= cbor_encoder_create_map(&cb->encoder, &pools,
+                                     CborIndefiniteLength);
+
+    prev_mp = NULL;
+    while (1) {
+        prev_mp = os_mempool_info_get_next(prev_mp, &omi);
+        if (prev_mp == NULL) {
+            break;
+        }
+
+        num = os_mempool_trace_oldest(prev_mp, owners,
+                                      MYNEWT_VAL(OS_MEMPOOL_TRACE_OLDEST));
+        now = os_time_get();
+
+        g_err |= cbor_encode_text_stringz(&pools, omi.omi_name);
+        g_err |= cbor_encoder_create_array(&pools, &blocks, num);
+        for (i = 0; i < num; i++) {
+            g_err |= cbor_encoder_create_map(&blocks, &block,
+                                             CborIndefiniteLength);
+            g_err |= cbor_encode_text_stringz(&block, "addr");
+            g_err |= cbor_encode_uint(&block,
+                                      (uintptr_t)owners[i].omo_addr);
+            g_err |= cbor_encode_text_stringz(&block, "age");
+            g_err |= cbor_encode_uint(&block, os_time_ticks_to_ms32(
+                                          now - owners[i].omo_time));
+            g_err |= cbor_encoder_close_container(&blocks, &block);
+        }
+        g_err |= cbor_encoder_close_container(&pools, &blocks);
+    }
+
+    g_err |= cbor_encoder_close_container(&cb->encoder, &pools);
+
+    if (g_err) {
+        return MGMT_ERR_ENOMEM;
+    }
+    return (0);
+}
+#endif
+
 static int
 nmgr_datetime_get(struct mgmt_cbuf *cb)
 {
@@ -81,6 +81,78 @@ shell_os_tasks_display_cmd(int argc, char **argv)
     return 0;
 }
 
+#if MYNEWT_VAL(OS_TASK_PROF)
+static unsigned long
+shell_os_cputime_to_ms(uint64_t ticks)
+{
+    return (unsigned long)(ticks * 1000 / MYNEWT_VAL(OS_CPUTIME_FREQ));
+}
+
+int
+shell_os_taskprof_display_cmd(int argc, char **argv)
+{
+    struct os_task *prev_task;
+    struct os_task_info oti;
+    char *name;
+    int found;
+    int i;
+
+    name = NULL;
+    found = 0;
+
+    if (argc > 1 && strcmp(argv[1], "")) {
+        if (!strcmp(argv[1], "reset")) {
+            os_task_prof_reset();
+            return 0;
+        }
+        name = argv[1];
+    }
+
+    console_printf("isr time: %lu ms\n",
+                   shell_os_cputime_to_ms(os_task_prof_isr_time()));
+    console_printf("%8s %8s %8s %8s %8s\n",
+                   "task", "run(ms)", "isr(ms)", "preempt", "maxlat");
+    prev_task = NULL;
+    while (1) {
+        prev_task = os_task_info_get_next(prev_task, &oti);
+        if (prev_task == NULL) {
+            break;
+        }
+
+        if (name) {
+            if (strcmp(name, oti.oti_name)) {
+                continue;
+            } else {
+                found = 1;
+            }
+        }
+
+        console_printf("%8s %8lu %8lu %8lu %8lu\n", oti.oti_name,
+                shell_os_cputime_to_ms(oti.oti_prof.otp_run_time),
+                shell_os_cputime_to_ms(oti.oti_prof.otp_isr_time),
+                (unsigned long)oti.oti_prof.otp_preempt_cnt,
+                (unsigned long)oti.oti_prof.otp_lat_max);
+
+        /* Latency histogram only for a single task. */
+        if (name) {
+            for (i = 0; i < OS_TASK_PROF_LAT_BUCKETS - 1; i++) {
+                console_printf("  lat < %lu: %lu\n", 1UL << i,
+                               (unsigned long)oti.oti_prof.otp_lat_hist[i]);
+            }
+            /* The last bucket also counts everything longer. */
+            console_printf("  lat >= %lu: %lu\n", 1UL << (i - 1),
+                           (unsigned long)oti.oti_prof.otp_lat_hist[i]);
+        }
+    }
+
+    if (name && !found) {
+        console_printf("Couldn't find task with name %s\n", name);
+    }
+
+    return 0;
+}
+#endif
+
 int
 shell_os_mpool_display_cmd(int argc, char **argv)
 {
@@ -127,6 +199,63 @@ shell_os_mpool_display_cmd(int argc, char **argv)
     return 0;
 }
 
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+int
+shell_os_mptrace_display_cmd(int argc, char **argv)
+{
+    struct os_memblock_owner owners[MYNEWT_VAL(OS_MEMPOOL_TRACE_OLDEST)];
+    struct os_mempool *mp;
+    struct os_mempool_info omi;
+    os_time_t now;
+    char *name;
+    int found;
+    int num;
+    int i;
+
+    name = NULL;
+    found = 0;
+
+    if (argc > 1 && strcmp(argv[1], "")) {
+        name = argv[1];
+    }
+
+    console_printf("Oldest mempool blocks: \n");
+    console_printf("%32s %10s %8s\n", "name", "owner", "age(ms)");
+    mp = NULL;
+    while (1) {
+        mp = os_mempool_info_get_next(mp, &omi);
+        if (mp == NULL) {
+            break;
+        }
+
+        if (name) {
+            if (strcmp(name, omi.omi_name)) {
+                continue;
+            } else {
+                found = 1;
+            }
+        }
+
+        num = os_mempool_trace_oldest(mp, owners,
+                                      MYNEWT_VAL(OS_MEMPOOL_TRACE_OLDEST));
+        now = os_time_get();
+        for (i = 0; i < num; i++) {
+            console_printf("%32s 0x%08lx %8lu\n", omi.omi_name,
+                           (unsigned long)(uintptr_t)owners[i].omo_addr,
+                           (unsigned long)os_time_ticks_to_ms32(
+                               now - owners[i].omo_time));
+        }
+    }
+
+    if (name && !found) {
+        console_printf("Couldn't find a memory pool with name %s\n",
+                name);
+    }
+
+    return 0;
+}
+#endif
+
 int
 shell_os_date_cmd(int argc, char **argv)
 {
@@ -185,6 +314,20 @@ static const struct shell_cmd_help tasks_help = {
     .params = tasks_params,
 };
 
+#if MYNEWT_VAL(OS_TASK_PROF)
+static const struct shell_param taskprof_params[] = {
+    {"", "task name, shows latency histogram (in os_cputime ticks)"},
+    {"reset", "clear profiling data"},
+    {NULL, NULL}
+};
+
+static const struct shell_cmd_help taskprof_help = {
+    .summary = "show os task profiling data",
+    .usage = NULL,
+    .params = taskprof_params,
+};
+#endif
+
 static const struct shell_param mpool_params[] = {
     {"", "mpool name"},
     {NULL, NULL}
@@ -196,6 +339,14 @@ static const struct shell_cmd_help mpool_help = {
     .params = mpool_params,
 };
 
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+static const struct shell_cmd_help mptrace_help = {
+    .summary = "show owners of the oldest mpool blocks",
+    .usage = NULL,
+    .params = mpool_params,
+};
+#endif
+
 static const struct shell_param date_params[] = {
     {"", "datetime to set"},
     {NULL, NULL}
@@ -229,6 +380,15 @@ static const struct shell_cmd os_commands[] = {
         .help = &tasks_help,
 #endif
     },
+#if MYNEWT_VAL(OS_TASK_PROF)
+    {
+        .sc_cmd = "taskprof",
+        .sc_cmd_func = shell_os_taskprof_display_cmd,
+#if MYNEWT_VAL(SHELL_CMD_HELP)
+        .help = &taskprof_help,
+#endif
+    },
+#endif
     {
         .sc_cmd = "mpool",
         .sc_cmd_func = shell_os_mpool_display_cmd,
@@ -236,6 +396,15 @@ static const struct shell_cmd os_commands[] = {
         .help = &mpool_help,
 #endif
     },
+#if MYNEWT_VAL(OS_MEMPOOL_TRACE)
+    {
+        .sc_cmd = "mptrace",
+        .sc_cmd_func = shell_os_mptrace_display_cmd,
+#if MYNEWT_VAL(SHELL_CMD_HELP)
+        .help = &mptrace_help,
+#endif
+    },
+#endif
     {
         .sc_cmd = "date",
         .sc_cmd_func = shell_os_date_cmd,
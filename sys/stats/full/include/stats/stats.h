@@ -116,6 +116,7 @@ const struct stats_name_map STATS_NAME_MAP_NAME(__sectname)[] = {
 int stats_init(struct stats_hdr *shdr, uint8_t size, uint8_t cnt,
     const struct stats_name_map *map, uint8_t map_cnt);
 int stats_register(char *name, struct stats_hdr *shdr);
+int stats_deregister(struct stats_hdr *shdr);
 int stats_init_and_reg(struct stats_hdr *shdr, uint8_t size, uint8_t cnt,
                        const struct stats_name_map *map, uint8_t map_cnt,
                        char *name);
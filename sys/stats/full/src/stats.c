@@ -315,6 +315,34 @@ err:
     return (rc);
 }
 
+/**
+ * Remove the statistics pointed to by shdr from the statistic map.  The
+ * section can be registered again afterwards, under the same or another name.
+ *
+ * @param shdr The statistics header to remove.
+ *
+ * @return 0 on success, non-zero error code if shdr is not registered.
+ */
+int
+stats_deregister(struct stats_hdr *shdr)
+{
+    struct stats_hdr *cur;
+
+    STAILQ_FOREACH(cur, &g_stats_registry, s_next) {
+        if (cur == shdr) {
+            break;
+        }
+    }
+
+    if (cur == NULL) {
+        return (-1);
+    }
+
+    STAILQ_REMOVE(&g_stats_registry, shdr, stats_hdr, s_next);
+
+    return (0);
+}
+
 /**
  * Initializes and registers the specified statistics section.
  *
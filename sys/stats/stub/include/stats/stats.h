@@ -73,6 +73,7 @@ struct stats_hdr {
 
 #define stats_init(...) 0
 #define stats_register(name, shdr) 0
+#define stats_deregister(shdr) 0
 #define stats_init_and_reg(...) 0
 #define stats_reset(shdr)
 
@@ -88,6 +88,15 @@ struct ts_suite {
 SLIST_HEAD(ts_testsuite_list, ts_suite);
 extern struct ts_testsuite_list g_ts_suites;
 
+/*
+ * Initializer for an array entry passed to tu_suite_run_parallel().
+ */
+#define TEST_SUITE_ENTRY(suite_name)                         \
+    { .ts_name = #suite_name, .ts_test = (tu_testsuite_fn_t *)suite_name }
+
+int tu_suite_run_parallel(const struct ts_suite *suites, int num_suites,
+                          int jobs);
+
 struct ts_config {
     int ts_print_results;
     int ts_system_assert;
@@ -0,0 +1,232 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "os/mynewt.h"
+#include "testutil/testutil.h"
+#include "testutil_priv.h"
+
+#if MYNEWT_VAL(SELFTEST)
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/*
+ * Each suite runs in its own forked copy of the sim.  The simulated OS keeps
+ * its state in globals and drives the scheduler with signals, so OS instances
+ * cannot share a process; a fork gives every suite a private instance for
+ * free.  Child output goes to a temporary file that the parent copies to
+ * stdout when the child exits, so reports from concurrent suites do not
+ * interleave.
+ */
+struct tu_parallel_job {
+    pid_t tpj_pid;
+    FILE *tpj_out;
+};
+
+static int
+tu_parallel_jobs_dflt(void)
+{
+    long ncpu;
+
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1) {
+        return 1;
+    }
+    return ncpu;
+}
+
+static int
+tu_parallel_start(const struct ts_suite *suite, struct tu_parallel_job *job)
+{
+    pid_t pid;
+    FILE *out;
+
+    out = tmpfile();
+    if (out == NULL) {
+        return -1;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+    if (pid < 0) {
+        fclose(out);
+        return -1;
+    }
+
+    if (pid == 0) {
+        dup2(fileno(out), STDOUT_FILENO);
+        dup2(fileno(out), STDERR_FILENO);
+        /* Keep the output of a suite that crashes. */
+        setvbuf(stdout, NULL, _IONBF, 0);
+
+        tu_any_failed = 0;
+        suite->ts_test();
+
+        fflush(stdout);
+        fflush(stderr);
+        _exit(tu_any_failed);
+    }
+
+    job->tpj_pid = pid;
+    job->tpj_out = out;
+    return 0;
+}
+
+/**
+ * Copies the output of a finished child to stdout and returns whether the
+ * suite failed.
+ */
+static int
+tu_parallel_finish(const struct ts_suite *suite, struct tu_parallel_job *job,
+                   int status)
+{
+    char buf[256];
+    size_t len;
+    int failed;
+
+    rewind(job->tpj_out);
+    while ((len = fread(buf, 1, sizeof buf, job->tpj_out)) > 0) {
+        fwrite(buf, 1, len, stdout);
+    }
+    fclose(job->tpj_out);
+    job->tpj_out = NULL;
+    job->tpj_pid = 0;
+
+    if (WIFEXITED(status)) {
+        failed = WEXITSTATUS(status) != 0;
+    } else {
+        failed = 1;
+        if (WIFSIGNALED(status)) {
+            printf("[FAIL] %s: terminated by signal %d\n",
+                   suite->ts_name, WTERMSIG(status));
+        }
+    }
+    fflush(stdout);
+
+    return failed;
+}
+
+static int
+tu_parallel_fork(const struct ts_suite *suites, int num_suites, int jobs)
+{
+    struct tu_parallel_job *job;
+    int num_running;
+    int num_failed;
+    int status;
+    pid_t pid;
+    int next;
+    int i;
+
+    job = calloc(num_suites, sizeof *job);
+    if (job == NULL) {
+        return -1;
+    }
+
+    num_running = 0;
+    num_failed = 0;
+    next = 0;
+    while (next < num_suites || num_running > 0) {
+        while (next < num_suites && num_running < jobs) {
+            if (tu_parallel_start(&suites[next], &job[next]) != 0) {
+                /* Out of resources; run it in this process instead. */
+                tu_any_failed = 0;
+                suites[next].ts_test();
+                num_failed += tu_any_failed;
+            } else {
+                num_running++;
+            }
+            next++;
+        }
+
+        if (num_running == 0) {
+            continue;
+        }
+
+        pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            perror("waitpid");
+            abort();
+        }
+
+        for (i = 0; i < next; i++) {
+            if (job[i].tpj_pid == pid) {
+                num_failed += tu_parallel_finish(&suites[i], &job[i], status);
+                num_running--;
+                break;
+            }
+        }
+    }
+
+    free(job);
+
+    printf("%d of %d test suites failed\n", num_failed, num_suites);
+
+    return num_failed;
+}
+#endif
+
+/**
+ * Runs a set of test suites, up to 'jobs' at a time.
+ *
+ * In the sim (SELFTEST) every suite runs in a separate process with its own
+ * OS instance, and the reports are printed one suite at a time as the suites
+ * complete.  On other targets, or if jobs is 1, the suites run one after
+ * another in the calling process.
+ *
+ * @param suites                The suites to run.
+ * @param num_suites            The number of entries in 'suites'.
+ * @param jobs                  Maximum number of suites running at once;
+ *                                  0 means one per host CPU.
+ *
+ * @return                      0 if every suite passed, 1 otherwise.
+ */
+int
+tu_suite_run_parallel(const struct ts_suite *suites, int num_suites, int jobs)
+{
+    int i;
+#if MYNEWT_VAL(SELFTEST)
+    int rc;
+
+    if (jobs == 0) {
+        jobs = tu_parallel_jobs_dflt();
+    }
+
+    if (jobs > 1 && num_suites > 1) {
+        rc = tu_parallel_fork(suites, num_suites, jobs);
+        if (rc > 0) {
+            tu_any_failed = 1;
+        }
+        if (rc >= 0) {
+            return tu_any_failed;
+        }
+    }
+#endif
+
+    for (i = 0; i < num_suites; i++) {
+        suites[i].ts_test();
+    }
+
+    return tu_any_failed;
+}
@@ -0,0 +1,114 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <stdlib.h>
+#include "testutil_test_priv.h"
+
+/*
+ * Suites for tu_suite_run_parallel() to run in child processes: one passes,
+ * one fails an assertion and one crashes.
+ */
+TEST_CASE(tpt_case_pass)
+{
+    TEST_ASSERT(1);
+}
+
+TEST_CASE(tpt_case_fail)
+{
+    TEST_ASSERT(0, "expected failure");
+}
+
+TEST_CASE(tpt_case_crash)
+{
+    abort();
+}
+
+TEST_SUITE(tpt_suite_pass)
+{
+    tpt_case_pass();
+}
+
+TEST_SUITE(tpt_suite_fail)
+{
+    tpt_case_fail();
+}
+
+TEST_SUITE(tpt_suite_crash)
+{
+    tpt_case_crash();
+}
+
+static const struct ts_suite tpt_suites_pass[] = {
+    TEST_SUITE_ENTRY(tpt_suite_pass),
+    TEST_SUITE_ENTRY(tpt_suite_pass),
+    TEST_SUITE_ENTRY(tpt_suite_pass),
+};
+
+static const struct ts_suite tpt_suites_fail[] = {
+    TEST_SUITE_ENTRY(tpt_suite_pass),
+    TEST_SUITE_ENTRY(tpt_suite_fail),
+    TEST_SUITE_ENTRY(tpt_suite_pass),
+};
+
+static const struct ts_suite tpt_suites_crash[] = {
+    TEST_SUITE_ENTRY(tpt_suite_pass),
+    TEST_SUITE_ENTRY(tpt_suite_crash),
+    TEST_SUITE_ENTRY(tpt_suite_pass),
+};
+
+/*
+ * Runs the suites in forked children and returns the result.  The failure
+ * the runner records in tu_any_failed belongs to the child suites, not to
+ * this test case, so the caller's value is restored afterwards.
+ */
+static int
+tpt_run(const struct ts_suite *suites, int num_suites)
+{
+    int any_failed;
+    int rc;
+
+    any_failed = tu_any_failed;
+    tu_any_failed = 0;
+    rc = tu_suite_run_parallel(suites, num_suites, 2);
+    TEST_ASSERT(rc == tu_any_failed);
+    tu_any_failed = any_failed;
+
+    return rc;
+}
+
+/**
+ * Tests that the forked runner reports a suite that fails an assertion and
+ * a suite that crashes, and that the other suites still run.
+ */
+TEST_CASE(tu_parallel_test_report)
+{
+    int rc;
+
+    rc = tpt_run(tpt_suites_pass,
+                 sizeof tpt_suites_pass / sizeof tpt_suites_pass[0]);
+    TEST_ASSERT(rc == 0);
+
+    rc = tpt_run(tpt_suites_fail,
+                 sizeof tpt_suites_fail / sizeof tpt_suites_fail[0]);
+    TEST_ASSERT(rc == 1);
+
+    /* An in-process run of this set would take the test runner down too. */
+    rc = tpt_run(tpt_suites_crash,
+                 sizeof tpt_suites_crash / sizeof tpt_suites_crash[0]);
+    TEST_ASSERT(rc == 1);
+}
@@ -0,0 +1,45 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "os/mynewt.h"
+#include "testutil/testutil.h"
+#include "testutil_test_priv.h"
+
+#if MYNEWT_VAL(SELFTEST)
+TEST_CASE_DECL(tu_parallel_test_report)
+#endif
+
+TEST_SUITE(testutil_test_suite)
+{
+#if MYNEWT_VAL(SELFTEST)
+    tu_parallel_test_report();
+#endif
+}
+
+#if MYNEWT_VAL(SELFTEST)
+
+int
+main(int argc, char **argv)
+{
+    sysinit();
+
+    testutil_test_suite();
+    return tu_any_failed;
+}
+
+#endif